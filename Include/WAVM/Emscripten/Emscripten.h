@@ -27,10 +27,23 @@ namespace WAVM { namespace Emscripten {
 										  Runtime::Context* context,
 										  const IR::Module& module,
 										  Runtime::ModuleInstance* moduleInstance);
+
+	// Equivalent to the above, but reads the IR from a compiled module, so the caller doesn't need
+	// to keep its own copy of the IR.
+	EMSCRIPTEN_API Instance* instantiate(Runtime::Compartment* compartment,
+										 Runtime::ModuleConstRefParam module);
+	EMSCRIPTEN_API void initializeGlobals(Emscripten::Instance* instance,
+										  Runtime::Context* context,
+										  Runtime::ModuleConstRefParam module,
+										  Runtime::ModuleInstance* moduleInstance);
 	EMSCRIPTEN_API void injectCommandArgs(Emscripten::Instance* instance,
 										  const std::vector<const char*>& argStrings,
 										  std::vector<IR::Value>& outInvokeArgs);
 
+	// Allocates memory in the instance's memory from the same heap as the guest's sbrk, and returns
+	// its address. Throws an outOfMemory exception if the memory can't grow to fit it.
+	EMSCRIPTEN_API U32 allocateMemory(Emscripten::Instance* instance, U32 numBytes);
+
     EMSCRIPTEN_API void setGasLimit(Emscripten::Instance* instance, U64 gaslimit);
     EMSCRIPTEN_API U64 getGasUsed(Emscripten::Instance* instance);
 }}
@@ -46,4 +46,17 @@ namespace WAVM { namespace IR {
 		Uptr maxLabelsPerFunction = UINTPTR_MAX;
 		Uptr maxDataSegments = UINTPTR_MAX;
 	};
+
+	// The encodings that may be used for the operators in a module's function definitions.
+	enum class OperatorEncoding : U8
+	{
+		// Each operator is stored as a fixed-size OpcodeAndImm<Imm> struct. This is the fastest to
+		// decode, but is several times larger than the WebAssembly binary encoding.
+		fixed,
+
+		// Each operator is stored as a one or two byte opcode followed by its immediate's fields,
+		// with integer fields LEB128 encoded. This is about as compact as the WebAssembly binary
+		// encoding, but slower to decode.
+		compact,
+	};
 }}
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "WAVM/IR/IR.h"
@@ -11,9 +13,12 @@
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Mutex.h"
 
 namespace WAVM { namespace IR {
 	enum class Opcode : U16;
+	struct Module;
 
 	// An initializer expression: serialized like any other code, but only supports a few specific
 	// instructions.
@@ -88,13 +93,42 @@ namespace WAVM { namespace IR {
 
 	typedef InitializerExpressionBase<Uptr> InitializerExpression;
 
+	// A bool that is loaded and stored atomically, but that may still be copied, so the structs
+	// that contain it stay copyable aggregates. The copy isn't atomic with the rest of the struct.
+	struct AtomicBool
+	{
+		std::atomic<bool> value;
+
+		AtomicBool(bool inValue = false) : value(inValue) {}
+		AtomicBool(const AtomicBool& copyee) : value(copyee.value.load(std::memory_order_acquire))
+		{
+		}
+		AtomicBool& operator=(const AtomicBool& copyee)
+		{
+			value.store(copyee.value.load(std::memory_order_acquire), std::memory_order_release);
+			return *this;
+		}
+	};
+
 	// A function definition
 	struct FunctionDef
 	{
 		IndexedFunctionType type;
 		std::vector<ValueType> nonParameterLocalTypes;
-		std::vector<U8> code;
-		std::vector<std::vector<Uptr>> branchTables;
+
+		// The code and branch tables are mutable so a lazily loaded function definition may be
+		// materialized in a const module. See materializeFunctionDef.
+		mutable std::vector<U8> code;
+		mutable std::vector<std::vector<Uptr>> branchTables;
+
+		// If the module's function bodies were loaded lazily: whether the function's code and
+		// branch tables have yet to be decoded, and the range of the module's LazyFunctionBodies
+		// bytes to decode them from. isLazy is cleared with release semantics after the code and
+		// branch tables are written, so a thread that reads it as false with acquire semantics may
+		// read them without holding the LazyFunctionBodies mutex.
+		mutable AtomicBool isLazy;
+		Uptr lazyCodeOffset{0};
+		Uptr numLazyCodeBytes{0};
 	};
 
 	// A table definition
@@ -144,14 +178,79 @@ namespace WAVM { namespace IR {
 		Uptr index;
 	};
 
+	// A read-only mapping of a WebAssembly binary file that a module was loaded from. The module may
+	// borrow bytes from the mapping instead of copying them, and copies of the module share it. The
+	// file is kept open so that, if mapDataSegments is true, its pages may be mapped directly into a
+	// Runtime::Memory.
+	struct MappedModuleFile
+	{
+		Platform::File* const file;
+		const U8* const bytes;
+		const Uptr numBytes;
+		const bool mapDataSegments;
+
+		MappedModuleFile(Platform::File* inFile,
+						 const U8* inBytes,
+						 Uptr inNumBytes,
+						 bool inMapDataSegments)
+		: file(inFile), bytes(inBytes), numBytes(inNumBytes), mapDataSegments(inMapDataSegments)
+		{
+		}
+
+		IR_API ~MappedModuleFile();
+
+		MappedModuleFile(const MappedModuleFile&) = delete;
+		MappedModuleFile& operator=(const MappedModuleFile&) = delete;
+	};
+
+	// The undecoded code of a module's lazily loaded function definitions. The bytes are borrowed
+	// from a mapped module file if the module was loaded from one, and otherwise owned by this
+	// object. Copies of the module share it.
+	struct LazyFunctionBodies
+	{
+		// Decodes and validates a function definition's code, provided by the module loader.
+		typedef void (*DecodeCodeFunction)(const Module& module,
+										   FunctionDef& functionDef,
+										   const U8* codeBytes,
+										   Uptr numCodeBytes);
+
+		const std::shared_ptr<MappedModuleFile> mappedFile;
+		const std::vector<U8> ownedBytes;
+		const DecodeCodeFunction decodeCode;
+
+		// Serializes the writes to the lazy function definitions' isLazy, code, and branchTables
+		// when they are materialized.
+		Platform::Mutex mutex;
+
+		LazyFunctionBodies(const std::shared_ptr<MappedModuleFile>& inMappedFile,
+						   std::vector<U8>&& inOwnedBytes,
+						   DecodeCodeFunction inDecodeCode)
+		: mappedFile(inMappedFile), ownedBytes(std::move(inOwnedBytes)), decodeCode(inDecodeCode)
+		{
+		}
+
+		const U8* getBytes() const { return mappedFile ? mappedFile->bytes : ownedBytes.data(); }
+	};
+
 	// A data segment: a literal sequence of bytes that is copied into a Runtime::Memory when
-	// instantiating a module
+	// instantiating a module. If mappedFile is non-null, the bytes are borrowed from the range
+	// [mappedFileOffset, mappedFileOffset + numMappedBytes) of the file instead of stored in data.
 	struct DataSegment
 	{
 		bool isActive;
 		Uptr memoryIndex;
 		InitializerExpression baseOffset;
 		std::vector<U8> data;
+
+		std::shared_ptr<MappedModuleFile> mappedFile;
+		Uptr mappedFileOffset{0};
+		Uptr numMappedBytes{0};
+
+		const U8* getBytes() const
+		{
+			return mappedFile ? mappedFile->bytes + mappedFileOffset : data.data();
+		}
+		Uptr getNumBytes() const { return mappedFile ? numMappedBytes : data.size(); }
 	};
 
 	// An elem: a literal reference used to initialize a table element.
@@ -202,11 +301,22 @@ namespace WAVM { namespace IR {
 		std::vector<Elem> elems;
 	};
 
-	// A user-defined module section as an array of bytes
+	// A user-defined module section as an array of bytes. Like a DataSegment, if mappedFile is
+	// non-null, the bytes are borrowed from the mapped file instead of stored in data.
 	struct UserSection
 	{
 		std::string name;
 		std::vector<U8> data;
+
+		std::shared_ptr<MappedModuleFile> mappedFile;
+		Uptr mappedFileOffset{0};
+		Uptr numMappedBytes{0};
+
+		const U8* getBytes() const
+		{
+			return mappedFile ? mappedFile->bytes + mappedFileOffset : data.data();
+		}
+		Uptr getNumBytes() const { return mappedFile ? numMappedBytes : data.size(); }
 	};
 
 	// An index-space for imports and definitions of a specific kind.
@@ -246,6 +356,11 @@ namespace WAVM { namespace IR {
 	{
 		FeatureSpec featureSpec;
 
+		// The encoding used for the operators in the module's function definitions. The WASM and
+		// WAST loaders encode the function definitions they load with the module's encoding, so
+		// setting it before loading a module avoids converting the module's code afterwards.
+		OperatorEncoding operatorEncoding;
+
 		std::vector<FunctionType> types;
 
 		IndexSpace<FunctionDef, IndexedFunctionType> functions;
@@ -261,10 +376,15 @@ namespace WAVM { namespace IR {
 
 		Uptr startFunctionIndex;
 
-		Module() : startFunctionIndex(UINTPTR_MAX) {}
+		// Non-null if the module's function bodies were loaded lazily.
+		std::shared_ptr<LazyFunctionBodies> lazyFunctionBodies;
+
+		Module() : operatorEncoding(OperatorEncoding::fixed), startFunctionIndex(UINTPTR_MAX) {}
 
 		Module(const FeatureSpec& inFeatureSpec)
-		: featureSpec(inFeatureSpec), startFunctionIndex(UINTPTR_MAX)
+		: featureSpec(inFeatureSpec)
+		, operatorEncoding(OperatorEncoding::fixed)
+		, startFunctionIndex(UINTPTR_MAX)
 		{
 		}
 	};
@@ -297,6 +417,21 @@ namespace WAVM { namespace IR {
 		};
 	}
 
+	// Decodes the code of a lazily loaded function definition, if it hasn't been already. The
+	// function definition's code and branch tables may not be accessed until it is materialized.
+	// This may be called concurrently from multiple threads, but not concurrently with copying the
+	// module. The module loader validates lazily loaded code before deferring it, so this doesn't
+	// throw.
+	IR_API void materializeFunctionDef(const Module& module, Uptr functionDefIndex);
+
+	// Materializes all of a module's function definitions.
+	IR_API void materializeFunctionDefs(const Module& module);
+
+	// Re-encodes the operators in all the module's function definitions with a different encoding.
+	// Lazily loaded function definitions that haven't been materialized yet will be decoded to the
+	// new encoding when they are.
+	IR_API void setOperatorEncoding(Module& module, OperatorEncoding encoding);
+
 	// Maps declarations in a module to names to use in disassembly.
 	struct DisassemblyNames
 	{
@@ -8,6 +8,7 @@
 #include "WAVM/IR/Types.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/Serialization.h"
 #include "WAVM/Platform/Defines.h"
 
@@ -155,11 +156,240 @@ namespace WAVM { namespace IR {
 		};
 	};
 
+	// Functions that encode and decode operators in the compact encoding.
+	namespace CompactOperatorEncoding {
+		FORCEINLINE void encodeVarUInt(Serialization::OutputStream& stream, U64 value)
+		{
+			U8 bytes[10];
+			Uptr numBytes = 0;
+			do
+			{
+				const U8 byte = U8(value & 0x7f);
+				value >>= 7;
+				bytes[numBytes++] = value ? (byte | 0x80) : byte;
+			} while(value);
+			memcpy(stream.advance(numBytes), bytes, numBytes);
+		}
+
+		FORCEINLINE U64 decodeVarUInt(const U8*& nextByte)
+		{
+			U64 result = 0;
+			Uptr shift = 0;
+			U8 byte;
+			do
+			{
+				byte = *nextByte++;
+				result |= U64(byte & 0x7f) << shift;
+				shift += 7;
+			} while(byte & 0x80);
+			return result;
+		}
+
+		// Signed integers are zigzag encoded, so small negative numbers are encoded in few bytes.
+		FORCEINLINE void encodeVarSInt(Serialization::OutputStream& stream, I64 value)
+		{
+			encodeVarUInt(stream, (U64(value) << 1) ^ U64(value >> 63));
+		}
+
+		FORCEINLINE I64 decodeVarSInt(const U8*& nextByte)
+		{
+			const U64 zigzag = decodeVarUInt(nextByte);
+			return I64((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+		}
+
+		template<typename Value>
+		FORCEINLINE void encodeBytes(Serialization::OutputStream& stream, const Value& value)
+		{
+			memcpy(stream.advance(sizeof(Value)), &value, sizeof(Value));
+		}
+
+		template<typename Value> FORCEINLINE void decodeBytes(const U8*& nextByte, Value& value)
+		{
+			memcpy(&value, nextByte, sizeof(Value));
+			nextByte += sizeof(Value);
+		}
+
+		// Opcodes below maxSingleByteOpcode are encoded in one byte, and prefixed opcodes are
+		// encoded as the prefix byte followed by the opcode's low byte.
+		FORCEINLINE void encodeOpcode(Serialization::OutputStream& stream, Opcode opcode)
+		{
+			if(opcode <= Opcode::maxSingleByteOpcode) { *stream.advance(1) = U8(opcode); }
+			else
+			{
+				U8* bytes = stream.advance(2);
+				bytes[0] = U8(U16(opcode) >> 8);
+				bytes[1] = U8(opcode);
+			}
+		}
+
+		FORCEINLINE Opcode decodeOpcode(const U8*& nextByte)
+		{
+			U16 opcode = *nextByte++;
+			if(opcode > U16(Opcode::maxSingleByteOpcode)) { opcode = (opcode << 8) | *nextByte++; }
+			return Opcode(opcode);
+		}
+
+		// Encode and decode each type of immediate.
+		inline void encode(Serialization::OutputStream&, const NoImm&) {}
+		inline void decode(const U8*&, NoImm&) {}
+
+#define DEFINE_UINT_IMM_CODEC(Imm, field)                                                         \
+	inline void encode(Serialization::OutputStream& stream, const Imm& imm)                        \
+	{                                                                                              \
+		encodeVarUInt(stream, imm.field);                                                          \
+	}                                                                                              \
+	inline void decode(const U8*& nextByte, Imm& imm) { imm.field = Uptr(decodeVarUInt(nextByte)); }
+
+#define DEFINE_UINT_PAIR_IMM_CODEC(Imm, field0, field1)                                           \
+	inline void encode(Serialization::OutputStream& stream, const Imm& imm)                        \
+	{                                                                                              \
+		encodeVarUInt(stream, imm.field0);                                                         \
+		encodeVarUInt(stream, imm.field1);                                                         \
+	}                                                                                              \
+	inline void decode(const U8*& nextByte, Imm& imm)                                              \
+	{                                                                                              \
+		imm.field0 = Uptr(decodeVarUInt(nextByte));                                                \
+		imm.field1 = Uptr(decodeVarUInt(nextByte));                                                \
+	}
+
+		DEFINE_UINT_IMM_CODEC(MemoryImm, memoryIndex)
+		DEFINE_UINT_PAIR_IMM_CODEC(MemoryCopyImm, sourceMemoryIndex, destMemoryIndex)
+		DEFINE_UINT_IMM_CODEC(TableImm, tableIndex)
+		DEFINE_UINT_PAIR_IMM_CODEC(TableCopyImm, sourceTableIndex, destTableIndex)
+		DEFINE_UINT_IMM_CODEC(BranchImm, targetDepth)
+		DEFINE_UINT_PAIR_IMM_CODEC(BranchTableImm, defaultTargetDepth, branchTableIndex)
+		DEFINE_UINT_IMM_CODEC(FunctionImm, functionIndex)
+		DEFINE_UINT_PAIR_IMM_CODEC(CallIndirectImm, type.index, tableIndex)
+		DEFINE_UINT_IMM_CODEC(ExceptionTypeImm, exceptionTypeIndex)
+		DEFINE_UINT_IMM_CODEC(RethrowImm, catchDepth)
+		DEFINE_UINT_PAIR_IMM_CODEC(DataSegmentAndMemImm, dataSegmentIndex, memoryIndex)
+		DEFINE_UINT_IMM_CODEC(DataSegmentImm, dataSegmentIndex)
+		DEFINE_UINT_PAIR_IMM_CODEC(ElemSegmentAndTableImm, elemSegmentIndex, tableIndex)
+		DEFINE_UINT_IMM_CODEC(ElemSegmentImm, elemSegmentIndex)
+
+#undef DEFINE_UINT_IMM_CODEC
+#undef DEFINE_UINT_PAIR_IMM_CODEC
+
+		inline void encode(Serialization::OutputStream& stream, const ControlStructureImm& imm)
+		{
+			*stream.advance(1) = U8(imm.type.format);
+			switch(imm.type.format)
+			{
+			case IndexedBlockType::noParametersOrResult: break;
+			case IndexedBlockType::oneResult: *stream.advance(1) = U8(imm.type.resultType); break;
+			case IndexedBlockType::functionType: encodeVarUInt(stream, imm.type.index); break;
+			default: Errors::unreachable();
+			};
+		}
+		inline void decode(const U8*& nextByte, ControlStructureImm& imm)
+		{
+			imm.type.format = IndexedBlockType::Format(*nextByte++);
+			switch(imm.type.format)
+			{
+			case IndexedBlockType::noParametersOrResult: imm.type.index = 0; break;
+			case IndexedBlockType::oneResult: imm.type.resultType = ValueType(*nextByte++); break;
+			case IndexedBlockType::functionType:
+				imm.type.index = Uptr(decodeVarUInt(nextByte));
+				break;
+			default: Errors::unreachable();
+			};
+		}
+
+		template<bool isGlobal>
+		void encode(Serialization::OutputStream& stream, const GetOrSetVariableImm<isGlobal>& imm)
+		{
+			encodeVarUInt(stream, imm.variableIndex);
+		}
+		template<bool isGlobal>
+		void decode(const U8*& nextByte, GetOrSetVariableImm<isGlobal>& imm)
+		{
+			imm.variableIndex = Uptr(decodeVarUInt(nextByte));
+		}
+
+		inline void encode(Serialization::OutputStream& stream, const LiteralImm<I32>& imm)
+		{
+			encodeVarSInt(stream, imm.value);
+		}
+		inline void decode(const U8*& nextByte, LiteralImm<I32>& imm)
+		{
+			imm.value = I32(decodeVarSInt(nextByte));
+		}
+		inline void encode(Serialization::OutputStream& stream, const LiteralImm<I64>& imm)
+		{
+			encodeVarSInt(stream, imm.value);
+		}
+		inline void decode(const U8*& nextByte, LiteralImm<I64>& imm)
+		{
+			imm.value = decodeVarSInt(nextByte);
+		}
+
+		// Floating-point and vector literals are copied verbatim.
+		template<typename Value>
+		void encode(Serialization::OutputStream& stream, const LiteralImm<Value>& imm)
+		{
+			encodeBytes(stream, imm.value);
+		}
+		template<typename Value> void decode(const U8*& nextByte, LiteralImm<Value>& imm)
+		{
+			decodeBytes(nextByte, imm.value);
+		}
+
+		template<Uptr naturalAlignmentLog2>
+		void encode(Serialization::OutputStream& stream,
+					const LoadOrStoreImm<naturalAlignmentLog2>& imm)
+		{
+			*stream.advance(1) = imm.alignmentLog2;
+			encodeVarUInt(stream, imm.offset);
+		}
+		template<Uptr naturalAlignmentLog2>
+		void decode(const U8*& nextByte, LoadOrStoreImm<naturalAlignmentLog2>& imm)
+		{
+			imm.alignmentLog2 = *nextByte++;
+			imm.offset = U32(decodeVarUInt(nextByte));
+		}
+
+		template<Uptr naturalAlignmentLog2>
+		void encode(Serialization::OutputStream& stream,
+					const AtomicLoadOrStoreImm<naturalAlignmentLog2>& imm)
+		{
+			*stream.advance(1) = imm.alignmentLog2;
+			encodeVarUInt(stream, imm.offset);
+		}
+		template<Uptr naturalAlignmentLog2>
+		void decode(const U8*& nextByte, AtomicLoadOrStoreImm<naturalAlignmentLog2>& imm)
+		{
+			imm.alignmentLog2 = *nextByte++;
+			imm.offset = U32(decodeVarUInt(nextByte));
+		}
+
+		template<Uptr numLanes>
+		void encode(Serialization::OutputStream& stream, const LaneIndexImm<numLanes>& imm)
+		{
+			*stream.advance(1) = imm.laneIndex;
+		}
+		template<Uptr numLanes> void decode(const U8*& nextByte, LaneIndexImm<numLanes>& imm)
+		{
+			imm.laneIndex = *nextByte++;
+		}
+
+		template<Uptr numLanes>
+		void encode(Serialization::OutputStream& stream, const ShuffleImm<numLanes>& imm)
+		{
+			encodeBytes(stream, imm.laneIndices);
+		}
+		template<Uptr numLanes> void decode(const U8*& nextByte, ShuffleImm<numLanes>& imm)
+		{
+			decodeBytes(nextByte, imm.laneIndices);
+		}
+	}
+
 	// Decodes an operator from an input stream and dispatches by opcode.
 	struct OperatorDecoderStream
 	{
-		OperatorDecoderStream(const std::vector<U8>& codeBytes)
-		: nextByte(codeBytes.data()), end(codeBytes.data() + codeBytes.size())
+		OperatorDecoderStream(const std::vector<U8>& codeBytes, OperatorEncoding inEncoding)
+		: nextByte(codeBytes.data())
+		, end(codeBytes.data() + codeBytes.size())
+		, encoding(inEncoding)
 		{
 		}
 
@@ -167,6 +397,8 @@ namespace WAVM { namespace IR {
 
 		template<typename Visitor> typename Visitor::Result decodeOp(Visitor& visitor)
 		{
+			if(encoding == OperatorEncoding::compact) { return decodeCompactOp(visitor); }
+
 			wavmAssert(nextByte + sizeof(Opcode) <= end);
 			Opcode opcode;
 			memcpy(&opcode, nextByte, sizeof(Opcode));
@@ -198,18 +430,47 @@ namespace WAVM { namespace IR {
 	private:
 		const U8* nextByte;
 		const U8* end;
+		OperatorEncoding encoding;
+
+		template<typename Visitor> typename Visitor::Result decodeCompactOp(Visitor& visitor)
+		{
+			wavmAssert(nextByte < end);
+			const Opcode opcode = CompactOperatorEncoding::decodeOpcode(nextByte);
+			switch(opcode)
+			{
+#define VISIT_OPCODE(opcode, name, nameString, Imm, ...)                                           \
+	case Opcode::name:                                                                             \
+	{                                                                                              \
+		Imm imm;                                                                                   \
+		CompactOperatorEncoding::decode(nextByte, imm);                                            \
+		wavmAssert(nextByte <= end);                                                               \
+		return visitor.name(imm);                                                                  \
+	}
+				ENUM_OPERATORS(VISIT_OPCODE)
+#undef VISIT_OPCODE
+			default: return visitor.unknown(opcode);
+			}
+		}
 	};
 
 	// Encodes an operator to an output stream.
 	struct OperatorEncoderStream
 	{
-		OperatorEncoderStream(Serialization::OutputStream& inByteStream) : byteStream(inByteStream)
+		OperatorEncoderStream(Serialization::OutputStream& inByteStream,
+							  OperatorEncoding inEncoding = OperatorEncoding::fixed)
+		: byteStream(inByteStream), encoding(inEncoding)
 		{
 		}
 
 #define VISIT_OPCODE(_, name, nameString, Imm, ...)                                                \
 	void name(Imm imm = {})                                                                        \
 	{                                                                                              \
+		if(encoding == OperatorEncoding::compact)                                                  \
+		{                                                                                          \
+			CompactOperatorEncoding::encodeOpcode(byteStream, Opcode::name);                       \
+			CompactOperatorEncoding::encode(byteStream, imm);                                      \
+			return;                                                                                \
+		}                                                                                          \
 		OpcodeAndImm<Imm> encodedOperator;                                                         \
 		encodedOperator.opcode = Opcode::name;                                                     \
 		encodedOperator.imm = imm;                                                                 \
@@ -222,6 +483,7 @@ namespace WAVM { namespace IR {
 
 	private:
 		Serialization::OutputStream& byteStream;
+		OperatorEncoding encoding;
 	};
 
 	IR_API const char* getOpcodeName(Opcode opcode);
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Serialization.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/File.h"
 
+#include <string.h>
+#include <algorithm>
 #include <vector>
 
 namespace WAVM {
@@ -37,6 +40,169 @@ namespace WAVM {
 		return true;
 	}
 
+	// Returns true if the file starts with the WebAssembly binary magic number. Returns false if it
+	// doesn't, or if it can't be read.
+	inline bool isBinaryModuleFile(const char* filename)
+	{
+		Platform::File* file = Platform::openFile(
+			filename, Platform::FileAccessMode::readOnly, Platform::FileCreateMode::openExisting);
+		if(!file) { return false; }
+
+		static const U8 wasmMagicNumber[4] = {0x00, 0x61, 0x73, 0x6d};
+		U8 fileMagicNumber[4] = {0};
+		Uptr numBytesRead = 0;
+		const bool readSucceeded
+			= Platform::readFile(file, fileMagicNumber, sizeof(fileMagicNumber), &numBytesRead);
+		errorUnless(Platform::closeFile(file));
+
+		return readSucceeded && numBytesRead == sizeof(fileMagicNumber)
+			   && !memcmp(fileMagicNumber, wasmMagicNumber, sizeof(wasmMagicNumber));
+	}
+
+	// An input stream that reads a file in chunks, so the start of the file may be deserialized
+	// before the rest of it has been read. Pointers returned by the stream are only valid until the
+	// next time it reads from the file.
+	struct FileInputStream : Serialization::InputStream
+	{
+		FileInputStream(Platform::File* inFile, Uptr inNumChunkBytes = 1024 * 1024)
+		: InputStream(nullptr, nullptr)
+		, file(inFile)
+		, numChunkBytes(inNumChunkBytes)
+		, isAtEndOfFile(false)
+		{
+		}
+
+		// Returns the number of bytes that have been read from the file but not from the stream. The
+		// full size of the file isn't known until its end is reached, so this may be less than the
+		// number of bytes remaining in the stream, but is only zero at the end of the file.
+		virtual Uptr capacity() const
+		{
+			if(next == end && !isAtEndOfFile)
+			{ const_cast<FileInputStream*>(this)->readMoreData(1); }
+			return Uptr(end - next);
+		}
+
+		// Returns true if the stream starts with the given bytes at its cursor, without advancing
+		// past them. Returns false if the stream ends before numBytes. May throw
+		// FatalSerializationException if the file can't be read.
+		bool startsWith(const U8* bytes, Uptr numBytes)
+		{
+			if(Uptr(end - next) < numBytes && !isAtEndOfFile) { readMoreData(numBytes); }
+			return Uptr(end - next) >= numBytes && !memcmp(next, bytes, numBytes);
+		}
+
+	private:
+		Platform::File* file;
+		Uptr numChunkBytes;
+		bool isAtEndOfFile;
+		std::vector<U8> buffer;
+
+		virtual void getMoreData(Uptr numBytes)
+		{
+			readMoreData(numBytes);
+			if(Uptr(end - next) < numBytes)
+			{
+				throw Serialization::FatalSerializationException(
+					"expected data but found end of stream");
+			}
+		}
+
+		// Reads from the file until there are at least numBytes buffered, or the end of the file is
+		// reached.
+		void readMoreData(Uptr numBytes)
+		{
+			// Move the unread bytes to the start of the buffer, and make room for another chunk.
+			const Uptr numBufferedBytes = Uptr(end - next);
+			if(numBufferedBytes) { memmove(buffer.data(), next, numBufferedBytes); }
+			buffer.resize(std::max(numBytes, numBufferedBytes + numChunkBytes));
+
+			Uptr numReadBytes = numBufferedBytes;
+			while(!isAtEndOfFile && numReadBytes < numBytes)
+			{
+				Uptr numChunkReadBytes = 0;
+				if(!Platform::readFile(file,
+									   buffer.data() + numReadBytes,
+									   buffer.size() - numReadBytes,
+									   &numChunkReadBytes))
+				{ throw Serialization::FatalSerializationException("couldn't read file"); }
+
+				isAtEndOfFile = numChunkReadBytes == 0;
+				numReadBytes += numChunkReadBytes;
+			}
+
+			next = buffer.data();
+			end = next + numReadBytes;
+		}
+	};
+
+	// An output stream that buffers a bounded number of bytes, and passes them to writeChunk when
+	// the buffer is full, so the whole output doesn't need to be buffered in memory. flush must be
+	// called after the last write to the stream.
+	struct ChunkedOutputStream : Serialization::OutputStream
+	{
+		ChunkedOutputStream(Uptr numChunkBytes) : buffer(numChunkBytes)
+		{
+			next = buffer.data();
+			end = next + buffer.size();
+		}
+
+		// Passes the buffered bytes to writeChunk.
+		void flush()
+		{
+			if(next != buffer.data()) { writeChunk(buffer.data(), Uptr(next - buffer.data())); }
+			next = buffer.data();
+		}
+
+	protected:
+		virtual void writeChunk(const U8* bytes, Uptr numBytes) = 0;
+
+	private:
+		std::vector<U8> buffer;
+
+		virtual void extendBuffer(Uptr numBytes)
+		{
+			flush();
+			if(numBytes > buffer.size()) { buffer.resize(numBytes); }
+			next = buffer.data();
+			end = next + buffer.size();
+		}
+	};
+
+	// An output stream that writes to a file in chunks.
+	struct FileOutputStream : ChunkedOutputStream
+	{
+		FileOutputStream(Platform::File* inFile, Uptr numChunkBytes = 1024 * 1024)
+		: ChunkedOutputStream(numChunkBytes), file(inFile)
+		{
+		}
+
+	protected:
+		virtual void writeChunk(const U8* bytes, Uptr numBytes)
+		{
+			if(!Platform::writeFile(file, bytes, numBytes))
+			{ throw Serialization::FatalSerializationException("couldn't write file"); }
+		}
+
+	private:
+		Platform::File* file;
+	};
+
+	// An output stream that prints text to a log category in chunks.
+	struct LogOutputStream : ChunkedOutputStream
+	{
+		LogOutputStream(Log::Category inCategory, Uptr numChunkBytes = 64 * 1024)
+		: ChunkedOutputStream(numChunkBytes), category(inCategory)
+		{
+		}
+
+	protected:
+		virtual void writeChunk(const U8* bytes, Uptr numBytes)
+		{ Log::printf(category, "%.*s", int(numBytes), (const char*)bytes); }
+
+	private:
+		Log::Category category;
+	};
+
 	inline bool saveFile(const char* filename, const void* fileBytes, Uptr numFileBytes)
 	{
 		Platform::File* file = Platform::openFile(
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "WAVM/Inline/Assert.h"
+#include "WAVM/Platform/Intrinsic.h"
 
 #include <string.h>
 #include <algorithm>
@@ -108,6 +109,14 @@ namespace WAVM { namespace Serialization {
 			return next;
 		}
 
+		// Returns a pointer to the current stream cursor if there are at least numBytes following
+		// it in the stream's current buffer, or null if there aren't. Unlike peek, this never
+		// calls getMoreData.
+		inline const U8* peekBuffered(Uptr numBytes) const
+		{
+			return Uptr(end - next) >= numBytes ? next : nullptr;
+		}
+
 	protected:
 		const U8* next;
 		const U8* end;
@@ -217,22 +226,37 @@ namespace WAVM { namespace Serialization {
 									 Value minValue,
 									 Value maxValue)
 	{
-		// First, read the variable number of input bytes into a fixed size buffer.
+		// First, find the variable number of input bytes.
 		enum
 		{
 			maxBytes = (maxBits + 6) / 7
 		};
-		U8 bytes[maxBytes] = {0};
+		U8 bufferedBytes[maxBytes];
+		const U8* bytes;
 		Uptr numBytes = 0;
-		I8 signExtendShift = (I8)sizeof(Value) * 8;
-		while(numBytes < maxBytes)
+		if(const U8* peekedBytes = stream.peekBuffered(16))
 		{
-			U8 byte = *stream.advance(1);
-			bytes[numBytes] = byte;
-			++numBytes;
-			signExtendShift -= 7;
-			if(!(byte & 0x80)) { break; }
-		};
+			// If the stream's buffer has at least 16 more bytes, find the first byte that doesn't
+			// have the continuation bit set with a single SIMD comparison, and decode the bytes
+			// directly from the stream's buffer without checking the bounds of each byte.
+			const U32 lastByteMask = ~Platform::getMostSignificantBitMask16(peekedBytes);
+			numBytes = std::min(Uptr(Platform::countTrailingZeroes(lastByteMask)) + 1,
+								Uptr(maxBytes));
+			bytes = stream.advance(numBytes);
+		}
+		else
+		{
+			// Otherwise, read the input bytes one at a time into a fixed size buffer.
+			while(numBytes < maxBytes)
+			{
+				U8 byte = *stream.advance(1);
+				bufferedBytes[numBytes] = byte;
+				++numBytes;
+				if(!(byte & 0x80)) { break; }
+			};
+			bytes = bufferedBytes;
+		}
+		const I8 signExtendShift = I8(sizeof(Value) * 8) - I8(numBytes * 7);
 
 		// Ensure that the input does not encode more than maxBits of data.
 		enum
@@ -243,7 +267,7 @@ namespace WAVM { namespace Serialization {
 			lastByteUsedMask = U8(1 << numUsedBitsInLastByte) - U8(1),
 			lastByteSignedMask = U8(~U8(lastByteUsedMask) & ~U8(0x80))
 		};
-		const U8 lastByte = bytes[maxBytes - 1];
+		const U8 lastByte = numBytes == maxBytes ? bytes[maxBytes - 1] : 0;
 		if(!std::is_signed<Value>::value)
 		{
 			if((lastByte & ~lastByteUsedMask) != 0)
@@ -266,7 +290,7 @@ namespace WAVM { namespace Serialization {
 
 		// Decode the buffer's bytes into the output integer.
 		value = 0;
-		for(Uptr byteIndex = 0; byteIndex < maxBytes; ++byteIndex)
+		for(Uptr byteIndex = 0; byteIndex < numBytes; ++byteIndex)
 		{ value |= Value(U64(bytes[byteIndex] & ~0x80) << U64(byteIndex * 7)); }
 
 		// Sign extend the output integer to the full size of Value.
@@ -2,6 +2,7 @@
 
 #include "BasicTypes.h"
 #include "WAVM/Inline/Assert.h"
+#include "WAVM/Platform/Intrinsic.h"
 
 namespace WAVM { namespace Unicode {
 	template<typename String> void encodeUTF8CodePoint(U32 codePoint, String& outString)
@@ -142,7 +143,23 @@ namespace WAVM { namespace Unicode {
 	inline const U8* validateUTF8String(const U8* nextChar, const U8* endChar)
 	{
 		U32 codePoint;
-		while(nextChar != endChar && decodeUTF8CodePoint(nextChar, endChar, codePoint)) {};
+		while(nextChar != endChar)
+		{
+			// Skip over runs of ASCII characters 16 bytes at a time, and only decode the non-ASCII
+			// code points.
+			if(endChar - nextChar >= 16)
+			{
+				const U32 nonASCIIMask = Platform::getMostSignificantBitMask16(nextChar);
+				if(!nonASCIIMask)
+				{
+					nextChar += 16;
+					continue;
+				}
+				nextChar += Platform::countTrailingZeroes(nonASCIIMask);
+			}
+
+			if(!decodeUTF8CodePoint(nextChar, endChar, codePoint)) { break; }
+		};
 		return nextChar;
 	}
 
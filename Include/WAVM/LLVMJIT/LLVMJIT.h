@@ -27,6 +27,26 @@ namespace WAVM { namespace LLVMJIT {
 	// Compiles a module to object code.
 	LLVMJIT_API std::vector<U8> compileModule(const IR::Module& irModule);
 
+	// An opaque type that holds the state of a module that is being compiled one function definition
+	// at a time.
+	struct StreamingModuleCompiler;
+
+	// Begins compiling a module before the code of its function definitions is available. All the
+	// module's declarations, up to and including the function definitions' types, must already be in
+	// irModule, and irModule must outlive the StreamingModuleCompiler.
+	LLVMJIT_API StreamingModuleCompiler* beginStreamingCompile(const IR::Module& irModule);
+
+	// Emits LLVM IR for a function definition whose code is now in the IR::Module. The calls for a
+	// StreamingModuleCompiler must not be made concurrently, but may be made from any thread.
+	LLVMJIT_API void compileFunctionDef(StreamingModuleCompiler* compiler, Uptr functionDefIndex);
+
+	// Emits any function definitions that weren't passed to compileFunctionDef, compiles the module
+	// to object code, and deletes the StreamingModuleCompiler.
+	LLVMJIT_API std::vector<U8> finishStreamingCompile(StreamingModuleCompiler* compiler);
+
+	// Deletes a StreamingModuleCompiler without finishing compiling its module.
+	LLVMJIT_API void abortStreamingCompile(StreamingModuleCompiler* compiler);
+
 	// An opaque type that can be used to reference a loaded JIT module.
 	struct Module;
 
@@ -71,8 +91,10 @@ namespace WAVM { namespace LLVMJIT {
 	};
 
 	// Loads a module from object code, and binds its undefined symbols to the provided bindings.
+	// The object code is only accessed during the call.
 	LLVMJIT_API std::shared_ptr<Module> loadModule(
-		const std::vector<U8>& objectFileBytes,
+		const U8* objectFileBytes,
+		Uptr numObjectFileBytes,
 		HashMap<std::string, FunctionBinding>&& wavmIntrinsicsExportMap,
 		std::vector<IR::FunctionType>&& types,
 		std::vector<FunctionBinding>&& functionImports,
@@ -88,9 +110,30 @@ namespace WAVM { namespace LLVMJIT {
 	// given address, returns null.
 	LLVMJIT_API Runtime::Function* getFunctionByAddress(Uptr address);
 
+	// Writes the address range and name of each JIT function that is loaded after this call to
+	// /tmp/perf-<pid>.map, so the Linux perf tool can attribute samples in JIT code to functions.
+	// Returns false if the file couldn't be created, or if the platform isn't Linux.
+	// The perf map has no record of when a function is unloaded, so while it is enabled, the
+	// address range of an unloaded module stays reserved for the rest of the process, to keep other
+	// code from being loaded at an address that the map attributes to the unloaded functions. Hosts
+	// that load and unload many modules will leak address space, so they should use
+	// enablePerfJITDump instead, which records when each function is loaded.
+	LLVMJIT_API bool enablePerfMap();
+
+	// Writes each JIT function that is loaded after this call to a jit-<pid>.dump file in the given
+	// directory, including its code and the WebAssembly operator index of each instruction as its
+	// line number, for use with perf record -k 1 and perf inject --jit. Returns false if the file
+	// couldn't be created, or if the platform isn't Linux.
+	LLVMJIT_API bool enablePerfJITDump(const char* directory);
+
 	// Generates an invoke thunk for a specific function type.
 	LLVMJIT_API Runtime::InvokeThunkPointer getInvokeThunk(IR::FunctionType functionType);
 
+	// Generates a thunk that invokes a function of a specific type once for each argument tuple in
+	// an array.
+	LLVMJIT_API Runtime::InvokeBatchThunkPointer getInvokeBatchThunk(
+		IR::FunctionType functionType);
+
 	// Generates a thunk to call a native function from generated code.
 	LLVMJIT_API Runtime::Function* getIntrinsicThunk(void* nativeFunction,
 													 IR::FunctionType functionType,
@@ -22,4 +22,17 @@ namespace WAVM { namespace Log {
 	// Print some categorized, formatted string, and flush the output. Newline is not included.
 	LOGGING_API void printf(Category category, const char* format, ...) VALIDATE_AS_PRINTF(2, 3);
 	LOGGING_API void vprintf(Category category, const char* format, va_list argList);
+
+	// Enables or disables asynchronous output. While enabled, messages in categories other than
+	// error are formatted into a buffer owned by the calling thread, and a background thread writes
+	// them to stdout, so logging doesn't wait for stdio. If a thread's buffer is full, its messages
+	// are dropped until the background thread catches up. Errors are still written synchronously,
+	// after any buffered messages. Buffered messages are lost if the process exits abnormally.
+	LOGGING_API void setAsyncOutputEnabled(bool enable);
+
+	// Writes any buffered asynchronous output.
+	LOGGING_API void flushAsyncOutput();
+
+	// Returns the number of messages that were dropped because a thread's buffer was full.
+	LOGGING_API U64 getNumDroppedMessages();
 }}
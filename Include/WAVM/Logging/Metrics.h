@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+
+// Metrics that the runtime records while it runs, and that an embedder may read at any time.
+namespace WAVM { namespace Metrics {
+	enum class Kind : U8
+	{
+		counter,
+		gauge,
+		histogram
+	};
+
+	// A metric is identified by its name and labels. The labels are formatted as they are written
+	// inside the braces of a Prometheus metric, e.g. type="wavm.outOfBoundsMemoryAccess", or are
+	// empty. Each thread records into its own copy of each metric's values, and the copies are only
+	// added together when the metrics are read, so recording a value doesn't contend with other
+	// threads. Metrics are never destroyed, so they are usually declared as static objects.
+	struct Metric
+	{
+		LOGGING_API Metric(Kind kind,
+						   const char* name,
+						   const char* description,
+						   std::string&& labels = std::string());
+
+		Metric(const Metric&) = delete;
+		void operator=(const Metric&) = delete;
+
+	protected:
+		Uptr firstSlotIndex;
+	};
+
+	// Adds a value to one of the calling thread's metric slots.
+	LOGGING_API void addToThreadSlot(Uptr slotIndex, U64 delta);
+
+	// A count of events that only increases.
+	struct Counter : Metric
+	{
+		Counter(const char* name, const char* description, std::string&& labels = std::string())
+		: Metric(Kind::counter, name, description, std::move(labels))
+		{
+		}
+
+		void add(U64 delta = 1) { addToThreadSlot(firstSlotIndex, delta); }
+	};
+
+	// A value that may increase or decrease, e.g. a number of bytes that are in use.
+	struct Gauge : Metric
+	{
+		Gauge(const char* name, const char* description, std::string&& labels = std::string())
+		: Metric(Kind::gauge, name, description, std::move(labels))
+		{
+		}
+
+		void add(I64 delta) { addToThreadSlot(firstSlotIndex, U64(delta)); }
+	};
+
+	// A distribution of values, e.g. the number of microseconds an operation took. The values are
+	// counted in buckets whose width is 1/8 of the power of two they are in, so a percentile read
+	// from the histogram is within 12.5% of the true value.
+	struct Histogram : Metric
+	{
+		Histogram(const char* name, const char* description, std::string&& labels = std::string())
+		: Metric(Kind::histogram, name, description, std::move(labels))
+		{
+		}
+
+		LOGGING_API void record(U64 value);
+	};
+
+	// Formats a label for a metric's labels, escaping the characters in the value that Prometheus
+	// requires to be escaped.
+	LOGGING_API std::string formatLabel(const char* name, const std::string& value);
+
+	// Returns the counter with the given name and labels, creating it if it doesn't exist yet.
+	LOGGING_API Counter* getCounter(const char* name,
+									const char* description,
+									std::string&& labels);
+
+	// The values of a metric at the time getSnapshot was called.
+	struct HistogramBucket
+	{
+		// The largest value counted in the bucket.
+		U64 maxValue;
+		U64 numValues;
+	};
+
+	struct MetricSnapshot
+	{
+		Kind kind;
+		std::string name;
+		std::string description;
+		std::string labels;
+
+		// The value of a counter or gauge.
+		U64 counterValue = 0;
+		I64 gaugeValue = 0;
+
+		// The number of values recorded in a histogram, their sum, and the histogram's non-empty
+		// buckets in ascending order.
+		U64 numValues = 0;
+		U64 sum = 0;
+		std::vector<HistogramBucket> buckets;
+
+		// Returns the value that the given fraction (0-1) of the histogram's values are <=.
+		LOGGING_API U64 getPercentile(F64 fraction) const;
+	};
+
+	// Reads all metrics, sorted by name and labels.
+	LOGGING_API std::vector<MetricSnapshot> getSnapshot();
+
+	// Formats metrics in the Prometheus text exposition format.
+	LOGGING_API std::string exportText(const std::vector<MetricSnapshot>& snapshot);
+}}
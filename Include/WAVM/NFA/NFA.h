@@ -45,7 +45,13 @@ namespace WAVM { namespace NFA {
 	// Encapsulates a NFA that has been translated into a DFA that can be efficiently executed.
 	struct NFA_API Machine
 	{
-		Machine() : stateAndOffsetToNextStateMap(nullptr), numClasses(0), numStates(0) {}
+		Machine()
+		: stateAndOffsetToNextStateMap(nullptr)
+		, numClasses(0)
+		, numStates(0)
+		, ownsStateAndOffsetToNextStateMap(false)
+		{
+		}
 		~Machine();
 
 		Machine(Machine&& inMachine) { moveFrom(std::move(inMachine)); }
@@ -54,6 +60,13 @@ namespace WAVM { namespace NFA {
 		// Constructs a DFA from the abstract builder object (which is destroyed).
 		Machine(Builder* inBuilder);
 
+		// Constructs a DFA from the tables defined by the source that dumpCPPTables generated for
+		// an equivalent DFA. The transition table isn't copied, so it must outlive the Machine.
+		Machine(const U32* inCharToOffsetMap,
+				const I16* inStateAndOffsetToNextStateMap,
+				Uptr inNumClasses,
+				Uptr inNumStates);
+
 		// Feeds characters into the DFA until it reaches a terminal state.
 		// Upon reaching a terminal state, the state is returned, and the nextChar pointer
 		// is updated to point to the first character not consumed by the DFA.
@@ -94,6 +107,11 @@ namespace WAVM { namespace NFA {
 		// Dumps the DFA's states and edges to the GraphViz .dot format.
 		std::string dumpDFAGraphViz() const;
 
+		// Dumps the DFA's tables as C++ source that defines <name>NumClasses, <name>NumStates,
+		// <name>CharToOffsetMap, and <name>StateAndOffsetToNextStateMap constants, which may be
+		// passed to the Machine constructor to recreate the DFA without building it from an NFA.
+		std::string dumpCPPTables(const char* name) const;
+
 	private:
 		typedef I16 InternalStateIndex;
 		enum
@@ -102,9 +120,10 @@ namespace WAVM { namespace NFA {
 		};
 
 		U32 charToOffsetMap[256];
-		InternalStateIndex* stateAndOffsetToNextStateMap;
+		const InternalStateIndex* stateAndOffsetToNextStateMap;
 		Uptr numClasses;
 		Uptr numStates;
+		bool ownsStateAndOffsetToNextStateMap;
 
 		void moveFrom(Machine&& inMachine);
 	};
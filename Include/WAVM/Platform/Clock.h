@@ -5,4 +5,23 @@ namespace WAVM { namespace Platform {
 	// Returns the current value of a clock that may be used as an absolute time for wait timeouts.
 	// The resolution is microseconds, and the origin is arbitrary.
 	PLATFORM_API U64 getMonotonicClock();
+
+	// The clocks that may be read by getClockTime.
+	enum class Clock
+	{
+		// The wall clock time, with the Unix epoch as its origin.
+		realtime,
+		// A clock that never goes backward, with an arbitrary origin.
+		monotonic,
+		// The CPU time used by all the threads in the process.
+		processCPUTime,
+		// The CPU time used by the calling thread.
+		threadCPUTime,
+	};
+
+	// Reads a clock in nanoseconds. Returns false if the clock isn't supported.
+	PLATFORM_API bool getClockTime(Clock clock, U64& outNanoseconds);
+
+	// Gets the resolution of a clock in nanoseconds. Returns false if the clock isn't supported.
+	PLATFORM_API bool getClockResolution(Clock clock, U64& outNanoseconds);
 }}
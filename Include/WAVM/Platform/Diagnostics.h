@@ -27,27 +27,58 @@ namespace WAVM { namespace Platform {
 	// Call stack and exceptions
 	//
 
-	// Describes a call stack.
+	// Describes a call stack. The frames are stored inline, so capturing a call stack doesn't
+	// allocate memory. If the call stack is deeper than maxFrames, the frames nearest the base of
+	// the stack are omitted.
 	struct CallStack
 	{
 		struct Frame
 		{
 			Uptr ip;
 		};
-		std::vector<Frame> stackFrames;
 
-		CallStack() {}
-		CallStack(const CallStack& copy) : stackFrames(copy.stackFrames) {}
-		CallStack(CallStack&& movee) : stackFrames(std::move(movee.stackFrames)) {}
-		~CallStack() {}
+		enum
+		{
+			maxFrames = 64
+		};
+
+		Frame stackFrames[maxFrames];
+		Uptr numStackFrames{0};
+
+		// Adds a frame to the base of the call stack. Returns false if the call stack is full.
+		bool addFrame(Uptr ip)
+		{
+			if(numStackFrames == maxFrames) { return false; }
+			stackFrames[numStackFrames++] = Frame{ip};
+			return true;
+		}
 	};
 
-	// Captures the execution context of the caller.
+	// Captures the execution context of the caller, using the platform's unwind information.
 	PLATFORM_API CallStack captureCallStack(Uptr numOmittedFramesFromTop = 0);
 
+	// Captures the execution context of the caller by following the chain of frame pointers. This
+	// is much cheaper than captureCallStack, but the call stack ends at the first frame that
+	// doesn't maintain a frame pointer. WAVM and the code it generates are compiled with frame
+	// pointers, so this is sufficient to describe the WebAssembly frames of a trap.
+	PLATFORM_API CallStack captureFramePointerCallStack(Uptr numOmittedFramesFromTop = 0);
+
 	// Describes an instruction pointer.
 	PLATFORM_API bool describeInstructionPointer(Uptr ip, std::string& outDescription);
 
+	// Starts sampling the call stacks of the process's threads: each time the process consumes
+	// intervalMicroseconds of CPU time, the thread that is running is interrupted, and
+	// callback(argument, callStack) is called on it with the interrupted call stack. Only threads
+	// running code within catchSignals are sampled. The callback is called from a signal handler,
+	// so it must only call async-signal-safe functions: it must not allocate memory or lock a
+	// mutex. Returns false if sampling is already started, or isn't supported by the platform.
+	PLATFORM_API bool startCallStackSampling(U64 intervalMicroseconds,
+											 void (*callback)(void*, const CallStack&),
+											 void* argument);
+
+	// Stops sampling call stacks. When it returns, no calls to the sample callback are running.
+	PLATFORM_API void stopCallStackSampling();
+
 #if WAVM_ENABLE_ASAN
 	PLATFORM_API void expectLeakedObject(void* object);
 #else
@@ -16,7 +16,14 @@ namespace WAVM { namespace Platform {
 		void operator=(const Event&) = delete;
 		void operator=(Event&&) = delete;
 
+		// Waits until the event is signaled, or until the monotonic clock reaches untilClock.
+		// Returns true if the event was signaled, and resets it, so the next wait blocks until it
+		// is signaled again. A signal that happens while no thread is waiting isn't lost: the next
+		// wait returns immediately.
 		PLATFORM_API bool wait(U64 untilClock);
+
+		// Signals the event, waking one waiting thread. Signaling an event that is already
+		// signaled has no effect.
 		PLATFORM_API void signal();
 
 	private:
@@ -51,6 +58,9 @@ namespace WAVM { namespace Platform {
 		} pthreadCond;
 #else
 #error unsupported platform
+#endif
+#ifndef WIN32
+		bool isSignaled;
 #endif
 	};
 }}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+
+namespace WAVM { namespace Platform {
+	struct File;
+
+	// A file, and whether to wait for it to be readable or writable.
+	struct FileWait
+	{
+		File* file;
+		bool read;
+		bool write;
+	};
+
+	// Whether a file is ready to read without blocking, or to write without blocking. A file that
+	// has hung up or has an error is also ready: reading or writing it will not block.
+	struct FileReadiness
+	{
+		bool readable;
+		bool writable;
+		bool hangup;
+		bool error;
+	};
+
+	// Checks whether the given files are ready, waiting until at least one of them is ready or the
+	// monotonic clock reaches untilClock. untilClock=0 doesn't wait, and untilClock=UINT64_MAX waits
+	// without a timeout. Writes the readiness of each file to outReadiness, and returns the number
+	// of files that are ready.
+	PLATFORM_API Uptr pollFiles(const FileWait* waits,
+								FileReadiness* outReadiness,
+								Uptr numWaits,
+								U64 untilClock);
+
+	// An event loop waits for files to become ready, and for timeouts to expire, and calls a
+	// callback for each wait that is satisfied. On Linux, it is implemented with epoll, so the cost
+	// of waiting doesn't depend on the number of waits. On Windows, all files are treated as ready,
+	// so an event loop only waits for timeouts.
+	//
+	// An event loop may only be used by one thread at a time.
+	struct EventLoop;
+
+	PLATFORM_API EventLoop* createEventLoop();
+
+	// Destroys an event loop. Any pending waits are discarded without calling their callbacks.
+	PLATFORM_API void destroyEventLoop(EventLoop* eventLoop);
+
+	// Adds a wait to an event loop: when any of the files is ready as requested, or the monotonic
+	// clock reaches untilClock, runEventLoop will call callback(argument) once, and remove the wait.
+	// Regular files are always ready, so a wait for a regular file is satisfied immediately.
+	PLATFORM_API void addEventLoopWait(EventLoop* eventLoop,
+									   const FileWait* waits,
+									   Uptr numWaits,
+									   U64 untilClock,
+									   void (*callback)(void*),
+									   void* argument);
+
+	// Returns the number of waits that have been added to the event loop, but not yet satisfied.
+	PLATFORM_API Uptr getNumPendingEventLoopWaits(EventLoop* eventLoop);
+
+	// Waits until at least one of the event loop's waits is satisfied, or the monotonic clock
+	// reaches untilClock, then calls the callbacks of the satisfied waits. The callbacks may add new
+	// waits. Returns the number of callbacks that were called.
+	PLATFORM_API Uptr runEventLoop(EventLoop* eventLoop, U64 untilClock);
+}}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+
+namespace WAVM { namespace Platform {
+	// A fiber calls a function on its own stack. The function may suspend the fiber, which returns
+	// control to the thread that resumed it. A suspended fiber may be resumed by any thread.
+	//
+	// Code running on a fiber must not suspend it while handling a C++ exception, and must not
+	// depend on the address of a thread-local variable that it computed before suspending.
+	struct Fiber;
+
+	// Creates a fiber that will call entry(argument) when it is first resumed. The fiber's stack is
+	// numStackBytes, rounded up to a whole number of pages, with an inaccessible guard page below
+	// it, so overflowing the stack raises a stack overflow signal.
+	PLATFORM_API Fiber* createFiber(Uptr numStackBytes, void (*entry)(void*), void* argument);
+
+	// Frees a fiber and its stack. The fiber must not be running. If the fiber is suspended, its
+	// stack is freed without unwinding it.
+	PLATFORM_API void destroyFiber(Fiber* fiber);
+
+	// Runs a fiber on the calling thread until it suspends, or its entry function returns. Returns
+	// true if the entry function returned. A fiber whose entry function has returned must not be
+	// resumed again.
+	PLATFORM_API bool resumeFiber(Fiber* fiber);
+
+	// Suspends the fiber running on the calling thread, returning from the call to resumeFiber that
+	// resumed it. Returns when the fiber is resumed again, possibly on a different thread.
+	PLATFORM_API void suspendFiber();
+
+	// Forks the fiber running on the calling thread: creates a suspended fiber with the same stack
+	// size, and a copy of the active part of the calling fiber's stack. Returns the forked fiber to
+	// the calling fiber. When the forked fiber is resumed, it returns null from forkCurrentFiber,
+	// and getFiberArgument returns forkedArgument for it.
+	//
+	// As with forkCurrentThread, the forked fiber's stack frames are copies of the calling fiber's,
+	// so a pointer into the calling fiber's stack still points there in the forked fiber. Code
+	// after the fork must not depend on such pointers, and the forked fiber must not use the
+	// argument its entry function was called with.
+	RETURNS_TWICE PLATFORM_API Fiber* forkCurrentFiber(void* forkedArgument);
+
+	// Returns the argument that was passed to createFiber for a fiber, or to forkCurrentFiber for a
+	// forked fiber.
+	PLATFORM_API void* getFiberArgument(Fiber* fiber);
+
+	// Returns the fiber running on the calling thread, or null if the calling thread isn't running
+	// a fiber.
+	PLATFORM_API Fiber* getCurrentFiber();
+}}
@@ -55,5 +55,21 @@ namespace WAVM { namespace Platform {
 								Uptr numBytes,
 								Uptr* outNumBytesWritten = nullptr);
 	PLATFORM_API bool flushFileWrites(File* file);
+
+	// Maps the contents of a file into the address-space as read-only memory. The mapping stays
+	// valid until it is passed to unmapFile, even if the file is closed. Returns nullptr if the file
+	// couldn't be mapped; an empty file can't be mapped.
+	PLATFORM_API const U8* mapFile(File* file, Uptr& outNumBytes);
+	PLATFORM_API void unmapFile(const U8* bytes, Uptr numBytes);
+
+	// Replaces the virtual pages starting at baseVirtualAddress with a private copy-on-write view of
+	// the file contents starting at fileOffset. baseVirtualAddress and fileOffset must be multiples
+	// of the page size. The file must not be modified while the view is mapped.
+	// Returns true if successful. If unsuccessful, the pages are left committed for read-write
+	// access, but their contents are undefined.
+	PLATFORM_API bool mapFileCopyOnWrite(File* file,
+										 U64 fileOffset,
+										 U8* baseVirtualAddress,
+										 Uptr numPages);
 	PLATFORM_API std::string getCurrentWorkingDirectory();
 }}
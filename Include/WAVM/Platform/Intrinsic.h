@@ -7,6 +7,13 @@
 #include <intrin.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WAVM_HAS_SSE2 1
+#include <emmintrin.h>
+#else
+#define WAVM_HAS_SSE2 0
+#endif
+
 namespace WAVM { namespace Platform {
 	// The number of bytes in a cache line: assume 64 for now.
 	enum
@@ -63,6 +70,19 @@ namespace WAVM { namespace Platform {
 #endif
 	}
 
+	// Returns a mask with bit N set if the most-significant bit of bytes[N] is set, for the 16 bytes
+	// starting at bytes. The bytes don't need to be aligned.
+	inline U32 getMostSignificantBitMask16(const U8* bytes)
+	{
+#if WAVM_HAS_SSE2
+		return U32(_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)bytes)));
+#else
+		U32 result = 0;
+		for(Uptr index = 0; index < 16; ++index) { result |= U32(bytes[index] >> 7) << index; }
+		return result;
+#endif
+	}
+
 	inline U64 floorLogTwo(U64 value) { return value <= 1 ? 0 : 63 - countLeadingZeroes(value); }
 	inline U32 floorLogTwo(U32 value) { return value <= 1 ? 0 : 31 - countLeadingZeroes(value); }
 	inline U64 ceilLogTwo(U64 value)
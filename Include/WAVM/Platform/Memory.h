@@ -17,6 +17,10 @@ namespace WAVM { namespace Platform {
 	// Returns the base 2 logarithm of the smallest virtual page size.
 	PLATFORM_API Uptr getPageSizeLog2();
 
+	// Returns the base 2 logarithm of the huge page size that the OS may transparently use to back
+	// suitably aligned virtual pages, or of the smallest virtual page size if it isn't known.
+	PLATFORM_API Uptr getHugePageSizeLog2();
+
 	// Allocates virtual addresses without commiting physical pages to them.
 	// Returns the base virtual address of the allocated addresses, or nullptr if the virtual
 	// address space has been exhausted.
@@ -43,6 +47,16 @@ namespace WAVM { namespace Platform {
 										   Uptr numPages,
 										   MemoryAccess access);
 
+	// Advises the OS that the specified virtual pages should be backed by huge pages when they are
+	// committed. baseVirtualAddress must be a multiple of the preferred page size.
+	// Returns true if the advice was accepted, or false if huge pages are unsupported.
+	PLATFORM_API bool adviseHugeVirtualPages(U8* baseVirtualAddress, Uptr numPages);
+
+	// Faults in physical memory for the specified committed virtual pages, so the first access to
+	// each page doesn't incur a page fault. The contents of the pages are not changed.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	PLATFORM_API void prefaultVirtualPages(U8* baseVirtualAddress, Uptr numPages);
+
 	// Decommits the physical memory that was committed to the specified virtual pages.
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages);
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "WAVM/IR/Types.h"
@@ -15,6 +16,11 @@ namespace WAVM { namespace IR {
 	struct Module;
 }}
 
+// Declare Serialization::OutputStream to avoid including the definition.
+namespace WAVM { namespace Serialization {
+	struct OutputStream;
+}}
+
 // Declare the different kinds of objects. They are only declared as incomplete struct types here,
 // and Runtime clients will only handle opaque pointers to them.
 #define DECLARE_OBJECT_TYPE(kindId, kindName, Type)                                                \
@@ -233,6 +239,18 @@ namespace WAVM { namespace Runtime {
 														   Function* function,
 														   const IR::UntaggedValue* arguments);
 
+	// Invokes a Function once for each of numCalls argument tuples. argsArray contains the
+	// function's parameters for each call, packed as one UntaggedValue per parameter, and the
+	// results of each call are written to resultsArray as one UntaggedValue per result. All the
+	// calls are made from a single generated thunk, without returning to C++ between them. If a
+	// call throws an exception, the remaining calls are skipped, and the results of the calls
+	// before it have already been written.
+	RUNTIME_API void invokeFunctionBatch(Context* context,
+										 Function* function,
+										 const IR::UntaggedValue* argsArray,
+										 Uptr numCalls,
+										 IR::UntaggedValue* resultsArray);
+
 	// Like invokeFunctionUnchecked, but returns a result tagged with its type, and takes arguments
 	// as tagged values. If the wrong number or types or arguments are provided, a runtime exception
 	// is thrown.
@@ -243,6 +261,114 @@ namespace WAVM { namespace Runtime {
 	// Returns the type of a Function.
 	RUNTIME_API IR::FunctionType getFunctionType(Function* function);
 
+	//
+	// Fibers
+	//
+
+	// A fiber invokes a Function on its own stack, allocated by the runtime. Code called by the
+	// Function, such as an intrinsic function, may suspend the fiber, which returns control to the
+	// caller of resumeFiber. A suspended fiber may be resumed later by any thread, so many fibers
+	// that are blocked waiting for the host can share a few threads.
+	//
+	// A fiber uses its Context until the Function returns, so the Context must not be used by any
+	// other code while the fiber is suspended. Intrinsic functions that suspend a fiber must not
+	// depend on thread-local state across the suspension.
+	struct Fiber;
+
+	// Creates a fiber that will invoke a Function with the given arguments when it is first
+	// resumed. The fiber's stack has numStackBytes, and a guard page to detect stack overflow.
+	// Returns null if the stack couldn't be allocated.
+	RUNTIME_API Fiber* createFiber(Context* context,
+								   Function* function,
+								   std::vector<IR::Value>&& arguments,
+								   Uptr numStackBytes = 1024 * 1024);
+
+	// Destroys a fiber. The fiber must not be running. If the fiber is suspended, its stack is freed
+	// without unwinding it.
+	RUNTIME_API void destroyFiber(Fiber* fiber);
+
+	// Runs a fiber on the calling thread until it suspends, or the Function it invokes returns.
+	// Returns true if the Function returned, in which case the fiber must not be resumed again. If
+	// the Function throws a runtime exception, or an intrinsic function it calls throws a C++
+	// exception, the fiber returns, and resumeFiber rethrows the exception on the calling thread.
+	RUNTIME_API bool resumeFiber(Fiber* fiber);
+
+	// Returns the results of the Function invoked by a fiber, after resumeFiber returned true.
+	RUNTIME_API const IR::ValueTuple& getFiberResults(const Fiber* fiber);
+
+	// Suspends the fiber running on the calling thread, and returns when it is resumed. It is a
+	// fatal error to call this outside a fiber.
+	RUNTIME_API void suspendCurrentFiber();
+
+	// Returns the fiber running on the calling thread, or null if it isn't running a fiber.
+	RUNTIME_API Fiber* getCurrentFiber();
+
+	// Sets or gets a pointer that the embedder may associate with a fiber.
+	RUNTIME_API void setUserData(Fiber* fiber, void* userData);
+	RUNTIME_API void* getUserData(const Fiber* fiber);
+
+	//
+	// Waiting
+	//
+
+	// memory.atomic.wait blocks on a WaitEvent until memory.atomic.notify signals it, or it times
+	// out. By default, each thread waits on its own Platform::Event, but an embedder that runs
+	// WebAssembly threads as fibers on a pool of threads may provide a WaitEvent for each fiber that
+	// suspends the fiber, instead of blocking the thread running it.
+	struct WaitEvent
+	{
+		virtual ~WaitEvent() {}
+
+		// Waits until the event is signaled, or the monotonic clock reaches untilClock, and resets
+		// the event. Returns true if the event was signaled. If the event was signaled while nothing
+		// was waiting on it, returns true immediately.
+		virtual bool wait(U64 untilClock) = 0;
+
+		virtual void signal() = 0;
+	};
+
+	// Sets a function that returns the WaitEvent for the calling thread or fiber, or null to use
+	// the calling thread's own event.
+	RUNTIME_API void setWaitEventProvider(WaitEvent* (*provider)());
+
+	// Returns the WaitEvent for the calling thread or fiber.
+	RUNTIME_API WaitEvent* getCurrentWaitEvent();
+
+	//
+	// Profiling
+	//
+
+	// A Profiler periodically samples the call stacks of threads running WebAssembly code, and
+	// counts the samples by the WebAssembly functions and operators on the call stack.
+	struct Profiler;
+
+	// Starts sampling every sampleIntervalMicroseconds of CPU time. Returns null if sampling isn't
+	// supported on this platform, or if another profiler is already sampling.
+	RUNTIME_API Profiler* createProfiler(U64 sampleIntervalMicroseconds = 1000);
+
+	// Stops sampling, and counts the samples that were taken before it stopped. The samples can
+	// still be written until the profiler is destroyed.
+	RUNTIME_API void stopProfiler(Profiler* profiler);
+
+	// Stops sampling if it hasn't been stopped, and frees the profiler.
+	RUNTIME_API void destroyProfiler(Profiler* profiler);
+
+	// Writes the samples counted so far in the folded stack format used by flame graph tools: a
+	// line for each distinct call stack, with the frames from outermost to innermost separated by
+	// semicolons, followed by the number of samples. Each frame is "<function name>+<op index>".
+	RUNTIME_API void writeFoldedStacksProfile(Profiler* profiler,
+											  Serialization::OutputStream& stream);
+
+	// Writes the samples counted so far as an uncompressed pprof profile.proto message. The
+	// operator index of each frame is written as its line number.
+	RUNTIME_API void writePprofProfile(Profiler* profiler, Serialization::OutputStream& stream);
+
+	// Returns the number of samples counted so far in each WebAssembly function, by the function's
+	// debug name. Each sample is counted in the innermost WebAssembly function on its call stack,
+	// including samples that interrupted host code called by that function.
+	RUNTIME_API std::vector<std::pair<std::string, U64>> getFunctionSampleCounts(
+		Profiler* profiler);
+
 	//
 	// Tables
 	//
@@ -271,10 +397,27 @@ namespace WAVM { namespace Runtime {
 	// Memories
 	//
 
+	// Controls how physical pages are committed to a Memory's reserved address-space.
+	struct MemoryPolicy
+	{
+		// Aligns the memory's address-space reservation to the huge page size, and advises the OS
+		// to back its committed pages with transparent huge pages.
+		bool useHugePages = false;
+
+		// Faults in the pages for the memory's initial size when it is created, instead of on the
+		// first access to each page.
+		bool prefaultInitialPages = false;
+
+		// Faults in the pages added by growMemory before it returns, instead of on the first access
+		// to each page.
+		bool prefaultGrownPages = false;
+	};
+
 	// Creates a Memory. May return null if the memory allocation fails.
 	RUNTIME_API Memory* createMemory(Compartment* compartment,
 									 IR::MemoryType type,
-									 std::string&& debugName);
+									 std::string&& debugName,
+									 const MemoryPolicy& policy = MemoryPolicy());
 
 	// Gets the base address of the memory's data.
 	RUNTIME_API U8* getMemoryBaseAddress(Memory* memory);
@@ -347,21 +490,67 @@ namespace WAVM { namespace Runtime {
 	typedef const std::shared_ptr<Module>& ModuleRefParam;
 	typedef const std::shared_ptr<const Module>& ModuleConstRefParam;
 
-	// Compiles an IR module to object code.
-	RUNTIME_API ModuleRef compileModule(const IR::Module& irModule);
+	// Compiles an IR module to object code. The IR module is moved into the compiled module, or
+	// shared with it, instead of copied. Its function definitions are kept in the operator encoding
+	// they were loaded with, so to reduce the memory used by compiled modules, load the IR module
+	// with the compact encoding. If the IR module's function bodies were loaded lazily, this
+	// materializes them.
+	RUNTIME_API ModuleRef compileModule(IR::Module&& irModule);
+	RUNTIME_API ModuleRef compileModule(std::shared_ptr<const IR::Module> irModule);
+
+	// The state of a module that is compiled while it is loaded. Each function definition passed to
+	// compileFunctionDef is compiled on a background thread while the caller loads the rest of the
+	// module.
+	struct StreamingCompile;
+
+	// Begins compiling an IR module before the code of its function definitions is available. All
+	// the module's declarations, up to and including the function definitions' types, must already
+	// be in irModule. irModule must not be destroyed, and those declarations must not be modified,
+	// until the StreamingCompile is finished or aborted.
+	RUNTIME_API StreamingCompile* beginStreamingCompile(const IR::Module& irModule);
+
+	// Queues a function definition whose code has been added to the IR module for compilation. The
+	// IR module's function definition must not be modified after this call.
+	RUNTIME_API void compileFunctionDef(StreamingCompile* streamingCompile, Uptr functionDefIndex);
+
+	// Waits for the queued function definitions to be compiled, compiles any function definitions
+	// that weren't queued, and returns the compiled module. irModule must be the IR module passed
+	// to beginStreamingCompile, and is moved into the compiled module instead of copied. The
+	// StreamingCompile is deleted.
+	RUNTIME_API ModuleRef finishStreamingCompile(StreamingCompile* streamingCompile,
+												 IR::Module&& irModule);
+
+	// Stops compiling a module, and deletes the StreamingCompile.
+	RUNTIME_API void abortStreamingCompile(StreamingCompile* streamingCompile);
 
 	// Extracts the compiled object code for a module. This may be used as an input to
 	// loadPrecompiledModule to bypass redundant compilations of the module.
 	RUNTIME_API std::vector<U8> getObjectCode(ModuleConstRefParam module);
 
 	// Loads a previously compiled module from a combination of an IR module and the object code
-	// returned by getObjectCode for the previously compiled module.
-	RUNTIME_API ModuleRef loadPrecompiledModule(const IR::Module& irModule,
-												const std::vector<U8>& objectCode);
+	// returned by getObjectCode for the previously compiled module. Like compileModule, the IR
+	// module is moved or shared instead of copied.
+	RUNTIME_API ModuleRef loadPrecompiledModule(IR::Module&& irModule,
+												std::vector<U8>&& objectCode);
+	RUNTIME_API ModuleRef loadPrecompiledModule(std::shared_ptr<const IR::Module> irModule,
+												std::vector<U8>&& objectCode);
+
+	// Loads a previously compiled module from an IR module that contains its object code in a
+	// "wavm.precompiled_object" user section, as written by wavm-compile. The object code isn't
+	// copied, so if the IR module was loaded by WASM::loadBinaryModuleFromFile, it is read directly
+	// from the mapped file. Returns null if the IR module doesn't contain the section. The IR
+	// module's function bodies don't need to be decoded to use the object code, so they may be
+	// loaded lazily to skip decoding them.
+	RUNTIME_API ModuleRef loadPrecompiledModule(IR::Module&& irModule);
+	RUNTIME_API ModuleRef loadPrecompiledModule(std::shared_ptr<const IR::Module> irModule);
 
 	// Accesses the IR for a compiled module.
 	RUNTIME_API const IR::Module& getModuleIR(ModuleConstRefParam module);
 
+	// Returns a shared reference to a compiled module's IR, which may be passed to compileModule or
+	// loadPrecompiledModule to create another module from the same IR without copying it.
+	RUNTIME_API std::shared_ptr<const IR::Module> getSharedModuleIR(ModuleConstRefParam module);
+
 	// Instantiates a compiled module, bindings its imports to the specified objects. May throw a
 	// runtime exception for bad segment offsets.
 	RUNTIME_API ModuleInstance* instantiateModule(Compartment* compartment,
@@ -122,6 +122,11 @@ namespace WAVM { namespace Runtime {
 
 	typedef Runtime::ContextRuntimeData* (*InvokeThunkPointer)(Runtime::Function*,
 															   Runtime::ContextRuntimeData*);
+	typedef Runtime::ContextRuntimeData* (*InvokeBatchThunkPointer)(Runtime::Function*,
+																	Runtime::ContextRuntimeData*,
+																	const IR::UntaggedValue*,
+																	Uptr,
+																	IR::UntaggedValue*);
 
 	// Metadata about a function, used to hold data that can't be emitted directly in an object
 	// file, or must be mutable.
@@ -134,6 +139,7 @@ namespace WAVM { namespace Runtime {
 		std::map<U32, U32> offsetToOpIndexMap;
 		std::string debugName;
 		std::atomic<InvokeThunkPointer> invokeThunk{nullptr};
+		std::atomic<InvokeBatchThunkPointer> invokeBatchThunk{nullptr};
 		void* userData{nullptr};
 
 		FunctionMutableData(std::string&& inDebugName) : debugName(inDebugName) {}
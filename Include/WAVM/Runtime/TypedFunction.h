@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string.h>
+#include <type_traits>
+
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/Runtime/RuntimeData.h"
+
+namespace WAVM { namespace Runtime {
+
+	// Returns the invoke thunk for a Function's type. The thunk is created the first time it is
+	// needed, and cached in the Function.
+	RUNTIME_API InvokeThunkPointer getInvokeThunk(Function* function);
+
+	// The C++ type that a value of type T is stored as when passed to or returned from a
+	// WebAssembly function: integers narrower than 32 bits are widened to 32 bits.
+	template<typename T> struct InvokeValueType
+	{
+		typedef typename std::conditional<
+			IR::inferValueType<T>() == IR::ValueType::i32 && (sizeof(T) < sizeof(I32)),
+			typename std::conditional<std::is_signed<T>::value, I32, U32>::type,
+			T>::type Type;
+	};
+
+	template<typename Signature> struct TypedFunction;
+
+	// A Function bound to a Context, that may be invoked directly with C++ arguments. The Function's
+	// type is checked against the C++ signature once when the TypedFunction is created, and the
+	// layout of the arguments in ContextRuntimeData::thunkArgAndReturnData is computed then.
+	// Invoking it writes the arguments directly into the Context's ContextRuntimeData, and calls
+	// the Function's invoke thunk without allocating any memory. Like the Context it is bound to, a
+	// TypedFunction must only be invoked by one thread at a time.
+	template<typename R, typename... Args> struct TypedFunction<R(Args...)>
+	{
+		TypedFunction() : function(nullptr), contextRuntimeData(nullptr), invokeThunk(nullptr) {}
+
+		// Throws ExceptionTypes::invokeSignatureMismatch if the function's type doesn't match the
+		// C++ signature.
+		TypedFunction(Context* context, Function* inFunction)
+		: function(inFunction), contextRuntimeData(nullptr), invokeThunk(nullptr)
+		{
+			errorUnless(isInCompartment(asObject(function), getCompartment(asObject(context))));
+
+			// The arguments must be subtypes of the function's parameters, and the function's results
+			// must be subtypes of the C++ result.
+			const IR::FunctionType functionType = getFunctionType(function);
+			const IR::TypeTuple paramTypes({IR::inferValueType<Args>()...});
+			if(!isSubtype(paramTypes, functionType.params())
+			   || !isSubtype(functionType.results(), IR::inferResultType<R>()))
+			{ throwException(ExceptionTypes::invokeSignatureMismatch); }
+
+			// Naturally align each argument, as invokeFunctionUnchecked does.
+			Uptr argDataOffset = 0;
+			for(Uptr argIndex = 0; argIndex < paramTypes.size(); ++argIndex)
+			{
+				const Uptr numArgBytes = getTypeByteWidth(functionType.params()[argIndex]);
+				argDataOffset = (argDataOffset + numArgBytes - 1) & -numArgBytes;
+				if(argDataOffset + numArgBytes > maxThunkArgAndReturnBytes)
+				{
+					// Throw an exception if the invoke uses too much memory for arguments.
+					throwException(ExceptionTypes::outOfMemory);
+				}
+				argOffsets[argIndex] = U32(argDataOffset);
+				argDataOffset += numArgBytes;
+			}
+
+			contextRuntimeData = getContextRuntimeData(context);
+			invokeThunk = getInvokeThunk(function);
+		}
+
+		R operator()(Args... args) const
+		{
+			wavmAssert(invokeThunk);
+			writeArgs(contextRuntimeData->thunkArgAndReturnData, argOffsets, args...);
+			ContextRuntimeData* resultContextRuntimeData = (*invokeThunk)(function, contextRuntimeData);
+			return readResult(resultContextRuntimeData->thunkArgAndReturnData, (R*)nullptr);
+		}
+
+		Function* getFunction() const { return function; }
+
+	private:
+		Function* function;
+		ContextRuntimeData* contextRuntimeData;
+		InvokeThunkPointer invokeThunk;
+		U32 argOffsets[sizeof...(Args) + 1];
+
+		static void writeArgs(U8* argData, const U32* argOffsets) {}
+
+		template<typename Arg, typename... RestArgs>
+		static void writeArgs(U8* argData, const U32* argOffsets, Arg arg, RestArgs... restArgs)
+		{
+			const typename InvokeValueType<Arg>::Type storedArg = arg;
+			memcpy(argData + argOffsets[0], &storedArg, sizeof(storedArg));
+			writeArgs(argData, argOffsets + 1, restArgs...);
+		}
+
+		template<typename Result> static Result readResult(const U8* resultData, Result*)
+		{
+			typename InvokeValueType<Result>::Type storedResult;
+			memcpy(&storedResult, resultData, sizeof(storedResult));
+			return Result(storedResult);
+		}
+
+		static void readResult(const U8* resultData, void*) {}
+	};
+}}
@@ -16,5 +16,30 @@ namespace WAVM { namespace WASI {
 						   std::vector<std::string>&& inEnvs,
 						   I32& outExitCode);
 
+	// A worker runs many WASI processes on the thread that calls runWorker. Each process runs on
+	// its own fiber. When a process would block waiting for I/O, or in poll_oneoff, it is suspended
+	// until the worker's event loop finds that it may continue, and the worker runs other processes
+	// in the meantime.
+	struct Worker;
+
+	WASI_API Worker* createWorker();
+
+	// Destroys a worker, and any processes that haven't exited.
+	WASI_API void destroyWorker(Worker* worker);
+
+	// Creates a process that runs on a worker. The process doesn't start running until runWorker
+	// is called. When the process exits, its exit code is written to outExitCode, which must stay
+	// valid until then. If the result isn't RunResult::success, the process wasn't created.
+	WASI_API RunResult addProcess(Worker* worker,
+								  Runtime::ModuleConstRefParam module,
+								  std::vector<std::string>&& inArgs,
+								  std::vector<std::string>&& inEnvs,
+								  I32& outExitCode);
+
+	// Runs a worker's processes until they have all exited. If a process throws a runtime
+	// exception, it is rethrown by runWorker, and the other processes may be resumed by calling
+	// runWorker again.
+	WASI_API void runWorker(Worker* worker);
+
 	WASI_API void setTraceSyscalls(bool newTraceSyscalls);
 }}
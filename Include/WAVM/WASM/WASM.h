@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "WAVM/IR/Validate.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Logging/Logging.h"
@@ -18,9 +21,85 @@ namespace WAVM { namespace WASM {
 	WASM_API void serialize(Serialization::InputStream& stream, IR::Module& module);
 	WASM_API void serialize(Serialization::OutputStream& stream, const IR::Module& module);
 
-	// Loads a binary module, catching any exceptions that might be
+	// Whether loading a binary module decodes its function bodies into the IR, or only records where
+	// each function body's code is. Lazily loaded function bodies are still validated when the
+	// module is loaded, so loading fails if any of them are invalid, but they aren't decoded into
+	// the IR until they are materialized by IR::materializeFunctionDef. lazyIfValidated only loads
+	// the function bodies lazily if the module has a validated section that matches its contents,
+	// and trusts the section instead of validating them.
+	enum class FunctionBodyDecoding
+	{
+		eager,
+		lazy,
+		lazyIfValidated
+	};
+
+	// Appends a user section to a serialized binary module.
+	WASM_API void addUserSection(std::vector<U8>& wasmBytes,
+								 const std::string& name,
+								 const std::vector<U8>& data);
+
+	// Adds a "wavm.validated" user section to a serialized binary module, to record that the module
+	// was validated when it was written. The section contains a hash of the module's other
+	// sections, excluding user sections, so it won't match if they are modified. The hash guards
+	// against accidental changes, not tampering: loading function bodies lazily because of it
+	// trusts the module's author as much as running the module's precompiled object code does. The
+	// module must not already have a validated section.
+	WASM_API void addValidatedSection(std::vector<U8>& wasmBytes);
+
+	// Loads a binary module, catching any exceptions that might be thrown. numDecodeThreads is the
+	// maximum number of threads, including the calling thread, to deserialize the module's function
+	// bodies on; 0 means one per hardware thread. The function bodies are only deserialized in
+	// parallel if there are enough of them, and the extra threads are created for each load, so
+	// only callers that load large modules should allow more than one. The errors reported for an
+	// invalid module don't depend on the number of threads.
 	WASM_API bool loadBinaryModule(const void* wasmBytes,
 								   Uptr numBytes,
 								   IR::Module& outModule,
+								   Log::Category errorCategory = Log::error,
+								   FunctionBodyDecoding functionBodyDecoding
+								   = FunctionBodyDecoding::eager,
+								   Uptr numDecodeThreads = 1);
+
+	// Receives notifications from loadBinaryModule as it loads a module from a stream.
+	struct StreamingLoadCallbacks
+	{
+		virtual ~StreamingLoadCallbacks() {}
+
+		// Called when the code section's header has been read. All the declarations that precede
+		// the code section, including the function definitions' types, are in the module, but the
+		// function definitions' code is not.
+		virtual void onCodeSectionStart(const IR::Module& module) {}
+
+		// Called after each function definition's code has been deserialized and validated. The
+		// function definition will not be modified again by the loader.
+		virtual void onFunctionDefLoaded(const IR::Module& module, Uptr functionDefIndex) {}
+	};
+
+	// Loads a binary module from a stream that may pull the module's bytes in chunks, catching any
+	// exceptions that might be thrown. If callbacks is non-null, the code section is read and
+	// deserialized one function body at a time, and callbacks is notified as each function body is
+	// loaded. This allows a function body to be processed while the rest of the module is read.
+	WASM_API bool loadBinaryModule(Serialization::InputStream& stream,
+								   IR::Module& outModule,
+								   StreamingLoadCallbacks* callbacks = nullptr,
 								   Log::Category errorCategory = Log::error);
+
+	// Loads a binary module from a file. The file is mapped into memory instead of read, and the
+	// module's data segments, user sections, and lazily loaded function bodies borrow their bytes
+	// from the mapping. numDecodeThreads is the same as for loadBinaryModule.
+	// If mapDataSegments is true, the runtime maps the pages of the file that a data segment wholly
+	// covers directly into a memory when the module is instantiated, instead of copying them. The
+	// pages are private copy-on-write mappings, so the guest's writes don't change the file, but
+	// the file's contents are only copied when the guest writes to a page.
+	// The file must not be modified or truncated while the module or any instance of it exists:
+	// rewriting it may change the contents of an instance's memory, and truncating it causes a
+	// SIGBUS when the guest or the runtime touches a page past the end of the file.
+	WASM_API bool loadBinaryModuleFromFile(const char* filename,
+										   IR::Module& outModule,
+										   Log::Category errorCategory = Log::error,
+										   FunctionBodyDecoding functionBodyDecoding
+										   = FunctionBodyDecoding::eager,
+										   Uptr numDecodeThreads = 1,
+										   bool mapDataSegments = false);
 }}
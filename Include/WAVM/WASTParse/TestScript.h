@@ -81,7 +81,9 @@ namespace WAVM { namespace WAST {
 	struct ModuleAction : Action
 	{
 		std::string internalModuleName;
-		std::unique_ptr<IR::Module> module;
+
+		// Shared so it can be compiled without copying it each time the action is run.
+		std::shared_ptr<IR::Module> module;
 		ModuleAction(TextFileLocus&& inLocus,
 					 std::string&& inInternalModuleName,
 					 IR::Module* inModule)
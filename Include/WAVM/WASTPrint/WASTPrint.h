@@ -7,7 +7,23 @@ namespace WAVM { namespace IR {
 	struct Module;
 }}
 
+namespace WAVM { namespace Serialization {
+	struct OutputStream;
+}}
+
 namespace WAVM { namespace WAST {
 	// Prints a module in WAST format.
 	WASTPRINT_API std::string print(const IR::Module& module);
+
+	// Prints a module in WAST format to a stream. The text is written to the stream in chunks as it
+	// is printed, so only a bounded amount of it is buffered in memory.
+	WASTPRINT_API void print(Serialization::OutputStream& stream, const IR::Module& module);
+
+	// Prints the module's function definitions in [beginFunctionDefIndex,endFunctionDefIndex) in
+	// WAST format to a stream, named as they would be when printing the whole module. Only the
+	// printed function definitions are materialized if the module was loaded lazily.
+	WASTPRINT_API void printFunctionDefs(Serialization::OutputStream& stream,
+										 const IR::Module& module,
+										 Uptr beginFunctionDefIndex,
+										 Uptr endFunctionDefIndex);
 }}
@@ -880,6 +880,24 @@ void Emscripten::initializeGlobals(Emscripten::Instance* instance,
 	}
 }
 
+Emscripten::Instance* Emscripten::instantiate(Compartment* compartment, ModuleConstRefParam module)
+{
+	return instantiate(compartment, getModuleIR(module));
+}
+
+void Emscripten::initializeGlobals(Emscripten::Instance* instance,
+								   Context* context,
+								   ModuleConstRefParam module,
+								   ModuleInstance* moduleInstance)
+{
+	initializeGlobals(instance, context, getModuleIR(module), moduleInstance);
+}
+
+U32 Emscripten::allocateMemory(Emscripten::Instance* instance, U32 numBytes)
+{
+	return dynamicAlloc(instance, numBytes);
+}
+
 void Emscripten::injectCommandArgs(Emscripten::Instance* instance,
 								   const std::vector<const char*>& argStrings,
 								   std::vector<IR::Value>& outInvokeArgs)
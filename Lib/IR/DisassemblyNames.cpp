@@ -272,7 +272,7 @@ void IR::getDisassemblyNames(const Module& module, DisassemblyNames& outNames)
 		try
 		{
 			const UserSection& nameSection = module.userSections[userSectionIndex];
-			MemoryInputStream stream(nameSection.data.data(), nameSection.data.size());
+			MemoryInputStream stream(nameSection.getBytes(), nameSection.getNumBytes());
 
 			while(stream.capacity()) { deserializeNameSubsection(module, outNames, stream); };
 		}
@@ -406,5 +406,7 @@ void IR::setDisassemblyNames(Module& module, const DisassemblyNames& names)
 			});
 	}
 
-	module.userSections[userSectionIndex].data = stream.getBytes();
+	UserSection& nameSection = module.userSections[userSectionIndex];
+	nameSection.data = stream.getBytes();
+	nameSection.mappedFile.reset();
 }
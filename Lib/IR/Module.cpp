@@ -0,0 +1,63 @@
+#include "WAVM/IR/Module.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Lock.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Mutex.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+MappedModuleFile::~MappedModuleFile()
+{
+	Platform::unmapFile(bytes, numBytes);
+	errorUnless(Platform::closeFile(file));
+}
+
+void IR::materializeFunctionDef(const Module& module, Uptr functionDefIndex)
+{
+	wavmAssert(functionDefIndex < module.functions.defs.size());
+	const FunctionDef& functionDef = module.functions.defs[functionDefIndex];
+
+	// The acquire load synchronizes with the release store that clears isLazy below, so if the
+	// function definition has already been materialized, its code may be read without the lock.
+	if(!functionDef.isLazy.value.load(std::memory_order_acquire)) { return; }
+
+	LazyFunctionBodies* lazyFunctionBodies = module.lazyFunctionBodies.get();
+	wavmAssert(lazyFunctionBodies);
+
+	// Decode the code without holding the lock, so other function definitions may be materialized
+	// concurrently. The function definition's type, locals, and lazy code range aren't modified
+	// after the module is loaded, so they may be read without holding the lock.
+	FunctionDef decodedFunctionDef{functionDef.type, functionDef.nonParameterLocalTypes, {}, {}};
+	(*lazyFunctionBodies->decodeCode)(module,
+									  decodedFunctionDef,
+									  lazyFunctionBodies->getBytes() + functionDef.lazyCodeOffset,
+									  functionDef.numLazyCodeBytes);
+
+	// If another thread materialized the function definition while this thread was decoding it,
+	// just discard this thread's result.
+	Lock<Platform::Mutex> lazyLock(lazyFunctionBodies->mutex);
+	if(functionDef.isLazy.value.load(std::memory_order_relaxed))
+	{
+		functionDef.code = std::move(decodedFunctionDef.code);
+		functionDef.branchTables = std::move(decodedFunctionDef.branchTables);
+		functionDef.isLazy.value.store(false, std::memory_order_release);
+	}
+}
+
+void IR::materializeFunctionDefs(const Module& module)
+{
+	if(!module.lazyFunctionBodies) { return; }
+
+	for(Uptr functionDefIndex = 0; functionDefIndex < module.functions.defs.size();
+		++functionDefIndex)
+	{ materializeFunctionDef(module, functionDefIndex); }
+}
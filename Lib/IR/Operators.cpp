@@ -1,5 +1,12 @@
+#include <utility>
+#include <vector>
+
+#include "WAVM/IR/Module.h"
 #include "WAVM/IR/Operators.h"
 #include "WAVM/IR/Types.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Serialization.h"
 
 using namespace WAVM;
 using namespace WAVM::IR;
@@ -25,3 +32,41 @@ const IR::NonParametricOpSignatures& IR::getNonParametricOpSigs()
 	};
 	return nonParametricOpSignatures;
 }
+
+// Forwards decoded operators to an OperatorEncoderStream.
+struct OperatorReencoder
+{
+	typedef void Result;
+
+	OperatorEncoderStream& encoder;
+
+#define VISIT_OPCODE(_, name, nameString, Imm, ...)                                                \
+	void name(Imm imm) { encoder.name(imm); }
+	ENUM_OPERATORS(VISIT_OPCODE)
+#undef VISIT_OPCODE
+
+	void unknown(Opcode opcode) { Errors::unreachable(); }
+};
+
+void IR::setOperatorEncoding(Module& module, OperatorEncoding encoding)
+{
+	if(module.operatorEncoding == encoding) { return; }
+
+	for(FunctionDef& functionDef : module.functions.defs)
+	{
+		if(functionDef.isLazy.value.load(std::memory_order_acquire)) { continue; }
+
+		Serialization::ArrayOutputStream codeStream;
+		OperatorEncoderStream encoder(codeStream, encoding);
+		OperatorReencoder reencoder{encoder};
+
+		OperatorDecoderStream decoder(functionDef.code, module.operatorEncoding);
+		while(decoder) { decoder.decodeOp(reencoder); };
+
+		// ArrayOutputStream over-allocates its buffer, so release the unused capacity.
+		functionDef.code = std::move(codeStream.getBytes());
+		functionDef.code.shrink_to_fit();
+	}
+
+	module.operatorEncoding = encoding;
+}
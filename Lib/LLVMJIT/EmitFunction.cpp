@@ -402,7 +402,7 @@ void EmitFunctionContext::emit()
 	}
 
 	// Decode the WebAssembly opcodes and emit LLVM IR for them.
-	OperatorDecoderStream decoder(functionDef.code);
+	OperatorDecoderStream decoder(functionDef.code, irModule.operatorEncoding);
 	UnreachableOpVisitor unreachableOpVisitor(*this);
 	OperatorPrinter operatorPrinter(irModule, functionDef);
 	Uptr opIndex = 0;
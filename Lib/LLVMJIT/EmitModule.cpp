@@ -8,6 +8,7 @@
 #include "WAVM/IR/Types.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Metrics.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include "llvm/ADT/Twine.h"
@@ -89,15 +90,14 @@ static llvm::Constant* createImportedConstant(llvm::Module& llvmModule, llvm::Tw
 									externalName);
 }
 
-void LLVMJIT::emitModule(const IR::Module& irModule,
-						 LLVMContext& llvmContext,
-						 llvm::Module& outLLVMModule)
+void LLVMJIT::emitModuleDeclarations(EmitModuleContext& moduleContext)
 {
-	Timing::Timer emitTimer;
-	EmitModuleContext moduleContext(irModule, llvmContext, &outLLVMModule);
+	const IR::Module& irModule = moduleContext.irModule;
+	LLVMContext& llvmContext = moduleContext.llvmContext;
+	llvm::Module& outLLVMModule = *moduleContext.llvmModule;
 
 	// Create an external reference to the appropriate exception personality function.
-	auto personalityFunction
+	moduleContext.personalityFunction
 		= llvm::Function::Create(llvm::FunctionType::get(llvmContext.i32Type, {}, false),
 								 llvm::GlobalValue::LinkageTypes::ExternalLinkage,
 								 USE_WINDOWS_SEH ? "__CxxFrameHandler3" : "__gxx_personality_v0",
@@ -218,34 +218,55 @@ void LLVMJIT::emitModule(const IR::Module& irModule,
 		function->setCallingConv(asLLVMCallingConv(CallingConvention::wasm));
 		moduleContext.functions[functionIndex] = function;
 	}
+}
 
-	// Compile each function in the module.
-	for(Uptr functionDefIndex = 0; functionDefIndex < irModule.functions.defs.size();
-		++functionDefIndex)
-	{
-		const FunctionDef& functionDef = irModule.functions.defs[functionDefIndex];
-		llvm::Function* function
-			= moduleContext.functions[irModule.functions.imports.size() + functionDefIndex];
+void LLVMJIT::emitFunctionDef(EmitModuleContext& moduleContext, Uptr functionDefIndex)
+{
+	const IR::Module& irModule = moduleContext.irModule;
+	LLVMContext& llvmContext = moduleContext.llvmContext;
 
-		function->setPersonalityFn(personalityFunction);
+	materializeFunctionDef(irModule, functionDefIndex);
+	const FunctionDef& functionDef = irModule.functions.defs[functionDefIndex];
+	llvm::Function* function
+		= moduleContext.functions[irModule.functions.imports.size() + functionDefIndex];
 
-		llvm::Constant* functionDefMutableData = createImportedConstant(
-			outLLVMModule, getExternalName("functionDefMutableDatas", functionDefIndex));
-		llvm::Constant* functionDefMutableDataAsIptr
-			= llvm::ConstantExpr::getPtrToInt(functionDefMutableData, llvmContext.iptrType);
+	function->setPersonalityFn(moduleContext.personalityFunction);
 
-		setRuntimeFunctionPrefix(llvmContext,
-								 function,
-								 functionDefMutableDataAsIptr,
-								 moduleContext.moduleInstanceId,
-								 moduleContext.typeIds[functionDef.type.index]);
-		setFramePointerAttribute(function);
+	llvm::Constant* functionDefMutableData = createImportedConstant(
+		*moduleContext.llvmModule, getExternalName("functionDefMutableDatas", functionDefIndex));
+	llvm::Constant* functionDefMutableDataAsIptr
+		= llvm::ConstantExpr::getPtrToInt(functionDefMutableData, llvmContext.iptrType);
 
-		EmitFunctionContext(llvmContext, moduleContext, irModule, functionDef, function).emit();
-	}
+	setRuntimeFunctionPrefix(llvmContext,
+							 function,
+							 functionDefMutableDataAsIptr,
+							 moduleContext.moduleInstanceId,
+							 moduleContext.typeIds[functionDef.type.index]);
+	setFramePointerAttribute(function);
+
+	EmitFunctionContext(llvmContext, moduleContext, irModule, functionDef, function).emit();
+}
+
+Metrics::Histogram LLVMJIT::emitModuleMicroseconds(
+	"wavm_llvmjit_emit_ir_microseconds",
+	"Time taken to emit LLVM IR for a WebAssembly module, in microseconds");
+
+void LLVMJIT::emitModule(const IR::Module& irModule,
+						 LLVMContext& llvmContext,
+						 llvm::Module& outLLVMModule)
+{
+	Timing::Timer emitTimer;
+	EmitModuleContext moduleContext(irModule, llvmContext, &outLLVMModule);
+
+	// Emit the module's declarations, and then compile each function in the module.
+	emitModuleDeclarations(moduleContext);
+	for(Uptr functionDefIndex = 0; functionDefIndex < irModule.functions.defs.size();
+		++functionDefIndex)
+	{ emitFunctionDef(moduleContext, functionDefIndex); }
 
 	// Finalize the debug info.
 	moduleContext.diBuilder.finalize();
 
+	emitModuleMicroseconds.record(emitTimer.getMicroseconds());
 	Timing::logRatePerSecond("Emitted LLVM IR", emitTimer, (F64)outLLVMModule.size(), "functions");
 }
@@ -43,6 +43,8 @@ namespace WAVM { namespace LLVMJIT {
 		llvm::Function* cxaEndCatchFunction = nullptr;
 		llvm::Constant* runtimeExceptionTypeInfo = nullptr;
 
+		llvm::Function* personalityFunction = nullptr;
+
 		EmitModuleContext(const IR::Module& inModule,
 						  LLVMContext& inLLVMContext,
 						  llvm::Module* inLLVMModule);
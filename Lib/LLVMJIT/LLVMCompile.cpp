@@ -5,6 +5,7 @@
 #include <utility>
 #include <vector>
 
+#include "EmitModuleContext.h"
 #include "LLVMJITPrivate.h"
 #include "WAVM/IR/Module.h"
 #include "WAVM/Inline/Assert.h"
@@ -13,6 +14,7 @@
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Defines.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
@@ -96,6 +98,13 @@ private:
 	std::vector<U8> output;
 };
 
+static Metrics::Histogram optimizeMicroseconds(
+	"wavm_llvmjit_optimize_microseconds",
+	"Time taken to optimize the LLVM IR for a WebAssembly module, in microseconds");
+static Metrics::Histogram codegenMicroseconds(
+	"wavm_llvmjit_codegen_microseconds",
+	"Time taken to generate machine code for a WebAssembly module, in microseconds");
+
 static void optimizeLLVMModule(llvm::Module& llvmModule, bool shouldLogMetrics)
 {
 	// Run some optimization on the module's functions.
@@ -113,6 +122,7 @@ static void optimizeLLVMModule(llvm::Module& llvmModule, bool shouldLogMetrics)
 
 	if(shouldLogMetrics)
 	{
+		optimizeMicroseconds.record(optimizationTimer.getMicroseconds());
 		Timing::logRatePerSecond(
 			"Optimized LLVM module", optimizationTimer, (F64)llvmModule.size(), "functions");
 	}
@@ -171,6 +181,7 @@ std::vector<U8> LLVMJIT::compileLLVMModule(LLVMContext& llvmContext,
 	}
 	if(shouldLogMetrics)
 	{
+		codegenMicroseconds.record(machineCodeTimer.getMicroseconds());
 		Timing::logRatePerSecond(
 			"Generated machine code", machineCodeTimer, (F64)llvmModule.size(), "functions");
 	}
@@ -202,3 +213,59 @@ std::vector<U8> LLVMJIT::compileModule(const IR::Module& irModule)
 	// Compile the LLVM IR to object code.
 	return compileLLVMModule(llvmContext, std::move(llvmModule), true);
 }
+
+struct LLVMJIT::StreamingModuleCompiler
+{
+	LLVMContext llvmContext;
+	llvm::Module llvmModule;
+	EmitModuleContext moduleContext;
+	std::vector<bool> isFunctionDefEmitted;
+	Timing::Timer emitTimer;
+
+	StreamingModuleCompiler(const IR::Module& irModule)
+	: llvmModule("", llvmContext)
+	, moduleContext(irModule, llvmContext, &llvmModule)
+	, isFunctionDefEmitted(irModule.functions.defs.size(), false)
+	{
+	}
+};
+
+LLVMJIT::StreamingModuleCompiler* LLVMJIT::beginStreamingCompile(const IR::Module& irModule)
+{
+	StreamingModuleCompiler* compiler = new StreamingModuleCompiler(irModule);
+	emitModuleDeclarations(compiler->moduleContext);
+	return compiler;
+}
+
+void LLVMJIT::compileFunctionDef(StreamingModuleCompiler* compiler, Uptr functionDefIndex)
+{
+	wavmAssert(functionDefIndex < compiler->isFunctionDefEmitted.size());
+	wavmAssert(!compiler->isFunctionDefEmitted[functionDefIndex]);
+	emitFunctionDef(compiler->moduleContext, functionDefIndex);
+	compiler->isFunctionDefEmitted[functionDefIndex] = true;
+}
+
+std::vector<U8> LLVMJIT::finishStreamingCompile(StreamingModuleCompiler* compiler)
+{
+	std::unique_ptr<StreamingModuleCompiler> compilerPtr(compiler);
+
+	// Emit any function definitions that weren't passed to compileFunctionDef.
+	for(Uptr functionDefIndex = 0; functionDefIndex < compiler->isFunctionDefEmitted.size();
+		++functionDefIndex)
+	{
+		if(!compiler->isFunctionDefEmitted[functionDefIndex])
+		{ compileFunctionDef(compiler, functionDefIndex); }
+	}
+
+	// Finalize the debug info.
+	compiler->moduleContext.diBuilder.finalize();
+
+	emitModuleMicroseconds.record(compiler->emitTimer.getMicroseconds());
+	Timing::logRatePerSecond(
+		"Emitted LLVM IR", compiler->emitTimer, (F64)compiler->llvmModule.size(), "functions");
+
+	// Compile the LLVM IR to object code.
+	return compileLLVMModule(compiler->llvmContext, std::move(compiler->llvmModule), true);
+}
+
+void LLVMJIT::abortStreamingCompile(StreamingModuleCompiler* compiler) { delete compiler; }
@@ -4,6 +4,7 @@
 #include "WAVM/IR/Operators.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Runtime/RuntimeData.h"
 
 #include <cctype>
@@ -70,6 +71,8 @@ namespace llvm {
 }
 
 namespace WAVM { namespace LLVMJIT {
+	struct EmitModuleContext;
+
 	typedef llvm::SmallVector<llvm::Value*, 1> ValueVector;
 	typedef llvm::SmallVector<llvm::PHINode*, 1> PHIVector;
 
@@ -317,11 +320,23 @@ namespace WAVM { namespace LLVMJIT {
 		return std::string(baseName) + std::to_string(index);
 	}
 
+	// The time it takes to emit LLVM IR for a module, whether it is compiled all at once or one
+	// function definition at a time.
+	extern Metrics::Histogram emitModuleMicroseconds;
+
 	// Emits LLVM IR for a module.
 	void emitModule(const IR::Module& irModule,
 					LLVMContext& llvmContext,
 					llvm::Module& outLLVMModule);
 
+	// Emits the LLVM declarations for a module's imports and definitions, without emitting the
+	// bodies of its function definitions.
+	void emitModuleDeclarations(EmitModuleContext& moduleContext);
+
+	// Emits the LLVM IR body of a function definition. emitModuleDeclarations must have been called
+	// on the EmitModuleContext first.
+	void emitFunctionDef(EmitModuleContext& moduleContext, Uptr functionDefIndex);
+
 	// Used to override LLVM's default behavior of looking up unresolved symbols in DLL exports.
 	llvm::JITEvaluatedSymbol resolveJITImport(llvm::StringRef name);
 
@@ -333,7 +348,8 @@ namespace WAVM { namespace LLVMJIT {
 		std::map<Uptr, Runtime::Function*> addressToFunctionMap;
 		HashMap<std::string, Runtime::Function*> nameToFunctionMap;
 
-		Module(const std::vector<U8>& inObjectBytes,
+		Module(const U8* inObjectBytes,
+			   Uptr numObjectBytes,
 			   const HashMap<std::string, Uptr>& importedSymbolMap,
 			   bool shouldLogMetrics);
 		~Module();
@@ -349,6 +365,14 @@ namespace WAVM { namespace LLVMJIT {
 #endif
 	};
 
+	// Tells perf about the functions in a module that was just loaded, if enablePerfMap or
+	// enablePerfJITDump was called.
+	extern void notifyPerfModuleLoaded(const Module* module);
+
+	// Returns whether enablePerfMap was called. Since perf maps can't describe unloaded code, the
+	// address ranges of unloaded modules must not be reused while the perf map is enabled.
+	extern bool isPerfMapEnabled();
+
 	extern std::vector<U8> compileLLVMModule(LLVMContext& llvmContext,
 											 llvm::Module&& llvmModule,
 											 bool shouldLogMetrics);
@@ -20,6 +20,7 @@
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/Signal.h"
@@ -59,6 +60,10 @@ using namespace WAVM::LLVMJIT;
 static Platform::Mutex gdbRegistrationListenerMutex;
 static llvm::JITEventListener* gdbRegistrationListener = nullptr;
 
+static Metrics::Histogram loadObjectMicroseconds(
+	"wavm_llvmjit_load_object_microseconds",
+	"Time taken to load the object code for a WebAssembly module, in microseconds");
+
 // A map from address to loaded JIT symbols.
 static Platform::Mutex addressToModuleMapMutex;
 static std::map<Uptr, LLVMJIT::Module*> addressToModuleMap;
@@ -80,12 +85,13 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 		// Deregister the exception handling frame info.
 		deregisterEHFrames();
 
-		if(!KEEP_UNLOADED_MODULE_ADDRESSES_RESERVED)
+		if(!KEEP_UNLOADED_MODULE_ADDRESSES_RESERVED && !isPerfMapEnabled())
 		{ Platform::freeVirtualPages(imageBaseAddress, numAllocatedImagePages); }
 		else
 		{
 			// Decommit the image pages, but leave them reserved to catch any references to them
-			// that might erroneously remain.
+			// that might erroneously remain, or so the perf map entries for the unloaded
+			// functions don't describe code that is later loaded at the same address.
 			Platform::decommitVirtualPages(imageBaseAddress, numAllocatedImagePages);
 		}
 	}
@@ -292,12 +298,13 @@ static void disassembleFunction(U8* bytes, Uptr numBytes)
 	LLVMDisasmDispose(disasmRef);
 }
 
-Module::Module(const std::vector<U8>& objectBytes,
+Module::Module(const U8* inObjectBytes,
+			   Uptr numObjectBytes,
 			   const HashMap<std::string, Uptr>& importedSymbolMap,
 			   bool shouldLogMetrics)
 : memoryManager(new ModuleMemoryManager())
 #if LLVM_VERSION_MAJOR < 8
-, objectBytes(objectBytes)
+, objectBytes(inObjectBytes, inObjectBytes + numObjectBytes)
 #endif
 {
 	Timing::Timer loadObjectTimer;
@@ -307,7 +314,7 @@ Module::Module(const std::vector<U8>& objectBytes,
 #endif
 
 	object = cantFail(llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef(
-		llvm::StringRef((const char*)objectBytes.data(), objectBytes.size()), "memory")));
+		llvm::StringRef((const char*)inObjectBytes, numObjectBytes), "memory")));
 
 	// Create the LLVM object loader.
 	struct SymbolResolver : llvm::JITSymbolResolver
@@ -547,6 +554,9 @@ Module::Module(const std::vector<U8>& objectBytes,
 		function->mutableData->offsetToOpIndexMap = std::move(std::move(offsetToOpIndexMap));
 	}
 
+	// Notify perf of the new functions.
+	notifyPerfModuleLoaded(this);
+
 	const Uptr moduleEndAddress = reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress()
 														 + memoryManager->getNumImageBytes());
 	{
@@ -556,8 +566,9 @@ Module::Module(const std::vector<U8>& objectBytes,
 
 	if(shouldLogMetrics)
 	{
+		loadObjectMicroseconds.record(loadObjectTimer.getMicroseconds());
 		Timing::logRatePerSecond(
-			"Loaded object", loadObjectTimer, (F64)objectBytes.size() / 1024.0 / 1024.0, "MB");
+			"Loaded object", loadObjectTimer, (F64)numObjectBytes / 1024.0 / 1024.0, "MB");
 	}
 }
 
@@ -586,7 +597,8 @@ Module::~Module()
 }
 
 std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
-	const std::vector<U8>& objectFileBytes,
+	const U8* objectFileBytes,
+	Uptr numObjectFileBytes,
 	HashMap<std::string, FunctionBinding>&& wavmIntrinsicsExportMap,
 	std::vector<IR::FunctionType>&& types,
 	std::vector<FunctionBinding>&& functionImports,
@@ -707,7 +719,7 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 #endif
 
 	// Load the module.
-	return std::make_shared<Module>(objectFileBytes, importedSymbolMap, true);
+	return std::make_shared<Module>(objectFileBytes, numObjectFileBytes, importedSymbolMap, true);
 }
 
 Runtime::Function* LLVMJIT::getFunctionByAddress(Uptr address)
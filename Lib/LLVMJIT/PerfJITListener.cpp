@@ -0,0 +1,325 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "LLVMJITPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Lock.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Runtime/RuntimeData.h"
+
+#ifdef __linux__
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::LLVMJIT;
+
+// Tells the Linux perf tool about JIT functions, so it can attribute samples in them to the
+// WebAssembly functions they were compiled from. There are two ways to do that:
+// - A perf map is a text file at /tmp/perf-<pid>.map with a line for each function's address
+//   range and name, that perf report reads when it finds samples in anonymous executable memory.
+// - A jitdump file is a binary log of the code that was loaded over time, including the code
+//   bytes and line info, that perf inject --jit merges into a perf.data file recorded with -k 1.
+//   This describes each function's code at the time it was sampled, so it remains correct if the
+//   address of an unloaded function is reused by another function.
+// Since a perf map can't express that a function was unloaded, the address ranges of unloaded
+// modules aren't reused while the perf map is enabled.
+
+#ifdef __linux__
+
+// The jitdump format is specified in tools/perf/Documentation/jitdump-specification.txt in the
+// Linux source tree.
+enum
+{
+	jitDumpMagic = 0x4A695444,
+	jitDumpVersion = 1
+};
+
+enum class JITDumpRecordId : U32
+{
+	codeLoad = 0,
+	codeMove = 1,
+	debugInfo = 2,
+	close = 3
+};
+
+struct JITDumpFileHeader
+{
+	U32 magic;
+	U32 version;
+	U32 numHeaderBytes;
+	U32 elfMachine;
+	U32 padding;
+	U32 pid;
+	U64 timestamp;
+	U64 flags;
+};
+
+struct JITDumpRecordHeader
+{
+	JITDumpRecordId id;
+	U32 numRecordBytes;
+	U64 timestamp;
+};
+
+struct JITDumpCodeLoadRecord
+{
+	JITDumpRecordHeader header;
+	U32 pid;
+	U32 tid;
+	U64 vma;
+	U64 codeAddress;
+	U64 numCodeBytes;
+	U64 codeIndex;
+	// Followed by the null-terminated function name and the code bytes.
+};
+
+struct JITDumpDebugInfoRecord
+{
+	JITDumpRecordHeader header;
+	U64 codeAddress;
+	U64 numEntries;
+	// Followed by the entries.
+};
+
+struct JITDumpDebugInfoEntry
+{
+	U64 address;
+	U32 line;
+	U32 discriminator;
+	// Followed by the null-terminated file name.
+};
+
+static Platform::Mutex perfMutex;
+static int perfMapFD = -1;
+static int jitDumpFD = -1;
+static void* jitDumpMarker = nullptr;
+static U64 nextJITDumpCodeIndex = 0;
+
+// perf record uses CLOCK_MONOTONIC for its timestamps when passed -k 1, so jitdump records must
+// use the same clock.
+static U64 getJITDumpTimestamp()
+{
+	timespec time;
+	errorUnless(!clock_gettime(CLOCK_MONOTONIC, &time));
+	return U64(time.tv_sec) * 1000000000 + U64(time.tv_nsec);
+}
+
+static bool writeAll(int fd, const void* data, Uptr numBytes)
+{
+	const U8* nextByte = (const U8*)data;
+	while(numBytes)
+	{
+		const ssize_t result = write(fd, nextByte, numBytes);
+		if(result < 0)
+		{
+			if(errno == EINTR) { continue; }
+			return false;
+		}
+		nextByte += result;
+		numBytes -= Uptr(result);
+	}
+	return true;
+}
+
+template<typename Value> static void appendBytes(std::vector<U8>& bytes, const Value& value)
+{
+	bytes.insert(bytes.end(), (const U8*)&value, (const U8*)&value + sizeof(Value));
+}
+
+static void appendString(std::vector<U8>& bytes, const std::string& string)
+{
+	const U8* stringBytes = (const U8*)string.c_str();
+	bytes.insert(bytes.end(), stringBytes, stringBytes + string.size() + 1);
+}
+
+static void writeJITDumpRecord(std::vector<U8>& recordBytes)
+{
+	JITDumpRecordHeader* header = (JITDumpRecordHeader*)recordBytes.data();
+	header->numRecordBytes = U32(recordBytes.size());
+	if(!writeAll(jitDumpFD, recordBytes.data(), recordBytes.size()))
+	{ Log::printf(Log::error, "Failed to write jitdump record: %s\n", strerror(errno)); }
+}
+
+static void writeJITDumpFunction(Runtime::Function* function, U64 timestamp)
+{
+	const Runtime::FunctionMutableData* mutableData = function->mutableData;
+	const Uptr codeAddress = reinterpret_cast<Uptr>(function->code);
+
+	// The debug info record must precede the code load record it describes. Each WebAssembly
+	// operator is written as a line in a file named after the function.
+	if(mutableData->offsetToOpIndexMap.size())
+	{
+		std::vector<U8> recordBytes;
+		JITDumpDebugInfoRecord record;
+		record.header.id = JITDumpRecordId::debugInfo;
+		record.header.timestamp = timestamp;
+		record.codeAddress = codeAddress;
+		record.numEntries = mutableData->offsetToOpIndexMap.size();
+		appendBytes(recordBytes, record);
+		for(const auto& offsetOpIndexPair : mutableData->offsetToOpIndexMap)
+		{
+			JITDumpDebugInfoEntry entry;
+			entry.address = codeAddress + offsetOpIndexPair.first;
+			entry.line = offsetOpIndexPair.second;
+			entry.discriminator = 0;
+			appendBytes(recordBytes, entry);
+			appendString(recordBytes, mutableData->debugName);
+		}
+		writeJITDumpRecord(recordBytes);
+	}
+
+	std::vector<U8> recordBytes;
+	JITDumpCodeLoadRecord record;
+	record.header.id = JITDumpRecordId::codeLoad;
+	record.header.timestamp = timestamp;
+	record.pid = U32(getpid());
+	record.tid = U32(syscall(SYS_gettid));
+	record.vma = codeAddress;
+	record.codeAddress = codeAddress;
+	record.numCodeBytes = mutableData->numCodeBytes;
+	record.codeIndex = nextJITDumpCodeIndex++;
+	appendBytes(recordBytes, record);
+	appendString(recordBytes, mutableData->debugName);
+	recordBytes.insert(
+		recordBytes.end(), function->code, function->code + mutableData->numCodeBytes);
+	writeJITDumpRecord(recordBytes);
+}
+
+bool LLVMJIT::enablePerfMap()
+{
+	Lock<Platform::Mutex> perfLock(perfMutex);
+	if(perfMapFD != -1) { return true; }
+
+	const std::string perfMapPath = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+	perfMapFD = open(perfMapPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(perfMapFD == -1)
+	{
+		Log::printf(Log::error, "Couldn't create %s: %s\n", perfMapPath.c_str(), strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+bool LLVMJIT::enablePerfJITDump(const char* directory)
+{
+	Lock<Platform::Mutex> perfLock(perfMutex);
+	if(jitDumpFD != -1) { return true; }
+
+	// perf inject finds the jitdump file by looking for an executable mapping of a file named
+	// jit-<pid>.dump in the perf.data file.
+	const std::string jitDumpPath
+		= std::string(directory) + "/jit-" + std::to_string(getpid()) + ".dump";
+	jitDumpFD = open(jitDumpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(jitDumpFD == -1)
+	{
+		Log::printf(Log::error, "Couldn't create %s: %s\n", jitDumpPath.c_str(), strerror(errno));
+		return false;
+	}
+
+	JITDumpFileHeader header;
+	header.magic = jitDumpMagic;
+	header.version = jitDumpVersion;
+	header.numHeaderBytes = sizeof(JITDumpFileHeader);
+#if defined(__x86_64__)
+	header.elfMachine = EM_X86_64;
+#elif defined(__aarch64__)
+	header.elfMachine = EM_AARCH64;
+#elif defined(__i386__)
+	header.elfMachine = EM_386;
+#else
+	header.elfMachine = EM_NONE;
+#endif
+	header.padding = 0;
+	header.pid = U32(getpid());
+	header.timestamp = getJITDumpTimestamp();
+	header.flags = 0;
+	if(!writeAll(jitDumpFD, &header, sizeof(header)))
+	{
+		Log::printf(Log::error, "Couldn't write %s: %s\n", jitDumpPath.c_str(), strerror(errno));
+		close(jitDumpFD);
+		jitDumpFD = -1;
+		return false;
+	}
+
+	jitDumpMarker = mmap(nullptr,
+						 Uptr(sysconf(_SC_PAGESIZE)),
+						 PROT_READ | PROT_EXEC,
+						 MAP_PRIVATE,
+						 jitDumpFD,
+						 0);
+	if(jitDumpMarker == MAP_FAILED)
+	{
+		Log::printf(Log::error, "Couldn't map %s: %s\n", jitDumpPath.c_str(), strerror(errno));
+		jitDumpMarker = nullptr;
+	}
+
+	return true;
+}
+
+bool LLVMJIT::isPerfMapEnabled()
+{
+	Lock<Platform::Mutex> perfLock(perfMutex);
+	return perfMapFD != -1;
+}
+
+void LLVMJIT::notifyPerfModuleLoaded(const Module* module)
+{
+	Lock<Platform::Mutex> perfLock(perfMutex);
+	if(perfMapFD == -1 && jitDumpFD == -1) { return; }
+
+	const U64 timestamp = jitDumpFD == -1 ? 0 : getJITDumpTimestamp();
+	std::string perfMapLines;
+	for(const auto& addressFunctionPair : module->addressToFunctionMap)
+	{
+		Runtime::Function* function = addressFunctionPair.second;
+		if(perfMapFD != -1)
+		{
+			char addressAndSize[64];
+			snprintf(addressAndSize,
+					 sizeof(addressAndSize),
+					 "%" PRIxPTR " %" PRIxPTR " ",
+					 reinterpret_cast<Uptr>(function->code),
+					 function->mutableData->numCodeBytes);
+			perfMapLines += addressAndSize;
+			perfMapLines += function->mutableData->debugName;
+			perfMapLines += '\n';
+		}
+		if(jitDumpFD != -1) { writeJITDumpFunction(function, timestamp); }
+	}
+
+	if(perfMapFD != -1 && !writeAll(perfMapFD, perfMapLines.data(), perfMapLines.size()))
+	{ Log::printf(Log::error, "Failed to write perf map: %s\n", strerror(errno)); }
+}
+
+#else
+
+bool LLVMJIT::enablePerfMap()
+{
+	Log::printf(Log::error, "perf maps are only supported on Linux.\n");
+	return false;
+}
+
+bool LLVMJIT::enablePerfJITDump(const char* directory)
+{
+	Log::printf(Log::error, "jitdump files are only supported on Linux.\n");
+	return false;
+}
+
+bool LLVMJIT::isPerfMapEnabled() { return false; }
+void LLVMJIT::notifyPerfModuleLoaded(const Module* module) {}
+
+#endif
@@ -48,6 +48,10 @@ using namespace WAVM::Runtime;
 static Platform::Mutex invokeThunkMutex;
 static HashMap<FunctionType, Runtime::Function*> invokeThunkTypeToFunctionMap;
 
+// A map from function types to JIT symbols for cached batch invoke thunks (C++ -> WASM)
+static Platform::Mutex invokeBatchThunkMutex;
+static HashMap<FunctionType, Runtime::Function*> invokeBatchThunkTypeToFunctionMap;
+
 // A map from function types to JIT symbols for cached native thunks (WASM -> C++)
 static Platform::Mutex intrinsicThunkMutex;
 static HashMap<void*, Runtime::Function*> intrinsicFunctionToThunkFunctionMap;
@@ -149,7 +153,7 @@ InvokeThunkPointer LLVMJIT::getInvokeThunk(FunctionType functionType)
 	std::vector<U8> objectBytes = compileLLVMModule(llvmContext, std::move(llvmModule), false);
 
 	// Load the object code.
-	auto jitModule = new LLVMJIT::Module(objectBytes, {}, false);
+	auto jitModule = new LLVMJIT::Module(objectBytes.data(), objectBytes.size(), {}, false);
 	Platform::expectLeakedObject(jitModule);
 
 #if(defined(_WIN32) && !defined(_WIN64))
@@ -161,6 +165,138 @@ InvokeThunkPointer LLVMJIT::getInvokeThunk(FunctionType functionType)
 	return reinterpret_cast<InvokeThunkPointer>(const_cast<U8*>(invokeThunkFunction->code));
 }
 
+InvokeBatchThunkPointer LLVMJIT::getInvokeBatchThunk(FunctionType functionType)
+{
+	Lock<Platform::Mutex> invokeBatchThunkLock(invokeBatchThunkMutex);
+
+	// Reuse cached batch invoke thunks for the same function type.
+	Runtime::Function*& invokeBatchThunkFunction
+		= invokeBatchThunkTypeToFunctionMap.getOrAdd(functionType, nullptr);
+	if(invokeBatchThunkFunction)
+	{
+		return reinterpret_cast<InvokeBatchThunkPointer>(
+			const_cast<U8*>(invokeBatchThunkFunction->code));
+	}
+
+	// Create a FunctionMutableData object for the thunk.
+	FunctionMutableData* functionMutableData
+		= new FunctionMutableData("thnk!C to WASM batch thunk!" + asString(functionType));
+
+	// Create a LLVM module and a LLVM function for the thunk.
+	LLVMContext llvmContext;
+	llvm::Module llvmModule("", llvmContext);
+	auto llvmFunctionType = llvm::FunctionType::get(llvmContext.i8PtrType,
+													{llvmContext.i8PtrType,
+													 llvmContext.i8PtrType,
+													 llvmContext.i8PtrType,
+													 llvmContext.iptrType,
+													 llvmContext.i8PtrType},
+													false);
+	auto function = llvm::Function::Create(
+		llvmFunctionType, llvm::Function::ExternalLinkage, "thunk", &llvmModule);
+	setRuntimeFunctionPrefix(llvmContext,
+							 function,
+							 emitLiteralPointer(functionMutableData, llvmContext.iptrType),
+							 emitLiteral(llvmContext, Uptr(UINTPTR_MAX)),
+							 emitLiteral(llvmContext, functionType.getEncoding().impl));
+	setFramePointerAttribute(function);
+
+	llvm::Value* calleeFunction = &*(function->args().begin() + 0);
+	llvm::Value* contextPointer = &*(function->args().begin() + 1);
+	llvm::Value* argsArray = &*(function->args().begin() + 2);
+	llvm::Value* numCalls = &*(function->args().begin() + 3);
+	llvm::Value* resultsArray = &*(function->args().begin() + 4);
+
+	EmitContext emitContext(llvmContext, nullptr);
+	auto entryBlock = llvm::BasicBlock::Create(llvmContext, "entry", function);
+	auto loopBlock = llvm::BasicBlock::Create(llvmContext, "loop", function);
+	auto exitBlock = llvm::BasicBlock::Create(llvmContext, "exit", function);
+	emitContext.irBuilder.SetInsertPoint(entryBlock);
+
+	emitContext.initContextVariables(contextPointer);
+
+	llvm::Value* functionCode = emitContext.irBuilder.CreatePointerCast(
+		emitContext.irBuilder.CreateInBoundsGEP(
+			calleeFunction, {emitLiteral(llvmContext, Uptr(offsetof(Runtime::Function, code)))}),
+		asLLVMType(llvmContext, functionType, IR::CallingConvention::wasm)->getPointerTo());
+
+	emitContext.irBuilder.CreateCondBr(
+		emitContext.irBuilder.CreateICmpNE(numCalls, emitLiteral(llvmContext, Uptr(0))),
+		loopBlock,
+		exitBlock);
+
+	// Loop over the calls. Each iteration reads its args and writes its results at the call index
+	// times the size of one call's args or results, so consecutive calls use consecutive ranges.
+	emitContext.irBuilder.SetInsertPoint(loopBlock);
+	llvm::PHINode* callIndex = emitContext.irBuilder.CreatePHI(llvmContext.iptrType, 2);
+	callIndex->addIncoming(emitLiteral(llvmContext, Uptr(0)), entryBlock);
+
+	// Load the call's arguments from the args array, which contains an UntaggedValue for each
+	// parameter of each call.
+	const Uptr numParams = functionType.params().size();
+	llvm::Value* callArgs = emitContext.irBuilder.CreateInBoundsGEP(
+		argsArray,
+		{emitContext.irBuilder.CreateMul(
+			callIndex, emitLiteral(llvmContext, Uptr(numParams * sizeof(UntaggedValue))))});
+	std::vector<llvm::Value*> arguments;
+	for(Uptr paramIndex = 0; paramIndex < numParams; ++paramIndex)
+	{
+		const ValueType parameterType = functionType.params()[paramIndex];
+		arguments.push_back(emitContext.loadFromUntypedPointer(
+			emitContext.irBuilder.CreateInBoundsGEP(
+				callArgs, {emitLiteral(llvmContext, Uptr(paramIndex * sizeof(UntaggedValue)))}),
+			asLLVMType(llvmContext, parameterType),
+			getTypeByteWidth(parameterType)));
+	}
+
+	// Call the function.
+	ValueVector results = emitContext.emitCallOrInvoke(
+		functionCode, arguments, functionType, IR::CallingConvention::wasm);
+
+	// Write the call's results to the results array, which contains an UntaggedValue for each
+	// result of each call.
+	wavmAssert(results.size() == functionType.results().size());
+	const Uptr numResults = results.size();
+	llvm::Value* callResults = emitContext.irBuilder.CreateInBoundsGEP(
+		resultsArray,
+		{emitContext.irBuilder.CreateMul(
+			callIndex, emitLiteral(llvmContext, Uptr(numResults * sizeof(UntaggedValue))))});
+	for(Uptr resultIndex = 0; resultIndex < numResults; ++resultIndex)
+	{
+		emitContext.storeToUntypedPointer(
+			results[resultIndex],
+			emitContext.irBuilder.CreateInBoundsGEP(
+				callResults, {emitLiteral(llvmContext, Uptr(resultIndex * sizeof(UntaggedValue)))}),
+			getTypeByteWidth(functionType.results()[resultIndex]));
+	}
+
+	llvm::Value* nextCallIndex
+		= emitContext.irBuilder.CreateAdd(callIndex, emitLiteral(llvmContext, Uptr(1)));
+	callIndex->addIncoming(nextCallIndex, emitContext.irBuilder.GetInsertBlock());
+	emitContext.irBuilder.CreateCondBr(
+		emitContext.irBuilder.CreateICmpULT(nextCallIndex, numCalls), loopBlock, exitBlock);
+
+	emitContext.irBuilder.SetInsertPoint(exitBlock);
+	emitContext.irBuilder.CreateRet(
+		emitContext.irBuilder.CreateLoad(emitContext.contextPointerVariable));
+
+	// Compile the LLVM IR to object code.
+	std::vector<U8> objectBytes = compileLLVMModule(llvmContext, std::move(llvmModule), false);
+
+	// Load the object code.
+	auto jitModule = new LLVMJIT::Module(objectBytes.data(), objectBytes.size(), {}, false);
+	Platform::expectLeakedObject(jitModule);
+
+#if(defined(_WIN32) && !defined(_WIN64))
+	const char* thunkFunctionName = "_thunk";
+#else
+	const char* thunkFunctionName = "thunk";
+#endif
+	invokeBatchThunkFunction = jitModule->nameToFunctionMap[thunkFunctionName];
+	return reinterpret_cast<InvokeBatchThunkPointer>(
+		const_cast<U8*>(invokeBatchThunkFunction->code));
+}
+
 Runtime::Function* LLVMJIT::getIntrinsicThunk(void* nativeFunction,
 											  FunctionType functionType,
 											  CallingConvention callingConvention,
@@ -218,7 +354,7 @@ Runtime::Function* LLVMJIT::getIntrinsicThunk(void* nativeFunction,
 	std::vector<U8> objectBytes = compileLLVMModule(llvmContext, std::move(llvmModule), false);
 
 	// Load the object code.
-	auto jitModule = new LLVMJIT::Module(objectBytes, {}, false);
+	auto jitModule = new LLVMJIT::Module(objectBytes.data(), objectBytes.size(), {}, false);
 	Platform::expectLeakedObject(jitModule);
 
 #if(defined(_WIN32) && !defined(_WIN64))
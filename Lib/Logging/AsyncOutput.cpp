@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "LoggingPrivate.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Lock.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+
+using namespace WAVM;
+using namespace WAVM::Log;
+
+// In asynchronous mode, each thread formats its messages into its own ring buffer, and a
+// background thread copies them from the buffers to stdout. Only the thread that owns a buffer
+// writes messages to it, and only one thread at a time reads messages from the buffers, so the
+// buffers don't need locks.
+
+enum
+{
+	numAsyncBufferBytesLog2 = 16,
+	numAsyncBufferBytes = 1 << numAsyncBufferBytesLog2,
+	maxStackFormattedBytes = 1024,
+	asyncWriterThreadStackBytes = 1024 * 1024,
+	asyncWriteIntervalMicroseconds = 10000
+};
+
+struct AsyncBuffer
+{
+	U8 bytes[numAsyncBufferBytes];
+
+	// The offsets increase monotonically, and are wrapped to the buffer size when accessing bytes.
+	std::atomic<U64> writeOffset{0};
+	std::atomic<U64> readOffset{0};
+
+	// Set when the owning thread exits. The buffer is freed once its messages are written.
+	std::atomic<bool> isOrphaned{false};
+};
+
+struct AsyncOutput
+{
+	// Locked while adding or removing buffers, or reading messages from them.
+	Platform::Mutex buffersMutex;
+	std::vector<AsyncBuffer*> buffers;
+
+	Platform::Mutex writerThreadMutex;
+	Platform::Thread* writerThread = nullptr;
+	Platform::Event writerEvent;
+	std::atomic<bool> isStopping{false};
+	bool isExitHandlerRegistered = false;
+};
+
+static std::atomic<U64> numDroppedMessages{0};
+static Metrics::Counter numDroppedMessagesCounter(
+	"wavm_log_dropped_messages_total",
+	"Number of log messages dropped because the logging thread's buffer was full");
+static Metrics::Gauge numAsyncBuffersGauge(
+	"wavm_log_async_buffers",
+	"Number of asynchronous log output buffers, including those of exited threads that haven't "
+	"been written yet");
+
+// The async output state is never destroyed, since threads may log after static objects are
+// destroyed.
+static AsyncOutput& getAsyncOutput()
+{
+	static AsyncOutput* asyncOutput = new AsyncOutput;
+	return *asyncOutput;
+}
+
+struct ThreadAsyncBuffer
+{
+	AsyncBuffer* buffer = nullptr;
+
+	~ThreadAsyncBuffer()
+	{
+		if(buffer)
+		{
+			buffer->isOrphaned.store(true, std::memory_order_release);
+			buffer = nullptr;
+		}
+	}
+};
+
+static AsyncBuffer* getThreadAsyncBuffer()
+{
+	static thread_local ThreadAsyncBuffer threadBuffer;
+	if(!threadBuffer.buffer)
+	{
+		threadBuffer.buffer = new AsyncBuffer;
+		numAsyncBuffersGauge.add(1);
+
+		AsyncOutput& asyncOutput = getAsyncOutput();
+		Lock<Platform::Mutex> buffersLock(asyncOutput.buffersMutex);
+		asyncOutput.buffers.push_back(threadBuffer.buffer);
+	}
+	return threadBuffer.buffer;
+}
+
+static void writeAsyncMessage(const char* message, Uptr numMessageBytes)
+{
+	AsyncBuffer* buffer = getThreadAsyncBuffer();
+	const U64 writeOffset = buffer->writeOffset.load(std::memory_order_relaxed);
+	const U64 readOffset = buffer->readOffset.load(std::memory_order_acquire);
+	if(numMessageBytes > numAsyncBufferBytes - (writeOffset - readOffset))
+	{
+		++numDroppedMessages;
+		numDroppedMessagesCounter.add();
+		return;
+	}
+
+	const Uptr bufferOffset = Uptr(writeOffset & (numAsyncBufferBytes - 1));
+	const Uptr numBytesBeforeWrap = std::min(numMessageBytes, numAsyncBufferBytes - bufferOffset);
+	memcpy(buffer->bytes + bufferOffset, message, numBytesBeforeWrap);
+	memcpy(buffer->bytes, message + numBytesBeforeWrap, numMessageBytes - numBytesBeforeWrap);
+	buffer->writeOffset.store(writeOffset + numMessageBytes, std::memory_order_release);
+}
+
+static void vprintfAsync(const char* format, va_list argList)
+{
+	// Format the message on the stack if it fits, or on the heap if it doesn't.
+	char stackMessage[maxStackFormattedBytes];
+	va_list argListCopy;
+	va_copy(argListCopy, argList);
+	const int numMessageChars = vsnprintf(stackMessage, sizeof(stackMessage), format, argListCopy);
+	va_end(argListCopy);
+	if(numMessageChars <= 0) { return; }
+	else if(Uptr(numMessageChars) < sizeof(stackMessage))
+	{
+		writeAsyncMessage(stackMessage, Uptr(numMessageChars));
+	}
+	else
+	{
+		std::string heapMessage(Uptr(numMessageChars) + 1, 0);
+		vsnprintf(&heapMessage[0], heapMessage.size(), format, argList);
+		writeAsyncMessage(heapMessage.data(), Uptr(numMessageChars));
+	}
+}
+
+// Writes the buffered messages to stdout, and frees the buffers of threads that have exited.
+static void writeAsyncBuffers()
+{
+	AsyncOutput& asyncOutput = getAsyncOutput();
+	Lock<Platform::Mutex> buffersLock(asyncOutput.buffersMutex);
+
+	bool wroteMessages = false;
+	for(Uptr bufferIndex = 0; bufferIndex < asyncOutput.buffers.size();)
+	{
+		AsyncBuffer* buffer = asyncOutput.buffers[bufferIndex];
+
+		// Read isOrphaned before writeOffset, so if the buffer is orphaned, all its messages are
+		// written before it is freed.
+		const bool isOrphaned = buffer->isOrphaned.load(std::memory_order_acquire);
+		const U64 writeOffset = buffer->writeOffset.load(std::memory_order_acquire);
+		const U64 readOffset = buffer->readOffset.load(std::memory_order_relaxed);
+		if(writeOffset != readOffset)
+		{
+			const Uptr bufferOffset = Uptr(readOffset & (numAsyncBufferBytes - 1));
+			const Uptr numBytes = Uptr(writeOffset - readOffset);
+			const Uptr numBytesBeforeWrap = std::min(numBytes, numAsyncBufferBytes - bufferOffset);
+			fwrite(buffer->bytes + bufferOffset, 1, numBytesBeforeWrap, stdout);
+			fwrite(buffer->bytes, 1, numBytes - numBytesBeforeWrap, stdout);
+			buffer->readOffset.store(writeOffset, std::memory_order_release);
+			wroteMessages = true;
+		}
+
+		if(!isOrphaned) { ++bufferIndex; }
+		else
+		{
+			delete buffer;
+			numAsyncBuffersGauge.add(-1);
+			asyncOutput.buffers.erase(asyncOutput.buffers.begin() + bufferIndex);
+		}
+	}
+
+	if(wroteMessages) { fflush(stdout); }
+}
+
+static I64 asyncWriterThreadEntry(void*)
+{
+	AsyncOutput& asyncOutput = getAsyncOutput();
+	const U64 intervalMicroseconds = asyncWriteIntervalMicroseconds;
+	while(!asyncOutput.isStopping.load(std::memory_order_acquire))
+	{
+		writeAsyncBuffers();
+		asyncOutput.writerEvent.wait(Platform::getMonotonicClock() + intervalMicroseconds);
+	}
+	return 0;
+}
+
+static const AsyncOutputHooks hooks = {vprintfAsync, writeAsyncBuffers};
+
+void Log::setAsyncOutputEnabled(bool enable)
+{
+	AsyncOutput& asyncOutput = getAsyncOutput();
+	Lock<Platform::Mutex> writerThreadLock(asyncOutput.writerThreadMutex);
+	if(enable && !asyncOutput.writerThread)
+	{
+		// Write any buffered messages when the process exits.
+		if(!asyncOutput.isExitHandlerRegistered)
+		{
+			atexit(flushAsyncOutput);
+			asyncOutput.isExitHandlerRegistered = true;
+		}
+
+		asyncOutput.isStopping.store(false, std::memory_order_release);
+		asyncOutput.writerThread = Platform::createThread(
+			asyncWriterThreadStackBytes, asyncWriterThreadEntry, nullptr);
+		asyncOutputHooks.store(&hooks, std::memory_order_release);
+	}
+	else if(!enable && asyncOutput.writerThread)
+	{
+		asyncOutputHooks.store(nullptr, std::memory_order_release);
+
+		asyncOutput.isStopping.store(true, std::memory_order_release);
+		asyncOutput.writerEvent.signal();
+		Platform::joinThread(asyncOutput.writerThread);
+		asyncOutput.writerThread = nullptr;
+
+		writeAsyncBuffers();
+	}
+}
+
+void Log::flushAsyncOutput() { writeAsyncBuffers(); }
+
+U64 Log::getNumDroppedMessages() { return numDroppedMessages.load(std::memory_order_relaxed); }
@@ -1,6 +1,7 @@
 #include <atomic>
 #include <cstdio>
 
+#include "LoggingPrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Config.h"
@@ -17,6 +18,8 @@ static std::atomic<bool> categoryEnabled[(Uptr)Category::num] = {
 	{true},                     // output
 };
 
+std::atomic<const AsyncOutputHooks*> Log::asyncOutputHooks{nullptr};
+
 static FILE* getFileForCategory(Log::Category category)
 {
 	return category == Log::error ? stderr : stdout;
@@ -40,9 +43,7 @@ void Log::printf(Category category, const char* format, ...)
 	{
 		va_list argList;
 		va_start(argList, format);
-		FILE* file = getFileForCategory(category);
-		vfprintf(file, format, argList);
-		fflush(file);
+		Log::vprintf(category, format, argList);
 		va_end(argList);
 	}
 }
@@ -51,8 +52,17 @@ void Log::vprintf(Category category, const char* format, va_list argList)
 {
 	if(categoryEnabled[(Uptr)category].load())
 	{
-		FILE* file = getFileForCategory(category);
-		vfprintf(file, format, argList);
-		fflush(file);
+		const AsyncOutputHooks* hooks = asyncOutputHooks.load(std::memory_order_acquire);
+		if(hooks && category != Log::error) { hooks->vprintf(format, argList); }
+		else
+		{
+			// Write any buffered messages before an error, so the error is written after the
+			// messages that were logged before it.
+			if(hooks) { hooks->flush(); }
+
+			FILE* file = getFileForCategory(category);
+			vfprintf(file, format, argList);
+			fflush(file);
+		}
 	}
 }
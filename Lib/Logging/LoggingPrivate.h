@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdarg.h>
+#include <atomic>
+
+namespace WAVM { namespace Log {
+	// While asynchronous output is enabled, AsyncOutput.cpp installs these hooks for vprintf to
+	// call. They're installed at runtime instead of called directly so that programs that build
+	// Logging.cpp from source, like GenerateLexerTables, don't need to link with Platform threads.
+	struct AsyncOutputHooks
+	{
+		// Buffers a formatted message in a category other than error.
+		void (*vprintf)(const char* format, va_list argList);
+
+		// Writes any buffered messages.
+		void (*flush)();
+	};
+
+	extern std::atomic<const AsyncOutputHooks*> asyncOutputHooks;
+}}
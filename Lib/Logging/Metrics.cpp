@@ -0,0 +1,400 @@
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Lock.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/Mutex.h"
+
+using namespace WAVM;
+using namespace WAVM::Metrics;
+
+// Each metric is stored in one or more slots: a counter or gauge has one slot, and a histogram has
+// a slot for the sum of its values followed by a slot for each bucket. Each thread has its own
+// copy of the slots, which it allocates in chunks as they are first used. When a thread exits, its
+// slots are added to the retired slots.
+
+enum
+{
+	numSlotsPerChunkLog2 = 8,
+	maxChunks = 1024,
+	maxSlots = maxChunks << numSlotsPerChunkLog2,
+
+	// Each power of two is divided into 1 << numSubBucketsLog2 buckets. Values below the first
+	// power of two that is divided into that many buckets are counted in a bucket per value.
+	numSubBucketsLog2 = 3,
+	numHistogramBuckets = (64 - numSubBucketsLog2 + 1) << numSubBucketsLog2,
+	numHistogramSlots = 1 + numHistogramBuckets
+};
+
+struct SlotChunk
+{
+	std::atomic<U64> slots[Uptr(1) << numSlotsPerChunkLog2];
+
+	SlotChunk()
+	{
+		for(std::atomic<U64>& slot : slots) { slot.store(0, std::memory_order_relaxed); }
+	}
+};
+
+struct ThreadSlots
+{
+	// Only the owning thread writes to its slots, but any thread that holds the registry's mutex
+	// may read them.
+	std::atomic<SlotChunk*> chunks[maxChunks];
+
+	ThreadSlots();
+	~ThreadSlots();
+};
+
+struct MetricInfo
+{
+	Kind kind;
+	std::string name;
+	std::string description;
+	std::string labels;
+	Uptr firstSlotIndex;
+};
+
+struct Registry
+{
+	Platform::Mutex mutex;
+	std::vector<MetricInfo> metrics;
+	Uptr numSlots = 0;
+	std::vector<ThreadSlots*> threadSlots;
+	std::vector<U64> retiredSlots;
+
+	Platform::Mutex counterMapMutex;
+	std::map<std::pair<std::string, std::string>, Counter*> counterMap;
+};
+
+// The registry is created the first time it's used, since metrics may be declared as static
+// objects in other translation units, and is never destroyed, since threads may exit after static
+// objects are destroyed.
+static Registry& getRegistry()
+{
+	static Registry* registry = new Registry;
+	return *registry;
+}
+
+ThreadSlots::ThreadSlots()
+{
+	for(std::atomic<SlotChunk*>& chunk : chunks)
+	{ chunk.store(nullptr, std::memory_order_relaxed); }
+
+	Registry& registry = getRegistry();
+	Lock<Platform::Mutex> registryLock(registry.mutex);
+	registry.threadSlots.push_back(this);
+}
+
+ThreadSlots::~ThreadSlots()
+{
+	Registry& registry = getRegistry();
+	Lock<Platform::Mutex> registryLock(registry.mutex);
+
+	for(Uptr chunkIndex = 0; chunkIndex < maxChunks; ++chunkIndex)
+	{
+		SlotChunk* chunk = chunks[chunkIndex].load(std::memory_order_relaxed);
+		if(!chunk) { continue; }
+
+		for(Uptr chunkSlotIndex = 0; chunkSlotIndex < (Uptr(1) << numSlotsPerChunkLog2);
+			++chunkSlotIndex)
+		{
+			const Uptr slotIndex = (chunkIndex << numSlotsPerChunkLog2) + chunkSlotIndex;
+			if(slotIndex < registry.retiredSlots.size())
+			{
+				registry.retiredSlots[slotIndex]
+					+= chunk->slots[chunkSlotIndex].load(std::memory_order_relaxed);
+			}
+		}
+		delete chunk;
+	}
+
+	registry.threadSlots.erase(
+		std::find(registry.threadSlots.begin(), registry.threadSlots.end(), this));
+}
+
+static ThreadSlots& getThreadSlots()
+{
+	static thread_local ThreadSlots threadSlots;
+	return threadSlots;
+}
+
+void Metrics::addToThreadSlot(Uptr slotIndex, U64 delta)
+{
+	wavmAssert(slotIndex < maxSlots);
+	std::atomic<SlotChunk*>& chunkPointer
+		= getThreadSlots().chunks[slotIndex >> numSlotsPerChunkLog2];
+	SlotChunk* chunk = chunkPointer.load(std::memory_order_relaxed);
+	if(!chunk)
+	{
+		chunk = new SlotChunk;
+		chunkPointer.store(chunk, std::memory_order_release);
+	}
+
+	// Only this thread writes to the slot, so it doesn't need an atomic read-modify-write.
+	std::atomic<U64>& slot = chunk->slots[slotIndex & ((Uptr(1) << numSlotsPerChunkLog2) - 1)];
+	slot.store(slot.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// Adds all threads' copies of a slot. The caller must have locked the registry's mutex.
+static U64 sumSlot(const Registry& registry, Uptr slotIndex)
+{
+	U64 sum = registry.retiredSlots[slotIndex];
+	for(const ThreadSlots* threadSlots : registry.threadSlots)
+	{
+		const std::atomic<SlotChunk*>& chunkPointer
+			= threadSlots->chunks[slotIndex >> numSlotsPerChunkLog2];
+		const SlotChunk* chunk = chunkPointer.load(std::memory_order_acquire);
+		if(chunk)
+		{
+			sum += chunk->slots[slotIndex & ((Uptr(1) << numSlotsPerChunkLog2) - 1)].load(
+				std::memory_order_relaxed);
+		}
+	}
+	return sum;
+}
+
+Metric::Metric(Kind kind, const char* name, const char* description, std::string&& labels)
+{
+	Registry& registry = getRegistry();
+	Lock<Platform::Mutex> registryLock(registry.mutex);
+
+	const Uptr numSlots = kind == Kind::histogram ? numHistogramSlots : 1;
+	if(registry.numSlots + numSlots > maxSlots) { Errors::fatalf("Too many metrics: %s", name); }
+
+	firstSlotIndex = registry.numSlots;
+	registry.numSlots += numSlots;
+	registry.retiredSlots.resize(registry.numSlots, 0);
+	registry.metrics.push_back(
+		MetricInfo{kind, name, description, std::move(labels), firstSlotIndex});
+}
+
+static Uptr getHistogramBucketIndex(U64 value)
+{
+	if(value < (U64(1) << numSubBucketsLog2)) { return Uptr(value); }
+
+	const U64 exponent = Platform::floorLogTwo(value);
+	const U64 subBucketIndex
+		= (value >> (exponent - numSubBucketsLog2)) & ((U64(1) << numSubBucketsLog2) - 1);
+	return Uptr(((exponent - numSubBucketsLog2 + 1) << numSubBucketsLog2) + subBucketIndex);
+}
+
+static U64 getHistogramBucketMaxValue(Uptr bucketIndex)
+{
+	if(bucketIndex < (Uptr(1) << numSubBucketsLog2)) { return U64(bucketIndex); }
+
+	const U64 exponent = (bucketIndex >> numSubBucketsLog2) + numSubBucketsLog2 - 1;
+	const U64 subBucketIndex = bucketIndex & ((Uptr(1) << numSubBucketsLog2) - 1);
+	const U64 bucketWidth = U64(1) << (exponent - numSubBucketsLog2);
+	return (((U64(1) << numSubBucketsLog2) + subBucketIndex) << (exponent - numSubBucketsLog2))
+		   + bucketWidth - 1;
+}
+
+void Histogram::record(U64 value)
+{
+	addToThreadSlot(firstSlotIndex, value);
+	addToThreadSlot(firstSlotIndex + 1 + getHistogramBucketIndex(value), 1);
+}
+
+std::string Metrics::formatLabel(const char* name, const std::string& value)
+{
+	std::string label = name;
+	label += "=\"";
+	for(char c : value)
+	{
+		switch(c)
+		{
+		case '\\': label += "\\\\"; break;
+		case '"': label += "\\\""; break;
+		case '\n': label += "\\n"; break;
+		default: label += c; break;
+		};
+	}
+	label += '"';
+	return label;
+}
+
+Counter* Metrics::getCounter(const char* name, const char* description, std::string&& labels)
+{
+	Registry& registry = getRegistry();
+	Lock<Platform::Mutex> counterMapLock(registry.counterMapMutex);
+
+	std::pair<std::string, std::string> key(name, labels);
+	auto counterIt = registry.counterMap.find(key);
+	if(counterIt != registry.counterMap.end()) { return counterIt->second; }
+
+	Counter* counter = new Counter(name, description, std::move(labels));
+	registry.counterMap.emplace(std::move(key), counter);
+	return counter;
+}
+
+U64 MetricSnapshot::getPercentile(F64 fraction) const
+{
+	if(!numValues) { return 0; }
+
+	// Find the bucket that contains the value at the given rank.
+	const U64 rank = std::max(U64(1), std::min(numValues, U64(ceil(fraction * numValues))));
+	U64 numValuesBelowBucket = 0;
+	for(const HistogramBucket& bucket : buckets)
+	{
+		numValuesBelowBucket += bucket.numValues;
+		if(numValuesBelowBucket >= rank) { return bucket.maxValue; }
+	}
+	return buckets.back().maxValue;
+}
+
+std::vector<MetricSnapshot> Metrics::getSnapshot()
+{
+	Registry& registry = getRegistry();
+	std::vector<MetricSnapshot> snapshot;
+	{
+		Lock<Platform::Mutex> registryLock(registry.mutex);
+		for(const MetricInfo& metric : registry.metrics)
+		{
+			MetricSnapshot metricSnapshot;
+			metricSnapshot.kind = metric.kind;
+			metricSnapshot.name = metric.name;
+			metricSnapshot.description = metric.description;
+			metricSnapshot.labels = metric.labels;
+			switch(metric.kind)
+			{
+			case Kind::counter:
+				metricSnapshot.counterValue = sumSlot(registry, metric.firstSlotIndex);
+				break;
+			case Kind::gauge:
+				metricSnapshot.gaugeValue = I64(sumSlot(registry, metric.firstSlotIndex));
+				break;
+			case Kind::histogram:
+				metricSnapshot.sum = sumSlot(registry, metric.firstSlotIndex);
+				for(Uptr bucketIndex = 0; bucketIndex < numHistogramBuckets; ++bucketIndex)
+				{
+					const U64 numBucketValues
+						= sumSlot(registry, metric.firstSlotIndex + 1 + bucketIndex);
+					if(numBucketValues)
+					{
+						metricSnapshot.buckets.push_back(HistogramBucket{
+							getHistogramBucketMaxValue(bucketIndex), numBucketValues});
+						metricSnapshot.numValues += numBucketValues;
+					}
+				}
+				break;
+			default: Errors::unreachable();
+			};
+			snapshot.push_back(std::move(metricSnapshot));
+		}
+	}
+
+	std::sort(snapshot.begin(),
+			  snapshot.end(),
+			  [](const MetricSnapshot& left, const MetricSnapshot& right) {
+				  return left.name != right.name ? left.name < right.name
+												 : left.labels < right.labels;
+			  });
+	return snapshot;
+}
+
+static std::string formatLabels(const std::string& labels, const std::string& extraLabel)
+{
+	if(labels.empty() && extraLabel.empty()) { return std::string(); }
+	else if(labels.empty())
+	{
+		return '{' + extraLabel + '}';
+	}
+	else if(extraLabel.empty())
+	{
+		return '{' + labels + '}';
+	}
+	else
+	{
+		return '{' + labels + ',' + extraLabel + '}';
+	}
+}
+
+static void appendSample(std::string& text,
+						 const std::string& name,
+						 const std::string& labels,
+						 const std::string& value)
+{
+	text += name;
+	text += labels;
+	text += ' ';
+	text += value;
+	text += '\n';
+}
+
+std::string Metrics::exportText(const std::vector<MetricSnapshot>& snapshot)
+{
+	std::string text;
+	for(Uptr metricIndex = 0; metricIndex < snapshot.size(); ++metricIndex)
+	{
+		const MetricSnapshot& metric = snapshot[metricIndex];
+
+		// Metrics with the same name but different labels share a description and type.
+		if(metricIndex == 0 || snapshot[metricIndex - 1].name != metric.name)
+		{
+			text += "# HELP " + metric.name + ' ' + metric.description + '\n';
+			text += "# TYPE " + metric.name + ' ';
+			switch(metric.kind)
+			{
+			case Kind::counter: text += "counter\n"; break;
+			case Kind::gauge: text += "gauge\n"; break;
+			case Kind::histogram: text += "histogram\n"; break;
+			default: Errors::unreachable();
+			};
+		}
+
+		switch(metric.kind)
+		{
+		case Kind::counter:
+			appendSample(text,
+						 metric.name,
+						 formatLabels(metric.labels, ""),
+						 std::to_string(metric.counterValue));
+			break;
+		case Kind::gauge:
+			appendSample(text,
+						 metric.name,
+						 formatLabels(metric.labels, ""),
+						 std::to_string(metric.gaugeValue));
+			break;
+		case Kind::histogram:
+		{
+			// Prometheus histogram buckets are cumulative.
+			U64 numValuesInBuckets = 0;
+			for(const HistogramBucket& bucket : metric.buckets)
+			{
+				numValuesInBuckets += bucket.numValues;
+				appendSample(
+					text,
+					metric.name + "_bucket",
+					formatLabels(metric.labels, "le=\"" + std::to_string(bucket.maxValue) + '"'),
+					std::to_string(numValuesInBuckets));
+			}
+			appendSample(text,
+						 metric.name + "_bucket",
+						 formatLabels(metric.labels, "le=\"+Inf\""),
+						 std::to_string(metric.numValues));
+			appendSample(text,
+						 metric.name + "_sum",
+						 formatLabels(metric.labels, ""),
+						 std::to_string(metric.sum));
+			appendSample(text,
+						 metric.name + "_count",
+						 formatLabels(metric.labels, ""),
+						 std::to_string(metric.numValues));
+			break;
+		}
+		default: Errors::unreachable();
+		};
+	}
+	return text;
+}
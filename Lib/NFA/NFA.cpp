@@ -381,15 +381,19 @@ NFA::Machine::Machine(Builder* builder)
 	}
 
 	// Build a [charClass][state] transition map.
-	stateAndOffsetToNextStateMap = new InternalStateIndex[numClasses * numStates];
+	InternalStateIndex* newStateAndOffsetToNextStateMap
+		= new InternalStateIndex[numClasses * numStates];
 	for(Uptr classIndex = 0; classIndex < numClasses; ++classIndex)
 	{
 		for(Uptr stateIndex = 0; stateIndex < numStates; ++stateIndex)
 		{
-			stateAndOffsetToNextStateMap[stateIndex + classIndex * numStates] = InternalStateIndex(
-				dfaStates[stateIndex].nextStateByChar[representativeCharsByClass[classIndex]]);
+			newStateAndOffsetToNextStateMap[stateIndex + classIndex * numStates]
+				= InternalStateIndex(
+					dfaStates[stateIndex].nextStateByChar[representativeCharsByClass[classIndex]]);
 		}
 	}
+	stateAndOffsetToNextStateMap = newStateAndOffsetToNextStateMap;
+	ownsStateAndOffsetToNextStateMap = true;
 
 	// Build a map from character index to offset into [charClass][initialState] transition map.
 	wavmAssert((numClasses - 1) * (numStates - 1) <= UINT32_MAX);
@@ -400,9 +404,21 @@ NFA::Machine::Machine(Builder* builder)
 	Log::printf(Log::metrics, "  reduced DFA character classes to %" PRIuPTR "\n", numClasses);
 }
 
+NFA::Machine::Machine(const U32* inCharToOffsetMap,
+					  const I16* inStateAndOffsetToNextStateMap,
+					  Uptr inNumClasses,
+					  Uptr inNumStates)
+: stateAndOffsetToNextStateMap(inStateAndOffsetToNextStateMap)
+, numClasses(inNumClasses)
+, numStates(inNumStates)
+, ownsStateAndOffsetToNextStateMap(false)
+{
+	memcpy(charToOffsetMap, inCharToOffsetMap, sizeof(charToOffsetMap));
+}
+
 NFA::Machine::~Machine()
 {
-	if(stateAndOffsetToNextStateMap)
+	if(stateAndOffsetToNextStateMap && ownsStateAndOffsetToNextStateMap)
 	{
 		delete[] stateAndOffsetToNextStateMap;
 		stateAndOffsetToNextStateMap = nullptr;
@@ -416,6 +432,7 @@ void NFA::Machine::moveFrom(Machine&& inMachine)
 	inMachine.stateAndOffsetToNextStateMap = nullptr;
 	numClasses = inMachine.numClasses;
 	numStates = inMachine.numStates;
+	ownsStateAndOffsetToNextStateMap = inMachine.ownsStateAndOffsetToNextStateMap;
 }
 
 static char nibbleToHexChar(U8 value) { return value < 10 ? ('0' + value) : 'a' + value - 10; }
@@ -642,3 +659,31 @@ std::string NFA::Machine::dumpDFAGraphViz() const
 	result += "}\n";
 	return result;
 }
+
+std::string NFA::Machine::dumpCPPTables(const char* name) const
+{
+	std::string result;
+	result += "static constexpr Uptr " + std::string(name) + "NumClasses = "
+			  + std::to_string(numClasses) + ";\n";
+	result += "static constexpr Uptr " + std::string(name) + "NumStates = "
+			  + std::to_string(numStates) + ";\n";
+
+	result += "static constexpr U32 " + std::string(name) + "CharToOffsetMap[256] = {";
+	for(Uptr charIndex = 0; charIndex < 256; ++charIndex)
+	{
+		result += charIndex % 16 == 0 ? "\n\t" : " ";
+		result += std::to_string(charToOffsetMap[charIndex]) + ",";
+	}
+	result += "\n};\n";
+
+	result += "static constexpr I16 " + std::string(name) + "StateAndOffsetToNextStateMap["
+			  + std::to_string(numClasses * numStates) + "] = {";
+	for(Uptr offset = 0; offset < numClasses * numStates; ++offset)
+	{
+		result += offset % 16 == 0 ? "\n\t" : " ";
+		result += std::to_string(stateAndOffsetToNextStateMap[offset]) + ",";
+	}
+	result += "\n};\n";
+
+	return result;
+}
@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "WAVM/Platform/Clock.h"
 
@@ -19,3 +20,37 @@ U64 Platform::getMonotonicClock()
 	return U64(monotonicClock.tv_sec) * 1000000 + U64(monotonicClock.tv_nsec) / 1000;
 #endif
 }
+
+static bool getPOSIXClockId(Clock clock, clockid_t& outClockId)
+{
+	switch(clock)
+	{
+	case Clock::realtime: outClockId = CLOCK_REALTIME; return true;
+	case Clock::monotonic: outClockId = CLOCK_MONOTONIC; return true;
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+	case Clock::processCPUTime: outClockId = CLOCK_PROCESS_CPUTIME_ID; return true;
+#endif
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	case Clock::threadCPUTime: outClockId = CLOCK_THREAD_CPUTIME_ID; return true;
+#endif
+	default: return false;
+	}
+}
+
+bool Platform::getClockTime(Clock clock, U64& outNanoseconds)
+{
+	clockid_t clockId;
+	timespec time;
+	if(!getPOSIXClockId(clock, clockId) || clock_gettime(clockId, &time)) { return false; }
+	outNanoseconds = U64(time.tv_sec) * 1000000000 + U64(time.tv_nsec);
+	return true;
+}
+
+bool Platform::getClockResolution(Clock clock, U64& outNanoseconds)
+{
+	clockid_t clockId;
+	timespec resolution;
+	if(!getPOSIXClockId(clock, clockId) || clock_getres(clockId, &resolution)) { return false; }
+	outNanoseconds = U64(resolution.tv_sec) * 1000000000 + U64(resolution.tv_nsec);
+	return true;
+}
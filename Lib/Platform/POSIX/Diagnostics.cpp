@@ -55,7 +55,7 @@ CallStack Platform::captureCallStack(Uptr numOmittedFramesFromTop)
             {
                 ip = unw_proc.start_ip;
             }
-			result.stackFrames.push_back(CallStack::Frame{ip});
+			if(!result.addFrame(ip)) { break; }
 		}
 	}
 #endif
@@ -67,10 +67,11 @@ void Platform::dumpErrorCallStack(Uptr numOmittedFramesFromTop)
 {
 	std::fprintf(stderr, "Call stack:\n");
 	CallStack callStack = captureCallStack(numOmittedFramesFromTop);
-	for(auto frame : callStack.stackFrames)
+	for(Uptr frameIndex = 0; frameIndex < callStack.numStackFrames; ++frameIndex)
 	{
 		std::string frameDescription;
-		if(!Platform::describeInstructionPointer(frame.ip, frameDescription))
+		if(!Platform::describeInstructionPointer(callStack.stackFrames[frameIndex].ip,
+												 frameDescription))
 		{ frameDescription = "<unknown function>"; }
 		std::fprintf(stderr, "  %s\n", frameDescription.c_str());
 	}
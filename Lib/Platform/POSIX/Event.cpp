@@ -26,10 +26,12 @@ Platform::Event::Event()
 	errorUnless(!pthread_condattr_setclock(&conditionVariableAttr, CLOCK_MONOTONIC));
 #endif
 
-	errorUnless(!pthread_cond_init((pthread_cond_t*)&pthreadCond, nullptr));
+	errorUnless(!pthread_cond_init((pthread_cond_t*)&pthreadCond, &conditionVariableAttr));
 	errorUnless(!pthread_mutex_init((pthread_mutex_t*)&pthreadMutex, nullptr));
 
 	errorUnless(!pthread_condattr_destroy(&conditionVariableAttr));
+
+	isSignaled = false;
 }
 
 Platform::Event::~Event()
@@ -42,29 +44,41 @@ bool Platform::Event::wait(U64 untilTime)
 {
 	errorUnless(!pthread_mutex_lock((pthread_mutex_t*)&pthreadMutex));
 
-	int result;
-	if(untilTime == UINT64_MAX)
-	{
-		result = pthread_cond_wait((pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex);
-	}
-	else
+	// Wait until the event is signaled: pthread_cond_wait may wake up spuriously, and the event may
+	// have been signaled before this thread started waiting.
+	int result = 0;
+	while(!isSignaled && !result)
 	{
-		timespec untilTimeSpec;
-		untilTimeSpec.tv_sec = untilTime / 1000000;
-		untilTimeSpec.tv_nsec = (untilTime % 1000000) * 1000;
+		if(untilTime == UINT64_MAX)
+		{
+			result
+				= pthread_cond_wait((pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex);
+		}
+		else
+		{
+			timespec untilTimeSpec;
+			untilTimeSpec.tv_sec = untilTime / 1000000;
+			untilTimeSpec.tv_nsec = (untilTime % 1000000) * 1000;
 
-		result = pthread_cond_timedwait(
-			(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &untilTimeSpec);
+			result = pthread_cond_timedwait(
+				(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &untilTimeSpec);
+		}
 	}
 
+	// Reset the event if it was signaled, so the next wait will block until it is signaled again.
+	const bool wasSignaled = isSignaled;
+	isSignaled = false;
+
 	errorUnless(!pthread_mutex_unlock((pthread_mutex_t*)&pthreadMutex));
 
-	if(result == ETIMEDOUT) { return false; }
-	else
-	{
-		errorUnless(!result);
-		return true;
-	}
+	if(!wasSignaled) { errorUnless(result == ETIMEDOUT); }
+	return wasSignaled;
 }
 
-void Platform::Event::signal() { errorUnless(!pthread_cond_signal((pthread_cond_t*)&pthreadCond)); }
+void Platform::Event::signal()
+{
+	errorUnless(!pthread_mutex_lock((pthread_mutex_t*)&pthreadMutex));
+	isSignaled = true;
+	errorUnless(!pthread_cond_signal((pthread_cond_t*)&pthreadCond));
+	errorUnless(!pthread_mutex_unlock((pthread_mutex_t*)&pthreadMutex));
+}
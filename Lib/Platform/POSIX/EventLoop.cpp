@@ -0,0 +1,364 @@
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <map>
+#include <vector>
+
+#include "POSIXPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/EventLoop.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+namespace {
+	struct Waiter
+	{
+		void (*callback)(void*);
+		void* argument;
+
+		// The file descriptors that the waiter is waiting for.
+		std::vector<I32> fds;
+
+		// The waiter's entry in EventLoop::timers, if it has a timeout.
+		std::multimap<U64, Waiter*>::iterator timer;
+		bool hasTimer{false};
+
+		bool isSatisfied{false};
+	};
+
+	struct FileDescriptorWaiter
+	{
+		Waiter* waiter;
+		I16 pollEvents;
+	};
+
+	struct FileDescriptorState
+	{
+		std::vector<FileDescriptorWaiter> waiters;
+
+		// The union of the poll events that the waiters are waiting for, as registered with epoll.
+		I16 registeredPollEvents{0};
+
+		// True if epoll doesn't support the file descriptor: it refers to a regular file or a
+		// directory, which is always ready.
+		bool isAlwaysReady{false};
+	};
+}
+
+struct Platform::EventLoop
+{
+#ifdef __linux__
+	I32 epollFD{-1};
+#endif
+
+	HashMap<I32, FileDescriptorState> fdStates;
+	std::multimap<U64, Waiter*> timers;
+
+	// Waiters that were satisfied when they were added, to be called by the next runEventLoop.
+	std::vector<Waiter*> satisfiedWaiters;
+
+	Uptr numPendingWaits{0};
+};
+
+static I16 getPollEvents(const FileWait& wait)
+{
+	return I16((wait.read ? POLLIN : 0) | (wait.write ? POLLOUT : 0));
+}
+
+static FileReadiness getReadiness(I16 pollEvents)
+{
+	FileReadiness readiness;
+	readiness.readable = (pollEvents & POLLIN) != 0;
+	readiness.writable = (pollEvents & POLLOUT) != 0;
+	readiness.hangup = (pollEvents & POLLHUP) != 0;
+	readiness.error = (pollEvents & (POLLERR | POLLNVAL)) != 0;
+	return readiness;
+}
+
+// Converts an absolute time on the monotonic clock to a timeout in milliseconds for poll or
+// epoll_wait, rounding up so the wait doesn't return before the time.
+static int getPollTimeoutMS(U64 untilClock)
+{
+	if(untilClock == UINT64_MAX) { return -1; }
+
+	const U64 currentClock = getMonotonicClock();
+	if(untilClock <= currentClock) { return 0; }
+
+	const U64 timeoutMS = (untilClock - currentClock + 999) / 1000;
+	return timeoutMS > U64(INT32_MAX) ? INT32_MAX : int(timeoutMS);
+}
+
+Uptr Platform::pollFiles(const FileWait* waits,
+						 FileReadiness* outReadiness,
+						 Uptr numWaits,
+						 U64 untilClock)
+{
+	std::vector<pollfd> pollFDs(numWaits);
+	for(Uptr waitIndex = 0; waitIndex < numWaits; ++waitIndex)
+	{
+		pollFDs[waitIndex].fd = filePtrToIndex(waits[waitIndex].file);
+		pollFDs[waitIndex].events = getPollEvents(waits[waitIndex]);
+		pollFDs[waitIndex].revents = 0;
+	}
+
+	// Retry the poll if it's interrupted by a signal before any files are ready.
+	int result;
+	do
+	{
+		result = poll(pollFDs.data(), nfds_t(numWaits), getPollTimeoutMS(untilClock));
+	} while(result < 0 && errno == EINTR);
+	if(result < 0) { Errors::fatalf("poll failed: %s", strerror(errno)); }
+
+	for(Uptr waitIndex = 0; waitIndex < numWaits; ++waitIndex)
+	{ outReadiness[waitIndex] = getReadiness(pollFDs[waitIndex].revents); }
+	return Uptr(result);
+}
+
+static void satisfyWaiter(std::vector<Waiter*>& satisfiedWaiters, Waiter* waiter)
+{
+	if(!waiter->isSatisfied)
+	{
+		waiter->isSatisfied = true;
+		satisfiedWaiters.push_back(waiter);
+	}
+}
+
+EventLoop* Platform::createEventLoop()
+{
+	EventLoop* eventLoop = new EventLoop;
+#ifdef __linux__
+	eventLoop->epollFD = epoll_create1(EPOLL_CLOEXEC);
+	if(eventLoop->epollFD < 0) { Errors::fatalf("epoll_create1 failed: %s", strerror(errno)); }
+#endif
+	return eventLoop;
+}
+
+void Platform::destroyEventLoop(EventLoop* eventLoop)
+{
+	// Find all the pending waiters, and delete them.
+	std::vector<Waiter*> pendingWaiters = std::move(eventLoop->satisfiedWaiters);
+	for(const auto& fdStatePair : eventLoop->fdStates)
+	{
+		for(const FileDescriptorWaiter& fdWaiter : fdStatePair.value.waiters)
+		{ satisfyWaiter(pendingWaiters, fdWaiter.waiter); }
+	}
+	for(const auto& timerPair : eventLoop->timers)
+	{ satisfyWaiter(pendingWaiters, timerPair.second); }
+	wavmAssert(pendingWaiters.size() == eventLoop->numPendingWaits);
+	for(Waiter* waiter : pendingWaiters) { delete waiter; }
+
+#ifdef __linux__
+	errorUnless(!close(eventLoop->epollFD));
+#endif
+	delete eventLoop;
+}
+
+// Updates the events registered with epoll for a file descriptor to match its waiters, and removes
+// the file descriptor's state if it has no waiters.
+static void updateFileDescriptorState(EventLoop* eventLoop, I32 fd)
+{
+	FileDescriptorState& fdState = eventLoop->fdStates.getOrAdd(fd);
+
+	I16 pollEvents = 0;
+	for(const FileDescriptorWaiter& fdWaiter : fdState.waiters)
+	{ pollEvents |= fdWaiter.pollEvents; }
+
+#ifdef __linux__
+	if(pollEvents != fdState.registeredPollEvents && !fdState.isAlwaysReady)
+	{
+		// EPOLLIN and EPOLLOUT have the same values as POLLIN and POLLOUT on Linux.
+		epoll_event event;
+		event.events = U32(pollEvents);
+		event.data.fd = fd;
+
+		int op = EPOLL_CTL_MOD;
+		if(!fdState.registeredPollEvents) { op = EPOLL_CTL_ADD; }
+		else if(!pollEvents)
+		{
+			op = EPOLL_CTL_DEL;
+		}
+
+		if(epoll_ctl(eventLoop->epollFD, op, fd, &event))
+		{
+			// epoll returns EPERM for regular files and directories: they are always ready.
+			// Removing a file descriptor fails if it was closed while it was being waited for, but
+			// closing it removed it from the epoll set anyway.
+			if(op == EPOLL_CTL_ADD && errno == EPERM) { fdState.isAlwaysReady = true; }
+			else if(op != EPOLL_CTL_DEL)
+			{
+				Errors::fatalf("epoll_ctl(%i, %i) failed: %s", op, fd, strerror(errno));
+			}
+		}
+		else
+		{
+			fdState.registeredPollEvents = pollEvents;
+		}
+	}
+#else
+	fdState.registeredPollEvents = pollEvents;
+#endif
+
+	if(!pollEvents) { eventLoop->fdStates.removeOrFail(fd); }
+}
+
+// Removes a waiter from the file descriptors and timer that it is waiting for.
+static void removeWaiter(EventLoop* eventLoop, Waiter* waiter)
+{
+	for(I32 fd : waiter->fds)
+	{
+		FileDescriptorState& fdState = eventLoop->fdStates.getOrAdd(fd);
+		for(Uptr fdWaiterIndex = 0; fdWaiterIndex < fdState.waiters.size(); ++fdWaiterIndex)
+		{
+			if(fdState.waiters[fdWaiterIndex].waiter == waiter)
+			{
+				fdState.waiters.erase(fdState.waiters.begin() + fdWaiterIndex);
+				break;
+			}
+		}
+		updateFileDescriptorState(eventLoop, fd);
+	}
+	waiter->fds.clear();
+
+	if(waiter->hasTimer)
+	{
+		eventLoop->timers.erase(waiter->timer);
+		waiter->hasTimer = false;
+	}
+}
+
+void Platform::addEventLoopWait(EventLoop* eventLoop,
+								const FileWait* waits,
+								Uptr numWaits,
+								U64 untilClock,
+								void (*callback)(void*),
+								void* argument)
+{
+	Waiter* waiter = new Waiter;
+	waiter->callback = callback;
+	waiter->argument = argument;
+	++eventLoop->numPendingWaits;
+
+	bool isWaitingForAlwaysReadyFile = false;
+	for(Uptr waitIndex = 0; waitIndex < numWaits; ++waitIndex)
+	{
+		const I16 pollEvents = getPollEvents(waits[waitIndex]);
+		if(!pollEvents) { continue; }
+
+		const I32 fd = filePtrToIndex(waits[waitIndex].file);
+		FileDescriptorState& fdState = eventLoop->fdStates.getOrAdd(fd);
+		fdState.waiters.push_back({waiter, pollEvents});
+		waiter->fds.push_back(fd);
+
+		updateFileDescriptorState(eventLoop, fd);
+		if(eventLoop->fdStates[fd].isAlwaysReady) { isWaitingForAlwaysReadyFile = true; }
+	}
+
+	if(untilClock != UINT64_MAX)
+	{
+		waiter->timer = eventLoop->timers.emplace(untilClock, waiter);
+		waiter->hasTimer = true;
+	}
+
+	if(isWaitingForAlwaysReadyFile)
+	{
+		removeWaiter(eventLoop, waiter);
+		satisfyWaiter(eventLoop->satisfiedWaiters, waiter);
+	}
+}
+
+Uptr Platform::getNumPendingEventLoopWaits(EventLoop* eventLoop)
+{
+	return eventLoop->numPendingWaits;
+}
+
+// Satisfies the waiters of a file descriptor that are waiting for any of the given poll events.
+static void satisfyFileDescriptorWaiters(EventLoop* eventLoop,
+										 I32 fd,
+										 I16 pollEvents,
+										 std::vector<Waiter*>& outSatisfiedWaiters)
+{
+	const FileDescriptorState* fdState = eventLoop->fdStates.get(fd);
+	if(!fdState) { return; }
+
+	// Errors and hangups satisfy all waiters, since reading or writing the file won't block.
+	const bool isErrorOrHangup = (pollEvents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+	for(const FileDescriptorWaiter& fdWaiter : fdState->waiters)
+	{
+		if(isErrorOrHangup || (fdWaiter.pollEvents & pollEvents))
+		{ satisfyWaiter(outSatisfiedWaiters, fdWaiter.waiter); }
+	}
+}
+
+Uptr Platform::runEventLoop(EventLoop* eventLoop, U64 untilClock)
+{
+	std::vector<Waiter*> satisfiedWaiters = std::move(eventLoop->satisfiedWaiters);
+	eventLoop->satisfiedWaiters.clear();
+
+	// If there are waiters that were satisfied when they were added, call them without waiting.
+	U64 waitUntilClock = satisfiedWaiters.size() ? 0 : untilClock;
+	if(!eventLoop->timers.empty() && eventLoop->timers.begin()->first < waitUntilClock)
+	{ waitUntilClock = eventLoop->timers.begin()->first; }
+	const int timeoutMS = getPollTimeoutMS(waitUntilClock);
+
+#ifdef __linux__
+	enum
+	{
+		maxEventsPerWait = 64
+	};
+	epoll_event events[maxEventsPerWait];
+	const int numEvents = epoll_wait(eventLoop->epollFD, events, maxEventsPerWait, timeoutMS);
+	if(numEvents < 0 && errno != EINTR)
+	{ Errors::fatalf("epoll_wait failed: %s", strerror(errno)); }
+	for(int eventIndex = 0; eventIndex < numEvents; ++eventIndex)
+	{
+		satisfyFileDescriptorWaiters(
+			eventLoop, events[eventIndex].data.fd, I16(events[eventIndex].events), satisfiedWaiters);
+	}
+#else
+	std::vector<pollfd> pollFDs;
+	for(const auto& fdStatePair : eventLoop->fdStates)
+	{ pollFDs.push_back({fdStatePair.key, fdStatePair.value.registeredPollEvents, 0}); }
+	const int numEvents = poll(pollFDs.data(), nfds_t(pollFDs.size()), timeoutMS);
+	if(numEvents < 0 && errno != EINTR) { Errors::fatalf("poll failed: %s", strerror(errno)); }
+	for(Uptr pollFDIndex = 0; numEvents > 0 && pollFDIndex < pollFDs.size(); ++pollFDIndex)
+	{
+		if(pollFDs[pollFDIndex].revents)
+		{
+			satisfyFileDescriptorWaiters(eventLoop,
+										 pollFDs[pollFDIndex].fd,
+										 pollFDs[pollFDIndex].revents,
+										 satisfiedWaiters);
+		}
+	}
+#endif
+
+	// Satisfy the waiters whose timeouts have expired.
+	const U64 currentClock = getMonotonicClock();
+	for(auto timerIt = eventLoop->timers.begin();
+		timerIt != eventLoop->timers.end() && timerIt->first <= currentClock;
+		++timerIt)
+	{ satisfyWaiter(satisfiedWaiters, timerIt->second); }
+
+	// Remove all the satisfied waiters before calling any callbacks, so the callbacks may add new
+	// waits.
+	for(Waiter* waiter : satisfiedWaiters) { removeWaiter(eventLoop, waiter); }
+	eventLoop->numPendingWaits -= satisfiedWaiters.size();
+
+	for(Waiter* waiter : satisfiedWaiters)
+	{
+		(*waiter->callback)(waiter->argument);
+		delete waiter;
+	}
+
+	return satisfiedWaiters.size();
+}
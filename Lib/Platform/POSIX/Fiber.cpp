@@ -0,0 +1,221 @@
+#include <string.h>
+
+#include "POSIXPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/Memory.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+struct Platform::Fiber
+{
+	void (*entry)(void*);
+	void* entryArgument;
+
+	U8* stackGuardAddr;
+	U8* stackMinAddr;
+	U8* stackMaxAddr;
+
+	// The execution state that resumes the fiber, and the execution state that returns to the
+	// caller of resumeFiber when the fiber suspends or its entry function returns.
+	ExecutionContext fiberContext;
+	ExecutionContext resumerContext;
+
+	// The fiber's chain of signal contexts while it is suspended, and the resumer's chain while the
+	// fiber is running.
+	SignalContext* fiberSignalContext{nullptr};
+	SignalContext* resumerSignalContext{nullptr};
+
+	// The fiber that was running on the thread when this fiber was resumed, if any.
+	Fiber* resumerFiber{nullptr};
+
+	bool isRunning{false};
+	bool hasReturned{false};
+};
+
+static thread_local Fiber* currentFiber = nullptr;
+
+// Fibers may be resumed on a different thread than they were suspended on. The functions that
+// access thread-local state after a fiber may have been resumed aren't inlined, so the compiler
+// can't reuse the addresses of thread-local variables that it computed before the fiber was
+// resumed.
+[[noreturn]] FORCENOINLINE static void leaveFiber(Fiber* fiber)
+{
+	// Restore the resumer's thread state, and load the execution state saved by resumeFiber.
+	fiber->isRunning = false;
+	currentFiber = fiber->resumerFiber;
+	innermostSignalContext = fiber->resumerSignalContext;
+	loadExecutionState(&fiber->resumerContext, 1);
+}
+
+// The initial execution state of a fiber jumps to this function, as though it were called by a
+// function with a null return address and frame pointer at the base of the fiber's stack.
+[[noreturn]] static void fiberEntry()
+{
+	{
+		Fiber* fiber = currentFiber;
+		(*fiber->entry)(fiber->entryArgument);
+	}
+
+	// If the fiber was forked, the entry function returns to a copy of this frame on the forked
+	// fiber's stack, so get the fiber that returned from currentFiber instead of the local above.
+	Fiber* fiber = getCurrentFiber();
+	fiber->hasReturned = true;
+	leaveFiber(fiber);
+}
+
+Fiber* Platform::createFiber(Uptr numStackBytes, void (*entry)(void*), void* argument)
+{
+	const Uptr pageSizeLog2 = getPageSizeLog2();
+	const Uptr numStackPages = (numStackBytes + (Uptr(1) << pageSizeLog2) - 1) >> pageSizeLog2;
+
+	// Reserve the stack and a guard page below it, but only commit the stack.
+	U8* stackGuardAddr = allocateVirtualPages(numStackPages + 1);
+	if(!stackGuardAddr) { return nullptr; }
+	U8* stackMinAddr = stackGuardAddr + (Uptr(1) << pageSizeLog2);
+	if(!commitVirtualPages(stackMinAddr, numStackPages))
+	{
+		freeVirtualPages(stackGuardAddr, numStackPages + 1);
+		return nullptr;
+	}
+
+	Fiber* fiber = new Fiber;
+	fiber->entry = entry;
+	fiber->entryArgument = argument;
+	fiber->stackGuardAddr = stackGuardAddr;
+	fiber->stackMinAddr = stackMinAddr;
+	fiber->stackMaxAddr = stackMinAddr + (numStackPages << pageSizeLog2);
+
+	// Push a null return address, and align the stack as it would be on entry to a function.
+	U8* stackPointer = fiber->stackMaxAddr - sizeof(Uptr);
+	*reinterpret_cast<Uptr*>(stackPointer) = 0;
+
+	memset(&fiber->fiberContext, 0, sizeof(ExecutionContext));
+	fiber->fiberContext.rsp = reinterpret_cast<U64>(stackPointer);
+	fiber->fiberContext.rip = reinterpret_cast<U64>(&fiberEntry);
+
+	return fiber;
+}
+
+void Platform::destroyFiber(Fiber* fiber)
+{
+	wavmAssert(!fiber->isRunning);
+	const Uptr numStackPages
+		= Uptr(fiber->stackMaxAddr - fiber->stackGuardAddr) >> getPageSizeLog2();
+	freeVirtualPages(fiber->stackGuardAddr, numStackPages);
+	delete fiber;
+}
+
+bool Platform::resumeFiber(Fiber* fiber)
+{
+	wavmAssert(!fiber->isRunning && !fiber->hasReturned);
+
+	// Initialize the thread's signal stack while running on the thread's own stack: it may be
+	// allocated on the thread's stack, which can't be done while running on the fiber's stack.
+	sigAltStack.init();
+
+	// Save this thread's state, and replace it with the fiber's.
+	fiber->isRunning = true;
+	fiber->resumerFiber = currentFiber;
+	fiber->resumerSignalContext = innermostSignalContext;
+	currentFiber = fiber;
+	innermostSignalContext = fiber->fiberSignalContext;
+
+	// Save the execution state to return to, and load the fiber's. When the fiber suspends or
+	// returns, it restores this thread's state and loads the saved execution state, which returns
+	// from saveExecutionState a second time with a non-zero result.
+	if(!saveExecutionState(&fiber->resumerContext, 0))
+	{ loadExecutionState(&fiber->fiberContext, 1); }
+
+	return fiber->hasReturned;
+}
+
+void Platform::suspendFiber()
+{
+	Fiber* fiber = currentFiber;
+	errorUnless(fiber);
+
+	// Save the execution state to resume the fiber with. When the fiber is resumed, resumeFiber has
+	// already replaced the resuming thread's state with the fiber's, so just return.
+	if(!saveExecutionState(&fiber->fiberContext, 0))
+	{
+		fiber->fiberSignalContext = innermostSignalContext;
+		leaveFiber(fiber);
+	}
+}
+
+NO_ASAN Fiber* Platform::forkCurrentFiber(void* forkedArgument)
+{
+	Fiber* fiber = getCurrentFiber();
+	errorUnless(fiber);
+
+	const Uptr numStackBytes = Uptr(fiber->stackMaxAddr - fiber->stackMinAddr);
+	Fiber* forkedFiber = createFiber(numStackBytes, fiber->entry, forkedArgument);
+	if(!forkedFiber) { Errors::fatal("Couldn't allocate the stack for a forked fiber"); }
+
+	// Capture the current execution state as the forked fiber's. When the forked fiber is resumed,
+	// resumeFiber has already replaced the resuming thread's state with the forked fiber's, so it
+	// just "returns" from this function on the forked stack.
+	if(saveExecutionState(&forkedFiber->fiberContext, 0)) { return nullptr; }
+
+	// Use the current stack pointer to derive a conservative bounds on the area of the stack that
+	// is active, and copy it to the same offset from the top of the forked fiber's stack.
+	const U8* minActiveStackAddr = getStackPointer() - 128;
+	if(minActiveStackAddr < fiber->stackMinAddr) { minActiveStackAddr = fiber->stackMinAddr; }
+	const Uptr numActiveStackBytes = Uptr(fiber->stackMaxAddr - minActiveStackAddr);
+	const Iptr forkedStackOffset = forkedFiber->stackMaxAddr - fiber->stackMaxAddr;
+	memcpyNoASAN(
+		forkedFiber->stackMaxAddr - numActiveStackBytes, minActiveStackAddr, numActiveStackBytes);
+
+	// Translate the saved stack pointer to the forked stack.
+	forkedFiber->fiberContext.rsp += forkedStackOffset;
+
+	// Fix up the links in the frame pointer chain for the new stack. The chain ends with the null
+	// frame pointer that fiberEntry was "called" with.
+	for(U8** forkedStackFramePointer = (U8**)&forkedFiber->fiberContext.rbp;
+		*forkedStackFramePointer >= fiber->stackMinAddr
+		&& *forkedStackFramePointer < fiber->stackMaxAddr;
+		forkedStackFramePointer = (U8**)*forkedStackFramePointer)
+	{ *forkedStackFramePointer += forkedStackOffset; }
+
+	// Fix up the links in the signal context chain for the new stack. A fiber's chain starts empty
+	// when it is created, so all the signal contexts in it are on the fiber's stack.
+	forkedFiber->fiberSignalContext = innermostSignalContext;
+	for(SignalContext** forkedSignalContextLink = &forkedFiber->fiberSignalContext;
+		*forkedSignalContextLink;
+		forkedSignalContextLink = &(*forkedSignalContextLink)->outerContext)
+	{
+		*forkedSignalContextLink = reinterpret_cast<SignalContext*>(
+			reinterpret_cast<Uptr>(*forkedSignalContextLink) + forkedStackOffset);
+	}
+
+	return forkedFiber;
+}
+
+void* Platform::getFiberArgument(Fiber* fiber) { return fiber->entryArgument; }
+
+FORCENOINLINE Fiber* Platform::getCurrentFiber()
+{
+	// The empty volatile asm statement prevents the compiler from treating this function as pure,
+	// and reusing its result across a call that suspends the calling fiber.
+	__asm__ __volatile__("");
+	return currentFiber;
+}
+
+void Platform::getCurrentStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*& outMaxAddr)
+{
+	if(Fiber* fiber = getCurrentFiber())
+	{
+		outMinGuardAddr = fiber->stackGuardAddr;
+		outMinAddr = fiber->stackMinAddr;
+		outMaxAddr = fiber->stackMaxAddr;
+	}
+	else
+	{
+		sigAltStack.getNonSignalStack(outMinGuardAddr, outMinAddr, outMaxAddr);
+	}
+}
@@ -1,21 +1,25 @@
+#include <errno.h>
 #include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "POSIXPrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Memory.h"
+
+#ifdef __APPLE__
+#define MAP_ANONYMOUS MAP_ANON
+#endif
 
 using namespace WAVM;
 using namespace WAVM::Platform;
 
-// Instead of just reinterpreting the file descriptor as a pointer, use -fd - 1, which maps fd=0 to
-// a non-null value, and fd=-1 to null.
-static I32 filePtrToIndex(File* ptr) { return I32(-reinterpret_cast<Iptr>(ptr) - 1); }
-
-static File* fileIndexToPtr(int index) { return reinterpret_cast<File*>(-Iptr(index) - 1); }
-
 File* Platform::openFile(const std::string& pathName,
 						 FileAccessMode accessMode,
 						 FileCreateMode createMode)
@@ -101,6 +105,71 @@ bool Platform::writeFile(File* file, const void* data, Uptr numBytes, Uptr* outN
 
 bool Platform::flushFileWrites(File* file) { return fsync(filePtrToIndex(file)) == 0; }
 
+const U8* Platform::mapFile(File* file, Uptr& outNumBytes)
+{
+	struct stat fileStatus;
+	if(fstat(filePtrToIndex(file), &fileStatus) || fileStatus.st_size <= 0
+	   || U64(fileStatus.st_size) > UINTPTR_MAX)
+	{ return nullptr; }
+
+	const Uptr numBytes = Uptr(fileStatus.st_size);
+	void* result = mmap(nullptr, numBytes, PROT_READ, MAP_PRIVATE, filePtrToIndex(file), 0);
+	if(result == MAP_FAILED) { return nullptr; }
+
+	outNumBytes = numBytes;
+	return (const U8*)result;
+}
+
+void Platform::unmapFile(const U8* bytes, Uptr numBytes)
+{
+	if(munmap(const_cast<U8*>(bytes), numBytes))
+	{
+		Errors::fatalf("munmap(0x%" PRIxPTR ", %" PRIuPTR ") failed! errno=%s",
+					   reinterpret_cast<Uptr>(bytes),
+					   numBytes,
+					   strerror(errno));
+	}
+}
+
+bool Platform::mapFileCopyOnWrite(File* file,
+								  U64 fileOffset,
+								  U8* baseVirtualAddress,
+								  Uptr numPages)
+{
+	const Uptr pageSizeLog2 = getPageSizeLog2();
+	wavmAssert(!(reinterpret_cast<Uptr>(baseVirtualAddress) & ((Uptr(1) << pageSizeLog2) - 1)));
+	wavmAssert(!(fileOffset & ((U64(1) << pageSizeLog2) - 1)));
+
+	const Uptr numBytes = numPages << pageSizeLog2;
+	if(mmap(baseVirtualAddress,
+			numBytes,
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_FIXED,
+			filePtrToIndex(file),
+			off_t(fileOffset))
+	   != MAP_FAILED)
+	{ return true; }
+
+	// A failed MAP_FIXED mmap may have unmapped the pages, so map anonymous pages in their place to
+	// avoid leaving a hole in the caller's reservation.
+	if(mmap(baseVirtualAddress,
+			numBytes,
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS,
+			-1,
+			0)
+	   == MAP_FAILED)
+	{
+		Errors::fatalf("mmap(0x%" PRIxPTR ", %" PRIuPTR
+					   ", PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0) "
+					   "failed! errno=%s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   strerror(errno));
+	}
+	return false;
+}
+
 std::string Platform::getCurrentWorkingDirectory()
 {
 	const Uptr maxPathBytes = pathconf(".", _PC_PATH_MAX);
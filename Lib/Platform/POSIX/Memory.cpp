@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -15,6 +16,12 @@
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+// Older headers don't define MADV_POPULATE_WRITE. It is only used by prefaultVirtualPages, which
+// falls back to touching the pages if madvise fails with EINVAL on kernels that don't support it.
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23
+#endif
+
 using namespace WAVM;
 using namespace WAVM::Platform;
 
@@ -31,6 +38,32 @@ Uptr Platform::getPageSizeLog2()
 	return preferredVirtualPageSizeLog2;
 }
 
+static Uptr internalGetHugePageSizeLog2()
+{
+#ifdef __linux__
+	// The transparent huge page size depends on the architecture and the base page size, so ask
+	// the kernel for it.
+	FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+	if(file)
+	{
+		U64 hugePageSize = 0;
+		const bool readHugePageSize = fscanf(file, "%" SCNu64, &hugePageSize) == 1;
+		fclose(file);
+		if(readHugePageSize && hugePageSize > (U64(1) << getPageSizeLog2())
+		   && !(hugePageSize & (hugePageSize - 1)))
+		{ return Uptr(floorLogTwo(hugePageSize)); }
+	}
+#endif
+
+	// If the huge page size isn't known, don't align allocations to more than the page size.
+	return getPageSizeLog2();
+}
+Uptr Platform::getHugePageSizeLog2()
+{
+	static Uptr hugePageSizeLog2 = internalGetHugePageSizeLog2();
+	return hugePageSizeLog2;
+}
+
 static U32 memoryAccessAsPOSIXFlag(MemoryAccess access)
 {
 	switch(access)
@@ -142,6 +175,36 @@ bool Platform::setVirtualPageAccess(U8* baseVirtualAddress, Uptr numPages, Memor
 	return result == 0;
 }
 
+bool Platform::adviseHugeVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	errorUnless(isPageAligned(baseVirtualAddress));
+#ifdef MADV_HUGEPAGE
+	return !madvise(baseVirtualAddress, numPages << getPageSizeLog2(), MADV_HUGEPAGE);
+#else
+	return false;
+#endif
+}
+
+void Platform::prefaultVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	errorUnless(isPageAligned(baseVirtualAddress));
+	const Uptr pageSizeLog2 = getPageSizeLog2();
+
+#ifdef __linux__
+	// Linux 5.14+ can populate the pages in a single call without touching them. Older kernels fail
+	// with EINVAL, so fall back to touching the pages.
+	if(!madvise(baseVirtualAddress, numPages << pageSizeLog2, MADV_POPULATE_WRITE)) { return; }
+#endif
+
+	// Touch each page with an atomic read-modify-write that doesn't change its value: the pages may
+	// be concurrently accessed by other threads, and a read would just map the shared zero page.
+	for(Uptr pageIndex = 0; pageIndex < numPages; ++pageIndex)
+	{
+		__atomic_fetch_or(
+			baseVirtualAddress + (pageIndex << pageSizeLog2), U8(0), __ATOMIC_RELAXED);
+	}
+}
+
 void Platform::decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 {
 	errorUnless(isPageAligned(baseVirtualAddress));
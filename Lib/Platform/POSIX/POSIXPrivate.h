@@ -62,7 +62,7 @@ inline void __deregister_frame(const void* fde)
 #else
 // Defined in POSIX.S
 extern "C" I64 saveExecutionState(ExecutionContext* outContext, I64 returnCode) noexcept(false);
-[[noreturn]] extern void loadExecutionState(ExecutionContext* context, I64 returnCode);
+extern "C" [[noreturn]] void loadExecutionState(ExecutionContext* context, I64 returnCode);
 extern "C" I64 switchToForkedStackContext(ExecutionContext* forkedContext,
 										  U8* trampolineFramePointer) noexcept(false);
 extern "C" U8* getStackPointer();
@@ -75,6 +75,12 @@ extern "C" void __deregister_frame(const void* fde);
 namespace WAVM { namespace Platform {
 
 	struct CallStack;
+	struct File;
+
+	// Instead of just reinterpreting the file descriptor as a pointer, use -fd - 1, which maps fd=0
+	// to a non-null value, and fd=-1 to null.
+	inline I32 filePtrToIndex(File* ptr) { return I32(-reinterpret_cast<Iptr>(ptr) - 1); }
+	inline File* fileIndexToPtr(int index) { return reinterpret_cast<File*>(-Iptr(index) - 1); }
 
 	struct SignalContext
 	{
@@ -105,5 +111,21 @@ namespace WAVM { namespace Platform {
 	extern thread_local SignalContext* innermostSignalContext;
 
 	void dumpErrorCallStack(Uptr numOmittedFramesFromTop);
+
+	// Copies memory without checking or changing whether AddressSanitizer considers it addressable:
+	// copies the source's shadow memory to the destination's when AddressSanitizer is enabled.
+	void memcpyNoASAN(U8* dest, const U8* source, Uptr numBytes);
+
+	// Returns the address range of the stack that the calling thread is running on: the stack of
+	// the current fiber, or the thread's own stack.
+	void getCurrentStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*& outMaxAddr);
+
+	// Adds the return address in each frame of a chain of frame pointers to a call stack. Only
+	// follows frame pointers into the given range of stack addresses.
+	void walkFramePointers(CallStack& callStack,
+						   const Uptr* framePointer,
+						   Uptr numOmittedFramesFromTop,
+						   const U8* stackMinAddr,
+						   const U8* stackMaxAddr);
 	void getCurrentThreadStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*& outMaxAddr);
 }}
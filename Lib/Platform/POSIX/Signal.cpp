@@ -1,21 +1,63 @@
+#include <errno.h>
+#include <sched.h>
 #include <signal.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <atomic>
 
 #include "POSIXPrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Lock.h"
 #include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Mutex.h"
 
 using namespace WAVM;
 using namespace WAVM::Platform;
 
 thread_local SignalContext* Platform::innermostSignalContext = nullptr;
 
-[[noreturn]] static void signalHandler(int signalNumber, siginfo_t* signalInfo, void*)
+// Captures the call stack of the code that a signal interrupted. The signal frame doesn't continue
+// the chain of frame pointers, so start from the interrupted context's registers, and only follow
+// frame pointers into the stack between the interrupted stack pointer and stackMaxAddr. Returns
+// false if the platform's signal context isn't supported.
+static bool captureInterruptedCallStack(void* contextVoid,
+										CallStack& outCallStack,
+										const U8* stackMinAddr,
+										const U8* stackMaxAddr)
+{
+#if defined(__linux__) && defined(__x86_64__)
+	const mcontext_t& machineContext = ((ucontext_t*)contextVoid)->uc_mcontext;
+	const Uptr instructionPointer = Uptr(machineContext.gregs[REG_RIP]);
+	const Uptr* framePointer = (const Uptr*)machineContext.gregs[REG_RBP];
+	const U8* stackPointer = (const U8*)machineContext.gregs[REG_RSP];
+#elif defined(__APPLE__) && defined(__x86_64__)
+	const _STRUCT_X86_THREAD_STATE64& threadState = ((ucontext_t*)contextVoid)->uc_mcontext->__ss;
+	const Uptr instructionPointer = Uptr(threadState.__rip);
+	const Uptr* framePointer = (const Uptr*)threadState.__rbp;
+	const U8* stackPointer = (const U8*)threadState.__rsp;
+#else
+	const Uptr instructionPointer = 0;
+	const Uptr* framePointer = nullptr;
+	const U8* stackPointer = nullptr;
+	return false;
+#endif
+
+	if(stackPointer > stackMinAddr) { stackMinAddr = stackPointer; }
+	outCallStack.addFrame(instructionPointer);
+	walkFramePointers(outCallStack, framePointer, 0, stackMinAddr, stackMaxAddr);
+	return true;
+}
+
+[[noreturn]] static void signalHandler(int signalNumber, siginfo_t* signalInfo, void* contextVoid)
 {
 	Signal signal;
 
+	U8* stackMinGuardAddr;
+	U8* stackMinAddr;
+	U8* stackMaxAddr;
+	getCurrentStack(stackMinGuardAddr, stackMinAddr, stackMaxAddr);
+
 	// Derive the exception cause the from signal that was received.
 	switch(signalNumber)
 	{
@@ -28,10 +70,6 @@ thread_local SignalContext* Platform::innermostSignalContext = nullptr;
 	case SIGBUS:
 	{
 		// Determine whether the faulting address was an address reserved by the stack.
-		U8* stackMinGuardAddr;
-		U8* stackMinAddr;
-		U8* stackMaxAddr;
-		sigAltStack.getNonSignalStack(stackMinGuardAddr, stackMinAddr, stackMaxAddr);
 		signal.type = signalInfo->si_addr >= stackMinGuardAddr && signalInfo->si_addr < stackMaxAddr
 						  ? Signal::Type::stackOverflow
 						  : Signal::Type::accessViolation;
@@ -41,9 +79,14 @@ thread_local SignalContext* Platform::innermostSignalContext = nullptr;
 	default: Errors::fatalfWithCallStack("unknown signal number: %i", signalNumber); break;
 	};
 
-	// Capture the execution context, omitting this function and the function that called it, so the
-	// top of the callstack is the function that triggered the signal.
-	CallStack callStack = captureCallStack(2);
+	// Capture the call stack of the function that triggered the signal.
+	CallStack callStack;
+	if(!captureInterruptedCallStack(contextVoid, callStack, stackMinAddr, stackMaxAddr))
+	{
+		// Omit this function and the function that called it, so the top of the callstack is the
+		// function that triggered the signal.
+		callStack = captureCallStack(2);
+	}
 
 	// Call the signal handlers, from innermost to outermost, until one returns true.
 	for(SignalContext* signalContext = innermostSignalContext; signalContext;
@@ -51,9 +94,6 @@ thread_local SignalContext* Platform::innermostSignalContext = nullptr;
 	{
 		if(signalContext->filter(signalContext->filterArgument, signal, std::move(callStack)))
 		{
-			// siglongjmp won't unwind the stack, so manually call the CallStack destructor.
-			callStack.~CallStack();
-
 			// Jump back to the execution context that was saved in catchSignals.
 			siglongjmp(signalContext->catchJump, 1);
 		}
@@ -87,6 +127,14 @@ static bool initSignals()
 	return true;
 }
 
+// The thunk passed to catchSignals may suspend a fiber, which may be resumed on a different thread.
+// Restore innermostSignalContext in a function that isn't inlined, so the compiler can't reuse the
+// address of the thread-local variable that it computed before calling the thunk.
+FORCENOINLINE static void restoreInnermostSignalContext(SignalContext* signalContext)
+{
+	innermostSignalContext = signalContext;
+}
+
 bool Platform::catchSignals(void (*thunk)(void*),
 							bool (*filter)(void*, Signal, CallStack&&),
 							void* argument)
@@ -114,12 +162,95 @@ bool Platform::catchSignals(void (*thunk)(void*),
 		// Call the thunk.
 		thunk(argument);
 	}
-	innermostSignalContext = signalContext.outerContext;
+	restoreInnermostSignalContext(signalContext.outerContext);
 
 	return isReturningFromSignalHandler;
 #endif
 }
 
+// The state of call stack sampling. The sample handler counts itself in numRunningSampleHandlers
+// before loading sampleCallback, so stopCallStackSampling can wait for any calls to the callback
+// that loaded it before it was cleared.
+static Platform::Mutex samplingMutex;
+static std::atomic<void (*)(void*, const CallStack&)> sampleCallback{nullptr};
+static std::atomic<void*> sampleCallbackArgument{nullptr};
+static std::atomic<Uptr> numRunningSampleHandlers{0};
+
+static void sampleSignalHandler(int signalNumber, siginfo_t* signalInfo, void* contextVoid)
+{
+	// Only sample threads that are running code within catchSignals: that is how WAVM runs
+	// WebAssembly code, and it ensures that the thread-local state used to find the thread's stack
+	// has already been initialized, since initializing it isn't async-signal-safe.
+	if(!innermostSignalContext) { return; }
+
+	const int savedErrno = errno;
+	++numRunningSampleHandlers;
+	if(void (*callback)(void*, const CallStack&) = sampleCallback.load())
+	{
+		U8* stackMinGuardAddr;
+		U8* stackMinAddr;
+		U8* stackMaxAddr;
+		getCurrentStack(stackMinGuardAddr, stackMinAddr, stackMaxAddr);
+
+		CallStack callStack;
+		if(captureInterruptedCallStack(contextVoid, callStack, stackMinAddr, stackMaxAddr))
+		{ (*callback)(sampleCallbackArgument.load(), callStack); }
+	}
+	--numRunningSampleHandlers;
+	errno = savedErrno;
+}
+
+static void setSampleTimer(U64 intervalMicroseconds)
+{
+	struct itimerval timer;
+	timer.it_interval.tv_sec = time_t(intervalMicroseconds / 1000000);
+	timer.it_interval.tv_usec = suseconds_t(intervalMicroseconds % 1000000);
+	timer.it_value = timer.it_interval;
+	errorUnless(!setitimer(ITIMER_PROF, &timer, nullptr));
+}
+
+bool Platform::startCallStackSampling(U64 intervalMicroseconds,
+									  void (*callback)(void*, const CallStack&),
+									  void* argument)
+{
+	wavmAssert(intervalMicroseconds > 0);
+
+	Lock<Platform::Mutex> samplingLock(samplingMutex);
+	if(sampleCallback.load()) { return false; }
+	sampleCallbackArgument.store(argument);
+	sampleCallback.store(callback);
+
+	// Handle SIGPROF on the signal stack, and restart system calls that it interrupts.
+	struct sigaction signalAction;
+	sigemptyset(&signalAction.sa_mask);
+	signalAction.sa_sigaction = sampleSignalHandler;
+	signalAction.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+	errorUnless(!sigaction(SIGPROF, &signalAction, nullptr));
+
+	// Send SIGPROF to the process each time it consumes intervalMicroseconds of CPU time. The
+	// kernel delivers it to a thread that is running at the time.
+	setSampleTimer(intervalMicroseconds);
+
+	return true;
+}
+
+void Platform::stopCallStackSampling()
+{
+	Lock<Platform::Mutex> samplingLock(samplingMutex);
+	if(!sampleCallback.load()) { return; }
+
+	setSampleTimer(0);
+	sampleCallback.store(nullptr);
+	while(numRunningSampleHandlers.load()) { sched_yield(); }
+
+	// Ignore any SIGPROF that is still pending: its default action terminates the process.
+	struct sigaction signalAction;
+	sigemptyset(&signalAction.sa_mask);
+	signalAction.sa_handler = SIG_IGN;
+	signalAction.sa_flags = 0;
+	errorUnless(!sigaction(SIGPROF, &signalAction, nullptr));
+}
+
 static void visitFDEs(const U8* ehFrames, Uptr numBytes, void (*visitFDE)(const void*))
 {
 	// The LLVM project libunwind implementation that WAVM uses expects __register_frame and
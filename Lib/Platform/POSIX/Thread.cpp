@@ -21,6 +21,7 @@
 #include "WAVM/Inline/Config.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/Lock.h"
+#include "WAVM/Platform/Diagnostics.h"
 #include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
@@ -222,6 +223,50 @@ void SigAltStack::getNonSignalStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*&
 
 thread_local SigAltStack Platform::sigAltStack;
 
+void Platform::walkFramePointers(CallStack& callStack,
+								 const Uptr* framePointer,
+								 Uptr numOmittedFramesFromTop,
+								 const U8* stackMinAddr,
+								 const U8* stackMaxAddr)
+{
+	// Each frame starts with the caller's frame pointer, followed by the return address into the
+	// caller. Stop at the first frame pointer that isn't an aligned address in the stack above the
+	// previous frame: it was probably not written by a function that maintains a frame pointer.
+	while(!(reinterpret_cast<Uptr>(framePointer) & (sizeof(Uptr) - 1))
+		  && reinterpret_cast<const U8*>(framePointer) >= stackMinAddr
+		  && reinterpret_cast<const U8*>(framePointer + 2) <= stackMaxAddr)
+	{
+		const Uptr returnAddress = framePointer[1];
+		if(!returnAddress) { break; }
+
+		if(numOmittedFramesFromTop) { --numOmittedFramesFromTop; }
+		else if(!callStack.addFrame(returnAddress))
+		{
+			break;
+		}
+
+		const Uptr* callerFramePointer = reinterpret_cast<const Uptr*>(framePointer[0]);
+		if(callerFramePointer <= framePointer) { break; }
+		framePointer = callerFramePointer;
+	}
+}
+
+FORCENOINLINE CallStack Platform::captureFramePointerCallStack(Uptr numOmittedFramesFromTop)
+{
+	U8* stackMinGuardAddr;
+	U8* stackMinAddr;
+	U8* stackMaxAddr;
+	getCurrentStack(stackMinGuardAddr, stackMinAddr, stackMaxAddr);
+
+	CallStack result;
+	walkFramePointers(result,
+					  reinterpret_cast<const Uptr*>(__builtin_frame_address(0)),
+					  numOmittedFramesFromTop,
+					  stackMinAddr,
+					  stackMaxAddr);
+	return result;
+}
+
 struct ThreadEntryContext
 {
 	jmp_buf exitJump;
@@ -308,7 +353,7 @@ NO_ASAN static void* forkThreadEntry(void* argsVoid)
 	return reinterpret_cast<void*>(localThreadEntryContext.exitCode);
 }
 
-static void memcpyNoASAN(U8* dest, const U8* source, Uptr numBytes)
+void Platform::memcpyNoASAN(U8* dest, const U8* source, Uptr numBytes)
 {
 #if WAVM_ENABLE_ASAN
 	bytewiseMemCopy(dest, source, numBytes);
@@ -1,5 +1,6 @@
 #include "WAVM/Platform/Clock.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
 
 #define NOMINMAX
 #include <Windows.h>
@@ -22,3 +23,75 @@ U64 Platform::getMonotonicClock()
 			   : performanceCounter.QuadPart
 					 * (wavmFrequency / performanceCounterFrequency.QuadPart);
 }
+
+// FILETIMEs count 100ns intervals.
+static U64 fileTimeToNanoseconds(FILETIME fileTime)
+{
+	return ((U64(fileTime.dwHighDateTime) << 32) | U64(fileTime.dwLowDateTime)) * 100;
+}
+
+bool Platform::getClockTime(Clock clock, U64& outNanoseconds)
+{
+	switch(clock)
+	{
+	case Clock::realtime:
+	{
+		// The system time's origin is 1601, so subtract the number of nanoseconds from then to the
+		// Unix epoch.
+		FILETIME systemTime;
+		GetSystemTimePreciseAsFileTime(&systemTime);
+		outNanoseconds = fileTimeToNanoseconds(systemTime) - 11644473600000000000ull;
+		return true;
+	}
+	case Clock::monotonic:
+	{
+		// Convert the whole seconds and the remainder separately to avoid overflow.
+		LARGE_INTEGER performanceCounter;
+		LARGE_INTEGER performanceCounterFrequency;
+		QueryPerformanceCounter(&performanceCounter);
+		QueryPerformanceFrequency(&performanceCounterFrequency);
+		const U64 counter = U64(performanceCounter.QuadPart);
+		const U64 frequency = U64(performanceCounterFrequency.QuadPart);
+		outNanoseconds
+			= counter / frequency * 1000000000 + counter % frequency * 1000000000 / frequency;
+		return true;
+	}
+	case Clock::processCPUTime:
+	case Clock::threadCPUTime:
+	{
+		FILETIME creationTime;
+		FILETIME exitTime;
+		FILETIME kernelTime;
+		FILETIME userTime;
+		const BOOL result
+			= clock == Clock::processCPUTime
+				  ? GetProcessTimes(
+						GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)
+				  : GetThreadTimes(
+						GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime);
+		if(!result) { return false; }
+		outNanoseconds = fileTimeToNanoseconds(kernelTime) + fileTimeToNanoseconds(userTime);
+		return true;
+	}
+	default: Errors::unreachable();
+	}
+}
+
+bool Platform::getClockResolution(Clock clock, U64& outNanoseconds)
+{
+	switch(clock)
+	{
+	case Clock::realtime:
+	case Clock::processCPUTime:
+	case Clock::threadCPUTime: outNanoseconds = 100; return true;
+	case Clock::monotonic:
+	{
+		LARGE_INTEGER performanceCounterFrequency;
+		QueryPerformanceFrequency(&performanceCounterFrequency);
+		const U64 frequency = U64(performanceCounterFrequency.QuadPart);
+		outNanoseconds = frequency >= 1000000000 ? 1 : (1000000000 + frequency - 1) / frequency;
+		return true;
+	}
+	default: Errors::unreachable();
+	}
+}
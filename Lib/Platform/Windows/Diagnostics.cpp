@@ -25,10 +25,11 @@ static void dumpErrorCallStack(Uptr numOmittedFramesFromTop)
 {
 	std::fprintf(stderr, "Call stack:\n");
 	CallStack callStack = captureCallStack(numOmittedFramesFromTop);
-	for(auto frame : callStack.stackFrames)
+	for(Uptr frameIndex = 0; frameIndex < callStack.numStackFrames; ++frameIndex)
 	{
 		std::string frameDescription;
-		if(!Platform::describeInstructionPointer(frame.ip, frameDescription))
+		if(!Platform::describeInstructionPointer(callStack.stackFrames[frameIndex].ip,
+												 frameDescription))
 		{ frameDescription = "<unknown function>"; }
 		std::fprintf(stderr, "  %s\n", frameDescription.c_str());
 	}
@@ -158,6 +159,15 @@ bool Platform::describeInstructionPointer(Uptr ip, std::string& outDescription)
 	}
 }
 
+bool Platform::startCallStackSampling(U64 intervalMicroseconds,
+									  void (*callback)(void*, const CallStack&),
+									  void* argument)
+{
+	return false;
+}
+
+void Platform::stopCallStackSampling() {}
+
 CallStack Platform::unwindStack(const CONTEXT& immutableContext, Uptr numOmittedFramesFromTop)
 {
 	// Make a mutable copy of the context.
@@ -171,9 +181,9 @@ CallStack Platform::unwindStack(const CONTEXT& immutableContext, Uptr numOmitted
 	while(context.Rip)
 	{
 		if(numOmittedFramesFromTop) { --numOmittedFramesFromTop; }
-		else
+		else if(!callStack.addFrame(context.Rip))
 		{
-			callStack.stackFrames.push_back({context.Rip});
+			break;
 		}
 
 		// Look up the SEH unwind information for this function.
@@ -214,3 +224,10 @@ CallStack Platform::captureCallStack(Uptr numOmittedFramesFromTop)
 	// Unwind the stack.
 	return unwindStack(context, numOmittedFramesFromTop + 1);
 }
+
+FORCENOINLINE CallStack Platform::captureFramePointerCallStack(Uptr numOmittedFramesFromTop)
+{
+	// Windows x64 code doesn't maintain a chain of frame pointers, so use the SEH unwind
+	// information. Unwinding stops once the call stack is full, which bounds its cost.
+	return captureCallStack(numOmittedFramesFromTop + 1);
+}
@@ -12,6 +12,8 @@ using namespace WAVM::Platform;
 
 Platform::Event::Event()
 {
+	// Create an auto-reset event: a wait that it wakes resets it, and it stays signaled until then
+	// if no thread is waiting.
 	handle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 	errorUnless(handle);
 }
@@ -24,7 +26,9 @@ bool Platform::Event::wait(U64 untilTime)
 	while(true)
 	{
 		const U64 timeoutMicroseconds = currentTime > untilTime ? 0 : (untilTime - currentTime);
-		const U64 timeoutMilliseconds64 = timeoutMicroseconds / 1000;
+		// Round the timeout up, so a wait for less than a millisecond blocks instead of polling.
+		const U64 timeoutMilliseconds64
+			= timeoutMicroseconds / 1000 + (timeoutMicroseconds % 1000 ? 1 : 0);
 		const U32 timeoutMilliseconds32
 			= timeoutMilliseconds64 > UINT32_MAX ? (UINT32_MAX - 1) : U32(timeoutMilliseconds64);
 
@@ -0,0 +1,114 @@
+#include <map>
+#include <vector>
+
+#include "WAVM/Platform/EventLoop.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Clock.h"
+
+#define NOMINMAX
+#include <Windows.h>
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// Windows doesn't have a way to wait for the readiness of the kinds of files that WAVM uses, so
+// all files are treated as ready, and event loops only wait for timeouts.
+
+namespace {
+	struct Waiter
+	{
+		void (*callback)(void*);
+		void* argument;
+	};
+}
+
+struct Platform::EventLoop
+{
+	std::multimap<U64, Waiter> timers;
+	std::vector<Waiter> satisfiedWaiters;
+};
+
+static void sleepUntil(U64 untilClock)
+{
+	const U64 currentClock = getMonotonicClock();
+	if(untilClock > currentClock)
+	{
+		const U64 timeoutMilliseconds64 = (untilClock - currentClock + 999) / 1000;
+		Sleep(timeoutMilliseconds64 >= INFINITE ? (INFINITE - 1) : DWORD(timeoutMilliseconds64));
+	}
+}
+
+Uptr Platform::pollFiles(const FileWait* waits,
+						 FileReadiness* outReadiness,
+						 Uptr numWaits,
+						 U64 untilClock)
+{
+	Uptr numReadyFiles = 0;
+	for(Uptr waitIndex = 0; waitIndex < numWaits; ++waitIndex)
+	{
+		outReadiness[waitIndex].readable = waits[waitIndex].read;
+		outReadiness[waitIndex].writable = waits[waitIndex].write;
+		outReadiness[waitIndex].hangup = false;
+		outReadiness[waitIndex].error = false;
+		if(waits[waitIndex].read || waits[waitIndex].write) { ++numReadyFiles; }
+	}
+
+	if(!numReadyFiles && untilClock != UINT64_MAX) { sleepUntil(untilClock); }
+	return numReadyFiles;
+}
+
+EventLoop* Platform::createEventLoop() { return new EventLoop; }
+
+void Platform::destroyEventLoop(EventLoop* eventLoop) { delete eventLoop; }
+
+void Platform::addEventLoopWait(EventLoop* eventLoop,
+								const FileWait* waits,
+								Uptr numWaits,
+								U64 untilClock,
+								void (*callback)(void*),
+								void* argument)
+{
+	bool isWaitingForFile = false;
+	for(Uptr waitIndex = 0; waitIndex < numWaits; ++waitIndex)
+	{
+		if(waits[waitIndex].read || waits[waitIndex].write) { isWaitingForFile = true; }
+	}
+
+	if(isWaitingForFile) { eventLoop->satisfiedWaiters.push_back({callback, argument}); }
+	else
+	{
+		eventLoop->timers.emplace(untilClock, Waiter{callback, argument});
+	}
+}
+
+Uptr Platform::getNumPendingEventLoopWaits(EventLoop* eventLoop)
+{
+	return eventLoop->timers.size() + eventLoop->satisfiedWaiters.size();
+}
+
+Uptr Platform::runEventLoop(EventLoop* eventLoop, U64 untilClock)
+{
+	std::vector<Waiter> satisfiedWaiters = std::move(eventLoop->satisfiedWaiters);
+	eventLoop->satisfiedWaiters.clear();
+
+	if(satisfiedWaiters.empty())
+	{
+		U64 waitUntilClock = untilClock;
+		if(!eventLoop->timers.empty() && eventLoop->timers.begin()->first < waitUntilClock)
+		{ waitUntilClock = eventLoop->timers.begin()->first; }
+		errorUnless(waitUntilClock != UINT64_MAX);
+		sleepUntil(waitUntilClock);
+	}
+
+	// Satisfy the waiters whose timeouts have expired.
+	const U64 currentClock = getMonotonicClock();
+	while(!eventLoop->timers.empty() && eventLoop->timers.begin()->first <= currentClock)
+	{
+		satisfiedWaiters.push_back(eventLoop->timers.begin()->second);
+		eventLoop->timers.erase(eventLoop->timers.begin());
+	}
+
+	for(const Waiter& waiter : satisfiedWaiters) { (*waiter.callback)(waiter.argument); }
+	return satisfiedWaiters.size();
+}
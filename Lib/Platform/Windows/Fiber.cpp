@@ -0,0 +1,205 @@
+#include <malloc.h>
+#include <string.h>
+#include <vector>
+
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Defines.h"
+#include "WindowsPrivate.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// When a forked fiber starts, it copies the forked stack this many bytes below its initial stack
+// pointer, to leave room for the frames of the functions that copy the stack and switch to it.
+enum
+{
+	forkedStackGapBytes = 16384
+};
+
+struct Platform::Fiber
+{
+	void (*entry)(void*);
+	void* entryArgument;
+	Uptr numStackBytes;
+
+	// The stack pointer that the entry function was called with. The stack above it isn't copied
+	// when the fiber is forked.
+	U8* entryFramePointer{nullptr};
+
+	// For a forked fiber that hasn't started: the execution state to start it with, and a copy of
+	// the active part of the forked stack, which ends at entryFramePointer.
+	ExecutionContext forkContext;
+	std::vector<U8> forkedStackBytes;
+
+	// The Win32 fiber that runs this fiber, and the Win32 fiber to switch back to when this fiber
+	// suspends or its entry function returns.
+	void* win32Fiber{nullptr};
+	void* resumerWin32Fiber{nullptr};
+
+	// The fiber that was running on the thread when this fiber was resumed, if any.
+	Fiber* resumerFiber{nullptr};
+
+	bool isRunning{false};
+	bool hasReturned{false};
+};
+
+static thread_local Fiber* currentFiber = nullptr;
+
+// Fibers may be resumed on a different thread than they were suspended on, so don't inline the
+// function that accesses thread-local state after the fiber's entry function returns.
+FORCENOINLINE static void leaveFiber(Fiber* fiber)
+{
+	fiber->isRunning = false;
+	currentFiber = fiber->resumerFiber;
+	SwitchToFiber(fiber->resumerWin32Fiber);
+}
+
+static VOID CALLBACK fiberEntry(LPVOID parameter)
+{
+	Fiber* fiber = (Fiber*)parameter;
+	fiber->entryFramePointer = getStackPointer();
+	(*fiber->entry)(fiber->entryArgument);
+
+	fiber->hasReturned = true;
+	leaveFiber(fiber);
+	Errors::unreachable();
+}
+
+Fiber* Platform::createFiber(Uptr numStackBytes, void (*entry)(void*), void* argument)
+{
+	Fiber* fiber = new Fiber;
+	fiber->entry = entry;
+	fiber->entryArgument = argument;
+	fiber->numStackBytes = numStackBytes;
+
+	// Win32 fibers' stacks are reserved with a guard page, and committed on demand.
+	fiber->win32Fiber
+		= CreateFiberEx(numStackBytes, numStackBytes, FIBER_FLAG_FLOAT_SWITCH, fiberEntry, fiber);
+	if(!fiber->win32Fiber)
+	{
+		delete fiber;
+		return nullptr;
+	}
+
+	return fiber;
+}
+
+void Platform::destroyFiber(Fiber* fiber)
+{
+	wavmAssert(!fiber->isRunning);
+	DeleteFiber(fiber->win32Fiber);
+	delete fiber;
+}
+
+bool Platform::resumeFiber(Fiber* fiber)
+{
+	wavmAssert(!fiber->isRunning && !fiber->hasReturned);
+
+	// Switching to a fiber requires the calling thread to be a fiber. A thread that is converted
+	// to a fiber stays a fiber until it exits.
+	void* threadWin32Fiber = IsThreadAFiber() ? GetCurrentFiber() : ConvertThreadToFiber(nullptr);
+	errorUnless(threadWin32Fiber);
+
+	fiber->isRunning = true;
+	fiber->resumerWin32Fiber = threadWin32Fiber;
+	fiber->resumerFiber = currentFiber;
+	currentFiber = fiber;
+	SwitchToFiber(fiber->win32Fiber);
+
+	return fiber->hasReturned;
+}
+
+void Platform::suspendFiber()
+{
+	Fiber* fiber = getCurrentFiber();
+	errorUnless(fiber);
+	leaveFiber(fiber);
+}
+
+#ifdef _WIN64
+// The stack is committed on demand by touching its guard page, so writing to the stack far below
+// the stack pointer may fault. This commits the pages below the caller's stack pointer by
+// allocating them with _alloca, which touches each page in order.
+FORCENOINLINE static void commitStackBelowCaller(Uptr numBytes)
+{
+	volatile U8* bytes = (U8*)_alloca(numBytes);
+	bytes[0] = 0;
+}
+
+// The entry function of a forked fiber: copies the forked stack to this fiber's stack, and loads
+// the execution state captured by forkCurrentFiber. When the copy of the forked fiber's entry
+// function returns, switchToForkedStackContext returns here.
+static VOID CALLBACK forkedFiberEntry(LPVOID parameter)
+{
+	Fiber* fiber = (Fiber*)parameter;
+
+	U8* forkedStackMaxAddr
+		= reinterpret_cast<U8*>(reinterpret_cast<Uptr>(getStackPointer()) & ~Uptr(15))
+		  - forkedStackGapBytes;
+	const Uptr numForkedStackBytes = fiber->forkedStackBytes.size();
+	commitStackBelowCaller(forkedStackGapBytes + numForkedStackBytes + 4096);
+	memcpy(forkedStackMaxAddr - numForkedStackBytes,
+		   fiber->forkedStackBytes.data(),
+		   numForkedStackBytes);
+	std::vector<U8>().swap(fiber->forkedStackBytes);
+
+	// Translate the captured stack pointer and the entry frame pointer to this fiber's stack.
+	const Iptr forkedStackOffset = forkedStackMaxAddr - fiber->entryFramePointer;
+	wavmAssert(!(forkedStackOffset & 15));
+	fiber->forkContext.rsp += forkedStackOffset;
+	fiber->entryFramePointer = forkedStackMaxAddr;
+
+	switchToForkedStackContext(&fiber->forkContext, fiber->entryFramePointer);
+
+	fiber->hasReturned = true;
+	leaveFiber(fiber);
+	Errors::unreachable();
+}
+
+Fiber* Platform::forkCurrentFiber(void* forkedArgument)
+{
+	Fiber* fiber = getCurrentFiber();
+	errorUnless(fiber);
+	wavmAssert(fiber->entryFramePointer);
+
+	Fiber* forkedFiber = new Fiber;
+	forkedFiber->entry = fiber->entry;
+	forkedFiber->entryArgument = forkedArgument;
+	forkedFiber->numStackBytes = fiber->numStackBytes;
+
+	// Capture the current execution state as the forked fiber's. When the forked fiber is resumed,
+	// forkedFiberEntry loads it on the forked stack, so it "returns" from this function again.
+	if(saveExecutionState(&forkedFiber->forkContext, 0)) { return nullptr; }
+
+	// Use the current stack pointer to derive a conservative bounds on the area of the stack that
+	// is active, and copy it for the forked fiber to copy to its stack when it starts. The forked
+	// fiber's stack isn't known until it runs.
+	const U8* minActiveStackAddr = getStackPointer() - 128;
+	const Uptr numActiveStackBytes = Uptr(fiber->entryFramePointer - minActiveStackAddr);
+	if(numActiveStackBytes + forkedStackGapBytes + 4096 > fiber->numStackBytes)
+	{ Errors::fatal("not enough stack space to fork fiber"); }
+	forkedFiber->forkedStackBytes.assign(minActiveStackAddr, fiber->entryFramePointer);
+	forkedFiber->entryFramePointer = fiber->entryFramePointer;
+
+	forkedFiber->win32Fiber = CreateFiberEx(fiber->numStackBytes,
+											fiber->numStackBytes,
+											FIBER_FLAG_FLOAT_SWITCH,
+											forkedFiberEntry,
+											forkedFiber);
+	if(!forkedFiber->win32Fiber) { Errors::fatal("Couldn't allocate the stack for a forked fiber"); }
+
+	return forkedFiber;
+}
+#else
+Fiber* Platform::forkCurrentFiber(void* forkedArgument)
+{
+	Errors::fatal("Platform::forkCurrentFiber isn't implemented on 32-bit Windows");
+}
+#endif
+
+void* Platform::getFiberArgument(Fiber* fiber) { return fiber->entryArgument; }
+
+FORCENOINLINE Fiber* Platform::getCurrentFiber() { return currentFiber; }
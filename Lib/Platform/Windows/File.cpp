@@ -124,6 +124,41 @@ bool Platform::flushFileWrites(File* file)
 	return FlushFileBuffers(filePointerToHandle(file)) != 0;
 }
 
+const U8* Platform::mapFile(File* file, Uptr& outNumBytes)
+{
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(filePointerToHandle(file), &fileSize) || fileSize.QuadPart == 0
+	   || U64(fileSize.QuadPart) > UINTPTR_MAX)
+	{ return nullptr; }
+
+	HANDLE mappingHandle
+		= CreateFileMappingW(filePointerToHandle(file), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!mappingHandle) { return nullptr; }
+
+	// The view keeps a reference to the file mapping object, so its handle can be closed here.
+	void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	errorUnless(CloseHandle(mappingHandle));
+	if(!view) { return nullptr; }
+
+	outNumBytes = Uptr(fileSize.QuadPart);
+	return (const U8*)view;
+}
+
+void Platform::unmapFile(const U8* bytes, Uptr numBytes)
+{
+	if(!UnmapViewOfFile(bytes)) { Errors::fatal("UnmapViewOfFile failed"); }
+}
+
+bool Platform::mapFileCopyOnWrite(File* file,
+								  U64 fileOffset,
+								  U8* baseVirtualAddress,
+								  Uptr numPages)
+{
+	// Windows can't map a file view over part of a VirtualAlloc reservation, so the caller must
+	// fall back to copying the file contents.
+	return false;
+}
+
 std::string Platform::getCurrentWorkingDirectory()
 {
 	U16 buffer[MAX_PATH];
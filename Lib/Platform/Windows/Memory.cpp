@@ -25,6 +25,12 @@ Uptr Platform::getPageSizeLog2()
 	return preferredVirtualPageSizeLog2;
 }
 
+Uptr Platform::getHugePageSizeLog2()
+{
+	const Uptr largePageSize = GetLargePageMinimum();
+	return largePageSize ? floorLogTwo(largePageSize) : getPageSizeLog2();
+}
+
 static U32 memoryAccessAsWin32Flag(MemoryAccess access)
 {
 	switch(access)
@@ -124,6 +130,25 @@ bool Platform::setVirtualPageAccess(U8* baseVirtualAddress, Uptr numPages, Memor
 		   != 0;
 }
 
+bool Platform::adviseHugeVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	// Windows only supports large pages through MEM_LARGE_PAGES allocations, which require a
+	// privilege and can't be committed incrementally.
+	errorUnless(isPageAligned(baseVirtualAddress));
+	return false;
+}
+
+void Platform::prefaultVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	errorUnless(isPageAligned(baseVirtualAddress));
+
+	// Touch each page with an atomic read-modify-write that doesn't change its value, since the
+	// pages may be concurrently accessed by other threads.
+	const Uptr pageSizeLog2 = getPageSizeLog2();
+	for(Uptr pageIndex = 0; pageIndex < numPages; ++pageIndex)
+	{ InterlockedOr8((volatile char*)(baseVirtualAddress + (pageIndex << pageSizeLog2)), 0); }
+}
+
 void Platform::decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 {
 	errorUnless(isPageAligned(baseVirtualAddress));
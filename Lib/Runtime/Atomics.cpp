@@ -1,16 +1,13 @@
 #include <stdint.h>
-#include <algorithm>
 #include <atomic>
 #include <cmath>
 #include <memory>
 #include <utility>
-#include <vector>
 
 #include "RuntimePrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Hash.h"
-#include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Lock.h"
 #include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Event.h"
@@ -22,58 +19,96 @@
 using namespace WAVM;
 using namespace WAVM::Runtime;
 
-// Holds a list of threads (in the form of events that will wake them) that
-// are waiting on a specific address.
-struct WaitList
+// A thread that is waiting on an address. It is allocated on the waiting thread's stack, and is
+// linked into the wait bucket for the address while the thread is waiting.
+struct Waiter
 {
-	Platform::Mutex mutex;
-	std::vector<Platform::Event*> wakeEvents;
-	std::atomic<Uptr> numReferences;
-
-	WaitList() : numReferences(1) {}
+	Uptr address;
+	WaitEvent* wakeEvent;
+	Waiter* previous;
+	Waiter* next;
+	bool isQueued;
 };
 
-// An event that is reused within a thread when it waits on a WaitList.
-thread_local std::unique_ptr<Platform::Event> threadWakeEvent = nullptr;
+// A bucket of threads waiting on any of the addresses that hash to the bucket. Each bucket is on
+// its own cache line, so threads waiting on addresses in different buckets don't contend.
+struct alignas(64) WaitBucket
+{
+	Platform::Mutex mutex;
 
-// A map from address to a list of threads waiting on that address.
-static Platform::Mutex addressToWaitListMapMutex;
-static HashMap<Uptr, WaitList*> addressToWaitListMap;
+	// A FIFO list of the threads waiting on the bucket's addresses.
+	Waiter* firstWaiter = nullptr;
+	Waiter* lastWaiter = nullptr;
 
-// Opens the wait list for a given address.
-// Increases the wait list's reference count, and returns a pointer to it.
-// Note that it does not lock the wait list mutex.
-// A call to openWaitList should be followed by a call to closeWaitList to avoid leaks.
-static WaitList* openWaitList(Uptr address)
-{
-	Lock<Platform::Mutex> mapLock(addressToWaitListMapMutex);
-	auto waitListPtr = addressToWaitListMap.get(address);
-	if(waitListPtr)
+	void enqueue(Waiter* waiter)
 	{
-		++(*waitListPtr)->numReferences;
-		return *waitListPtr;
+		waiter->previous = lastWaiter;
+		waiter->next = nullptr;
+		if(lastWaiter) { lastWaiter->next = waiter; }
+		else
+		{
+			firstWaiter = waiter;
+		}
+		lastWaiter = waiter;
+		waiter->isQueued = true;
 	}
-	else
+
+	void remove(Waiter* waiter)
 	{
-		WaitList* waitList = new WaitList();
-		addressToWaitListMap.set(address, waitList);
-		return waitList;
+		wavmAssert(waiter->isQueued);
+		if(waiter->previous) { waiter->previous->next = waiter->next; }
+		else
+		{
+			firstWaiter = waiter->next;
+		}
+		if(waiter->next) { waiter->next->previous = waiter->previous; }
+		else
+		{
+			lastWaiter = waiter->previous;
+		}
+		waiter->isQueued = false;
 	}
+};
+
+// A fixed-size table of wait buckets, indexed by a hash of the address being waited on.
+enum
+{
+	numWaitBucketsLog2 = 9
+};
+static WaitBucket waitBuckets[Uptr(1) << numWaitBucketsLog2];
+
+static WaitBucket& getWaitBucket(Uptr address)
+{
+	return waitBuckets[Hash<Uptr>()(address) & ((Uptr(1) << numWaitBucketsLog2) - 1)];
 }
 
-// Closes a wait list, deleting it and removing it from the global map if it was the last reference.
-static void closeWaitList(Uptr address, WaitList* waitList)
+// The default WaitEvent, which blocks the waiting thread on a Platform::Event.
+struct ThreadWaitEvent : WaitEvent
+{
+	Platform::Event event;
+
+	virtual bool wait(U64 untilClock) override { return event.wait(untilClock); }
+	virtual void signal() override { event.signal(); }
+};
+
+// An event that is reused within a thread when it waits on an address.
+thread_local std::unique_ptr<ThreadWaitEvent> threadWakeEvent = nullptr;
+
+static std::atomic<WaitEvent* (*)()> waitEventProvider{nullptr};
+
+void Runtime::setWaitEventProvider(WaitEvent* (*provider)()) { waitEventProvider.store(provider); }
+
+WaitEvent* Runtime::getCurrentWaitEvent()
 {
-	if(--waitList->numReferences == 0)
+	if(WaitEvent* (*provider)() = waitEventProvider.load())
 	{
-		Lock<Platform::Mutex> mapLock(addressToWaitListMapMutex);
-		if(!waitList->numReferences)
-		{
-			wavmAssert(!waitList->wakeEvents.size());
-			delete waitList;
-			addressToWaitListMap.remove(address);
-		}
+		if(WaitEvent* waitEvent = (*provider)()) { return waitEvent; }
 	}
+
+	// If the thread hasn't yet created a wake event, do so.
+	if(!threadWakeEvent)
+	{ threadWakeEvent = std::unique_ptr<ThreadWaitEvent>(new ThreadWaitEvent()); }
+	return threadWakeEvent.get();
 }
 
 // Loads a value from memory with seq_cst memory order.
@@ -113,13 +148,23 @@ static U32 waitOnAddress(Value* valuePointer, Value expectedValue, I64 timeout)
 {
 	const U64 endTime = getEndTimeFromTimeout(Platform::getMonotonicClock(), timeout);
 
-	// Open the wait list for this address.
+	// Get the wait bucket for this address.
 	const Uptr address = reinterpret_cast<Uptr>(valuePointer);
-	WaitList* waitList = openWaitList(address);
+	WaitBucket& waitBucket = getWaitBucket(address);
+
+	// Get the event to wait on. If the caller is running on a fiber, this may be an event that
+	// suspends the fiber instead of blocking the thread.
+	WaitEvent* wakeEvent = getCurrentWaitEvent();
+
+	Waiter waiter;
+	waiter.address = address;
+	waiter.wakeEvent = wakeEvent;
+	waiter.isQueued = false;
 
-	// Lock the wait list, and check that *valuePointer is still what the caller expected it to be.
+	// Lock the wait bucket, and check that *valuePointer is still what the caller expected it to
+	// be.
 	{
-		Lock<Platform::Mutex> waitListLock(waitList->mutex);
+		Lock<Platform::Mutex> waitBucketLock(waitBucket.mutex);
 
 		// Use unwindSignalsAsExceptions to ensure that an access violation signal produced by the
 		// load will be thrown as a Runtime::Exception and unwind the stack (e.g. the locks).
@@ -127,51 +172,34 @@ static U32 waitOnAddress(Value* valuePointer, Value expectedValue, I64 timeout)
 		Runtime::unwindSignalsAsExceptions(
 			[valuePointer, &value] { value = atomicLoad(valuePointer); });
 
-		if(value != expectedValue)
-		{
-			// If *valuePointer wasn't the expected value, unlock the wait list and return.
-			waitListLock.unlock();
-			closeWaitList(address, waitList);
-			return 1;
-		}
-		else
-		{
-			// If the thread hasn't yet created a wake event, do so.
-			if(!threadWakeEvent)
-			{ threadWakeEvent = std::unique_ptr<Platform::Event>(new Platform::Event()); }
+		// If *valuePointer wasn't the expected value, unlock the wait bucket and return.
+		if(value != expectedValue) { return 1; }
 
-			// Add the wake event to the wait list, and unlock the wait list.
-			waitList->wakeEvents.push_back(threadWakeEvent.get());
-			waitListLock.unlock();
-		}
+		// Add the waiter to the wait bucket, and unlock the wait bucket.
+		waitBucket.enqueue(&waiter);
 	}
 
-	// Wait for the thread's wake event to be signaled.
+	// Wait for the wake event to be signaled.
 	bool timedOut = false;
-	if(!threadWakeEvent->wait(endTime))
+	if(!wakeEvent->wait(endTime))
 	{
-		// If the wait timed out, lock the wait list and check if the thread's wake event is still
-		// in the wait list.
-		Lock<Platform::Mutex> waitListLock(waitList->mutex);
-		auto wakeEventIt = std::find(
-			waitList->wakeEvents.begin(), waitList->wakeEvents.end(), threadWakeEvent.get());
-		if(wakeEventIt != waitList->wakeEvents.end())
+		// If the wait timed out, lock the wait bucket and check if the waiter is still queued.
+		Lock<Platform::Mutex> waitBucketLock(waitBucket.mutex);
+		if(waiter.isQueued)
 		{
-			// If the event was still on the wait list, remove it, and return the "timed out"
-			// result.
-			waitList->wakeEvents.erase(wakeEventIt);
+			// If the waiter was still queued, remove it, and return the "timed out" result.
+			waitBucket.remove(&waiter);
 			timedOut = true;
 		}
 		else
 		{
-			// In between the wait timing out and locking the wait list, some other thread tried to
-			// wake this thread. The event will now be signaled, so use an immediately expiring wait
-			// on it to reset it.
-			errorUnless(threadWakeEvent->wait(Platform::getMonotonicClock()));
+			// In between the wait timing out and locking the wait bucket, some other thread tried
+			// to wake this thread. The event will now be signaled, so use an immediately expiring
+			// wait on it to reset it.
+			errorUnless(wakeEvent->wait(Platform::getMonotonicClock()));
 		}
 	}
 
-	closeWaitList(address, waitList);
 	return timedOut ? 2 : 0;
 }
 
@@ -179,31 +207,34 @@ static U32 wakeAddress(void* pointer, U32 numToWake)
 {
 	if(numToWake == 0) { return 0; }
 
-	// Open the wait list for this address.
+	// Get the wait bucket for this address.
 	const Uptr address = reinterpret_cast<Uptr>(pointer);
-	WaitList* waitList = openWaitList(address);
-	Uptr actualNumToWake = numToWake;
-	{
-		Lock<Platform::Mutex> waitListLock(waitList->mutex);
+	WaitBucket& waitBucket = getWaitBucket(address);
 
-		// Determine how many threads to wake.
-		// numToWake==UINT32_MAX means wake all waiting threads.
-		if(actualNumToWake == UINT32_MAX || actualNumToWake > waitList->wakeEvents.size())
-		{ actualNumToWake = waitList->wakeEvents.size(); }
-
-		// Signal the events corresponding to the oldest waiting threads.
-		for(Uptr wakeIndex = 0; wakeIndex < actualNumToWake; ++wakeIndex)
-		{ waitList->wakeEvents[wakeIndex]->signal(); }
-
-		// Remove the events from the wait list.
-		waitList->wakeEvents.erase(waitList->wakeEvents.begin(),
-								   waitList->wakeEvents.begin() + actualNumToWake);
+	// Wake the oldest threads waiting on this address. numToWake==UINT32_MAX means wake all
+	// waiting threads.
+	Uptr numWoken = 0;
+	{
+		Lock<Platform::Mutex> waitBucketLock(waitBucket.mutex);
+		Waiter* waiter = waitBucket.firstWaiter;
+		while(waiter && (numToWake == UINT32_MAX || numWoken < numToWake))
+		{
+			Waiter* nextWaiter = waiter->next;
+			if(waiter->address == address)
+			{
+				// Remove the waiter from the bucket before signaling its event: once the event is
+				// signaled, the waiting thread may return and free the waiter.
+				WaitEvent* wakeEvent = waiter->wakeEvent;
+				waitBucket.remove(waiter);
+				wakeEvent->signal();
+				++numWoken;
+			}
+			waiter = nextWaiter;
+		}
 	}
-	closeWaitList(address, waitList);
 
-	if(actualNumToWake > UINT32_MAX)
-	{ throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
-	return U32(actualNumToWake);
+	if(numWoken > UINT32_MAX) { throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
+	return U32(numWoken);
 }
 
 DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
@@ -31,7 +31,14 @@ ENUM_INTRINSIC_EXCEPTION_TYPES(DEFINE_INTRINSIC_EXCEPTION_TYPE)
 
 bool Runtime::describeInstructionPointer(Uptr ip, std::string& outDescription)
 {
+	// A return address may be the end of a function that ends with a call that doesn't return, so
+	// if the address isn't in a JITed function, also try the preceding address.
 	Runtime::Function* function = LLVMJIT::getFunctionByAddress(ip);
+	if(!function)
+	{
+		function = LLVMJIT::getFunctionByAddress(ip - 1);
+		if(function) { --ip; }
+	}
 	if(!function) { return Platform::describeInstructionPointer(ip, outDescription); }
 	else
 	{
@@ -63,14 +70,14 @@ std::vector<std::string> Runtime::describeCallStack(const Platform::CallStack& c
 	std::vector<std::string> frameDescriptions;
 	HashSet<Uptr> describedIPs;
 	Uptr frameIndex = 0;
-	while(frameIndex < callStack.stackFrames.size())
+	while(frameIndex < callStack.numStackFrames)
 	{
-		if(frameIndex + 1 < callStack.stackFrames.size()
+		if(frameIndex + 1 < callStack.numStackFrames
 		   && describedIPs.contains(callStack.stackFrames[frameIndex].ip)
 		   && describedIPs.contains(callStack.stackFrames[frameIndex + 1].ip))
 		{
 			Uptr numOmittedFrames = 2;
-			while(frameIndex + numOmittedFrames < callStack.stackFrames.size()
+			while(frameIndex + numOmittedFrames < callStack.numStackFrames
 				  && describedIPs.contains(callStack.stackFrames[frameIndex + numOmittedFrames].ip))
 			{ ++numOmittedFrames; }
 
@@ -153,6 +160,8 @@ Exception* Runtime::createException(ExceptionType* type,
 	const IR::TypeTuple& params = type->sig.params;
 	wavmAssert(numArguments == params.size());
 
+	type->numCreatedExceptions->add();
+
 	const bool isUserException = type->compartment != nullptr;
 	Exception* exception = new(malloc(Exception::calcNumBytes(params.size())))
 		Exception{type->id, type, isUserException ? U8(1) : U8(0), std::move(callStack)};
@@ -226,8 +235,8 @@ std::string Runtime::describeException(const Exception* exception)
 										  const std::vector<IR::UntaggedValue>& arguments)
 {
 	wavmAssert(type->sig.params.size() == arguments.size());
-	throwException(
-		createException(type, arguments.data(), arguments.size(), Platform::captureCallStack(1)));
+	throwException(createException(
+		type, arguments.data(), arguments.size(), Platform::captureFramePointerCallStack(1)));
 }
 
 DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
@@ -246,8 +255,10 @@ DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
 	}
 	auto args = reinterpret_cast<const IR::UntaggedValue*>(Uptr(argsBits));
 
-	Exception* exception = createException(
-		exceptionType, args, exceptionType->sig.params.size(), Platform::captureCallStack(1));
+	Exception* exception = createException(exceptionType,
+										   args,
+										   exceptionType->sig.params.size(),
+										   Platform::captureFramePointerCallStack(1));
 
 	return reinterpret_cast<Uptr>(exception);
 }
@@ -0,0 +1,124 @@
+#include <exception>
+#include <utility>
+#include <vector>
+
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+struct Runtime::Fiber
+{
+	Platform::Fiber* platformFiber{nullptr};
+
+	// Keep the context and function alive while the fiber may still use them.
+	GCPointer<Context> context;
+	GCPointer<Function> function;
+	std::vector<IR::Value> arguments;
+
+	IR::ValueTuple results;
+	Exception* exception{nullptr};
+	std::exception_ptr hostException;
+	bool hasReturned{false};
+
+	void* userData{nullptr};
+
+	Fiber(Context* inContext, Function* inFunction, std::vector<IR::Value>&& inArguments)
+	: context(inContext), function(inFunction), arguments(std::move(inArguments))
+	{
+	}
+};
+
+Runtime::Fiber* Runtime::getCurrentFiber()
+{
+	// Runtime fibers are created with a pointer to the Runtime::Fiber as the Platform fiber's
+	// argument.
+	Platform::Fiber* platformFiber = Platform::getCurrentFiber();
+	return platformFiber ? (Fiber*)Platform::getFiberArgument(platformFiber) : nullptr;
+}
+
+static void fiberEntry(void* fiberVoid)
+{
+	Runtime::Fiber* fiber = (Runtime::Fiber*)fiberVoid;
+
+	// Catch exceptions on the fiber's stack, and pass them to resumeFiber to rethrow on the
+	// resuming thread's stack. This includes C++ exceptions thrown by intrinsic functions, which
+	// would otherwise unwind past the base of the fiber's stack.
+	try
+	{
+		catchRuntimeExceptions(
+			[fiber] {
+				fiber->results
+					= invokeFunctionChecked(fiber->context, fiber->function, fiber->arguments);
+			},
+			[fiber](Exception* exception) { fiber->exception = exception; });
+	}
+	catch(...)
+	{
+		fiber->hostException = std::current_exception();
+	}
+}
+
+Runtime::Fiber* Runtime::createFiber(Context* context,
+									 Function* function,
+									 std::vector<IR::Value>&& arguments,
+									 Uptr numStackBytes)
+{
+	errorUnless(isInCompartment(asObject(function), getCompartment(asObject(context))));
+
+	Fiber* fiber = new Fiber(context, function, std::move(arguments));
+	fiber->platformFiber = Platform::createFiber(numStackBytes, fiberEntry, fiber);
+	if(!fiber->platformFiber)
+	{
+		delete fiber;
+		return nullptr;
+	}
+	return fiber;
+}
+
+void Runtime::destroyFiber(Fiber* fiber)
+{
+	Platform::destroyFiber(fiber->platformFiber);
+	if(fiber->exception) { destroyException(fiber->exception); }
+	delete fiber;
+}
+
+bool Runtime::resumeFiber(Fiber* fiber)
+{
+	wavmAssert(!fiber->hasReturned);
+	fiber->hasReturned = Platform::resumeFiber(fiber->platformFiber);
+	if(fiber->exception)
+	{
+		Exception* exception = fiber->exception;
+		fiber->exception = nullptr;
+		throwException(exception);
+	}
+	if(fiber->hostException)
+	{
+		std::exception_ptr hostException = std::move(fiber->hostException);
+		fiber->hostException = nullptr;
+		std::rethrow_exception(hostException);
+	}
+	return fiber->hasReturned;
+}
+
+const IR::ValueTuple& Runtime::getFiberResults(const Fiber* fiber)
+{
+	wavmAssert(fiber->hasReturned);
+	return fiber->results;
+}
+
+void Runtime::suspendCurrentFiber()
+{
+	if(!getCurrentFiber()) { Errors::fatal("suspendCurrentFiber called outside a fiber"); }
+	Platform::suspendFiber();
+}
+
+void Runtime::setUserData(Fiber* fiber, void* userData) { fiber->userData = userData; }
+void* Runtime::getUserData(const Fiber* fiber) { return fiber->userData; }
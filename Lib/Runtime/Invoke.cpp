@@ -10,28 +10,35 @@
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/Runtime/RuntimeData.h"
+#include "WAVM/Runtime/TypedFunction.h"
 
 using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
-UntaggedValue* Runtime::invokeFunctionUnchecked(Context* context,
-												Function* function,
-												const UntaggedValue* arguments)
+InvokeThunkPointer Runtime::getInvokeThunk(Function* function)
 {
-	FunctionType functionType = function->encodedType;
-
 	// Get the invoke thunk for this function type. Cache it in the function's FunctionMutableData
 	// to avoid the global lock implied by LLVMJIT::getInvokeThunk.
 	InvokeThunkPointer invokeThunk
 		= function->mutableData->invokeThunk.load(std::memory_order_acquire);
 	while(!invokeThunk)
 	{
-		InvokeThunkPointer newInvokeThunk = LLVMJIT::getInvokeThunk(functionType);
+		InvokeThunkPointer newInvokeThunk
+			= LLVMJIT::getInvokeThunk(FunctionType{function->encodedType});
 		function->mutableData->invokeThunk.compare_exchange_strong(
 			invokeThunk, newInvokeThunk, std::memory_order_acq_rel);
 	};
 	wavmAssert(invokeThunk);
+	return invokeThunk;
+}
+
+UntaggedValue* Runtime::invokeFunctionUnchecked(Context* context,
+												Function* function,
+												const UntaggedValue* arguments)
+{
+	FunctionType functionType = function->encodedType;
+	InvokeThunkPointer invokeThunk = getInvokeThunk(function);
 
 	// Copy the arguments into the thunk arguments buffer in ContextRuntimeData.
 	ContextRuntimeData* contextRuntimeData
@@ -63,6 +70,31 @@ UntaggedValue* Runtime::invokeFunctionUnchecked(Context* context,
 	return (UntaggedValue*)contextRuntimeData->thunkArgAndReturnData;
 }
 
+void Runtime::invokeFunctionBatch(Context* context,
+								  Function* function,
+								  const UntaggedValue* argsArray,
+								  Uptr numCalls,
+								  UntaggedValue* resultsArray)
+{
+	// Get the batch invoke thunk for this function type, and cache it in the function's
+	// FunctionMutableData like the single invoke thunk.
+	InvokeBatchThunkPointer invokeBatchThunk
+		= function->mutableData->invokeBatchThunk.load(std::memory_order_acquire);
+	while(!invokeBatchThunk)
+	{
+		InvokeBatchThunkPointer newInvokeBatchThunk
+			= LLVMJIT::getInvokeBatchThunk(FunctionType{function->encodedType});
+		function->mutableData->invokeBatchThunk.compare_exchange_strong(
+			invokeBatchThunk, newInvokeBatchThunk, std::memory_order_acq_rel);
+	};
+	wavmAssert(invokeBatchThunk);
+
+	// Call the batch invoke thunk.
+	ContextRuntimeData* contextRuntimeData
+		= &context->compartment->runtimeData->contexts[context->id];
+	(*invokeBatchThunk)(function, contextRuntimeData, argsArray, numCalls, resultsArray);
+}
+
 ValueTuple Runtime::invokeFunctionChecked(Context* context,
 										  Function* function,
 										  const std::vector<Value>& arguments)
@@ -11,6 +11,7 @@
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Lock.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
@@ -20,6 +21,12 @@
 using namespace WAVM;
 using namespace WAVM::Runtime;
 
+static Metrics::Counter numMemoryGrows("wavm_runtime_memory_grows_total",
+									   "Number of calls that grew a memory by a non-zero size");
+static Metrics::Gauge numCommittedMemoryBytes(
+	"wavm_runtime_memory_committed_bytes",
+	"Number of bytes in the pages of all WebAssembly memories");
+
 // Global lists of memories; used to query whether an address is reserved by one of them.
 static Platform::Mutex memoriesMutex;
 static std::vector<Memory*> memories;
@@ -35,12 +42,18 @@ static Uptr getPlatformPagesPerWebAssemblyPageLog2()
 	return IR::numBytesPerPageLog2 - Platform::getPageSizeLog2();
 }
 
+static Uptr getReservationAlignmentLog2(const MemoryPolicy& policy)
+{
+	return policy.useHugePages ? Platform::getHugePageSizeLog2() : Platform::getPageSizeLog2();
+}
+
 static Memory* createMemoryImpl(Compartment* compartment,
 								IR::MemoryType type,
 								Uptr numPages,
-								std::string&& debugName)
+								std::string&& debugName,
+								const MemoryPolicy& policy)
 {
-	Memory* memory = new Memory(compartment, type, std::move(debugName));
+	Memory* memory = new Memory(compartment, type, std::move(debugName), policy);
 
 	// On a 64-bit runtime, allocate 8GB of address space for the memory.
 	// This allows eliding bounds checks on memory accesses, since a 32-bit index + 32-bit offset
@@ -49,7 +62,11 @@ static Memory* createMemoryImpl(Compartment* compartment,
 	const Uptr memoryMaxBytes = Uptr(8ull * 1024 * 1024 * 1024);
 	const Uptr memoryMaxPages = memoryMaxBytes >> pageBytesLog2;
 
-	memory->baseAddress = Platform::allocateVirtualPages(memoryMaxPages + numGuardPages);
+	// If the memory should use huge pages, align the reservation to the huge page size so the OS
+	// can map whole huge pages at the start of the memory.
+	memory->baseAddress = Platform::allocateAlignedVirtualPages(memoryMaxPages + numGuardPages,
+																getReservationAlignmentLog2(policy),
+																memory->unalignedBaseAddress);
 	memory->numReservedBytes = memoryMaxBytes;
 	if(!memory->baseAddress)
 	{
@@ -57,6 +74,9 @@ static Memory* createMemoryImpl(Compartment* compartment,
 		return nullptr;
 	}
 
+	if(policy.useHugePages)
+	{ Platform::adviseHugeVirtualPages(memory->baseAddress, memoryMaxPages); }
+
 	// Grow the memory to the type's minimum size.
 	if(growMemory(memory, numPages) == -1)
 	{
@@ -64,6 +84,14 @@ static Memory* createMemoryImpl(Compartment* compartment,
 		return nullptr;
 	}
 
+	// If the memory's policy requests it, fault in the initial pages now. growMemory already did
+	// if the policy also prefaults grown pages.
+	if(policy.prefaultInitialPages && !policy.prefaultGrownPages && numPages > 0)
+	{
+		Platform::prefaultVirtualPages(memory->baseAddress,
+									   numPages << getPlatformPagesPerWebAssemblyPageLog2());
+	}
+
 	// Add the memory to the global array.
 	{
 		Lock<Platform::Mutex> memoriesLock(memoriesMutex);
@@ -75,10 +103,12 @@ static Memory* createMemoryImpl(Compartment* compartment,
 
 Memory* Runtime::createMemory(Compartment* compartment,
 							  IR::MemoryType type,
-							  std::string&& debugName)
+							  std::string&& debugName,
+							  const MemoryPolicy& policy)
 {
 	wavmAssert(type.size.min <= UINTPTR_MAX);
-	Memory* memory = createMemoryImpl(compartment, type, Uptr(type.size.min), std::move(debugName));
+	Memory* memory
+		= createMemoryImpl(compartment, type, Uptr(type.size.min), std::move(debugName), policy);
 	if(!memory) { return nullptr; }
 
 	// Add the memory to the compartment's memories IndexMap.
@@ -102,8 +132,8 @@ Memory* Runtime::cloneMemory(Memory* memory, Compartment* newCompartment)
 	Lock<Platform::Mutex> resizingLock(memory->resizingMutex);
 	const Uptr numPages = memory->numPages.load(std::memory_order_acquire);
 	std::string debugName = memory->debugName;
-	Memory* newMemory
-		= createMemoryImpl(newCompartment, memory->type, numPages, std::move(debugName));
+	Memory* newMemory = createMemoryImpl(
+		newCompartment, memory->type, numPages, std::move(debugName), memory->policy);
 	if(!newMemory) { return nullptr; }
 
 	// Copy the memory contents to the new memory.
@@ -150,14 +180,18 @@ Runtime::Memory::~Memory()
 		}
 	}
 
+	const Uptr numFreedPages = numPages.load(std::memory_order_acquire);
+	numCommittedMemoryBytes.add(-I64(numFreedPages * IR::numBytesPerPage));
+
 	// Free the virtual address space.
 	const Uptr pageBytesLog2 = Platform::getPageSizeLog2();
 	if(numReservedBytes > 0)
 	{
-		Platform::freeVirtualPages(baseAddress,
-								   (numReservedBytes >> pageBytesLog2) + numGuardPages);
+		Platform::freeAlignedVirtualPages(unalignedBaseAddress,
+										  (numReservedBytes >> pageBytesLog2) + numGuardPages,
+										  getReservationAlignmentLog2(policy));
 	}
-	baseAddress = nullptr;
+	baseAddress = unalignedBaseAddress = nullptr;
 	numPages = numReservedBytes = 0;
 }
 
@@ -205,11 +239,18 @@ Iptr Runtime::growMemory(Memory* memory, Uptr numPagesToGrow)
 	{ return -1; }
 
 	// Try to commit the new pages, and return -1 if the commit fails.
-	if(!Platform::commitVirtualPages(memory->baseAddress + previousNumPages * IR::numBytesPerPage,
-									 numPagesToGrow << getPlatformPagesPerWebAssemblyPageLog2()))
-	{ return -1; }
+	U8* newPagesBaseAddress = memory->baseAddress + previousNumPages * IR::numBytesPerPage;
+	const Uptr numNewPlatformPages = numPagesToGrow << getPlatformPagesPerWebAssemblyPageLog2();
+	if(!Platform::commitVirtualPages(newPagesBaseAddress, numNewPlatformPages)) { return -1; }
+
+	// If the memory's policy requests it, fault in the new pages while the resizing lock is held,
+	// instead of taking a page fault on the first access to each page.
+	if(memory->policy.prefaultGrownPages)
+	{ Platform::prefaultVirtualPages(newPagesBaseAddress, numNewPlatformPages); }
 
 	memory->numPages.store(previousNumPages + numPagesToGrow, std::memory_order_release);
+	numMemoryGrows.add();
+	numCommittedMemoryBytes.add(I64(numPagesToGrow * IR::numBytesPerPage));
 	return previousNumPages;
 }
 
@@ -232,6 +273,7 @@ Iptr Runtime::shrinkMemory(Memory* memory, Uptr numPagesToShrink)
 								   numPagesToShrink << getPlatformPagesPerWebAssemblyPageLog2());
 
 	memory->numPages.store(previousNumPages - numPagesToShrink, std::memory_order_release);
+	numCommittedMemoryBytes.add(-I64(numPagesToShrink * IR::numBytesPerPage));
 	return previousNumPages;
 }
 
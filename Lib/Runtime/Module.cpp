@@ -1,5 +1,6 @@
 #include <string.h>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <utility>
 
@@ -14,15 +15,38 @@
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Lock.h"
 #include "WAVM/Inline/Serialization.h"
+#include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/File.h"
 #include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Runtime.h"
 
 using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
+static Metrics::Histogram compileModuleMicroseconds(
+	"wavm_runtime_compile_microseconds",
+	"Time taken to compile a WebAssembly module to object code, in microseconds");
+static Metrics::Counter numInstantiations("wavm_runtime_instantiations_total",
+										  "Number of module instances that were instantiated");
+static Metrics::Histogram instantiateModuleMicroseconds(
+	"wavm_runtime_instantiate_microseconds",
+	"Time taken to instantiate a compiled WebAssembly module, in microseconds");
+
+static std::vector<U8> compileObjectCode(const IR::Module& irModule)
+{
+	Timing::Timer compileTimer;
+	std::vector<U8> objectCode = LLVMJIT::compileModule(irModule);
+	compileModuleMicroseconds.record(compileTimer.getMicroseconds());
+	return objectCode;
+}
+
 static Value evaluateInitializer(const std::vector<Global*>& moduleGlobals,
 								 InitializerExpression expression)
 {
@@ -47,22 +71,217 @@ static Value evaluateInitializer(const std::vector<Global*>& moduleGlobals,
 	};
 }
 
-ModuleRef Runtime::compileModule(const IR::Module& irModule)
+// Copies an active data segment's bytes into a memory. If the segment's bytes are borrowed from a
+// module file that was loaded with mapDataSegments, and the segment has the same alignment in the
+// file and in the memory, then the memory pages that the segment wholly covers are replaced with
+// copy-on-write mappings of the file instead of copying them.
+static void copyDataSegmentToMemory(Memory* memory, U32 baseOffset, const DataSegment& dataSegment)
 {
-	std::vector<U8> objectCode = LLVMJIT::compileModule(irModule);
-	return std::make_shared<Module>(IR::Module(irModule), std::move(objectCode));
+	U8* destAddress = memory->baseAddress + baseOffset;
+	const U8* sourceBytes = dataSegment.getBytes();
+	const Uptr numBytes = dataSegment.getNumBytes();
+
+	Uptr numHeadBytes = 0;
+	Uptr numMappedBytes = 0;
+	if(dataSegment.mappedFile && dataSegment.mappedFile->mapDataSegments)
+	{
+		const Uptr pageSizeLog2 = Platform::getPageSizeLog2();
+		const Uptr pageOffsetMask = (Uptr(1) << pageSizeLog2) - 1;
+		const Uptr destPageOffset = reinterpret_cast<Uptr>(destAddress) & pageOffsetMask;
+		if(destPageOffset == (dataSegment.mappedFileOffset & pageOffsetMask))
+		{
+			numHeadBytes = (pageOffsetMask + 1 - destPageOffset) & pageOffsetMask;
+			const Uptr numPages = numBytes > numHeadBytes ? (numBytes - numHeadBytes) >> pageSizeLog2
+														 : 0;
+
+			// Hold the resizing lock while mapping the pages, to make sure they aren't decommitted
+			// by a concurrent shrink of the memory.
+			Lock<Platform::Mutex> resizingLock(memory->resizingMutex);
+			if(numPages > 0
+			   && U64(baseOffset) + numBytes
+					  <= U64(memory->numPages.load(std::memory_order_acquire))
+							 * IR::numBytesPerPage
+			   && Platform::mapFileCopyOnWrite(dataSegment.mappedFile->file,
+											   dataSegment.mappedFileOffset + numHeadBytes,
+											   destAddress + numHeadBytes,
+											   numPages))
+			{ numMappedBytes = numPages << pageSizeLog2; }
+		}
+	}
+
+	// Copy whatever part of the segment wasn't mapped.
+	Runtime::unwindSignalsAsExceptions([=] {
+		if(!numMappedBytes) { Platform::bytewiseMemCopy(destAddress, sourceBytes, numBytes); }
+		else
+		{
+			const Uptr numTailBytes = numBytes - numHeadBytes - numMappedBytes;
+			Platform::bytewiseMemCopy(destAddress, sourceBytes, numHeadBytes);
+			Platform::bytewiseMemCopy(destAddress + numHeadBytes + numMappedBytes,
+									  sourceBytes + numHeadBytes + numMappedBytes,
+									  numTailBytes);
+		}
+	});
 }
 
-std::vector<U8> Runtime::getObjectCode(ModuleConstRefParam module) { return module->objectCode; }
+// Takes ownership of an IR module for a compiled Module. The module is created non-const, so
+// materializing its lazy function definitions doesn't write to a const object.
+static std::shared_ptr<const IR::Module> shareIR(IR::Module&& irModule)
+{
+	return std::make_shared<IR::Module>(std::move(irModule));
+}
+
+ModuleRef Runtime::compileModule(IR::Module&& irModule)
+{
+	std::vector<U8> objectCode = compileObjectCode(irModule);
+	return std::make_shared<Module>(shareIR(std::move(irModule)), std::move(objectCode));
+}
 
-ModuleRef Runtime::loadPrecompiledModule(const IR::Module& irModule,
-										 const std::vector<U8>& objectCode)
+ModuleRef Runtime::compileModule(std::shared_ptr<const IR::Module> irModule)
 {
-	return std::make_shared<Module>(IR::Module(irModule), std::vector<U8>(objectCode));
+	std::vector<U8> objectCode = compileObjectCode(*irModule);
+	return std::make_shared<Module>(std::move(irModule), std::move(objectCode));
+}
+
+struct Runtime::StreamingCompile
+{
+	const IR::Module& irModule;
+	LLVMJIT::StreamingModuleCompiler* compiler;
+	Platform::Thread* workerThread;
+
+	// The worker thread waits on queueEvent when there are no pending function definitions.
+	Platform::Mutex queueMutex;
+	Platform::Event queueEvent;
+	std::deque<Uptr> pendingFunctionDefIndices;
+	bool isFinishing;
+
+	StreamingCompile(const IR::Module& inIRModule)
+	: irModule(inIRModule)
+	, compiler(LLVMJIT::beginStreamingCompile(inIRModule))
+	, workerThread(nullptr)
+	, isFinishing(false)
+	{
+	}
+};
+
+static I64 streamingCompileThreadEntry(void* argument)
+{
+	StreamingCompile* streamingCompile = (StreamingCompile*)argument;
+	while(true)
+	{
+		Lock<Platform::Mutex> queueLock(streamingCompile->queueMutex);
+		if(streamingCompile->pendingFunctionDefIndices.size())
+		{
+			const Uptr functionDefIndex = streamingCompile->pendingFunctionDefIndices.front();
+			streamingCompile->pendingFunctionDefIndices.pop_front();
+			queueLock.unlock();
+
+			LLVMJIT::compileFunctionDef(streamingCompile->compiler, functionDefIndex);
+		}
+		else if(streamingCompile->isFinishing)
+		{
+			return 0;
+		}
+		else
+		{
+			queueLock.unlock();
+			streamingCompile->queueEvent.wait(UINT64_MAX);
+		}
+	}
+}
+
+// Tells the worker thread to exit once it has compiled the pending function definitions, and waits
+// for it to exit.
+static void joinStreamingCompileThread(StreamingCompile* streamingCompile)
+{
+	{
+		Lock<Platform::Mutex> queueLock(streamingCompile->queueMutex);
+		streamingCompile->isFinishing = true;
+	}
+	streamingCompile->queueEvent.signal();
+	errorUnless(Platform::joinThread(streamingCompile->workerThread) == 0);
+}
+
+StreamingCompile* Runtime::beginStreamingCompile(const IR::Module& irModule)
+{
+	StreamingCompile* streamingCompile = new StreamingCompile(irModule);
+	streamingCompile->workerThread
+		= Platform::createThread(8 * 1024 * 1024, streamingCompileThreadEntry, streamingCompile);
+	return streamingCompile;
+}
+
+void Runtime::compileFunctionDef(StreamingCompile* streamingCompile, Uptr functionDefIndex)
+{
+	wavmAssert(functionDefIndex < streamingCompile->irModule.functions.defs.size());
+	{
+		Lock<Platform::Mutex> queueLock(streamingCompile->queueMutex);
+		wavmAssert(!streamingCompile->isFinishing);
+		streamingCompile->pendingFunctionDefIndices.push_back(functionDefIndex);
+	}
+	streamingCompile->queueEvent.signal();
+}
+
+ModuleRef Runtime::finishStreamingCompile(StreamingCompile* streamingCompile,
+										  IR::Module&& irModule)
+{
+	wavmAssert(&irModule == &streamingCompile->irModule);
+	std::unique_ptr<StreamingCompile> streamingCompilePtr(streamingCompile);
+	joinStreamingCompileThread(streamingCompile);
+
+	// The compiler doesn't use the IR module after it finishes, so the IR module can be moved into
+	// the compiled module.
+	std::vector<U8> objectCode = LLVMJIT::finishStreamingCompile(streamingCompile->compiler);
+	return std::make_shared<Module>(shareIR(std::move(irModule)), std::move(objectCode));
+}
+
+void Runtime::abortStreamingCompile(StreamingCompile* streamingCompile)
+{
+	joinStreamingCompileThread(streamingCompile);
+	LLVMJIT::abortStreamingCompile(streamingCompile->compiler);
+	delete streamingCompile;
+}
+
+std::vector<U8> Runtime::getObjectCode(ModuleConstRefParam module)
+{
+	return std::vector<U8>(module->objectCode, module->objectCode + module->numObjectCodeBytes);
+}
+
+ModuleRef Runtime::loadPrecompiledModule(IR::Module&& irModule, std::vector<U8>&& objectCode)
+{
+	return std::make_shared<Module>(shareIR(std::move(irModule)), std::move(objectCode));
+}
+
+ModuleRef Runtime::loadPrecompiledModule(std::shared_ptr<const IR::Module> irModule,
+										 std::vector<U8>&& objectCode)
+{
+	return std::make_shared<Module>(std::move(irModule), std::move(objectCode));
+}
+
+ModuleRef Runtime::loadPrecompiledModule(IR::Module&& irModule)
+{
+	Uptr objectCodeUserSectionIndex = 0;
+	if(!findUserSection(irModule, "wavm.precompiled_object", objectCodeUserSectionIndex))
+	{ return nullptr; }
+
+	// The object code is borrowed from the user section in the Module's IR, which may in turn
+	// borrow it from the file the IR module was loaded from.
+	return std::make_shared<Module>(shareIR(std::move(irModule)), objectCodeUserSectionIndex);
+}
+
+ModuleRef Runtime::loadPrecompiledModule(std::shared_ptr<const IR::Module> irModule)
+{
+	Uptr objectCodeUserSectionIndex = 0;
+	if(!findUserSection(*irModule, "wavm.precompiled_object", objectCodeUserSectionIndex))
+	{ return nullptr; }
+	return std::make_shared<Module>(std::move(irModule), objectCodeUserSectionIndex);
 }
 
 const IR::Module& Runtime::getModuleIR(ModuleConstRefParam module) { return module->ir; }
 
+std::shared_ptr<const IR::Module> Runtime::getSharedModuleIR(ModuleConstRefParam module)
+{
+	return module->sharedIR;
+}
+
 ModuleInstance::~ModuleInstance()
 {
 	if(id != UINTPTR_MAX)
@@ -77,6 +296,7 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 										   ImportBindings&& imports,
 										   std::string&& moduleDebugName)
 {
+	Timing::Timer instantiateTimer;
 	dummyReferenceAtomics();
 	dummyReferenceWAVMIntrinsics();
 
@@ -250,6 +470,7 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 	jitFunctionDefs.resize(module->ir.functions.defs.size(), nullptr);
 	std::shared_ptr<LLVMJIT::Module> jitModule
 		= LLVMJIT::loadModule(module->objectCode,
+							  module->numObjectCodeBytes,
 							  std::move(wavmIntrinsicsExportMap),
 							  std::move(jitTypes),
 							  std::move(jitFunctionImports),
@@ -291,8 +512,10 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 		const DataSegment& dataSegment = module->ir.dataSegments[segmentIndex];
 		if(!dataSegment.isActive)
 		{
-			passiveDataSegments.add(segmentIndex,
-									std::make_shared<std::vector<U8>>(dataSegment.data));
+			passiveDataSegments.add(
+				segmentIndex,
+				std::make_shared<std::vector<U8>>(
+					dataSegment.getBytes(), dataSegment.getBytes() + dataSegment.getNumBytes()));
 		}
 	}
 	for(Uptr segmentIndex = 0; segmentIndex < module->ir.elemSegments.size(); ++segmentIndex)
@@ -368,14 +591,8 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 			errorUnless(baseOffsetValue.type == ValueType::i32);
 			const U32 baseOffset = baseOffsetValue.i32;
 
-			if(dataSegment.data.size())
-			{
-				Runtime::unwindSignalsAsExceptions([memory, baseOffset, &dataSegment] {
-					Platform::bytewiseMemCopy(memory->baseAddress + baseOffset,
-											  dataSegment.data.data(),
-											  dataSegment.data.size());
-				});
-			}
+			if(dataSegment.getNumBytes())
+			{ copyDataSegmentToMemory(memory, baseOffset, dataSegment); }
 			else
 			{
 				// WebAssembly still expects out-of-bounds errors if the segment base offset is
@@ -425,6 +642,8 @@ ModuleInstance* Runtime::instantiateModule(Compartment* compartment,
 		}
 	}
 
+	numInstantiations.add();
+	instantiateModuleMicroseconds.record(instantiateTimer.getMicroseconds());
 	return moduleInstance;
 }
 
@@ -0,0 +1,509 @@
+#include <atomic>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RuntimePrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/Lock.h"
+#include "WAVM/Inline/Serialization.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/Runtime/RuntimeData.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+using namespace WAVM::Serialization;
+
+// Samples are captured in a signal handler, which can't allocate memory or lock a mutex, so the
+// handler just copies the sampled call stack's instruction pointers into a bounded lock-free queue.
+// The profiler's thread periodically takes the samples from the queues, maps their instruction
+// pointers to WebAssembly functions and operators, and counts them. Each sampled thread uses one of
+// several queues, chosen by a hash of its thread-local state, so threads rarely contend for a
+// queue. If a queue is full, the sample is dropped.
+
+enum
+{
+	numSampleQueuesLog2 = 3,
+	numSampleQueueSlotsLog2 = 8,
+	profilerThreadStackBytes = 1024 * 1024,
+	drainIntervalMicroseconds = 10000
+};
+
+// A bounded multi-producer queue of sampled call stacks. Each slot has a sequence number that
+// tells producers and the consumer whether the slot is free for the enqueue at a given index, or
+// holds the sample for a given index.
+struct SampleQueue
+{
+	struct Slot
+	{
+		std::atomic<Uptr> sequence;
+		Uptr numFrames;
+		Uptr ips[Platform::CallStack::maxFrames];
+	};
+
+	Slot slots[Uptr(1) << numSampleQueueSlotsLog2];
+	std::atomic<Uptr> enqueueIndex{0};
+	Uptr dequeueIndex{0};
+
+	SampleQueue()
+	{
+		for(Uptr slotIndex = 0; slotIndex < (Uptr(1) << numSampleQueueSlotsLog2); ++slotIndex)
+		{ slots[slotIndex].sequence.store(slotIndex, std::memory_order_relaxed); }
+	}
+
+	// Called from the signal handler. Returns false if the queue is full.
+	bool enqueue(const Platform::CallStack& callStack)
+	{
+		Uptr index = enqueueIndex.load(std::memory_order_relaxed);
+		Slot* slot;
+		while(true)
+		{
+			slot = &slots[index & ((Uptr(1) << numSampleQueueSlotsLog2) - 1)];
+			const Uptr sequence = slot->sequence.load(std::memory_order_acquire);
+			if(sequence == index)
+			{
+				if(enqueueIndex.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+				{ break; }
+			}
+			else if(sequence < index)
+			{
+				return false;
+			}
+			else
+			{
+				index = enqueueIndex.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->numFrames = callStack.numStackFrames;
+		for(Uptr frameIndex = 0; frameIndex < callStack.numStackFrames; ++frameIndex)
+		{ slot->ips[frameIndex] = callStack.stackFrames[frameIndex].ip; }
+		slot->sequence.store(index + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Only called by one thread at a time. Returns false if the queue is empty.
+	bool dequeue(Platform::CallStack& outCallStack)
+	{
+		Slot& slot = slots[dequeueIndex & ((Uptr(1) << numSampleQueueSlotsLog2) - 1)];
+		if(slot.sequence.load(std::memory_order_acquire) != dequeueIndex + 1) { return false; }
+
+		outCallStack.numStackFrames = slot.numFrames;
+		for(Uptr frameIndex = 0; frameIndex < slot.numFrames; ++frameIndex)
+		{ outCallStack.stackFrames[frameIndex].ip = slot.ips[frameIndex]; }
+		slot.sequence.store(dequeueIndex + (Uptr(1) << numSampleQueueSlotsLog2),
+							std::memory_order_release);
+		++dequeueIndex;
+		return true;
+	}
+};
+
+// A WebAssembly function, and the index of the operator in it that was executing.
+struct ProfileFrame
+{
+	std::string functionName;
+	Uptr opIndex;
+};
+
+struct Runtime::Profiler
+{
+	const U64 sampleIntervalMicroseconds;
+	const U64 startClock;
+
+	SampleQueue sampleQueues[Uptr(1) << numSampleQueuesLog2];
+	std::atomic<U64> numDroppedSamples{0};
+
+	Platform::Thread* thread{nullptr};
+	Platform::Event wakeEvent;
+	std::atomic<bool> isStopping{false};
+
+	// The counted samples. Each distinct call stack is a list of indices into frames, from the
+	// outermost frame to the innermost frame.
+	Platform::Mutex samplesMutex;
+	std::vector<ProfileFrame> frames;
+	std::map<std::pair<std::string, Uptr>, Uptr> frameIndexMap;
+	std::map<std::vector<Uptr>, U64> callStackCounts;
+	U64 numSamples{0};
+	U64 numSamplesOutsideWebAssembly{0};
+
+	Profiler(U64 inSampleIntervalMicroseconds)
+	: sampleIntervalMicroseconds(inSampleIntervalMicroseconds)
+	, startClock(Platform::getMonotonicClock())
+	{
+	}
+};
+
+// The frame that is used for samples that interrupted host code called by WebAssembly code.
+static const char* hostFunctionName = "<host>";
+
+static thread_local U8 sampleQueueSelector;
+
+static void sampleCallback(void* profilerVoid, const Platform::CallStack& callStack)
+{
+	Profiler* profiler = (Profiler*)profilerVoid;
+	const Uptr queueIndex = Hash<Uptr>()(reinterpret_cast<Uptr>(&sampleQueueSelector))
+							& ((Uptr(1) << numSampleQueuesLog2) - 1);
+	if(!profiler->sampleQueues[queueIndex].enqueue(callStack)) { ++profiler->numDroppedSamples; }
+}
+
+// Finds the WebAssembly function that contains an instruction pointer, and the index of the
+// operator that the instruction was generated for.
+static bool getProfileFrame(Uptr ip, std::string& outFunctionName, Uptr& outOpIndex)
+{
+	Function* function = LLVMJIT::getFunctionByAddress(ip);
+	if(!function) { return false; }
+
+	// Find the highest entry in the offsetToOpIndexMap whose offset is <= the function-relative IP.
+	const std::map<U32, U32>& offsetToOpIndexMap = function->mutableData->offsetToOpIndexMap;
+	const U32 ipOffset = U32(ip - reinterpret_cast<Uptr>(function->code));
+	auto offsetMapIt = offsetToOpIndexMap.upper_bound(ipOffset);
+	outOpIndex = offsetMapIt == offsetToOpIndexMap.begin() ? 0 : (--offsetMapIt)->second;
+	outFunctionName = function->mutableData->debugName;
+	return true;
+}
+
+static Uptr getProfileFrameIndex(Profiler* profiler, std::string&& functionName, Uptr opIndex)
+{
+	std::pair<std::string, Uptr> key(std::move(functionName), opIndex);
+	auto frameIndexIt = profiler->frameIndexMap.find(key);
+	if(frameIndexIt != profiler->frameIndexMap.end()) { return frameIndexIt->second; }
+
+	const Uptr frameIndex = profiler->frames.size();
+	profiler->frames.push_back(ProfileFrame{key.first, opIndex});
+	profiler->frameIndexMap.emplace(std::move(key), frameIndex);
+	return frameIndex;
+}
+
+// Takes the samples from the profiler's queues, and counts them. The caller must have locked the
+// profiler's samplesMutex.
+static void countSamples(Profiler* profiler)
+{
+	Platform::CallStack callStack;
+	std::vector<Uptr> frameIndices;
+	for(SampleQueue& sampleQueue : profiler->sampleQueues)
+	{
+		while(sampleQueue.dequeue(callStack))
+		{
+			++profiler->numSamples;
+
+			// The call stack starts with the interrupted instruction, followed by return
+			// addresses. Look up the call instruction before each return address, since a return
+			// address may be the end of a function that ends with a call that doesn't return.
+			frameIndices.clear();
+			for(Uptr frameIndex = callStack.numStackFrames; frameIndex > 0; --frameIndex)
+			{
+				const Uptr ip = callStack.stackFrames[frameIndex - 1].ip;
+				std::string functionName;
+				Uptr opIndex;
+				if(getProfileFrame(frameIndex == 1 ? ip : ip - 1, functionName, opIndex))
+				{
+					frameIndices.push_back(
+						getProfileFrameIndex(profiler, std::move(functionName), opIndex));
+				}
+			}
+
+			if(!frameIndices.size())
+			{
+				++profiler->numSamplesOutsideWebAssembly;
+				continue;
+			}
+
+			// If the sample interrupted host code called by WebAssembly code, count it in a
+			// frame for the host code called by the innermost WebAssembly frame.
+			std::string functionName;
+			Uptr opIndex;
+			if(!getProfileFrame(callStack.stackFrames[0].ip, functionName, opIndex))
+			{ frameIndices.push_back(getProfileFrameIndex(profiler, hostFunctionName, 0)); }
+
+			++profiler->callStackCounts[frameIndices];
+		}
+	}
+}
+
+static I64 profilerThreadEntry(void* profilerVoid)
+{
+	Profiler* profiler = (Profiler*)profilerVoid;
+	while(!profiler->isStopping.load())
+	{
+		{
+			Lock<Platform::Mutex> samplesLock(profiler->samplesMutex);
+			countSamples(profiler);
+		}
+		profiler->wakeEvent.wait(Platform::getMonotonicClock() + drainIntervalMicroseconds);
+	};
+	return 0;
+}
+
+Profiler* Runtime::createProfiler(U64 sampleIntervalMicroseconds)
+{
+	Profiler* profiler = new Profiler(sampleIntervalMicroseconds);
+	if(!Platform::startCallStackSampling(sampleIntervalMicroseconds, sampleCallback, profiler))
+	{
+		delete profiler;
+		return nullptr;
+	}
+
+	profiler->thread
+		= Platform::createThread(profilerThreadStackBytes, profilerThreadEntry, profiler);
+	return profiler;
+}
+
+void Runtime::stopProfiler(Profiler* profiler)
+{
+	if(!profiler->thread) { return; }
+
+	Platform::stopCallStackSampling();
+
+	profiler->isStopping.store(true);
+	profiler->wakeEvent.signal();
+	Platform::joinThread(profiler->thread);
+	profiler->thread = nullptr;
+
+	// Count the samples that were queued after the profiler's thread last counted them.
+	Lock<Platform::Mutex> samplesLock(profiler->samplesMutex);
+	countSamples(profiler);
+}
+
+void Runtime::destroyProfiler(Profiler* profiler)
+{
+	stopProfiler(profiler);
+	delete profiler;
+}
+
+static std::string getFrameDescription(const ProfileFrame& frame)
+{
+	if(frame.functionName == hostFunctionName) { return frame.functionName; }
+	return frame.functionName + '+' + std::to_string(frame.opIndex);
+}
+
+static void writeString(OutputStream& stream, const std::string& string)
+{
+	serializeBytes(stream, (const U8*)string.data(), string.size());
+}
+
+void Runtime::writeFoldedStacksProfile(Profiler* profiler, OutputStream& stream)
+{
+	Lock<Platform::Mutex> samplesLock(profiler->samplesMutex);
+	countSamples(profiler);
+
+	std::vector<std::string> frameDescriptions;
+	for(const ProfileFrame& frame : profiler->frames)
+	{ frameDescriptions.push_back(getFrameDescription(frame)); }
+
+	for(const auto& callStackCount : profiler->callStackCounts)
+	{
+		const std::vector<Uptr>& frameIndices = callStackCount.first;
+		for(Uptr frameIndex = 0; frameIndex < frameIndices.size(); ++frameIndex)
+		{
+			if(frameIndex > 0) { writeString(stream, ";"); }
+			writeString(stream, frameDescriptions[frameIndices[frameIndex]]);
+		}
+		writeString(stream, " " + std::to_string(callStackCount.second) + "\n");
+	}
+}
+
+std::vector<std::pair<std::string, U64>> Runtime::getFunctionSampleCounts(Profiler* profiler)
+{
+	Lock<Platform::Mutex> samplesLock(profiler->samplesMutex);
+	countSamples(profiler);
+
+	std::map<std::string, U64> functionSampleCounts;
+	for(const auto& callStackCount : profiler->callStackCounts)
+	{
+		// Skip the frame for host code, if there is one. The innermost frame before it is always a
+		// WebAssembly frame.
+		const std::vector<Uptr>& frameIndices = callStackCount.first;
+		Uptr innermostFrameIndex = frameIndices.back();
+		if(profiler->frames[innermostFrameIndex].functionName == hostFunctionName)
+		{ innermostFrameIndex = frameIndices[frameIndices.size() - 2]; }
+
+		functionSampleCounts[profiler->frames[innermostFrameIndex].functionName]
+			+= callStackCount.second;
+	}
+
+	return std::vector<std::pair<std::string, U64>>(functionSampleCounts.begin(),
+													functionSampleCounts.end());
+}
+
+// Writes protocol buffer fields, for the pprof format.
+enum class ProtobufWireType : U8
+{
+	varInt = 0,
+	lengthDelimited = 2
+};
+
+static void writeProtobufVarInt(OutputStream& stream, U64 value)
+{
+	serializeVarUInt64(stream, value);
+}
+
+static void writeProtobufTag(OutputStream& stream, U32 fieldNumber, ProtobufWireType wireType)
+{
+	writeProtobufVarInt(stream, (U64(fieldNumber) << 3) | U64(wireType));
+}
+
+static void writeProtobufVarIntField(OutputStream& stream, U32 fieldNumber, U64 value)
+{
+	writeProtobufTag(stream, fieldNumber, ProtobufWireType::varInt);
+	writeProtobufVarInt(stream, value);
+}
+
+static void writeProtobufBytesField(OutputStream& stream,
+									U32 fieldNumber,
+									const U8* bytes,
+									Uptr numBytes)
+{
+	writeProtobufTag(stream, fieldNumber, ProtobufWireType::lengthDelimited);
+	writeProtobufVarInt(stream, numBytes);
+	serializeBytes(stream, bytes, numBytes);
+}
+
+static void writeProtobufMessageField(OutputStream& stream,
+									  U32 fieldNumber,
+									  ArrayOutputStream& messageStream)
+{
+	std::vector<U8> messageBytes = messageStream.getBytes();
+	writeProtobufBytesField(stream, fieldNumber, messageBytes.data(), messageBytes.size());
+}
+
+static void writePackedVarIntsField(OutputStream& stream,
+									U32 fieldNumber,
+									const std::vector<U64>& values)
+{
+	ArrayOutputStream valuesStream;
+	for(U64 value : values) { writeProtobufVarInt(valuesStream, value); }
+	writeProtobufMessageField(stream, fieldNumber, valuesStream);
+}
+
+// The field numbers of the messages in pprof's profile.proto.
+enum PprofField : U32
+{
+	profileSampleType = 1,
+	profileSample = 2,
+	profileLocation = 4,
+	profileFunction = 5,
+	profileStringTable = 6,
+	profileTimeNanos = 9,
+	profileDurationNanos = 10,
+	profilePeriodType = 11,
+	profilePeriod = 12,
+
+	valueTypeType = 1,
+	valueTypeUnit = 2,
+
+	sampleLocationId = 1,
+	sampleValue = 2,
+
+	locationId = 1,
+	locationLine = 4,
+
+	lineFunctionId = 1,
+	lineLine = 2,
+
+	functionId = 1,
+	functionName = 2,
+	functionSystemName = 3
+};
+
+void Runtime::writePprofProfile(Profiler* profiler, OutputStream& stream)
+{
+	Lock<Platform::Mutex> samplesLock(profiler->samplesMutex);
+	countSamples(profiler);
+
+	// The string table must start with the empty string.
+	std::vector<std::string> strings;
+	std::map<std::string, Uptr> stringIndexMap;
+	auto getStringIndex = [&](const std::string& string) {
+		auto stringIndexIt = stringIndexMap.find(string);
+		if(stringIndexIt != stringIndexMap.end()) { return U64(stringIndexIt->second); }
+		strings.push_back(string);
+		stringIndexMap.emplace(string, strings.size() - 1);
+		return U64(strings.size() - 1);
+	};
+	getStringIndex("");
+
+	auto writeValueType
+		= [&](U32 fieldNumber, const std::string& typeString, const std::string& unitString) {
+			  ArrayOutputStream valueTypeStream;
+			  writeProtobufVarIntField(valueTypeStream, valueTypeType, getStringIndex(typeString));
+			  writeProtobufVarIntField(valueTypeStream, valueTypeUnit, getStringIndex(unitString));
+			  writeProtobufMessageField(stream, fieldNumber, valueTypeStream);
+		  };
+
+	// Each sample has a count of samples, and the CPU time they represent.
+	const U64 sampleIntervalNanoseconds = profiler->sampleIntervalMicroseconds * 1000;
+	writeValueType(profileSampleType, "samples", "count");
+	writeValueType(profileSampleType, "cpu", "nanoseconds");
+
+	// Write a sample for each distinct call stack. pprof lists the locations from innermost to
+	// outermost, and each frame is a location whose ID is the frame's index + 1.
+	for(const auto& callStackCount : profiler->callStackCounts)
+	{
+		const std::vector<Uptr>& frameIndices = callStackCount.first;
+		std::vector<U64> locationIds;
+		for(auto frameIndexIt = frameIndices.rbegin(); frameIndexIt != frameIndices.rend();
+			++frameIndexIt)
+		{ locationIds.push_back(U64(*frameIndexIt) + 1); }
+
+		ArrayOutputStream sampleStream;
+		writePackedVarIntsField(sampleStream, sampleLocationId, locationIds);
+		writePackedVarIntsField(
+			sampleStream,
+			sampleValue,
+			{callStackCount.second, callStackCount.second * sampleIntervalNanoseconds});
+		writeProtobufMessageField(stream, profileSample, sampleStream);
+	}
+
+	// Write a location for each frame, whose line is the frame's operator index in a function
+	// identified by the function's name.
+	std::map<std::string, U64> functionIdMap;
+	for(Uptr frameIndex = 0; frameIndex < profiler->frames.size(); ++frameIndex)
+	{
+		const ProfileFrame& frame = profiler->frames[frameIndex];
+		auto functionIdIt = functionIdMap.find(frame.functionName);
+		if(functionIdIt == functionIdMap.end())
+		{
+			functionIdIt
+				= functionIdMap.emplace(frame.functionName, U64(functionIdMap.size() + 1)).first;
+		}
+
+		ArrayOutputStream lineStream;
+		writeProtobufVarIntField(lineStream, lineFunctionId, functionIdIt->second);
+		writeProtobufVarIntField(lineStream, lineLine, U64(frame.opIndex));
+
+		ArrayOutputStream locationStream;
+		writeProtobufVarIntField(locationStream, locationId, U64(frameIndex) + 1);
+		writeProtobufMessageField(locationStream, locationLine, lineStream);
+		writeProtobufMessageField(stream, profileLocation, locationStream);
+	}
+
+	for(const auto& functionIdPair : functionIdMap)
+	{
+		const U64 functionNameIndex = getStringIndex(functionIdPair.first);
+
+		ArrayOutputStream functionStream;
+		writeProtobufVarIntField(functionStream, functionId, functionIdPair.second);
+		writeProtobufVarIntField(functionStream, functionName, functionNameIndex);
+		writeProtobufVarIntField(functionStream, functionSystemName, functionNameIndex);
+		writeProtobufMessageField(stream, profileFunction, functionStream);
+	}
+
+	// Write the profile's duration and sampling period.
+	const U64 durationMicroseconds = Platform::getMonotonicClock() - profiler->startClock;
+	writeProtobufVarIntField(stream, profileDurationNanos, durationMicroseconds * 1000);
+	writeValueType(profilePeriodType, "cpu", "nanoseconds");
+	writeProtobufVarIntField(stream, profilePeriod, sampleIntervalNanoseconds);
+
+	// Write the string table last, since writing the other messages adds strings to it.
+	for(const std::string& string : strings)
+	{ writeProtobufBytesField(stream, profileStringTable, (const U8*)string.data(), string.size()); }
+}
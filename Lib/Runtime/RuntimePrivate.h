@@ -7,6 +7,7 @@
 #include "WAVM/Inline/HashSet.h"
 #include "WAVM/Inline/IndexMap.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Defines.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Runtime/Intrinsics.h"
@@ -73,17 +74,23 @@ namespace WAVM { namespace Runtime {
 		Uptr id = UINTPTR_MAX;
 		IR::MemoryType type;
 		std::string debugName;
+		const MemoryPolicy policy;
 
 		U8* baseAddress = nullptr;
+		U8* unalignedBaseAddress = nullptr;
 		Uptr numReservedBytes = 0;
 
 		mutable Platform::Mutex resizingMutex;
 		std::atomic<Uptr> numPages{0};
 
-		Memory(Compartment* inCompartment, const IR::MemoryType& inType, std::string&& inDebugName)
+		Memory(Compartment* inCompartment,
+			   const IR::MemoryType& inType,
+			   std::string&& inDebugName,
+			   const MemoryPolicy& inPolicy)
 		: GCObject(ObjectKind::memory, inCompartment)
 		, type(inType)
 		, debugName(std::move(inDebugName))
+		, policy(inPolicy)
 		{
 		}
 		~Memory() override;
@@ -121,26 +128,54 @@ namespace WAVM { namespace Runtime {
 		IR::ExceptionType sig;
 		std::string debugName;
 
+		// Counts the exceptions of this type that are created, including traps. Exception types
+		// with the same name share a counter.
+		Metrics::Counter* numCreatedExceptions;
+
 		ExceptionType(Compartment* inCompartment,
 					  IR::ExceptionType inSig,
 					  std::string&& inDebugName)
 		: GCObject(ObjectKind::exceptionType, inCompartment)
 		, sig(inSig)
 		, debugName(std::move(inDebugName))
+		, numCreatedExceptions(
+			  Metrics::getCounter("wavm_runtime_exceptions_total",
+								  "Number of WebAssembly exceptions and traps, by exception type",
+								  Metrics::formatLabel("type", debugName)))
 		{
 		}
 
 		~ExceptionType() override;
 	};
 
-	// A compiled WebAssembly module.
+	// A compiled WebAssembly module. The object code is either owned by the module, or borrowed
+	// from one of the IR module's user sections. The IR is kept for the lifetime of the module, but
+	// its code is only needed to print or re-serialize the module, so it is stored in the compact
+	// operator encoding.
 	struct Module
 	{
-		IR::Module ir;
-		std::vector<U8> objectCode;
+		// The IR may be shared with other Modules or with the embedder, so it is immutable.
+		const std::shared_ptr<const IR::Module> sharedIR;
+		const IR::Module& ir;
+
+		std::vector<U8> ownedObjectCode;
+		const U8* objectCode;
+		Uptr numObjectCodeBytes;
+
+		Module(std::shared_ptr<const IR::Module>&& inIR, std::vector<U8>&& inObjectCode)
+		: sharedIR(std::move(inIR))
+		, ir(*sharedIR)
+		, ownedObjectCode(std::move(inObjectCode))
+		, objectCode(ownedObjectCode.data())
+		, numObjectCodeBytes(ownedObjectCode.size())
+		{
+		}
 
-		Module(IR::Module&& inIR, std::vector<U8>&& inObjectCode)
-		: ir(inIR), objectCode(std::move(inObjectCode))
+		Module(std::shared_ptr<const IR::Module>&& inIR, Uptr objectCodeUserSectionIndex)
+		: sharedIR(std::move(inIR))
+		, ir(*sharedIR)
+		, objectCode(ir.userSections[objectCodeUserSectionIndex].getBytes())
+		, numObjectCodeBytes(ir.userSections[objectCodeUserSectionIndex].getNumBytes())
 		{
 		}
 	};
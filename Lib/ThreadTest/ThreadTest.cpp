@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include <atomic>
+#include <deque>
+#include <map>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -12,6 +14,9 @@
 #include "WAVM/Inline/IndexMap.h"
 #include "WAVM/Inline/IntrusiveSharedPtr.h"
 #include "WAVM/Inline/Lock.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Fiber.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Intrinsics.h"
@@ -23,9 +28,47 @@ using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
+// Threads created by WebAssembly code don't each get a platform thread: they run as fibers on a
+// fixed pool of worker threads. Each worker has a queue of ready threads, which it runs newest
+// first, and when its queue is empty, it steals the oldest ready thread from another worker's
+// queue. A thread that joins another thread, or waits in memory.atomic.wait, suspends its fiber
+// instead of blocking the worker running it.
+
 enum
 {
-	numStackBytes = 1 * 1024 * 1024
+	numStackBytes = 1 * 1024 * 1024,
+	numWorkerStackBytes = 256 * 1024
+};
+
+struct Thread;
+
+// A WaitEvent that suspends a thread's fiber while it waits, and readies the thread again when the
+// event is signaled or the wait times out.
+struct FiberWaitEvent : WaitEvent
+{
+	// The low bits of the state are a WaitState. The remaining bits count the waits, so a timeout
+	// can tell whether the wait it was added for is still the current wait.
+	enum WaitState : U64
+	{
+		notWaiting = 0,
+		signaled = 1,
+		waiting = 2,
+
+		waitStateMask = 3,
+		waitSequenceIncrement = 4
+	};
+
+	Thread* thread;
+	std::atomic<U64> state{notWaiting};
+	U64 untilClock = UINT64_MAX;
+	bool wasSignaled = false;
+
+	FiberWaitEvent(Thread* inThread) : thread(inThread) {}
+
+	virtual bool wait(U64 inUntilClock) override;
+	virtual void signal() override;
+
+	void timeOut(U64 waitingState);
 };
 
 // Keeps track of the entry function used by a running WebAssembly-spawned thread.
@@ -35,19 +78,28 @@ struct Thread
 	Uptr id = UINTPTR_MAX;
 	std::atomic<Uptr> numRefs{0};
 
-	Platform::Thread* platformThread = nullptr;
+	Platform::Fiber* fiber = nullptr;
 	GCPointer<Context> context;
 	GCPointer<Function> entryFunction;
 
 	Platform::Mutex resultMutex;
+	bool isFinished = false;
+	bool isDetached = false;
+	WaitEvent* joinEvent = nullptr;
 	bool threwException = false;
 	Exception* exception = nullptr;
 	I64 result = -1;
 
 	IR::Value argument;
 
+	FiberWaitEvent waitEvent;
+
+	// If non-null, the worker that resumed the thread calls this after the thread's fiber suspends.
+	// Otherwise, the worker readies the thread again, so suspending just yields the worker.
+	void (*afterSuspend)(Thread*) = nullptr;
+
 	FORCENOINLINE Thread(Context* inContext, Function* inEntryFunction, const IR::Value& inArgument)
-	: context(inContext), entryFunction(inEntryFunction), argument(inArgument)
+	: context(inContext), entryFunction(inEntryFunction), argument(inArgument), waitEvent(this)
 	{
 	}
 
@@ -63,13 +115,48 @@ struct ExitThreadException
 	I64 code;
 };
 
+struct Scheduler;
+
+struct Worker
+{
+	Scheduler* scheduler;
+	Uptr index;
+
+	// The threads that are ready to run. The worker pushes and pops threads at the back, and other
+	// workers steal threads from the front.
+	Platform::Mutex readyThreadsMutex;
+	std::deque<Thread*> readyThreads;
+
+	// Set while the worker is waiting for its wake event to be signaled.
+	std::atomic<bool> isIdle{false};
+	Platform::Event wakeEvent;
+};
+
+struct Scheduler
+{
+	std::vector<Worker*> workers;
+
+	// Threads that are readied by a platform thread that isn't a worker are distributed among the
+	// workers' queues in turn.
+	std::atomic<Uptr> nextWorkerIndex{0};
+
+	// The threads that are waiting with a timeout, ordered by the time they time out.
+	struct Timer
+	{
+		IntrusiveSharedPtr<Thread> thread;
+		U64 waitingState;
+	};
+	Platform::Mutex timersMutex;
+	std::multimap<U64, Timer> timers;
+	std::atomic<U64> nextTimerClock{UINT64_MAX};
+};
+
 // A global list of running threads created by WebAssembly code.
 static Platform::Mutex threadsMutex;
 static IndexMap<Uptr, IntrusiveSharedPtr<Thread>> threads(1, UINTPTR_MAX);
 
-// A shared pointer to the current thread. This is used to decrement the thread's reference count
-// when the thread exits.
-thread_local IntrusiveSharedPtr<Thread> currentThread = nullptr;
+// The worker run by the calling platform thread, or null if it isn't a worker.
+thread_local Worker* currentWorker = nullptr;
 
 // Adds the thread to the global thread array, assigning it an ID corresponding to its index in the
 // array.
@@ -81,10 +168,15 @@ FORCENOINLINE static Uptr allocateThreadId(Thread* thread)
 	return thread->id;
 }
 
-// These functions just provide a way to read/write the currentThread thread-local variable in a
-// way that the compiler can't cache across a call to Platform::forkCurrentThread.
-FORCENOINLINE static void setCurrentThread(Thread* thread) { currentThread = thread; }
-FORCENOINLINE static Thread* getCurrentThread() { return currentThread; }
+// These functions just provide a way to read the currentWorker thread-local variable in a way that
+// the compiler can't cache across a suspension, after which the thread's fiber may be running on
+// a different worker, or across a call to Platform::forkCurrentFiber.
+FORCENOINLINE static Worker* getCurrentWorker() { return currentWorker; }
+FORCENOINLINE static Thread* getCurrentThread()
+{
+	Platform::Fiber* fiber = Platform::getCurrentFiber();
+	return fiber && currentWorker ? (Thread*)Platform::getFiberArgument(fiber) : nullptr;
+}
 
 // Validates that a thread ID is valid. i.e. 0 < threadId < threads.size(), and threads[threadId] !=
 // null If the thread ID is invalid, throws an invalid argument exception. The caller must have
@@ -95,18 +187,282 @@ static void validateThreadId(Uptr threadId)
 	{ throwException(ExceptionTypes::invalidArgument); }
 }
 
-DEFINE_INTRINSIC_MODULE(threadTest);
+// Wakes an idle worker, preferring the given worker, so it will look for ready threads.
+static void wakeIdleWorker(Scheduler* scheduler, Worker* preferredWorker)
+{
+	if(preferredWorker->isIdle.exchange(false))
+	{
+		preferredWorker->wakeEvent.signal();
+		return;
+	}
+
+	for(Worker* worker : scheduler->workers)
+	{
+		if(worker->isIdle.exchange(false))
+		{
+			worker->wakeEvent.signal();
+			return;
+		}
+	}
+}
+
+// Adds a thread to the calling worker's ready queue, or if the caller isn't a worker, to the next
+// worker's queue.
+static void readyThread(Scheduler* scheduler, Thread* thread)
+{
+	Worker* worker = getCurrentWorker();
+	if(!worker)
+	{
+		const Uptr workerIndex = scheduler->nextWorkerIndex++ % scheduler->workers.size();
+		worker = scheduler->workers[workerIndex];
+	}
+
+	{
+		Lock<Platform::Mutex> readyThreadsLock(worker->readyThreadsMutex);
+		worker->readyThreads.push_back(thread);
+	}
+
+	wakeIdleWorker(scheduler, worker);
+}
+
+// Takes the newest thread from the worker's ready queue, or if it's empty, steals the oldest thread
+// from another worker's queue. Returns null if no threads are ready.
+static Thread* takeReadyThread(Worker* worker)
+{
+	{
+		Lock<Platform::Mutex> readyThreadsLock(worker->readyThreadsMutex);
+		if(worker->readyThreads.size())
+		{
+			Thread* thread = worker->readyThreads.back();
+			worker->readyThreads.pop_back();
+			return thread;
+		}
+	}
+
+	const std::vector<Worker*>& workers = worker->scheduler->workers;
+	for(Uptr victimOffset = 1; victimOffset < workers.size(); ++victimOffset)
+	{
+		Worker* victim = workers[(worker->index + victimOffset) % workers.size()];
+		Lock<Platform::Mutex> readyThreadsLock(victim->readyThreadsMutex);
+		if(victim->readyThreads.size())
+		{
+			Thread* thread = victim->readyThreads.front();
+			victim->readyThreads.pop_front();
+			return thread;
+		}
+	}
+
+	return nullptr;
+}
+
+// Readies the threads whose waits have timed out.
+static void fireExpiredTimers(Scheduler* scheduler)
+{
+	const U64 currentClock = Platform::getMonotonicClock();
+	if(scheduler->nextTimerClock.load() > currentClock) { return; }
+
+	std::vector<Scheduler::Timer> expiredTimers;
+	{
+		Lock<Platform::Mutex> timersLock(scheduler->timersMutex);
+		while(scheduler->timers.size() && scheduler->timers.begin()->first <= currentClock)
+		{
+			expiredTimers.push_back(std::move(scheduler->timers.begin()->second));
+			scheduler->timers.erase(scheduler->timers.begin());
+		}
+		scheduler->nextTimerClock.store(
+			scheduler->timers.size() ? scheduler->timers.begin()->first : UINT64_MAX);
+	}
+
+	for(const Scheduler::Timer& timer : expiredTimers)
+	{ timer.thread->waitEvent.timeOut(timer.waitingState); }
+}
+
+static void addTimer(Scheduler* scheduler, Thread* thread, U64 untilClock, U64 waitingState)
+{
+	Scheduler::Timer timer;
+	timer.thread = thread;
+	timer.waitingState = waitingState;
+	{
+		Lock<Platform::Mutex> timersLock(scheduler->timersMutex);
+		scheduler->timers.emplace(untilClock, std::move(timer));
+		if(untilClock < scheduler->nextTimerClock.load())
+		{ scheduler->nextTimerClock.store(untilClock); }
+	}
 
-static I64 threadEntry(void* threadVoid)
+	// Wake an idle worker, so it will wait until the new timer expires at the latest.
+	wakeIdleWorker(scheduler, scheduler->workers[0]);
+}
+
+static Scheduler* createScheduler();
+
+static Scheduler* getScheduler()
+{
+	static Scheduler* scheduler = createScheduler();
+	return scheduler;
+}
+
+bool FiberWaitEvent::wait(U64 inUntilClock)
+{
+	wavmAssert(getCurrentThread() == thread);
+
+	// If the event was signaled while nothing was waiting on it, reset it and return immediately.
+	const U64 currentState = state.load();
+	if((currentState & waitStateMask) == signaled)
+	{
+		state.store(currentState - signaled);
+		return true;
+	}
+	if(inUntilClock <= Platform::getMonotonicClock()) { return false; }
+
+	// Suspend the thread's fiber, and let the worker that was running it start the wait: if the
+	// worker readied the thread before its fiber had suspended, another worker could resume it.
+	untilClock = inUntilClock;
+	thread->afterSuspend = [](Thread* suspendedThread) {
+		FiberWaitEvent& waitEvent = suspendedThread->waitEvent;
+		const U64 waitUntilClock = waitEvent.untilClock;
+
+		U64 currentState = waitEvent.state.load();
+		const U64 nextSequenceState = (currentState & ~U64(waitStateMask)) + waitSequenceIncrement;
+		const U64 waitingState = nextSequenceState + waiting;
+
+		// Add the timer before starting the wait: once the wait has started, the thread may be
+		// signaled, and finish, at any time. If the wait doesn't start, the timer is ignored.
+		if(waitUntilClock != UINT64_MAX)
+		{ addTimer(getScheduler(), suspendedThread, waitUntilClock, waitingState); }
+
+		if(!waitEvent.state.compare_exchange_strong(currentState, waitingState))
+		{
+			// The event was signaled after the fiber checked it, so ready the thread again.
+			wavmAssert((currentState & waitStateMask) == signaled);
+			waitEvent.state.store(nextSequenceState);
+			waitEvent.wasSignaled = true;
+			readyThread(getScheduler(), suspendedThread);
+		}
+	};
+	Platform::suspendFiber();
+
+	return wasSignaled;
+}
+
+void FiberWaitEvent::signal()
+{
+	U64 currentState = state.load();
+	while(true)
+	{
+		switch(currentState & waitStateMask)
+		{
+		case signaled: return;
+		case notWaiting:
+			if(state.compare_exchange_weak(currentState, currentState + signaled)) { return; }
+			break;
+		case waiting:
+			if(state.compare_exchange_weak(currentState, currentState - waiting))
+			{
+				wasSignaled = true;
+				readyThread(getScheduler(), thread);
+				return;
+			}
+			break;
+		default: Errors::unreachable();
+		}
+	}
+}
+
+void FiberWaitEvent::timeOut(U64 waitingState)
+{
+	U64 expectedState = waitingState;
+	if(state.compare_exchange_strong(expectedState, waitingState - waiting))
+	{
+		wasSignaled = false;
+		readyThread(getScheduler(), thread);
+	}
+}
+
+// Returns the wait event for the thread running on the calling worker, if any, so the
+// memory.atomic.wait suspends the thread instead of blocking the worker.
+static WaitEvent* getCurrentThreadWaitEvent()
 {
-	// Assign the thread to currentThread, and discard it: if this thread is forked, then the local
-	// thread/threadVoid will point to the original Thread, not the forked Thread.
+	Thread* thread = getCurrentThread();
+	return thread ? &thread->waitEvent : nullptr;
+}
+
+// Resumes a thread until it suspends or returns.
+static void runThread(Scheduler* scheduler, Thread* thread)
+{
+	thread->afterSuspend = nullptr;
+	if(Platform::resumeFiber(thread->fiber))
 	{
-		Thread* thread = (Thread*)threadVoid;
-		setCurrentThread(thread);
+		// The thread has finished, so free its fiber, and release the scheduler's reference to it.
+		Platform::destroyFiber(thread->fiber);
+		thread->fiber = nullptr;
 		thread->removeRef();
 	}
+	else if(thread->afterSuspend)
+	{
+		(*thread->afterSuspend)(thread);
+	}
+	else
+	{
+		readyThread(scheduler, thread);
+	}
+}
+
+static I64 workerEntry(void* workerVoid)
+{
+	Worker* worker = (Worker*)workerVoid;
+	Scheduler* scheduler = worker->scheduler;
+	currentWorker = worker;
+
+	while(true)
+	{
+		fireExpiredTimers(scheduler);
+
+		Thread* thread = takeReadyThread(worker);
+		if(!thread)
+		{
+			// Mark the worker as idle before checking for ready threads and timers again, so a
+			// thread or timer that is added in between will wake the worker.
+			worker->isIdle.store(true);
+			thread = takeReadyThread(worker);
+			if(!thread) { worker->wakeEvent.wait(scheduler->nextTimerClock.load()); }
+			worker->isIdle.store(false);
+		}
+
+		if(thread) { runThread(scheduler, thread); }
+	}
+
+	Errors::unreachable();
+}
+
+static Scheduler* createScheduler()
+{
+	Scheduler* scheduler = new Scheduler;
+
+	Uptr numWorkers = Platform::getNumberOfHardwareThreads();
+	if(numWorkers == 0) { numWorkers = 1; }
+	for(Uptr workerIndex = 0; workerIndex < numWorkers; ++workerIndex)
+	{
+		Worker* worker = new Worker;
+		worker->scheduler = scheduler;
+		worker->index = workerIndex;
+		scheduler->workers.push_back(worker);
+	}
+
+	// Start the workers after creating all of them, since they steal from each other's queues.
+	for(Worker* worker : scheduler->workers)
+	{ Platform::detachThread(Platform::createThread(numWorkerStackBytes, workerEntry, worker)); }
+
+	setWaitEventProvider(getCurrentThreadWaitEvent);
+
+	return scheduler;
+}
+
+DEFINE_INTRINSIC_MODULE(threadTest);
 
+static void threadEntry(void*)
+{
+	// Don't use the argument: if this thread is forked, the forked fiber returns to a copy of this
+	// frame, with the original Thread as its argument.
 	catchRuntimeExceptionsOnRelocatableStack(
 		[]() {
 			I64 result;
@@ -127,7 +483,7 @@ static I64 threadEntry(void* threadVoid)
 		},
 		[](Exception* exception) {
 			Lock<Platform::Mutex> resultLock(getCurrentThread()->resultMutex);
-			if(getCurrentThread()->numRefs == 1)
+			if(getCurrentThread()->isDetached)
 			{
 				// If the thread has already been detached, the exception is fatal.
 				Errors::fatalf("Runtime exception in detached thread: %s",
@@ -140,7 +496,11 @@ static I64 threadEntry(void* threadVoid)
 			}
 		});
 
-	return 0;
+	// Wake the thread that is joining this thread, if any.
+	Thread* thread = getCurrentThread();
+	Lock<Platform::Mutex> resultLock(thread->resultMutex);
+	thread->isFinished = true;
+	if(thread->joinEvent) { thread->joinEvent->signal(); }
 }
 
 DEFINE_INTRINSIC_FUNCTION(threadTest,
@@ -161,54 +521,52 @@ DEFINE_INTRINSIC_FUNCTION(threadTest,
 	auto newContext = createContext(getCompartmentFromContextRuntimeData(contextRuntimeData));
 	Thread* thread = new Thread(newContext, entryFunction, entryArgument);
 
-	allocateThreadId(thread);
+	thread->fiber = Platform::createFiber(numStackBytes, threadEntry, thread);
+	if(!thread->fiber)
+	{
+		delete thread;
+		throwException(ExceptionTypes::outOfMemory);
+	}
 
-	// Increment the Thread's reference count for the pointer passed to the thread's entry function.
-	// threadFunc calls the corresponding removeRef.
-	thread->addRef();
+	const Uptr threadId = allocateThreadId(thread);
 
-	// Spawn and detach a platform thread that calls threadFunc.
-	thread->platformThread = Platform::createThread(numStackBytes, threadEntry, thread);
+	// Increment the Thread's reference count for the scheduler, which calls the corresponding
+	// removeRef when the thread's fiber returns.
+	thread->addRef();
+	readyThread(getScheduler(), thread);
 
-	return thread->id;
+	return threadId;
 }
 
 DEFINE_INTRINSIC_FUNCTION_WITH_CONTEXT_SWITCH(threadTest, "forkThread", I64, forkThread)
 {
+	Thread* currentThread = getCurrentThread();
+	if(!currentThread) { throwException(ExceptionTypes::calledAbort); }
+
 	auto oldContext = getContextFromRuntimeData(contextRuntimeData);
 	auto compartment = getCompartmentFromContextRuntimeData(contextRuntimeData);
 	auto newContext = cloneContext(oldContext, compartment);
 
-	wavmAssert(currentThread);
 	Thread* childThread
 		= new Thread(newContext, currentThread->entryFunction, currentThread->argument);
 
-	// Increment the Thread's reference count twice to account for the reference to the Thread on
-	// the stack which is about to be forked. Each fork calls removeRef separately below.
-	childThread->addRef(2);
+	// Increment the Thread's reference count for the scheduler, which calls the corresponding
+	// removeRef when the forked fiber returns.
+	childThread->addRef();
 
-	Platform::Thread* platformThread = Platform::forkCurrentThread();
-	if(platformThread)
+	Platform::Fiber* forkedFiber = Platform::forkCurrentFiber(childThread);
+	if(forkedFiber)
 	{
-		// Initialize the child thread's platform thread pointer, and allocate a thread ID for it.
-		childThread->platformThread = platformThread;
+		// Initialize the child thread's fiber, allocate a thread ID for it, and ready it.
+		childThread->fiber = forkedFiber;
 		const Uptr threadId = allocateThreadId(childThread);
-		childThread->removeRef();
+		readyThread(getScheduler(), childThread);
 
 		return Intrinsics::resultInContextRuntimeData<I64>(contextRuntimeData, threadId);
 	}
 	else
 	{
-		// Move the childThread pointer into the thread-local currentThread variable. Since some
-		// compilers will cache a pointer to thread-local data that's accessed multiple times in one
-		// function, and currentThread is accessed before calling forkCurrentThread, we can't
-		// directly write to it in this function in case the compiler tries to write to the original
-		// thread's currentThread variable. Instead, call a FORCENOINLINE function
-		// (setCurrentThread) to set the variable.
-		setCurrentThread(childThread);
-		childThread->removeRef();
-		childThread = nullptr;
-
+		// The forked fiber's argument is the child Thread, so getCurrentThread now returns it.
 		// Switch the contextRuntimeData to point to the new context's runtime data.
 		contextRuntimeData = getContextRuntimeData(newContext);
 
@@ -242,10 +600,22 @@ static IntrusiveSharedPtr<Thread> removeThreadById(Uptr threadId)
 DEFINE_INTRINSIC_FUNCTION(threadTest, "joinThread", I64, joinThread, U64 threadId)
 {
 	IntrusiveSharedPtr<Thread> thread = removeThreadById(Uptr(threadId));
-	Platform::joinThread(thread->platformThread);
-	thread->platformThread = nullptr;
+
+	// Wait for the thread to finish. If the caller is also a thread created by WebAssembly code,
+	// this suspends its fiber instead of blocking the worker running it.
+	WaitEvent* joinEvent = getCurrentWaitEvent();
+	while(true)
+	{
+		{
+			Lock<Platform::Mutex> resultLock(thread->resultMutex);
+			if(thread->isFinished) { break; }
+			thread->joinEvent = joinEvent;
+		}
+		joinEvent->wait(UINT64_MAX);
+	}
 
 	Lock<Platform::Mutex> resultLock(thread->resultMutex);
+	thread->joinEvent = nullptr;
 	if(thread->threwException) { throwException(thread->exception); }
 	else
 	{
@@ -257,11 +627,9 @@ DEFINE_INTRINSIC_FUNCTION(threadTest, "detachThread", void, detachThread, U64 th
 {
 	IntrusiveSharedPtr<Thread> thread = removeThreadById(Uptr(threadId));
 
-	Platform::detachThread(thread->platformThread);
-	thread->platformThread = nullptr;
-
 	// If the thread threw an exception, turn it into a fatal error.
 	Lock<Platform::Mutex> resultLock(thread->resultMutex);
+	thread->isDetached = true;
 	if(thread->threwException)
 	{
 		Errors::fatalf("Runtime exception in detached thread: %s",
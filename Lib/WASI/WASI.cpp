@@ -1,11 +1,14 @@
 #include "WAVM/WASI/WASI.h"
 #include <atomic>
+#include <vector>
 #include "./WASIDefinitions.h"
+#include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Defines.h"
 #include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/EventLoop.h"
 #include "WAVM/Platform/File.h"
 #include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Runtime/Intrinsics.h"
@@ -69,10 +72,26 @@ namespace WAVM { namespace WASI {
 		GCPointer<Context> context;
 		GCPointer<Memory> memory;
 		GCPointer<ModuleInstance> moduleInstance;
+		GCPointer<Function> startFunction;
 		std::vector<std::string> args;
 		std::vector<std::string> envs;
 
 		ProcessResolver resolver;
+
+		// If the process runs on a worker, the worker, the fiber that the process runs on, and where
+		// to write the process's exit code.
+		Worker* worker{nullptr};
+		Runtime::Fiber* fiber{nullptr};
+		I32* outExitCode{nullptr};
+	};
+
+	struct Worker
+	{
+		Platform::EventLoop* eventLoop;
+
+		// The processes that haven't exited, and the processes that are ready to resume.
+		std::vector<Process*> processes;
+		std::vector<Process*> readyProcesses;
 	};
 }}
 
@@ -92,8 +111,8 @@ static void traceSyscallv(const char* syscallName, const char* argFormat, va_lis
 		Log::printf(Log::output, ". Call stack:\n");
 		va_end(argList);
 
-		Platform::CallStack callStack = Platform::captureCallStack(4);
-		if(callStack.stackFrames.size() > 4) { callStack.stackFrames.resize(4); }
+		Platform::CallStack callStack = Platform::captureFramePointerCallStack(4);
+		if(callStack.numStackFrames > 4) { callStack.numStackFrames = 4; }
 		std::vector<std::string> callStackFrameDescriptions = Runtime::describeCallStack(callStack);
 		for(const std::string& frameDescription : callStackFrameDescriptions)
 		{ Log::printf(Log::output, "SYSCALL:     %s\n", frameDescription.c_str()); }
@@ -136,10 +155,12 @@ static void traceUnimplementedSyscall(const char* syscallName, const char* argFo
 	traceSyscallReturnf(syscallName, "ENOSYS");
 }
 
-WASI::RunResult WASI::run(Runtime::ModuleConstRefParam module,
-						  std::vector<std::string>&& inArgs,
-						  std::vector<std::string>&& inEnvs,
-						  I32& outExitCode)
+// Links and instantiates a WASI module, and finds its start function. Returns null if the module
+// can't be run, and the reason in outResult.
+static Process* createProcess(Runtime::ModuleConstRefParam module,
+							  std::vector<std::string>&& inArgs,
+							  std::vector<std::string>&& inEnvs,
+							  RunResult& outResult)
 {
 	GCPointer<Compartment> compartment = createCompartment();
 	Context* context = createContext(compartment);
@@ -161,60 +182,222 @@ WASI::RunResult WASI::run(Runtime::ModuleConstRefParam module,
 						missingImport.exportName.c_str(),
 						asString(missingImport.type).c_str());
 		}
-		return RunResult::linkError;
+		outResult = RunResult::linkError;
+		return nullptr;
 	}
 
 	ModuleInstance* moduleInstance = instantiateModule(
 		compartment, module, std::move(linkResult.resolvedImports), "<main module>");
 
-	Memory* memory = asMemoryNullable(getInstanceExport(moduleInstance, "memory"));
+	Function* startFunction = asFunctionNullable(getInstanceExport(moduleInstance, "_start"));
+	if(!startFunction)
+	{
+		Log::printf(Log::Category::debug, "WASI module did not export start function.\n");
+		outResult = RunResult::noStartFunction;
+		return nullptr;
+	}
+
+	if(getFunctionType(startFunction) != FunctionType())
+	{
+		Log::printf(Log::Category::debug,
+					"WASI module exported _start : %s but expected _start : %s.\n",
+					asString(getFunctionType(startFunction)).c_str(),
+					asString(FunctionType()).c_str());
+		outResult = RunResult::mistypedStartFunction;
+		return nullptr;
+	}
 
-	Process* process = new Process{compartment,
-								   context,
-								   memory,
-								   moduleInstance,
-								   std::move(inArgs),
-								   std::move(inEnvs),
-								   std::move(processResolver)};
+	Process* process = new Process;
+	process->compartment = compartment;
+	process->context = context;
+	process->memory = asMemoryNullable(getInstanceExport(moduleInstance, "memory"));
+	process->moduleInstance = moduleInstance;
+	process->startFunction = startFunction;
+	process->args = std::move(inArgs);
+	process->envs = std::move(inEnvs);
+	process->resolver = std::move(processResolver);
 	setUserData(compartment, process);
 
-	try
-	{
-		Function* startFunction
-			= asFunctionNullable(getInstanceExport(process->moduleInstance, "_start"));
-		if(!startFunction)
-		{
-			Log::printf(Log::Category::debug, "WASI module did not export start function.\n");
-			return RunResult::noStartFunction;
-		}
+	outResult = RunResult::success;
+	return process;
+}
 
-		if(getFunctionType(startFunction) != FunctionType())
-		{
-			Log::printf(Log::Category::debug,
-						"WASI module exported _start : %s but expected _start : %s.\n",
-						asString(getFunctionType(startFunction)).c_str(),
-						asString(FunctionType()).c_str());
-			return RunResult::mistypedStartFunction;
-		}
+static void destroyProcess(Process* process)
+{
+	if(process->fiber) { destroyFiber(process->fiber); }
+
+	GCPointer<Compartment> compartment = process->compartment;
+	delete process;
+	errorUnless(tryCollectCompartment(std::move(compartment)));
+}
+
+WASI::RunResult WASI::run(Runtime::ModuleConstRefParam module,
+						  std::vector<std::string>&& inArgs,
+						  std::vector<std::string>&& inEnvs,
+						  I32& outExitCode)
+{
+	RunResult result;
+	Process* process = createProcess(module, std::move(inArgs), std::move(inEnvs), result);
+	if(!process) { return result; }
 
-		invokeFunctionChecked(process->context, startFunction, {});
+	try
+	{
+		invokeFunctionChecked(process->context, process->startFunction, {});
 	}
 	catch(const ExitException& exitException)
 	{
 		outExitCode = exitException.exitCode;
 	}
 
-	delete process;
-	errorUnless(tryCollectCompartment(std::move(compartment)));
+	destroyProcess(process);
+	return RunResult::success;
+}
+
+Worker* WASI::createWorker()
+{
+	Worker* worker = new Worker;
+	worker->eventLoop = Platform::createEventLoop();
+	return worker;
+}
+
+void WASI::destroyWorker(Worker* worker)
+{
+	for(Process* process : worker->processes) { destroyProcess(process); }
+	Platform::destroyEventLoop(worker->eventLoop);
+	delete worker;
+}
+
+WASI::RunResult WASI::addProcess(Worker* worker,
+								 Runtime::ModuleConstRefParam module,
+								 std::vector<std::string>&& inArgs,
+								 std::vector<std::string>&& inEnvs,
+								 I32& outExitCode)
+{
+	RunResult result;
+	Process* process = createProcess(module, std::move(inArgs), std::move(inEnvs), result);
+	if(!process) { return result; }
+
+	process->worker = worker;
+	process->outExitCode = &outExitCode;
+	process->fiber = createFiber(process->context, process->startFunction, {});
+	errorUnless(process->fiber);
 
+	worker->processes.push_back(process);
+	worker->readyProcesses.push_back(process);
 	return RunResult::success;
 }
 
+static void removeProcess(Worker* worker, Process* process)
+{
+	for(Uptr processIndex = 0; processIndex < worker->processes.size(); ++processIndex)
+	{
+		if(worker->processes[processIndex] == process)
+		{
+			worker->processes.erase(worker->processes.begin() + processIndex);
+			return;
+		}
+	}
+	Errors::unreachable();
+}
+
+void WASI::runWorker(Worker* worker)
+{
+	while(worker->processes.size())
+	{
+		// Resume each process that is ready, in the order they became ready. A process that waits
+		// adds a wait to the event loop that will add it back to readyProcesses.
+		std::vector<Process*> readyProcesses = std::move(worker->readyProcesses);
+		worker->readyProcesses.clear();
+		for(Uptr processIndex = 0; processIndex < readyProcesses.size(); ++processIndex)
+		{
+			Process* process = readyProcesses[processIndex];
+
+			bool hasExited;
+			try
+			{
+				hasExited = resumeFiber(process->fiber);
+			}
+			catch(const ExitException& exitException)
+			{
+				*process->outExitCode = exitException.exitCode;
+				hasExited = true;
+			}
+			catch(...)
+			{
+				// Leave the processes that weren't resumed ready to resume by the next runWorker.
+				worker->readyProcesses.insert(worker->readyProcesses.begin(),
+											  readyProcesses.begin() + processIndex + 1,
+											  readyProcesses.end());
+
+				// The exception may refer to objects in the process's compartment, so remove the
+				// process without collecting its compartment.
+				removeProcess(worker, process);
+				destroyFiber(process->fiber);
+				delete process;
+				throw;
+			}
+
+			if(hasExited)
+			{
+				removeProcess(worker, process);
+				destroyProcess(process);
+			}
+		}
+
+		// Wait for a process to become ready if there are none, or just poll the event loop if there
+		// are, so processes that yield don't starve processes that are waiting.
+		if(Platform::getNumPendingEventLoopWaits(worker->eventLoop))
+		{
+			Platform::runEventLoop(worker->eventLoop,
+								   worker->readyProcesses.empty() ? UINT64_MAX : 0);
+		}
+		wavmAssert(worker->processes.empty() || worker->readyProcesses.size()
+				   || Platform::getNumPendingEventLoopWaits(worker->eventLoop));
+	}
+}
+
 static Process* getProcessFromContextRuntimeData(ContextRuntimeData* contextRuntimeData)
 {
 	return (Process*)getUserData(getCompartmentFromContextRuntimeData(contextRuntimeData));
 }
 
+static Platform::File* getFileFromFD(__wasi_fd_t fd)
+{
+	switch(fd)
+	{
+	case 0: return Platform::getStdFile(Platform::StdDevice::in);
+	case 1: return Platform::getStdFile(Platform::StdDevice::out);
+	case 2: return Platform::getStdFile(Platform::StdDevice::err);
+	default: return nullptr;
+	}
+}
+
+static void readyProcess(void* processVoid)
+{
+	Process* process = (Process*)processVoid;
+	process->worker->readyProcesses.push_back(process);
+}
+
+// Waits until any of the files is ready, or the monotonic clock reaches untilClock. If the process
+// runs on a worker, this suspends the process until the worker's event loop finds that a file is
+// ready, or that the time has been reached, so the worker may run other processes in the meantime.
+// Otherwise, this blocks the calling thread.
+static void waitForFiles(Process* process,
+						 const Platform::FileWait* waits,
+						 Uptr numWaits,
+						 U64 untilClock)
+{
+	std::vector<Platform::FileReadiness> readiness(numWaits);
+	if(!process->worker) { Platform::pollFiles(waits, readiness.data(), numWaits, untilClock); }
+	else if(!Platform::pollFiles(waits, readiness.data(), numWaits, 0)
+			&& untilClock > Platform::getMonotonicClock())
+	{
+		Platform::addEventLoopWait(
+			process->worker->eventLoop, waits, numWaits, untilClock, readyProcess, process);
+		suspendCurrentFiber();
+	}
+}
+
 DEFINE_INTRINSIC_FUNCTION(wasi,
 						  "args_sizes_get",
 						  __wasi_errno_t,
@@ -351,6 +534,19 @@ DEFINE_INTRINSIC_FUNCTION(wasi,
 	return __WASI_ESUCCESS;
 }
 
+// Translates a WASI clock ID to the Platform clock it reads.
+static bool getPlatformClock(__wasi_clockid_t clockId, Platform::Clock& outClock)
+{
+	switch(clockId)
+	{
+	case __WASI_CLOCK_REALTIME: outClock = Platform::Clock::realtime; return true;
+	case __WASI_CLOCK_MONOTONIC: outClock = Platform::Clock::monotonic; return true;
+	case __WASI_CLOCK_PROCESS_CPUTIME_ID: outClock = Platform::Clock::processCPUTime; return true;
+	case __WASI_CLOCK_THREAD_CPUTIME_ID: outClock = Platform::Clock::threadCPUTime; return true;
+	default: return false;
+	}
+}
+
 DEFINE_INTRINSIC_FUNCTION(wasi,
 						  "clock_res_get",
 						  __wasi_errno_t,
@@ -360,14 +556,18 @@ DEFINE_INTRINSIC_FUNCTION(wasi,
 {
 	traceSyscallf("clock_res_get", "(%u, " WASIADDRESS_FORMAT ")", clockId, resolutionAddress);
 
+	Platform::Clock clock;
+	if(!getPlatformClock(clockId, clock))
+	{
+		traceSyscallReturnf("clock_res_get", "EINVAL");
+		return __WASI_EINVAL;
+	}
+
 	__wasi_timestamp_t resolution;
-	switch(clockId)
+	if(!Platform::getClockResolution(clock, resolution))
 	{
-	case __WASI_CLOCK_REALTIME:
-	case __WASI_CLOCK_PROCESS_CPUTIME_ID:
-	case __WASI_CLOCK_THREAD_CPUTIME_ID:
-	case __WASI_CLOCK_MONOTONIC: resolution = 1000000ul; break;
-	default: traceSyscallReturnf("clock_res_get", "EINVAL"); return __WASI_EINVAL;
+		traceSyscallReturnf("clock_res_get", "ENOTSUP");
+		return __WASI_ENOTSUP;
 	}
 	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
 	memoryRef<__wasi_timestamp_t>(process->memory, resolutionAddress) = resolution;
@@ -384,14 +584,20 @@ DEFINE_INTRINSIC_FUNCTION(wasi,
 						  __wasi_timestamp_t precision,
 						  WASIAddress timeAddress)
 {
+	// The CPU time clocks measure the host process and thread, so they include the CPU time used by
+	// any other processes that run in the same host process or on the same worker thread.
+	Platform::Clock clock;
+	if(!getPlatformClock(clockId, clock))
+	{
+		traceSyscallReturnf("clock_time_get", "EINVAL");
+		return __WASI_EINVAL;
+	}
+
 	__wasi_timestamp_t currentTime;
-	switch(clockId)
+	if(!Platform::getClockTime(clock, currentTime))
 	{
-	case __WASI_CLOCK_REALTIME:
-	case __WASI_CLOCK_PROCESS_CPUTIME_ID:
-	case __WASI_CLOCK_THREAD_CPUTIME_ID:
-	case __WASI_CLOCK_MONOTONIC: currentTime = Platform::getMonotonicClock(); break;
-	default: traceSyscallReturnf("clock_time_get", "EINVAL"); return __WASI_EINVAL;
+		traceSyscallReturnf("clock_time_get", "ENOTSUP");
+		return __WASI_ENOTSUP;
 	}
 	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
 	memoryRef<__wasi_timestamp_t>(process->memory, timeAddress) = currentTime;
@@ -488,13 +694,60 @@ DEFINE_INTRINSIC_FUNCTION(wasi,
 						  WASIAddress numIOVs,
 						  WASIAddress numBytesReadAddress)
 {
-	traceUnimplementedSyscall("fd_read",
-							  "(%u, " WASIADDRESS_FORMAT ", %u, " WASIADDRESS_FORMAT ")",
-							  fd,
-							  iovsAddress,
-							  numIOVs,
-							  numBytesReadAddress);
-	return __WASI_ENOSYS;
+	traceSyscallf("fd_read",
+				  "(%u, " WASIADDRESS_FORMAT ", %u, " WASIADDRESS_FORMAT ")",
+				  fd,
+				  iovsAddress,
+				  numIOVs,
+				  numBytesReadAddress);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	Platform::File* platformFile = getFileFromFD(fd);
+	if(!platformFile)
+	{
+		traceSyscallReturnf("fd_read", "EBADF");
+		return __WASI_EBADF;
+	}
+
+	// If the process runs on a worker, wait for the file to be readable, so reading it doesn't
+	// block the worker.
+	if(process->worker)
+	{
+		const Platform::FileWait wait = {platformFile, true, false};
+		waitForFiles(process, &wait, 1, UINT64_MAX);
+	}
+
+	const __wasi_iovec_t* iovs
+		= memoryArrayPtr<__wasi_iovec_t>(process->memory, iovsAddress, numIOVs);
+	U64 numBytesRead = 0;
+	for(WASIAddress iovIndex = 0; iovIndex < numIOVs; ++iovIndex)
+	{
+		Uptr numBytesReadThisIO = 0;
+		if(!Platform::readFile(
+			   platformFile,
+			   memoryArrayPtr<U8>(process->memory, iovs[iovIndex].buf, iovs[iovIndex].buf_len),
+			   iovs[iovIndex].buf_len,
+			   &numBytesReadThisIO))
+		{
+			traceSyscallReturnf("fd_read", "EIO");
+			return __WASI_EIO;
+		}
+		numBytesRead += numBytesReadThisIO;
+
+		// Stop after a short read: reading the next buffer might block.
+		if(numBytesReadThisIO < iovs[iovIndex].buf_len) { break; }
+	}
+
+	if(numBytesRead > WASIADDRESS_MAX)
+	{
+		traceSyscallReturnf("fd_read", "EOVERFLOW");
+		return __WASI_EOVERFLOW;
+	}
+	memoryRef<WASIAddress>(process->memory, numBytesReadAddress) = WASIAddress(numBytesRead);
+
+	traceSyscallReturnf("fd_read", "ESUCCESS (numBytesRead=%" PRIu64 ")", numBytesRead);
+	return __WASI_ESUCCESS;
 }
 
 DEFINE_INTRINSIC_FUNCTION(wasi,
@@ -616,13 +869,19 @@ DEFINE_INTRINSIC_FUNCTION(wasi,
 
 	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
 
-	Platform::File* platformFile;
-	switch(fd)
+	Platform::File* platformFile = getFileFromFD(fd);
+	if(!platformFile)
 	{
-	case 0: platformFile = Platform::getStdFile(Platform::StdDevice::in); break;
-	case 1: platformFile = Platform::getStdFile(Platform::StdDevice::out); break;
-	case 2: platformFile = Platform::getStdFile(Platform::StdDevice::err); break;
-	default: traceSyscallReturnf("fd_write", "EBADF"); return __WASI_EBADF;
+		traceSyscallReturnf("fd_write", "EBADF");
+		return __WASI_EBADF;
+	}
+
+	// If the process runs on a worker, wait for the file to be writable, so writing it is unlikely
+	// to block the worker.
+	if(process->worker)
+	{
+		const Platform::FileWait wait = {platformFile, false, true};
+		waitForFiles(process, &wait, 1, UINT64_MAX);
 	}
 
 	const __wasi_ciovec_t* iovs
@@ -941,14 +1200,138 @@ DEFINE_INTRINSIC_FUNCTION(wasi,
 						  WASIAddress numSubscriptions,
 						  WASIAddress outNumEventsAddress)
 {
-	traceUnimplementedSyscall("poll_oneoff",
-							  "(" WASIADDRESS_FORMAT ", " WASIADDRESS_FORMAT
-							  ", %u, " WASIADDRESS_FORMAT ")",
-							  inAddress,
-							  outAddress,
-							  numSubscriptions,
-							  outNumEventsAddress);
-	return __WASI_ENOSYS;
+	traceSyscallf("poll_oneoff",
+				  "(" WASIADDRESS_FORMAT ", " WASIADDRESS_FORMAT ", %u, " WASIADDRESS_FORMAT ")",
+				  inAddress,
+				  outAddress,
+				  numSubscriptions,
+				  outNumEventsAddress);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	if(!numSubscriptions)
+	{
+		traceSyscallReturnf("poll_oneoff", "EINVAL");
+		return __WASI_EINVAL;
+	}
+
+	const __wasi_subscription_t* subscriptions
+		= memoryArrayPtr<__wasi_subscription_t>(process->memory, inAddress, numSubscriptions);
+	__wasi_event_t* events
+		= memoryArrayPtr<__wasi_event_t>(process->memory, outAddress, numSubscriptions);
+
+	// Translate the subscriptions to files to wait for, and times to wait until. Subscriptions that
+	// are invalid are reported as events with an error.
+	std::vector<Platform::FileWait> waits;
+	std::vector<__wasi_errno_t> subscriptionErrors(numSubscriptions, __WASI_ESUCCESS);
+	std::vector<U64> subscriptionUntilClocks(numSubscriptions, UINT64_MAX);
+	U64 untilClock = UINT64_MAX;
+	const U64 startClock = Platform::getMonotonicClock();
+	for(WASIAddress subscriptionIndex = 0; subscriptionIndex < numSubscriptions; ++subscriptionIndex)
+	{
+		const __wasi_subscription_t& subscription = subscriptions[subscriptionIndex];
+		switch(subscription.type)
+		{
+		case __WASI_EVENTTYPE_CLOCK:
+		{
+			Platform::Clock clock;
+			if(!getPlatformClock(subscription.u.clock.clock_id, clock))
+			{
+				subscriptionErrors[subscriptionIndex] = __WASI_EINVAL;
+				break;
+			}
+
+			// An absolute timeout is a time on the subscription's clock, which may not be the
+			// monotonic clock that the wait uses, so translate it to a relative timeout.
+			__wasi_timestamp_t timeout = subscription.u.clock.timeout;
+			if(subscription.u.clock.flags & __WASI_SUBSCRIPTION_CLOCK_ABSTIME)
+			{
+				__wasi_timestamp_t currentTime;
+				if(!Platform::getClockTime(clock, currentTime))
+				{
+					subscriptionErrors[subscriptionIndex] = __WASI_ENOTSUP;
+					break;
+				}
+				timeout = timeout > currentTime ? timeout - currentTime : 0;
+			}
+
+			// WASI timestamps are in nanoseconds, but the monotonic clock is in microseconds.
+			U64 subscriptionUntilClock = timeout / 1000 + (timeout % 1000 ? 1 : 0);
+			subscriptionUntilClock = subscriptionUntilClock > UINT64_MAX - startClock
+										 ? UINT64_MAX
+										 : startClock + subscriptionUntilClock;
+			subscriptionUntilClocks[subscriptionIndex] = subscriptionUntilClock;
+			if(subscriptionUntilClock < untilClock) { untilClock = subscriptionUntilClock; }
+			break;
+		}
+		case __WASI_EVENTTYPE_FD_READ:
+		case __WASI_EVENTTYPE_FD_WRITE:
+		{
+			Platform::File* platformFile = getFileFromFD(subscription.u.fd_readwrite.fd);
+			if(!platformFile) { subscriptionErrors[subscriptionIndex] = __WASI_EBADF; }
+			else
+			{
+				waits.push_back({platformFile,
+								 subscription.type == __WASI_EVENTTYPE_FD_READ,
+								 subscription.type == __WASI_EVENTTYPE_FD_WRITE});
+			}
+			break;
+		}
+		default: subscriptionErrors[subscriptionIndex] = __WASI_EINVAL; break;
+		};
+	}
+
+	// Check which subscriptions are ready without waiting, and wait until one of them may be ready
+	// if none are.
+	std::vector<Platform::FileReadiness> readiness(waits.size());
+	WASIAddress numEvents = 0;
+	while(true)
+	{
+		Platform::pollFiles(waits.data(), readiness.data(), waits.size(), 0);
+		const U64 currentClock = Platform::getMonotonicClock();
+
+		Uptr waitIndex = 0;
+		for(WASIAddress subscriptionIndex = 0; subscriptionIndex < numSubscriptions;
+			++subscriptionIndex)
+		{
+			const __wasi_subscription_t& subscription = subscriptions[subscriptionIndex];
+
+			bool isReady;
+			__wasi_errno_t error = subscriptionErrors[subscriptionIndex];
+			__wasi_eventrwflags_t flags = 0;
+			if(error != __WASI_ESUCCESS) { isReady = true; }
+			else if(subscription.type == __WASI_EVENTTYPE_CLOCK)
+			{
+				isReady = currentClock >= subscriptionUntilClocks[subscriptionIndex];
+			}
+			else
+			{
+				const Platform::FileReadiness& fileReadiness = readiness[waitIndex++];
+				isReady = fileReadiness.readable || fileReadiness.writable || fileReadiness.hangup
+						  || fileReadiness.error;
+				if(fileReadiness.hangup) { flags |= __WASI_EVENT_FD_READWRITE_HANGUP; }
+				if(fileReadiness.error) { error = __WASI_EIO; }
+			}
+
+			if(isReady)
+			{
+				__wasi_event_t& event = events[numEvents++];
+				event.userdata = subscription.userdata;
+				event.error = error;
+				event.type = subscription.type;
+				event.u.fd_readwrite.nbytes = 0;
+				event.u.fd_readwrite.flags = flags;
+			}
+		}
+
+		if(numEvents) { break; }
+		waitForFiles(process, waits.data(), waits.size(), untilClock);
+	}
+
+	memoryRef<WASIAddress>(process->memory, outNumEventsAddress) = numEvents;
+
+	traceSyscallReturnf("poll_oneoff", "ESUCCESS (numEvents=%u)", numEvents);
+	return __WASI_ESUCCESS;
 }
 
 DEFINE_INTRINSIC_FUNCTION(wasi, "proc_exit", void, wasi_proc_exit, __wasi_exitcode_t exitCode)
@@ -1031,6 +1414,17 @@ DEFINE_INTRINSIC_FUNCTION(wasi,
 
 DEFINE_INTRINSIC_FUNCTION(wasi, "sched_yield", __wasi_errno_t, wasi_sched_yield)
 {
-	traceUnimplementedSyscall("sched_yield", "()");
-	return __WASI_ENOSYS;
+	traceSyscallf("sched_yield", "()");
+
+	// If the process runs on a worker, let the worker run the other processes that are ready
+	// before resuming this one.
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+	if(process->worker)
+	{
+		process->worker->readyProcesses.push_back(process);
+		suspendCurrentFiber();
+	}
+
+	traceSyscallReturnf("sched_yield", "ESUCCESS");
+	return __WASI_ESUCCESS;
 }
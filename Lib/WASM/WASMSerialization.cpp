@@ -1,4 +1,10 @@
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -11,17 +17,27 @@
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/Lock.h"
 #include "WAVM/Inline/Serialization.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Inline/Unicode.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/WASM/WASM.h"
 
 using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Serialization;
 
+static Metrics::Histogram loadBinaryModuleMicroseconds(
+	"wavm_wasm_load_microseconds",
+	"Time taken to decode a binary WebAssembly module, in microseconds");
+
 static void throwIfNotValidUTF8(const std::string& string)
 {
 	const U8* endChar = (const U8*)string.data() + string.size();
@@ -315,7 +331,41 @@ namespace WAVM { namespace IR {
 		}
 	}
 
-	template<typename Stream> void serialize(Stream& stream, DataSegment& dataSegment)
+	static void serializeDataSegmentBytes(InputStream& stream,
+										  DataSegment& dataSegment,
+										  const std::shared_ptr<MappedModuleFile>& mappedFile)
+	{
+		if(!mappedFile) { serialize(stream, dataSegment.data); }
+		else
+		{
+			// If the module is being loaded from a mapped file, borrow the segment's bytes from the
+			// mapping instead of copying them.
+			Uptr numBytes = 0;
+			serializeVarUInt32(stream, numBytes);
+			const U8* bytes = stream.advance(numBytes);
+			wavmAssert(bytes >= mappedFile->bytes
+					   && bytes + numBytes <= mappedFile->bytes + mappedFile->numBytes);
+
+			dataSegment.data.clear();
+			dataSegment.mappedFile = mappedFile;
+			dataSegment.mappedFileOffset = Uptr(bytes - mappedFile->bytes);
+			dataSegment.numMappedBytes = numBytes;
+		}
+	}
+
+	static void serializeDataSegmentBytes(OutputStream& stream,
+										  DataSegment& dataSegment,
+										  const std::shared_ptr<MappedModuleFile>& mappedFile)
+	{
+		Uptr numBytes = dataSegment.getNumBytes();
+		serializeVarUInt32(stream, numBytes);
+		serializeBytes(stream, dataSegment.getBytes(), numBytes);
+	}
+
+	template<typename Stream>
+	void serialize(Stream& stream,
+				   DataSegment& dataSegment,
+				   const std::shared_ptr<MappedModuleFile>& mappedFile = nullptr)
 	{
 		if(Stream::isInput)
 		{
@@ -356,7 +406,7 @@ namespace WAVM { namespace IR {
 				serialize(stream, dataSegment.baseOffset);
 			}
 		}
-		serialize(stream, dataSegment.data);
+		serializeDataSegmentBytes(stream, dataSegment, mappedFile);
 	}
 }}
 
@@ -645,12 +695,14 @@ static void serialize(OutputStream& stream, UserSection& userSection)
 	serialize(stream, SectionType::user);
 	ArrayOutputStream sectionStream;
 	serialize(sectionStream, userSection.name);
-	serializeBytes(sectionStream, userSection.data.data(), userSection.data.size());
+	serializeBytes(sectionStream, userSection.getBytes(), userSection.getNumBytes());
 	std::vector<U8> sectionBytes = sectionStream.getBytes();
 	serialize(stream, sectionBytes);
 }
 
-static void serialize(InputStream& stream, UserSection& userSection)
+static void serialize(InputStream& stream,
+					  UserSection& userSection,
+					  const std::shared_ptr<MappedModuleFile>& mappedFile)
 {
 	Uptr numSectionBytes = 0;
 	serializeVarUInt32(stream, numSectionBytes);
@@ -658,8 +710,25 @@ static void serialize(InputStream& stream, UserSection& userSection)
 	MemoryInputStream sectionStream(stream.advance(numSectionBytes), numSectionBytes);
 	serialize(sectionStream, userSection.name);
 	throwIfNotValidUTF8(userSection.name);
-	userSection.data.resize(sectionStream.capacity());
-	serializeBytes(sectionStream, userSection.data.data(), userSection.data.size());
+
+	const Uptr numBytes = sectionStream.capacity();
+	if(!mappedFile)
+	{
+		userSection.data.resize(numBytes);
+		serializeBytes(sectionStream, userSection.data.data(), numBytes);
+	}
+	else
+	{
+		// If the module is being loaded from a mapped file, borrow the section's bytes from the
+		// mapping instead of copying them.
+		const U8* bytes = sectionStream.advance(numBytes);
+		wavmAssert(bytes >= mappedFile->bytes
+				   && bytes + numBytes <= mappedFile->bytes + mappedFile->numBytes);
+
+		userSection.mappedFile = mappedFile;
+		userSection.mappedFileOffset = Uptr(bytes - mappedFile->bytes);
+		userSection.numMappedBytes = numBytes;
+	}
 	wavmAssert(!sectionStream.capacity());
 }
 
@@ -734,7 +803,7 @@ static void serializeFunctionBody(OutputStream& sectionStream,
 	{ serialize(bodyStream, localSets[setIndex]); }
 
 	// Serialize the function code.
-	OperatorDecoderStream irDecoderStream(functionDef.code);
+	OperatorDecoderStream irDecoderStream(functionDef.code, module.operatorEncoding);
 	OperatorSerializerStream wasmOpEncoderStream(bodyStream, functionDef);
 	while(irDecoderStream) { irDecoderStream.decodeOp(wasmOpEncoderStream); };
 
@@ -742,15 +811,10 @@ static void serializeFunctionBody(OutputStream& sectionStream,
 	serialize(sectionStream, bodyBytes);
 }
 
-static void serializeFunctionBody(InputStream& sectionStream,
-								  Module& module,
-								  FunctionDef& functionDef)
+static void deserializeLocalSets(InputStream& bodyStream,
+								 const Module& module,
+								 FunctionDef& functionDef)
 {
-	Uptr numBodyBytes = 0;
-	serializeVarUInt32(sectionStream, numBodyBytes);
-
-	MemoryInputStream bodyStream(sectionStream.advance(numBodyBytes), numBodyBytes);
-
 	// Deserialize local sets and unpack them into a linear array of local types.
 	Uptr numLocalSets = 0;
 	serializeVarUInt32(bodyStream, numLocalSets);
@@ -763,11 +827,14 @@ static void serializeFunctionBody(InputStream& sectionStream,
 		for(Uptr index = 0; index < localSet.num; ++index)
 		{ functionDef.nonParameterLocalTypes.push_back(localSet.type); }
 	}
+}
 
-	// Deserialize the function code, validate it, and re-encode it in the IR format.
-	ArrayOutputStream irCodeByteStream;
-	OperatorEncoderStream irEncoderStream(irCodeByteStream);
-	CodeValidationStream codeValidationStream(module, functionDef);
+// Deserializes a function's code, and passes each operator to a stream.
+template<typename OperatorStream>
+static void deserializeOperators(InputStream& bodyStream,
+								 FunctionDef& functionDef,
+								 OperatorStream& operatorStream)
+{
 	while(bodyStream.capacity())
 	{
 		Opcode opcode;
@@ -779,8 +846,7 @@ static void serializeFunctionBody(InputStream& sectionStream,
 	{                                                                                              \
 		Imm imm;                                                                                   \
 		serialize(bodyStream, imm, functionDef);                                                   \
-		codeValidationStream.name(imm);                                                            \
-		irEncoderStream.name(imm);                                                                 \
+		operatorStream.name(imm);                                                                  \
 		break;                                                                                     \
 	}
 			ENUM_OPERATORS(VISIT_OPCODE)
@@ -788,11 +854,88 @@ static void serializeFunctionBody(InputStream& sectionStream,
 		default: throw FatalSerializationException("unknown opcode");
 		};
 	};
-	codeValidationStream.finish();
+}
+
+static void deserializeFunctionCode(InputStream& bodyStream,
+									const Module& module,
+									FunctionDef& functionDef)
+{
+	// Deserialize the function code, validate it, and re-encode it in the IR format.
+	ArrayOutputStream irCodeByteStream;
+	OperatorEncoderStream irEncoderStream(irCodeByteStream, module.operatorEncoding);
+	CodeValidationProxyStream<OperatorEncoderStream> codeValidationStream(
+		module, functionDef, irEncoderStream);
+	deserializeOperators(bodyStream, functionDef, codeValidationStream);
+	codeValidationStream.finishValidation();
 
 	functionDef.code = std::move(irCodeByteStream.getBytes());
 }
 
+static void deserializeFunctionBody(const U8* bodyBytes,
+									Uptr numBodyBytes,
+									const Module& module,
+									FunctionDef& functionDef)
+{
+	MemoryInputStream bodyStream(bodyBytes, numBodyBytes);
+	deserializeLocalSets(bodyStream, module, functionDef);
+	deserializeFunctionCode(bodyStream, module, functionDef);
+}
+
+// Deserializes a lazily loaded function body's local declarations, and records the range of its
+// code for decodeLazyFunctionCode. If validate is true, the code is also validated, but not
+// re-encoded in the IR format.
+static void deserializeLazyFunctionBody(const U8* bodyBytes,
+										Uptr numBodyBytes,
+										const Module& module,
+										FunctionDef& functionDef,
+										const U8* baseBytes,
+										bool validate)
+{
+	MemoryInputStream bodyStream(bodyBytes, numBodyBytes);
+	deserializeLocalSets(bodyStream, module, functionDef);
+
+	const Uptr numCodeBytes = bodyStream.capacity();
+	const U8* codeBytes = bodyStream.advance(numCodeBytes);
+	if(validate)
+	{
+		MemoryInputStream codeStream(codeBytes, numCodeBytes);
+		CodeValidationStream codeValidationStream(module, functionDef);
+		deserializeOperators(codeStream, functionDef, codeValidationStream);
+		codeValidationStream.finish();
+
+		// The branch tables are deserialized again when the code is materialized.
+		functionDef.branchTables.clear();
+	}
+
+	functionDef.isLazy.value.store(true, std::memory_order_relaxed);
+	functionDef.lazyCodeOffset = Uptr(codeBytes - baseBytes);
+	functionDef.numLazyCodeBytes = numCodeBytes;
+}
+
+// Decodes the code of a lazily loaded function body when it is materialized. The code was either
+// validated when the module was loaded, or trusted because the module had a matching validated
+// section, so it is only re-encoded in the IR format. It's a fatal error if the code is malformed,
+// since that means the validated section didn't describe the module accurately.
+static void decodeLazyFunctionCode(const Module& module,
+								   FunctionDef& functionDef,
+								   const U8* codeBytes,
+								   Uptr numCodeBytes)
+{
+	try
+	{
+		MemoryInputStream codeStream(codeBytes, numCodeBytes);
+		ArrayOutputStream irCodeByteStream;
+		OperatorEncoderStream irEncoderStream(irCodeByteStream, module.operatorEncoding);
+		deserializeOperators(codeStream, functionDef, irEncoderStream);
+		functionDef.code = std::move(irCodeByteStream.getBytes());
+	}
+	catch(FatalSerializationException const& exception)
+	{
+		Errors::fatalf("Error decoding a lazily loaded function body: %s",
+					   exception.message.c_str());
+	}
+}
+
 template<typename Stream> void serializeTypeSection(Stream& moduleStream, Module& module)
 {
 	serializeSection(moduleStream, SectionType::type, [&module](Stream& sectionStream) {
@@ -1009,9 +1152,244 @@ template<typename Stream> void serializeElementSection(Stream& moduleStream, Mod
 	});
 }
 
-static void serializeCodeSection(InputStream& moduleStream, Module& module)
+// The state shared by the threads that deserialize a module's function bodies in parallel.
+struct ParallelFunctionBodyDeserializer
+{
+	const Uptr numFunctionBodies;
+	const std::function<void(Uptr)>& deserializeFunctionBody;
+
+	std::atomic<Uptr> nextFunctionIndex{0};
+
+	// The exception thrown by the lowest-indexed function body that failed to deserialize. Only the
+	// lowest-indexed failure is kept, so the error is the same one the serial loader would report.
+	Platform::Mutex errorMutex;
+	std::atomic<Uptr> errorFunctionIndex{UINTPTR_MAX};
+	std::exception_ptr error;
+
+	ParallelFunctionBodyDeserializer(Uptr inNumFunctionBodies,
+									 const std::function<void(Uptr)>& inDeserializeFunctionBody)
+	: numFunctionBodies(inNumFunctionBodies), deserializeFunctionBody(inDeserializeFunctionBody)
+	{
+	}
+
+	void run()
+	{
+		while(true)
+		{
+			// Stop when there are no more function bodies, or when all the remaining function
+			// bodies come after one that failed to deserialize.
+			const Uptr functionIndex = nextFunctionIndex++;
+			if(functionIndex >= numFunctionBodies
+			   || functionIndex > errorFunctionIndex.load(std::memory_order_relaxed))
+			{ break; }
+
+			try
+			{
+				deserializeFunctionBody(functionIndex);
+			}
+			catch(...)
+			{
+				Lock<Platform::Mutex> errorLock(errorMutex);
+				if(functionIndex < errorFunctionIndex.load(std::memory_order_relaxed))
+				{
+					errorFunctionIndex.store(functionIndex, std::memory_order_relaxed);
+					error = std::current_exception();
+				}
+			}
+		}
+	}
+
+	static I64 threadEntry(void* deserializerVoid)
+	{
+		((ParallelFunctionBodyDeserializer*)deserializerVoid)->run();
+		return 0;
+	}
+};
+
+// Only deserialize the function bodies in parallel if there are at least this many bodies per
+// thread.
+static constexpr Uptr minFunctionBodiesPerThread = 16;
+
+// Calls deserializeFunctionBody for each function body index. If numDecodeThreads allows it and
+// there are enough function bodies, the calls are made on up to numDecodeThreads threads,
+// including this one. If any calls throw, rethrows the exception thrown for the lowest function
+// body index.
+static void deserializeFunctionBodies(Uptr numFunctionBodies,
+									  Uptr numDecodeThreads,
+									  const std::function<void(Uptr)>& deserializeFunctionBody)
+{
+	if(!numDecodeThreads) { numDecodeThreads = Platform::getNumberOfHardwareThreads(); }
+	const Uptr numThreads
+		= std::min(numDecodeThreads, numFunctionBodies / minFunctionBodiesPerThread);
+	if(numThreads <= 1)
+	{
+		for(Uptr functionIndex = 0; functionIndex < numFunctionBodies; ++functionIndex)
+		{ deserializeFunctionBody(functionIndex); }
+	}
+	else
+	{
+		ParallelFunctionBodyDeserializer deserializer(numFunctionBodies, deserializeFunctionBody);
+		std::vector<Platform::Thread*> threads;
+		for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+		{
+			threads.push_back(Platform::createThread(
+				1024 * 1024, ParallelFunctionBodyDeserializer::threadEntry, &deserializer));
+		}
+		deserializer.run();
+		for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+		if(deserializer.error) { std::rethrow_exception(deserializer.error); }
+	}
+}
+
+// An input stream that reads a bounded number of bytes from another stream. Unlike the
+// MemoryInputStream that serializeSection creates, the bytes aren't read from the other stream
+// until they are needed, so a section may be deserialized while the rest of it is still arriving.
+struct SubInputStream : InputStream
+{
+	SubInputStream(InputStream& inInner, Uptr numBytes)
+	: InputStream(nullptr, nullptr), inner(inInner), numUnreadInnerBytes(numBytes)
+	{
+	}
+
+	virtual Uptr capacity() const { return Uptr(end - next) + numUnreadInnerBytes; }
+
+private:
+	InputStream& inner;
+	Uptr numUnreadInnerBytes;
+	std::vector<U8> buffer;
+
+	virtual void getMoreData(Uptr numBytes)
+	{
+		const Uptr numBufferedBytes = Uptr(end - next);
+		wavmAssert(numBytes > numBufferedBytes);
+		const Uptr numNeededInnerBytes = numBytes - numBufferedBytes;
+		if(numNeededInnerBytes > numUnreadInnerBytes)
+		{ throw FatalSerializationException("expected data but found end of stream"); }
+		numUnreadInnerBytes -= numNeededInnerBytes;
+
+		if(!numBufferedBytes)
+		{
+			// If there are no buffered bytes, just point directly into the inner stream's buffer.
+			next = inner.advance(numNeededInnerBytes);
+			end = next + numNeededInnerBytes;
+		}
+		else
+		{
+			// Otherwise, copy the buffered bytes before reading more from the inner stream, which
+			// may invalidate them, and append the new bytes to them.
+			std::vector<U8> newBuffer(next, end);
+			newBuffer.resize(numBytes);
+			memcpy(newBuffer.data() + numBufferedBytes,
+				   inner.advance(numNeededInnerBytes),
+				   numNeededInnerBytes);
+			buffer = std::move(newBuffer);
+			next = buffer.data();
+			end = next + numBytes;
+		}
+	}
+};
+
+// Deserializes the code section one function body at a time from the module stream, calling the
+// streaming load callbacks as each function body is deserialized and validated.
+static void deserializeCodeSectionStreaming(InputStream& moduleStream,
+											Module& module,
+											WASM::StreamingLoadCallbacks& callbacks)
+{
+	Uptr numSectionBytes = 0;
+	serializeVarUInt32(moduleStream, numSectionBytes);
+	SubInputStream sectionStream(moduleStream, numSectionBytes);
+
+	Uptr numFunctionBodies = module.functions.defs.size();
+	serializeVarUInt32(sectionStream, numFunctionBodies);
+	if(numFunctionBodies != module.functions.defs.size())
+	{
+		throw FatalSerializationException(
+			"function and code sections have mismatched function counts");
+	}
+
+	callbacks.onCodeSectionStart(module);
+
+	for(Uptr functionIndex = 0; functionIndex < numFunctionBodies; ++functionIndex)
+	{
+		Uptr numBodyBytes = 0;
+		serializeVarUInt32(sectionStream, numBodyBytes);
+		const U8* bodyBytes = sectionStream.advance(numBodyBytes);
+		deserializeFunctionBody(
+			bodyBytes, numBodyBytes, module, module.functions.defs[functionIndex]);
+
+		callbacks.onFunctionDefLoaded(module, functionIndex);
+	}
+
+	if(sectionStream.capacity())
+	{ throw FatalSerializationException("section contained more data than expected"); }
+}
+
+// How the loader deserializes the code section's function bodies.
+enum class FunctionBodyLoading
+{
+	// Deserialize and validate each function body, and re-encode it in the IR format.
+	eager,
+
+	// Deserialize and validate each function body, but defer re-encoding it in the IR format until
+	// its function definition is materialized.
+	lazy,
+
+	// Defer deserializing each function body until its function definition is materialized, and
+	// trust that it is valid.
+	lazyTrusted
+};
+
+// Deserializes only the local declarations at the start of each function body, and defers
+// re-encoding the rest of each body in the IR format until its function definition is
+// materialized. Unless the loader trusts the module's code, it is still validated here, so
+// materializing a function definition can't fail.
+static void deserializeLazyFunctionBodies(Module& module,
+										  const std::shared_ptr<MappedModuleFile>& mappedFile,
+										  Uptr numFunctionBodies,
+										  const std::vector<const U8*>& bodyBytes,
+										  const std::vector<Uptr>& numBodyBytes,
+										  bool validate,
+										  Uptr numDecodeThreads)
+{
+	if(!numFunctionBodies) { return; }
+
+	// If the module is being loaded from a mapped file, borrow the code from the mapping. Otherwise,
+	// copy the function bodies, since the module may outlive the bytes it is loaded from.
+	const U8* baseBytes = nullptr;
+	std::vector<U8> ownedBytes;
+	if(mappedFile) { baseBytes = mappedFile->bytes; }
+	else
+	{
+		baseBytes = bodyBytes[0];
+		ownedBytes.assign(baseBytes,
+						  bodyBytes[numFunctionBodies - 1] + numBodyBytes[numFunctionBodies - 1]);
+	}
+
+	deserializeFunctionBodies(numFunctionBodies, numDecodeThreads, [&](Uptr functionIndex) {
+		wavmAssert(!mappedFile
+				   || (bodyBytes[functionIndex] >= mappedFile->bytes
+					   && bodyBytes[functionIndex] + numBodyBytes[functionIndex]
+							  <= mappedFile->bytes + mappedFile->numBytes));
+		deserializeLazyFunctionBody(bodyBytes[functionIndex],
+									numBodyBytes[functionIndex],
+									module,
+									module.functions.defs[functionIndex],
+									baseBytes,
+									validate);
+	});
+
+	module.lazyFunctionBodies = std::make_shared<LazyFunctionBodies>(
+		mappedFile, std::move(ownedBytes), decodeLazyFunctionCode);
+}
+
+static void serializeCodeSection(InputStream& moduleStream,
+								 Module& module,
+								 const std::shared_ptr<MappedModuleFile>& mappedFile,
+								 FunctionBodyLoading functionBodyLoading,
+								 Uptr numDecodeThreads)
 {
-	serializeSection(moduleStream, SectionType::code, [&module](InputStream& sectionStream) {
+	serializeSection(moduleStream, SectionType::code, [&](InputStream& sectionStream) {
 		Uptr numFunctionBodies = module.functions.defs.size();
 		serializeVarUInt32(sectionStream, numFunctionBodies);
 		if(numFunctionBodies != module.functions.defs.size())
@@ -1019,13 +1397,61 @@ static void serializeCodeSection(InputStream& moduleStream, Module& module)
 			throw FatalSerializationException(
 				"function and code sections have mismatched function counts");
 		}
-		for(FunctionDef& functionDef : module.functions.defs)
-		{ serializeFunctionBody(sectionStream, module, functionDef); }
+
+		// Find the bytes of each function body. Each body is prefixed by its size, and may be
+		// deserialized independently of the others. If the section is malformed, the bodies before
+		// the error are still deserialized, so an error in one of them takes precedence just as it
+		// would if the bodies were deserialized while scanning.
+		std::vector<const U8*> bodyBytes(numFunctionBodies);
+		std::vector<Uptr> numBodyBytes(numFunctionBodies);
+		Uptr numScannedFunctionBodies = 0;
+		std::exception_ptr scanError;
+		try
+		{
+			for(; numScannedFunctionBodies < numFunctionBodies; ++numScannedFunctionBodies)
+			{
+				Uptr& numBytes = numBodyBytes[numScannedFunctionBodies];
+				serializeVarUInt32(sectionStream, numBytes);
+				bodyBytes[numScannedFunctionBodies] = sectionStream.advance(numBytes);
+			}
+		}
+		catch(FatalSerializationException const&)
+		{
+			scanError = std::current_exception();
+		}
+
+		switch(functionBodyLoading)
+		{
+		case FunctionBodyLoading::eager:
+			deserializeFunctionBodies(
+				numScannedFunctionBodies, numDecodeThreads, [&](Uptr functionIndex) {
+					deserializeFunctionBody(bodyBytes[functionIndex],
+											numBodyBytes[functionIndex],
+											module,
+											module.functions.defs[functionIndex]);
+				});
+			break;
+		case FunctionBodyLoading::lazy:
+		case FunctionBodyLoading::lazyTrusted:
+			deserializeLazyFunctionBodies(module,
+										  mappedFile,
+										  numScannedFunctionBodies,
+										  bodyBytes,
+										  numBodyBytes,
+										  functionBodyLoading == FunctionBodyLoading::lazy,
+										  numDecodeThreads);
+			break;
+		default: Errors::unreachable();
+		};
+
+		if(scanError) { std::rethrow_exception(scanError); }
 	});
 }
 
 void serializeCodeSection(OutputStream& moduleStream, Module& module)
 {
+	IR::materializeFunctionDefs(module);
+
 	serializeSection(moduleStream, SectionType::code, [&module](OutputStream& sectionStream) {
 		Uptr numFunctionBodies = module.functions.defs.size();
 		serializeVarUInt32(sectionStream, numFunctionBodies);
@@ -1051,11 +1477,14 @@ template<typename Stream> void serializeDataCountSection(Stream& moduleStream, M
 	});
 }
 
-void serializeDataSection(InputStream& moduleStream, Module& module, bool hadDataCountSection)
+void serializeDataSection(InputStream& moduleStream,
+						  Module& module,
+						  bool hadDataCountSection,
+						  const std::shared_ptr<MappedModuleFile>& mappedFile)
 {
 	serializeSection(moduleStream,
 					 SectionType::data,
-					 [&module, hadDataCountSection](InputStream& sectionStream) {
+					 [&module, hadDataCountSection, &mappedFile](InputStream& sectionStream) {
 						 Uptr numDataSegments = 0;
 						 serializeVarUInt32(sectionStream, numDataSegments);
 						 if(!hadDataCountSection)
@@ -1074,7 +1503,10 @@ void serializeDataSection(InputStream& moduleStream, Module& module, bool hadDat
 						 }
 						 for(Uptr segmentIndex = 0; segmentIndex < module.dataSegments.size();
 							 ++segmentIndex)
-						 { serialize(sectionStream, module.dataSegments[segmentIndex]); }
+						 {
+							 serialize(
+								 sectionStream, module.dataSegments[segmentIndex], mappedFile);
+						 }
 					 });
 }
 
@@ -1111,7 +1543,12 @@ static void serializeModule(OutputStream& moduleStream, Module& module)
 	for(auto& userSection : module.userSections) { serialize(moduleStream, userSection); }
 }
 
-static void serializeModule(InputStream& moduleStream, Module& module)
+static void serializeModule(InputStream& moduleStream,
+							Module& module,
+							const std::shared_ptr<MappedModuleFile>& mappedFile,
+							WASM::StreamingLoadCallbacks* callbacks,
+							FunctionBodyLoading functionBodyLoading,
+							Uptr numDecodeThreads)
 {
 	serializeConstant(moduleStream, "magic number", U32(magicNumber));
 	serializeConstant(moduleStream, "version", U32(currentVersion));
@@ -1181,11 +1618,16 @@ static void serializeModule(InputStream& moduleStream, Module& module)
 			hadDataCountSection = true;
 			break;
 		case SectionType::code:
-			serializeCodeSection(moduleStream, module);
+			if(callbacks) { deserializeCodeSectionStreaming(moduleStream, module, *callbacks); }
+			else
+			{
+				serializeCodeSection(
+					moduleStream, module, mappedFile, functionBodyLoading, numDecodeThreads);
+			}
 			hadFunctionDefinitions = true;
 			break;
 		case SectionType::data:
-			serializeDataSection(moduleStream, module, hadDataCountSection);
+			serializeDataSection(moduleStream, module, hadDataCountSection, mappedFile);
 			hadDataSection = true;
 			IR::validateDataSegments(module);
 			break;
@@ -1193,7 +1635,7 @@ static void serializeModule(InputStream& moduleStream, Module& module)
 		{
 			UserSection& userSection
 				= *module.userSections.insert(module.userSections.end(), UserSection());
-			serialize(moduleStream, userSection);
+			serialize(moduleStream, userSection, mappedFile);
 			break;
 		}
 		default: throw FatalSerializationException("unknown section ID");
@@ -1217,27 +1659,123 @@ static void serializeModule(InputStream& moduleStream, Module& module)
 
 void WASM::serialize(Serialization::InputStream& stream, Module& module)
 {
-	serializeModule(stream, module);
+	serializeModule(stream, module, nullptr, nullptr, FunctionBodyLoading::eager, 1);
 }
 void WASM::serialize(Serialization::OutputStream& stream, const Module& module)
 {
 	serializeModule(stream, const_cast<Module&>(module));
 }
 
-bool WASM::loadBinaryModule(const void* wasmBytes,
-							Uptr numBytes,
-							IR::Module& outModule,
-							Log::Category errorCategory)
+// The name of the user section that wavm-compile adds to modules it has validated, and the seed for
+// the hash of the module's other sections it contains. Changing the way the hash is computed should
+// also change the seed, so sections written by an older version won't match.
+static const char* const validatedSectionName = "wavm.validated";
+static constexpr U64 validatedSectionHashSeed = 1;
+
+// Computes a hash of the contents of all a binary module's sections other than user sections, and
+// finds the hash recorded in its validated section if it has one. Only the section headers are
+// decoded, so this doesn't check whether the module is well-formed, but may throw
+// FatalSerializationException if the section headers are malformed.
+static U64 hashNonUserSections(const U8* wasmBytes,
+							   Uptr numBytes,
+							   bool& outHasValidatedSection,
+							   U64& outValidatedSectionHash)
+{
+	MemoryInputStream stream(wasmBytes, numBytes);
+	serializeConstant(stream, "magic number", U32(magicNumber));
+	serializeConstant(stream, "version", U32(currentVersion));
+
+	U64 hash = validatedSectionHashSeed;
+	outHasValidatedSection = false;
+	while(stream.capacity())
+	{
+		U8 sectionId = 0;
+		serialize(stream, sectionId);
+		Uptr numSectionBytes = 0;
+		serializeVarUInt32(stream, numSectionBytes);
+		const U8* sectionBytes = stream.advance(numSectionBytes);
+
+		if(sectionId != 0)
+		{
+			hash = XXH<U64>(&sectionId, sizeof(sectionId), hash);
+			hash = XXH<U64>(sectionBytes, numSectionBytes, hash);
+		}
+		else
+		{
+			MemoryInputStream sectionStream(sectionBytes, numSectionBytes);
+			std::string name;
+			serialize(sectionStream, name);
+			if(name == validatedSectionName && sectionStream.capacity() == sizeof(U64))
+			{
+				outHasValidatedSection = true;
+				memcpy(&outValidatedSectionHash, sectionStream.advance(sizeof(U64)), sizeof(U64));
+			}
+		}
+	}
+	return hash;
+}
+
+// Returns true if a binary module has a validated section that matches the module's contents.
+static bool hasMatchingValidatedSection(const U8* wasmBytes, Uptr numBytes)
 {
-	// Load the module from a binary WebAssembly file.
 	try
 	{
-		Timing::Timer loadTimer;
+		bool hasValidatedSection = false;
+		U64 validatedSectionHash = 0;
+		const U64 hash
+			= hashNonUserSections(wasmBytes, numBytes, hasValidatedSection, validatedSectionHash);
+		return hasValidatedSection && hash == validatedSectionHash;
+	}
+	catch(FatalSerializationException const&)
+	{
+		return false;
+	}
+}
 
-		Serialization::MemoryInputStream stream((const U8*)wasmBytes, numBytes);
-		WASM::serialize(stream, outModule);
+void WASM::addUserSection(std::vector<U8>& wasmBytes,
+						  const std::string& name,
+						  const std::vector<U8>& data)
+{
+	ArrayOutputStream sectionStream;
+	std::string nameCopy = name;
+	serialize(sectionStream, nameCopy);
+	serializeBytes(sectionStream, data.data(), data.size());
+	std::vector<U8> sectionBytes = sectionStream.getBytes();
 
-		Timing::logRatePerSecond("Loaded WASM", loadTimer, numBytes / 1024.0 / 1024.0, "MB");
+	ArrayOutputStream stream;
+	serialize(stream, SectionType::user);
+	serialize(stream, sectionBytes);
+	const std::vector<U8> sectionWithHeaderBytes = stream.getBytes();
+	wasmBytes.insert(wasmBytes.end(), sectionWithHeaderBytes.begin(), sectionWithHeaderBytes.end());
+}
+
+void WASM::addValidatedSection(std::vector<U8>& wasmBytes)
+{
+	bool hasValidatedSection = false;
+	U64 validatedSectionHash = 0;
+	U64 hash = hashNonUserSections(
+		wasmBytes.data(), wasmBytes.size(), hasValidatedSection, validatedSectionHash);
+	errorUnless(!hasValidatedSection);
+
+	ArrayOutputStream hashStream;
+	serializeNativeValue(hashStream, hash);
+	addUserSection(wasmBytes, validatedSectionName, hashStream.getBytes());
+}
+
+// Loads a module from a stream, catching any exceptions that indicate the module is malformed or
+// invalid.
+static bool loadBinaryModuleImpl(InputStream& stream,
+								 IR::Module& outModule,
+								 Log::Category errorCategory,
+								 const std::shared_ptr<MappedModuleFile>& mappedFile,
+								 WASM::StreamingLoadCallbacks* callbacks,
+								 FunctionBodyLoading functionBodyLoading,
+								 Uptr numDecodeThreads)
+{
+	try
+	{
+		serializeModule(
+			stream, outModule, mappedFile, callbacks, functionBodyLoading, numDecodeThreads);
 		return true;
 	}
 	catch(Serialization::FatalSerializationException const& exception)
@@ -1260,3 +1798,116 @@ bool WASM::loadBinaryModule(const void* wasmBytes,
 		return false;
 	}
 }
+
+static bool loadBinaryModuleImpl(const U8* wasmBytes,
+								 Uptr numBytes,
+								 IR::Module& outModule,
+								 Log::Category errorCategory,
+								 const std::shared_ptr<MappedModuleFile>& mappedFile,
+								 FunctionBodyLoading functionBodyLoading,
+								 Uptr numDecodeThreads)
+{
+	// Load the module from a binary WebAssembly file.
+	Timing::Timer loadTimer;
+	Serialization::MemoryInputStream stream(wasmBytes, numBytes);
+	if(!loadBinaryModuleImpl(stream,
+							 outModule,
+							 errorCategory,
+							 mappedFile,
+							 nullptr,
+							 functionBodyLoading,
+							 numDecodeThreads))
+	{ return false; }
+
+	loadBinaryModuleMicroseconds.record(loadTimer.getMicroseconds());
+	Timing::logRatePerSecond("Loaded WASM", loadTimer, numBytes / 1024.0 / 1024.0, "MB");
+	return true;
+}
+
+// Decides how to load a binary module's function bodies. Function bodies are only trusted to be
+// valid if the caller asked to load them lazily if the module has a matching validated section.
+static FunctionBodyLoading getFunctionBodyLoading(const U8* wasmBytes,
+												  Uptr numBytes,
+												  WASM::FunctionBodyDecoding functionBodyDecoding)
+{
+	switch(functionBodyDecoding)
+	{
+	case WASM::FunctionBodyDecoding::eager: return FunctionBodyLoading::eager;
+	case WASM::FunctionBodyDecoding::lazy: return FunctionBodyLoading::lazy;
+	case WASM::FunctionBodyDecoding::lazyIfValidated:
+		return hasMatchingValidatedSection(wasmBytes, numBytes) ? FunctionBodyLoading::lazyTrusted
+																: FunctionBodyLoading::eager;
+	default: Errors::unreachable();
+	};
+}
+
+bool WASM::loadBinaryModule(const void* wasmBytes,
+							Uptr numBytes,
+							IR::Module& outModule,
+							Log::Category errorCategory,
+							FunctionBodyDecoding functionBodyDecoding,
+							Uptr numDecodeThreads)
+{
+	return loadBinaryModuleImpl(
+		(const U8*)wasmBytes,
+		numBytes,
+		outModule,
+		errorCategory,
+		nullptr,
+		getFunctionBodyLoading((const U8*)wasmBytes, numBytes, functionBodyDecoding),
+		numDecodeThreads);
+}
+
+bool WASM::loadBinaryModuleFromFile(const char* filename,
+									IR::Module& outModule,
+									Log::Category errorCategory,
+									FunctionBodyDecoding functionBodyDecoding,
+									Uptr numDecodeThreads,
+									bool mapDataSegments)
+{
+	Platform::File* file = Platform::openFile(
+		filename, Platform::FileAccessMode::readOnly, Platform::FileCreateMode::openExisting);
+	if(!file)
+	{
+		Log::printf(errorCategory, "Couldn't read %s: couldn't open file.\n", filename);
+		return false;
+	}
+
+	Uptr numFileBytes = 0;
+	const U8* fileBytes = Platform::mapFile(file, numFileBytes);
+	if(!fileBytes)
+	{
+		Log::printf(errorCategory, "Couldn't read %s: couldn't map file.\n", filename);
+		errorUnless(Platform::closeFile(file));
+		return false;
+	}
+
+	// The MappedModuleFile takes ownership of the file and mapping, and will be kept alive by any
+	// data segments, user sections, or lazy function bodies in the loaded module that borrow bytes
+	// from it.
+	auto mappedFile
+		= std::make_shared<MappedModuleFile>(file, fileBytes, numFileBytes, mapDataSegments);
+	return loadBinaryModuleImpl(fileBytes,
+								numFileBytes,
+								outModule,
+								errorCategory,
+								mappedFile,
+								getFunctionBodyLoading(
+									fileBytes, numFileBytes, functionBodyDecoding),
+								numDecodeThreads);
+}
+
+bool WASM::loadBinaryModule(Serialization::InputStream& stream,
+							IR::Module& outModule,
+							StreamingLoadCallbacks* callbacks,
+							Log::Category errorCategory)
+{
+	Timing::Timer loadTimer;
+	if(!loadBinaryModuleImpl(
+		   stream, outModule, errorCategory, nullptr, callbacks, FunctionBodyLoading::eager, 1))
+	{ return false; }
+
+	loadBinaryModuleMicroseconds.record(loadTimer.getMicroseconds());
+	Timing::logTimer("Loaded WASM", loadTimer);
+	return true;
+}
@@ -0,0 +1,268 @@
+// Builds the lexer's DFA from the token regular expressions and literal strings, and writes its
+// tables to a C++ header that is compiled into the WASTParse component. This avoids building the
+// NFA and converting it to a DFA every time a process first lexes a WAST file.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "Lexer.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/NFA/NFA.h"
+#include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/RegExp/RegExp.h"
+
+#define DUMP_NFA_GRAPH 0
+#define DUMP_DFA_GRAPH 0
+
+using namespace WAVM;
+using namespace WAVM::WAST;
+
+// The generator is only linked with the NFA and RegExp components, so it doesn't depend on the
+// WAVM library it generates code for, or on the platform-specific code in the Platform component.
+// These are the only Logging and Platform functions that the NFA and RegExp components use.
+void Log::printf(Category category, const char* format, ...)
+{
+	if(category == Log::error)
+	{
+		va_list varArgs;
+		va_start(varArgs, format);
+		vfprintf(stderr, format, varArgs);
+		va_end(varArgs);
+	}
+}
+
+void Platform::handleAssertionFailure(const AssertMetadata& metadata)
+{
+	fprintf(stderr,
+			"%s(%u): Assertion failed: %s\n",
+			metadata.file,
+			metadata.line,
+			metadata.condition);
+}
+
+void Platform::handleFatalError(const char* messageFormat, bool printCallStack, va_list varArgs)
+{
+	vfprintf(stderr, messageFormat, varArgs);
+	fputc('\n', stderr);
+	abort();
+}
+
+static bool saveFile(const char* filename, const std::string& contents)
+{
+	FILE* file = fopen(filename, "wb");
+	if(!file) { return false; }
+	const bool wroteContents = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	return !fclose(file) && wroteContents;
+}
+
+static NFA::StateIndex createTokenSeparatorPeekState(NFA::Builder* builder,
+													 NFA::StateIndex finalState)
+{
+	NFA::CharSet tokenSeparatorCharSet;
+	tokenSeparatorCharSet.add(U8(' '));
+	tokenSeparatorCharSet.add(U8('\t'));
+	tokenSeparatorCharSet.add(U8('\r'));
+	tokenSeparatorCharSet.add(U8('\n'));
+	tokenSeparatorCharSet.add(U8('='));
+	tokenSeparatorCharSet.add(U8('('));
+	tokenSeparatorCharSet.add(U8(')'));
+	tokenSeparatorCharSet.add(U8(';'));
+	tokenSeparatorCharSet.add(0);
+	auto separatorState = addState(builder);
+	NFA::addEdge(builder,
+				 separatorState,
+				 tokenSeparatorCharSet,
+				 finalState | NFA::edgeDoesntConsumeInputFlag);
+	return separatorState;
+}
+
+static void addLiteralStringToNFA(const char* string,
+								  NFA::Builder* builder,
+								  NFA::StateIndex initialState,
+								  NFA::StateIndex finalState)
+{
+	// Add the literal to the NFA, one character at a time, reusing existing states that are
+	// reachable by the same string.
+	for(const char* nextChar = string; *nextChar; ++nextChar)
+	{
+		NFA::StateIndex nextState = NFA::getNonTerminalEdge(builder, initialState, *nextChar);
+		if(nextState < 0 || nextChar[1] == 0)
+		{
+			nextState = nextChar[1] == 0 ? finalState : addState(builder);
+			NFA::addEdge(builder, initialState, NFA::CharSet(*nextChar), nextState);
+		}
+		initialState = nextState;
+	}
+}
+
+static void addLiteralTokenToNFA(const char* literalString,
+								 NFA::Builder* builder,
+								 TokenType tokenType,
+								 bool isTokenSeparator)
+{
+	NFA::StateIndex finalState = NFA::maximumTerminalStateIndex - (NFA::StateIndex)tokenType;
+	if(!isTokenSeparator) { finalState = createTokenSeparatorPeekState(builder, finalState); }
+
+	addLiteralStringToNFA(literalString, builder, 0, finalState);
+}
+
+static NFA::Machine buildLexerMachine(bool allowLegacyOperatorNames)
+{
+// Legacy aliases for tokens.
+// clang-format off
+#define ENUM_LEGACY_TOKEN_ALIASES(v)                        \
+	v(funcref                 , "anyfunc"                 ) \
+															\
+	v(local_get               , "get_local"               ) \
+	v(local_set               , "set_local"               ) \
+	v(local_tee               , "tee_local"               ) \
+	v(global_get              , "get_global"              ) \
+	v(global_set              , "set_global"              ) \
+															\
+	v(i32_wrap_i64            , "i32.wrap/i64"            ) \
+	v(i32_trunc_f32_s         , "i32.trunc_s/f32"         ) \
+	v(i32_trunc_f32_u         , "i32.trunc_u/f32"         ) \
+	v(i32_trunc_f64_s         , "i32.trunc_s/f64"         ) \
+	v(i32_trunc_f64_u         , "i32.trunc_u/f64"         ) \
+	v(i64_extend_i32_s        , "i64.extend_s/i32"        ) \
+	v(i64_extend_i32_u        , "i64.extend_u/i32"        ) \
+	v(i64_trunc_f32_s         , "i64.trunc_s/f32"         ) \
+	v(i64_trunc_f32_u         , "i64.trunc_u/f32"         ) \
+	v(i64_trunc_f64_s         , "i64.trunc_s/f64"         ) \
+	v(i64_trunc_f64_u         , "i64.trunc_u/f64"         ) \
+	v(f32_convert_i32_s       , "f32.convert_s/i32"       ) \
+	v(f32_convert_i32_u       , "f32.convert_u/i32"       ) \
+	v(f32_convert_i64_s       , "f32.convert_s/i64"       ) \
+	v(f32_convert_i64_u       , "f32.convert_u/i64"       ) \
+	v(f32_demote_f64          , "f32.demote/f64"          ) \
+	v(f64_convert_i32_s       , "f64.convert_s/i32"       ) \
+	v(f64_convert_i32_u       , "f64.convert_u/i32"       ) \
+	v(f64_convert_i64_s       , "f64.convert_s/i64"       ) \
+	v(f64_convert_i64_u       , "f64.convert_u/i64"       ) \
+	v(f64_promote_f32         , "f64.promote/f32"         ) \
+	v(i32_reinterpret_f32     , "i32.reinterpret/f32"     ) \
+	v(i64_reinterpret_f64     , "i64.reinterpret/f64"     ) \
+	v(f32_reinterpret_i32     , "f32.reinterpret/i32"     ) \
+	v(f64_reinterpret_i64     , "f64.reinterpret/i64"     )
+
+static const std::pair<TokenType, const char*> regexpTokenPairs[] = {
+	{t_decimalInt, "[+\\-]?\\d+(_\\d+)*"},
+	{t_decimalFloat, "[+\\-]?\\d+(_\\d+)*\\.(\\d+(_\\d+)*)*([eE][+\\-]?\\d+(_\\d+)*)?"},
+	{t_decimalFloat, "[+\\-]?\\d+(_\\d+)*[eE][+\\-]?\\d+(_\\d+)*"},
+
+	{t_hexInt, "[+\\-]?0[xX][\\da-fA-F]+(_[\\da-fA-F]+)*"},
+	{t_hexFloat, "[+\\-]?0[xX][\\da-fA-F]+(_[\\da-fA-F]+)*\\.([\\da-fA-F]+(_[\\da-fA-F]+)*)*([pP][+\\-]?\\d+(_\\d+)*)?"},
+	{t_hexFloat, "[+\\-]?0[xX][\\da-fA-F]+(_[\\da-fA-F]+)*[pP][+\\-]?\\d+(_\\d+)*"},
+
+	{t_floatNaN, "[+\\-]?nan(:0[xX][\\da-fA-F]+(_[\\da-fA-F]+)*)?"},
+	{t_floatInf, "[+\\-]?inf"},
+
+	{t_string, "\"([^\"\n\\\\]*(\\\\([^0-9a-fA-Fu]|[0-9a-fA-F][0-9a-fA-F]|u\\{[0-9a-fA-F]+})))*\""},
+
+	{t_name, "\\$[a-zA-Z0-9\'_+*/~=<>!?@#$%&|:`.\\-\\^\\\\]+"},
+	{t_quotedName, "\\$\"([^\"\n\\\\]*(\\\\([^0-9a-fA-Fu]|[0-9a-fA-F][0-9a-fA-F]|u\\{[0-9a-fA-F]+})))*\""},
+};
+
+static const std::tuple<TokenType, const char*, bool> literalTokenTuples[] = {
+	std::make_tuple(t_leftParenthesis, "(", true),
+	std::make_tuple(t_rightParenthesis, ")", true),
+	std::make_tuple(t_equals, "=", true),
+
+	#define VISIT_TOKEN(name, _, literalString) std::make_tuple(t_##name, literalString, false),
+	ENUM_LITERAL_TOKENS()
+	#undef VISIT_TOKEN
+
+	#undef VISIT_OPERATOR_TOKEN
+	#define VISIT_OPERATOR_TOKEN(_, name, nameString, ...) std::make_tuple(t_##name, nameString, false),
+	ENUM_OPERATORS(VISIT_OPERATOR_TOKEN)
+	#undef VISIT_OPERATOR_TOKEN
+};
+
+static const std::tuple<TokenType, const char*> legacyOperatorAliasTuples[] = {
+	#undef VISIT_LEGACY_OPERATOR_ALIAS
+	#define VISIT_LEGACY_OPERATOR_ALIAS(name, aliasString) std::make_tuple(t_##name, aliasString),
+	ENUM_LEGACY_TOKEN_ALIASES(VISIT_LEGACY_OPERATOR_ALIAS)
+	#undef VISIT_LEGACY_OPERATOR_ALIAS
+};
+	// clang-format on
+
+	NFA::Builder* nfaBuilder = NFA::createBuilder();
+
+	for(auto regexpTokenPair : regexpTokenPairs)
+	{
+		NFA::StateIndex finalState
+			= NFA::maximumTerminalStateIndex - (NFA::StateIndex)regexpTokenPair.first;
+		finalState = createTokenSeparatorPeekState(nfaBuilder, finalState);
+		RegExp::addToNFA(regexpTokenPair.second, nfaBuilder, 0, finalState);
+	}
+
+	for(auto literalTokenTuple : literalTokenTuples)
+	{
+		const TokenType tokenType = std::get<0>(literalTokenTuple);
+		const char* literalString = std::get<1>(literalTokenTuple);
+		const bool isTokenSeparator = std::get<2>(literalTokenTuple);
+		addLiteralTokenToNFA(literalString, nfaBuilder, tokenType, isTokenSeparator);
+	}
+
+	if(allowLegacyOperatorNames)
+	{
+		for(auto legacyOperatorAliasTuple : legacyOperatorAliasTuples)
+		{
+			const TokenType tokenType = std::get<0>(legacyOperatorAliasTuple);
+			const char* literalString = std::get<1>(legacyOperatorAliasTuple);
+			addLiteralTokenToNFA(literalString, nfaBuilder, tokenType, false);
+		}
+	}
+
+	if(DUMP_NFA_GRAPH)
+	{
+		std::string nfaGraphVizString = NFA::dumpNFAGraphViz(nfaBuilder);
+		errorUnless(saveFile("nfaGraph.dot", nfaGraphVizString));
+	}
+
+	NFA::Machine nfaMachine(nfaBuilder);
+
+	if(DUMP_DFA_GRAPH)
+	{
+		std::string dfaGraphVizString = nfaMachine.dumpDFAGraphViz().c_str();
+		errorUnless(saveFile("dfaGraph.dot", dfaGraphVizString));
+	}
+
+	return nfaMachine;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc != 2)
+	{
+		Log::printf(Log::error, "Usage: GenerateLexerTables <output header>\n");
+		return EXIT_FAILURE;
+	}
+
+	const NFA::Machine nfaMachine = buildLexerMachine(false);
+	const NFA::Machine legacyNFAMachine = buildLexerMachine(true);
+
+	std::string header;
+	header += "// Generated by GenerateLexerTables.cpp: do not edit.\n";
+	header += "#pragma once\n";
+	header += "\n";
+	header += "#include \"WAVM/Inline/BasicTypes.h\"\n";
+	header += "\n";
+	header += nfaMachine.dumpCPPTables("lexer");
+	header += "\n";
+	header += legacyNFAMachine.dumpCPPTables("legacyLexer");
+
+	if(!saveFile(argv[1], header))
+	{
+		Log::printf(Log::error, "Couldn't write %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
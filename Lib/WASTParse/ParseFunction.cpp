@@ -47,7 +47,7 @@ namespace WAVM { namespace WAST {
 		, numLocals(inFunctionDef.nonParameterLocalTypes.size()
 					+ moduleState->module.types[inFunctionDef.type.index].params().size())
 		, branchTargetDepth(0)
-		, operationEncoder(codeByteStream)
+		, operationEncoder(codeByteStream, moduleState->module.operatorEncoding)
 		, validatingCodeStream(moduleState->module, functionDef, operationEncoder)
 		{
 		}
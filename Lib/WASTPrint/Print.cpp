@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 #include <algorithm>
 #include <memory>
 #include <string>
@@ -101,26 +102,37 @@ static bool hasNonNameChars(const std::string& name)
 	return false;
 }
 
-static std::string expandIndentation(std::string&& inString, U8 spacesPerIndentLevel = 2)
+// Expands the INDENT_STRING and DEDENT_STRING markers in a chunk of printed text, and writes the
+// result to a stream. indentDepth is the indentation depth at the start of the chunk, and is
+// updated to the depth at the end of it, so a text may be expanded in multiple chunks as long as
+// the markers aren't split between chunks.
+static void expandIndentation(const std::string& chunk,
+							  Uptr& indentDepth,
+							  OutputStream& stream,
+							  U8 spacesPerIndentLevel = 2)
 {
-	std::string paddedInput = std::move(inString);
-	paddedInput += '\0';
-
-	std::string result;
-	result.reserve(paddedInput.size() * 2);
-	const char* next = paddedInput.data();
-	const char* end = paddedInput.data() + paddedInput.size() - 1;
-	Uptr indentDepth = 0;
+	const char* next = chunk.data();
+	const char* end = chunk.data() + chunk.size();
 	while(next < end)
 	{
+		// Copy the characters up to the next marker or newline to the stream.
+		const char* runEnd = next;
+		while(runEnd < end && *runEnd != INDENT_STRING[0] && *runEnd != '\n') { ++runEnd; };
+		if(runEnd != next)
+		{
+			memcpy(stream.advance(runEnd - next), next, runEnd - next);
+			next = runEnd;
+			continue;
+		}
+
 		// Absorb INDENT_STRING and DEDENT_STRING, but keep track of the indentation depth, and
 		// insert a proportional number of spaces following newlines.
-		if(next[0] == INDENT_STRING[0] && next[1] == INDENT_STRING[1])
+		if(next + 1 < end && next[0] == INDENT_STRING[0] && next[1] == INDENT_STRING[1])
 		{
 			++indentDepth;
 			next += 2;
 		}
-		else if(next[0] == DEDENT_STRING[0] && next[1] == DEDENT_STRING[1])
+		else if(next + 1 < end && next[0] == DEDENT_STRING[0] && next[1] == DEDENT_STRING[1])
 		{
 			errorUnless(indentDepth > 0);
 			--indentDepth;
@@ -128,16 +140,17 @@ static std::string expandIndentation(std::string&& inString, U8 spacesPerIndentL
 		}
 		else if(*next == '\n')
 		{
-			result += '\n';
-			result.insert(result.end(), indentDepth * spacesPerIndentLevel, ' ');
+			const Uptr numSpaces = indentDepth * spacesPerIndentLevel;
+			U8* newline = stream.advance(1 + numSpaces);
+			newline[0] = '\n';
+			memset(newline + 1, ' ', numSpaces);
 			++next;
 		}
 		else
 		{
-			result += *next++;
+			*stream.advance(1) = U8(*next++);
 		}
 	}
-	return result;
 }
 
 struct ScopedTagPrinter
@@ -282,12 +295,17 @@ private:
 struct ModulePrintContext
 {
 	const Module& module;
-	std::string& string;
+	OutputStream& stream;
+
+	// The text that has been printed but not yet written to the stream, with INDENT_STRING and
+	// DEDENT_STRING markers instead of the spaces after each newline.
+	std::string string;
+	Uptr indentDepth;
 
 	DisassemblyNames names;
 
-	ModulePrintContext(const Module& inModule, std::string& inString)
-	: module(inModule), string(inString)
+	ModulePrintContext(const Module& inModule, OutputStream& inStream)
+	: module(inModule), stream(inStream), indentDepth(0)
 	{
 		// Start with the names from the module's user name section, but make sure they are unique,
 		// and add the "$" sigil.
@@ -313,9 +331,28 @@ struct ModulePrintContext
 	}
 
 	void printModule();
+	void printFunctionDef(Uptr functionDefIndex);
 
 	void printLinkingSection(const IR::UserSection& linkingSection);
 
+	// Writes the printed text to the stream.
+	void flush()
+	{
+		expandIndentation(string, indentDepth, stream);
+		string.clear();
+	}
+
+	// Writes the printed text to the stream if enough has been printed, so the text buffered in
+	// memory stays bounded.
+	void flushIfFull()
+	{
+		enum
+		{
+			maxBufferedChars = 64 * 1024
+		};
+		if(string.size() >= maxBufferedChars) { flush(); }
+	}
+
 	void printInitializerExpression(const InitializerExpression& expression)
 	{
 		switch(expression.type)
@@ -769,6 +806,7 @@ void ModulePrintContext::printModule()
 		string += " (func";
 		print(string, module.types[typeIndex]);
 		string += ')';
+		flushIfFull();
 	}
 
 	// Print the module imports.
@@ -780,6 +818,7 @@ void ModulePrintContext::printModule()
 					importIndex,
 					names.functions[importIndex].name.c_str(),
 					"func");
+		flushIfFull();
 	}
 	for(Uptr importIndex = 0; importIndex < module.tables.imports.size(); ++importIndex)
 	{
@@ -789,6 +828,7 @@ void ModulePrintContext::printModule()
 					importIndex,
 					names.tables[importIndex].c_str(),
 					"table");
+		flushIfFull();
 	}
 	for(Uptr importIndex = 0; importIndex < module.memories.imports.size(); ++importIndex)
 	{
@@ -798,6 +838,7 @@ void ModulePrintContext::printModule()
 					importIndex,
 					names.memories[importIndex].c_str(),
 					"memory");
+		flushIfFull();
 	}
 	for(Uptr importIndex = 0; importIndex < module.globals.imports.size(); ++importIndex)
 	{
@@ -807,6 +848,7 @@ void ModulePrintContext::printModule()
 					importIndex,
 					names.globals[importIndex].c_str(),
 					"global");
+		flushIfFull();
 	}
 	for(Uptr importIndex = 0; importIndex < module.exceptionTypes.imports.size(); ++importIndex)
 	{
@@ -816,6 +858,7 @@ void ModulePrintContext::printModule()
 					importIndex,
 					names.exceptionTypes[importIndex].c_str(),
 					"exception_type");
+		flushIfFull();
 	}
 	// Print the module exports.
 	for(auto export_ : module.exports)
@@ -837,6 +880,7 @@ void ModulePrintContext::printModule()
 		default: Errors::unreachable();
 		};
 		string += ')';
+		flushIfFull();
 	}
 
 	// Print the module memory definitions.
@@ -849,6 +893,7 @@ void ModulePrintContext::printModule()
 		string += names.memories[module.memories.imports.size() + defIndex];
 		string += ' ';
 		print(string, memoryDef.type);
+		flushIfFull();
 	}
 
 	// Print the module table definitions and elem segments.
@@ -861,6 +906,7 @@ void ModulePrintContext::printModule()
 		string += names.tables[module.tables.imports.size() + defIndex];
 		string += ' ';
 		print(string, tableDef.type);
+		flushIfFull();
 	}
 
 	// Print the module global definitions.
@@ -875,6 +921,7 @@ void ModulePrintContext::printModule()
 		print(string, globalDef.type);
 		string += ' ';
 		printInitializerExpression(globalDef.initializer);
+		flushIfFull();
 	}
 
 	// Print the module exception type definitions.
@@ -886,6 +933,7 @@ void ModulePrintContext::printModule()
 		string += ' ';
 		string += names.exceptionTypes[module.exceptionTypes.imports.size() + defIndex];
 		print(string, exceptionTypeDef.type);
+		flushIfFull();
 	}
 
 	// Print the data and elem segment definitions.
@@ -941,6 +989,7 @@ void ModulePrintContext::printModule()
 				default: Errors::unreachable();
 				};
 			}
+			flushIfFull();
 		}
 	}
 	for(Uptr segmentIndex = 0; segmentIndex < module.dataSegments.size(); ++segmentIndex)
@@ -962,13 +1011,14 @@ void ModulePrintContext::printModule()
 		{
 			numBytesPerLine = 64
 		};
-		for(Uptr offset = 0; offset < dataSegment.data.size(); offset += numBytesPerLine)
+		for(Uptr offset = 0; offset < dataSegment.getNumBytes(); offset += numBytesPerLine)
 		{
 			string += "\n\"";
 			string += escapeString(
-				(const char*)dataSegment.data.data() + offset,
-				std::min(Uptr(dataSegment.data.size()) - offset, Uptr(numBytesPerLine)));
+				(const char*)dataSegment.getBytes() + offset,
+				std::min(dataSegment.getNumBytes() - offset, Uptr(numBytesPerLine)));
 			string += "\"";
+			flushIfFull();
 		}
 	}
 
@@ -984,64 +1034,7 @@ void ModulePrintContext::printModule()
 	// Print the function definitions.
 	for(Uptr functionDefIndex = 0; functionDefIndex < module.functions.defs.size();
 		++functionDefIndex)
-	{
-		const Uptr functionIndex = module.functions.imports.size() + functionDefIndex;
-		const FunctionDef& functionDef = module.functions.defs[functionDefIndex];
-		FunctionType functionType = module.types[functionDef.type.index];
-		FunctionPrintContext functionContext(*this, functionDefIndex);
-
-		string += "\n\n";
-		ScopedTagPrinter funcTag(string, "func");
-
-		string += ' ';
-		string += names.functions[functionIndex].name;
-
-		// Print the function's type.
-		string += " (type ";
-		string += names.types[functionDef.type.index];
-		string += ')';
-
-		// Print the function parameters.
-		if(functionType.params().size())
-		{
-			for(Uptr parameterIndex = 0; parameterIndex < functionType.params().size();
-				++parameterIndex)
-			{
-				string += '\n';
-				ScopedTagPrinter paramTag(string, "param");
-				string += ' ';
-				string += functionContext.localNames[parameterIndex];
-				string += ' ';
-				print(string, functionType.params()[parameterIndex]);
-			}
-		}
-
-		// Print the function return type.
-		if(functionType.results().size())
-		{
-			string += '\n';
-			ScopedTagPrinter resultTag(string, "result");
-			for(Uptr resultIndex = 0; resultIndex < functionType.results().size(); ++resultIndex)
-			{
-				string += ' ';
-				print(string, functionType.results()[resultIndex]);
-			}
-		}
-
-		// Print the function's locals.
-		for(Uptr localIndex = 0; localIndex < functionDef.nonParameterLocalTypes.size();
-			++localIndex)
-		{
-			string += '\n';
-			ScopedTagPrinter localTag(string, "local");
-			string += ' ';
-			string += functionContext.localNames[functionType.params().size() + localIndex];
-			string += ' ';
-			print(string, functionDef.nonParameterLocalTypes[localIndex]);
-		}
-
-		functionContext.printFunctionBody();
-	}
+	{ printFunctionDef(functionDefIndex); }
 
 	// Print user sections (other than the name section).
 	for(const auto& userSection : module.userSections)
@@ -1057,19 +1050,79 @@ void ModulePrintContext::printModule()
 			{
 				numBytesPerLine = 32
 			};
-			for(Uptr offset = 0; offset < userSection.data.size(); offset += numBytesPerLine)
+			for(Uptr offset = 0; offset < userSection.getNumBytes(); offset += numBytesPerLine)
 			{
 				string += "\n;; \"";
 				string += escapeString(
-					(const char*)userSection.data.data() + offset,
-					std::min(Uptr(userSection.data.size()) - offset, Uptr(numBytesPerLine)));
+					(const char*)userSection.getBytes() + offset,
+					std::min(userSection.getNumBytes() - offset, Uptr(numBytesPerLine)));
 				string += "\"";
+				flushIfFull();
 			}
 			string += DEDENT_STRING "\n";
 		}
 	}
 }
 
+void ModulePrintContext::printFunctionDef(Uptr functionDefIndex)
+{
+	const Uptr functionIndex = module.functions.imports.size() + functionDefIndex;
+	materializeFunctionDef(module, functionDefIndex);
+	const FunctionDef& functionDef = module.functions.defs[functionDefIndex];
+	FunctionType functionType = module.types[functionDef.type.index];
+	FunctionPrintContext functionContext(*this, functionDefIndex);
+
+	string += "\n\n";
+	ScopedTagPrinter funcTag(string, "func");
+
+	string += ' ';
+	string += names.functions[functionIndex].name;
+
+	// Print the function's type.
+	string += " (type ";
+	string += names.types[functionDef.type.index];
+	string += ')';
+
+	// Print the function parameters.
+	if(functionType.params().size())
+	{
+		for(Uptr parameterIndex = 0; parameterIndex < functionType.params().size(); ++parameterIndex)
+		{
+			string += '\n';
+			ScopedTagPrinter paramTag(string, "param");
+			string += ' ';
+			string += functionContext.localNames[parameterIndex];
+			string += ' ';
+			print(string, functionType.params()[parameterIndex]);
+		}
+	}
+
+	// Print the function return type.
+	if(functionType.results().size())
+	{
+		string += '\n';
+		ScopedTagPrinter resultTag(string, "result");
+		for(Uptr resultIndex = 0; resultIndex < functionType.results().size(); ++resultIndex)
+		{
+			string += ' ';
+			print(string, functionType.results()[resultIndex]);
+		}
+	}
+
+	// Print the function's locals.
+	for(Uptr localIndex = 0; localIndex < functionDef.nonParameterLocalTypes.size(); ++localIndex)
+	{
+		string += '\n';
+		ScopedTagPrinter localTag(string, "local");
+		string += ' ';
+		string += functionContext.localNames[functionType.params().size() + localIndex];
+		string += ' ';
+		print(string, functionDef.nonParameterLocalTypes[localIndex]);
+	}
+
+	functionContext.printFunctionBody();
+}
+
 void ModulePrintContext::printLinkingSection(const IR::UserSection& linkingSection)
 {
 	enum class LinkingSubsectionType
@@ -1102,7 +1155,7 @@ void ModulePrintContext::printLinkingSection(const IR::UserSection& linkingSecti
 	linkingSectionString += "\n;; linking section:" INDENT_STRING;
 	try
 	{
-		MemoryInputStream stream(linkingSection.data.data(), linkingSection.data.size());
+		MemoryInputStream stream(linkingSection.getBytes(), linkingSection.getNumBytes());
 
 		U32 version = 1;
 		serializeVarUInt32(stream, version);
@@ -1423,16 +1476,42 @@ void FunctionPrintContext::printFunctionBody()
 	pushControlStack(ControlContext::Type::function, "");
 	string += DEDENT_STRING;
 
-	OperatorDecoderStream decoder(functionDef.code);
-	while(decoder && controlStack.size()) { decoder.decodeOp(*this); };
+	OperatorDecoderStream decoder(functionDef.code, module.operatorEncoding);
+	while(decoder && controlStack.size())
+	{
+		decoder.decodeOp(*this);
+		moduleContext.flushIfFull();
+	};
 
 	string += INDENT_STRING "\n";
 }
 
-std::string WAST::print(const Module& module)
+void WAST::print(OutputStream& stream, const Module& module)
 {
-	std::string string;
-	ModulePrintContext context(module, string);
+	ModulePrintContext context(module, stream);
 	context.printModule();
-	return expandIndentation(std::move(string));
+	context.flush();
+}
+
+void WAST::printFunctionDefs(OutputStream& stream,
+							 const Module& module,
+							 Uptr beginFunctionDefIndex,
+							 Uptr endFunctionDefIndex)
+{
+	wavmAssert(beginFunctionDefIndex <= endFunctionDefIndex);
+	wavmAssert(endFunctionDefIndex <= module.functions.defs.size());
+
+	ModulePrintContext context(module, stream);
+	for(Uptr functionDefIndex = beginFunctionDefIndex; functionDefIndex < endFunctionDefIndex;
+		++functionDefIndex)
+	{ context.printFunctionDef(functionDefIndex); }
+	context.flush();
+}
+
+std::string WAST::print(const Module& module)
+{
+	ArrayOutputStream stream;
+	print(stream, module);
+	const std::vector<U8>& bytes = stream.getBytes();
+	return std::string((const char*)bytes.data(), bytes.size());
 }
@@ -8,6 +8,7 @@
 #include "WAVM/Inline/Serialization.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/File.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/WASM/WASM.h"
 #include "WAVM/WASTParse/WASTParse.h"
@@ -16,33 +17,76 @@ using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
-static bool loadModule(const char* filename, IR::Module& outModule)
+// Reads the rest of a file stream, and parses it as a text module.
+static bool loadTextModule(const char* filename, FileInputStream& stream, IR::Module& outModule)
 {
-	// Read the specified file into an array.
 	std::vector<U8> fileBytes;
-	if(!loadFile(filename, fileBytes)) { return false; }
+	while(Uptr numBufferedBytes = stream.capacity())
+	{
+		const U8* bytes = stream.advance(numBufferedBytes);
+		fileBytes.insert(fileBytes.end(), bytes, bytes + numBufferedBytes);
+	}
+
+	// Make sure the WAST file is null terminated.
+	fileBytes.push_back(0);
 
-	// If the file starts with the WASM binary magic number, load it as a binary irModule.
-	static const U8 wasmMagicNumber[4] = {0x00, 0x61, 0x73, 0x6d};
-	if(fileBytes.size() >= 4 && !memcmp(fileBytes.data(), wasmMagicNumber, 4))
-	{ return WASM::loadBinaryModule(fileBytes.data(), fileBytes.size(), outModule); }
-	else
+	// Load it as a text irModule.
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule((const char*)fileBytes.data(), fileBytes.size(), outModule, parseErrors))
 	{
-		// Make sure the WAST file is null terminated.
-		fileBytes.push_back(0);
+		Log::printf(Log::error, "Error parsing WebAssembly text file:\n");
+		WAST::reportParseErrors(filename, parseErrors);
+		return false;
+	}
 
-		// Load it as a text irModule.
-		std::vector<WAST::Error> parseErrors;
-		if(!WAST::parseModule(
-			   (const char*)fileBytes.data(), fileBytes.size(), outModule, parseErrors))
-		{
-			Log::printf(Log::error, "Error parsing WebAssembly text file:\n");
-			WAST::reportParseErrors(filename, parseErrors);
-			return false;
-		}
+	return true;
+}
+
+// Passes each function definition to a Runtime::StreamingCompile as soon as it is loaded.
+struct StreamingCompileCallbacks : WASM::StreamingLoadCallbacks
+{
+	Runtime::StreamingCompile* streamingCompile = nullptr;
+
+	virtual void onCodeSectionStart(const IR::Module& module) override
+	{
+		streamingCompile = Runtime::beginStreamingCompile(module);
+	}
+
+	virtual void onFunctionDefLoaded(const IR::Module& module, Uptr functionDefIndex) override
+	{
+		Runtime::compileFunctionDef(streamingCompile, functionDefIndex);
+	}
+};
+
+static void removeValidatedSections(IR::Module& irModule)
+{
+	Uptr validatedSectionIndex = 0;
+	while(IR::findUserSection(irModule, "wavm.validated", validatedSectionIndex))
+	{ irModule.userSections.erase(irModule.userSections.begin() + validatedSectionIndex); }
+}
 
-		return true;
+// Loads a binary module from a file stream, compiling its function definitions on another thread
+// while the rest of the file is read and deserialized.
+static Runtime::ModuleRef loadAndCompileBinaryModule(FileInputStream& stream, IR::Module& outModule)
+{
+	StreamingCompileCallbacks callbacks;
+	const bool loadSucceeded = WASM::loadBinaryModule(stream, outModule, &callbacks);
+
+	if(!loadSucceeded)
+	{
+		if(callbacks.streamingCompile)
+		{ Runtime::abortStreamingCompile(callbacks.streamingCompile); }
+		return nullptr;
 	}
+
+	// Remove any validated section from the input module, since a new one is added when the
+	// compiled module is serialized.
+	removeValidatedSections(outModule);
+
+	// If the module didn't have a code section, there wasn't anything to compile while loading it.
+	if(!callbacks.streamingCompile) { return Runtime::compileModule(std::move(outModule)); }
+
+	return Runtime::finishStreamingCompile(callbacks.streamingCompile, std::move(outModule));
 }
 
 int main(int argc, char** argv)
@@ -57,25 +101,62 @@ int main(int argc, char** argv)
 
 	IR::Module irModule;
 
-	// Load the module IR.
-	if(!loadModule(inputFilename, irModule)) { return EXIT_FAILURE; }
-
-	// Compile the module's IR.
-	Runtime::ModuleRef module = Runtime::compileModule(irModule);
+	// Open the input file once, and read it through one stream, so it can be a pipe: check whether
+	// the stream starts with the binary magic number without consuming it, then load the module
+	// from the same stream.
+	Platform::File* inputFile = Platform::openFile(
+		inputFilename, Platform::FileAccessMode::readOnly, Platform::FileCreateMode::openExisting);
+	if(!inputFile)
+	{
+		Log::printf(Log::error, "Couldn't read %s: couldn't open file.\n", inputFilename);
+		return EXIT_FAILURE;
+	}
 
-	// Extract the compiled object code and add it to the IR module as a user section.
-	irModule.userSections.push_back({"wavm.precompiled_object", Runtime::getObjectCode(module)});
+	Runtime::ModuleRef module;
+	{
+		FileInputStream stream(inputFile);
+		try
+		{
+			static const U8 wasmMagicNumber[4] = {0x00, 0x61, 0x73, 0x6d};
+			if(stream.startsWith(wasmMagicNumber, sizeof(wasmMagicNumber)))
+			{
+				// Load and compile a binary module in a pipeline.
+				module = loadAndCompileBinaryModule(stream, irModule);
+			}
+			else if(loadTextModule(inputFilename, stream, irModule))
+			{
+				// Compile the module's IR, moving it into the compiled module.
+				removeValidatedSections(irModule);
+				module = Runtime::compileModule(std::move(irModule));
+			}
+		}
+		catch(Serialization::FatalSerializationException const& exception)
+		{
+			Log::printf(
+				Log::error, "Couldn't read %s: %s\n", inputFilename, exception.message.c_str());
+		}
+	}
+	errorUnless(Platform::closeFile(inputFile));
+	if(!module) { return EXIT_FAILURE; }
 
-	// Serialize the WASM module.
+	// Serialize the WASM module from the compiled module's IR, which the IR module was moved into.
 	std::vector<U8> wasmBytes;
 	try
 	{
 		Timing::Timer saveTimer;
 
 		Serialization::ArrayOutputStream stream;
-		WASM::serialize(stream, irModule);
+		WASM::serialize(stream, Runtime::getModuleIR(module));
 		wasmBytes = stream.getBytes();
 
+		// Extract the compiled object code and add it to the serialized module as a user section.
+		WASM::addUserSection(wasmBytes, "wavm.precompiled_object", Runtime::getObjectCode(module));
+
+		// The module was validated when it was loaded, so mark it as validated. This allows
+		// wavm-run to skip decoding and validating its function bodies again when it only needs
+		// the precompiled object code.
+		WASM::addValidatedSection(wasmBytes);
+
 		Timing::logRatePerSecond(
 			"Serialized WASM", saveTimer, wasmBytes.size() / 1024.0 / 1024.0, "MB");
 	}
@@ -1,23 +1,34 @@
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 
 #include "WAVM/IR/Module.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/CLI.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/Inline/Serialization.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/File.h"
 #include "WAVM/WASM/WASM.h"
 #include "WAVM/WASTPrint/WASTPrint.h"
 
 using namespace WAVM;
 
-static bool loadBinaryModuleFromFile(const char* filename,
-									 IR::Module& outModule,
-									 Log::Category errorCategory = Log::error)
+// Parses a function definition index range of the form "first" or "first-last".
+static bool parseFunctionDefRange(const char* string, Uptr& outBegin, Uptr& outEnd)
 {
-	std::vector<U8> wasmBytes;
-	if(!loadFile(filename, wasmBytes)) { return false; }
-	return WASM::loadBinaryModule(wasmBytes.data(), wasmBytes.size(), outModule);
+	char* end = nullptr;
+	outBegin = Uptr(strtoull(string, &end, 10));
+	outEnd = outBegin + 1;
+	if(end == string) { return false; }
+	else if(*end == '-')
+	{
+		const char* lastString = end + 1;
+		outEnd = Uptr(strtoull(lastString, &end, 10)) + 1;
+		if(end == lastString || outEnd <= outBegin) { return false; }
+	}
+	return *end == 0;
 }
 
 int main(int argc, char** argv)
@@ -27,40 +38,104 @@ int main(int argc, char** argv)
 
 	bool showHelp = false;
 	bool enableQuotedNames = false;
-	if(argc < 3 || argc > 4) { showHelp = true; }
-	else
+	bool printFunctionDefRange = false;
+	Uptr beginFunctionDefIndex = 0;
+	Uptr endFunctionDefIndex = 0;
+	for(int argIndex = 1; argIndex < argc; ++argIndex)
 	{
-		inputFilename = argv[1];
-		outputFilename = argv[2];
-		if(!strcmp(argv[1], "--help")) { showHelp = true; }
-		else if(argc == 4)
+		if(!strcmp(argv[argIndex], "--help")) { showHelp = true; }
+		else if(!strcmp(argv[argIndex], "--enable-quoted-names"))
+		{
+			enableQuotedNames = true;
+		}
+		else if(!strcmp(argv[argIndex], "--function-defs"))
+		{
+			printFunctionDefRange = true;
+			if(++argIndex == argc
+			   || !parseFunctionDefRange(
+				   argv[argIndex], beginFunctionDefIndex, endFunctionDefIndex))
+			{ showHelp = true; }
+		}
+		else if(!inputFilename)
 		{
-			if(!strcmp(argv[3], "--enable-quoted-names")) { enableQuotedNames = true; }
-			else
-			{
-				showHelp = true;
-			}
+			inputFilename = argv[argIndex];
+		}
+		else if(!outputFilename)
+		{
+			outputFilename = argv[argIndex];
+		}
+		else
+		{
+			showHelp = true;
 		}
 	}
+	if(!outputFilename) { showHelp = true; }
 
 	if(showHelp)
 	{
-		Log::printf(Log::error, "Usage: wavm-disas in.wasm out.wast [--enable-quoted-names]\n");
+		Log::printf(Log::error,
+					"Usage: wavm-disas in.wasm out.wast [--enable-quoted-names]\n"
+					"                  [--function-defs <first>[-<last>]]\n"
+					"  --function-defs  Only prints the function definitions in the range of\n"
+					"                     function definition indices\n");
 		return EXIT_FAILURE;
 	}
 
-	// Load the WASM file.
+	// Load the WASM file. If only some function definitions are printed, load the function
+	// definitions lazily, so only the printed ones are decoded.
 	IR::Module module;
 	module.featureSpec.quotedNamesInTextFormat = enableQuotedNames;
-	if(!loadBinaryModuleFromFile(inputFilename, module)) { return EXIT_FAILURE; }
+	if(!WASM::loadBinaryModuleFromFile(inputFilename,
+									   module,
+									   Log::error,
+									   printFunctionDefRange ? WASM::FunctionBodyDecoding::lazy
+															 : WASM::FunctionBodyDecoding::eager))
+	{ return EXIT_FAILURE; }
+
+	if(printFunctionDefRange && endFunctionDefIndex > module.functions.defs.size())
+	{
+		Log::printf(Log::error,
+					"The module only has %" PRIuPTR " function definitions.\n",
+					module.functions.defs.size());
+		return EXIT_FAILURE;
+	}
+
+	Platform::File* outputFile = Platform::openFile(
+		outputFilename, Platform::FileAccessMode::writeOnly, Platform::FileCreateMode::createAlways);
+	if(!outputFile)
+	{
+		Log::printf(Log::error, "Couldn't write %s: couldn't open file.\n", outputFilename);
+		return EXIT_FAILURE;
+	}
 
-	// Print the module to WAST.
+	// Print the module to WAST, writing it to the output file as it is printed.
+	bool succeeded = true;
 	Timing::Timer printTimer;
-	const std::string wastString = WAST::print(module);
+	U64 numPrintedBytes = 0;
+	try
+	{
+		FileOutputStream stream(outputFile);
+		if(printFunctionDefRange)
+		{ WAST::printFunctionDefs(stream, module, beginFunctionDefIndex, endFunctionDefIndex); }
+		else
+		{
+			WAST::print(stream, module);
+		}
+		stream.flush();
+		errorUnless(
+			Platform::seekFile(outputFile, 0, Platform::FileSeekOrigin::cur, &numPrintedBytes));
+	}
+	catch(Serialization::FatalSerializationException const& exception)
+	{
+		Log::printf(Log::error,
+					"Error writing %s:\n%s\n",
+					outputFilename,
+					exception.message.c_str());
+		succeeded = false;
+	}
+	errorUnless(Platform::closeFile(outputFile));
 	Timing::logRatePerSecond(
-		"Printed WAST", printTimer, F64(wastString.size()) / 1024.0 / 1024.0, "MB");
+		"Printed WAST", printTimer, F64(numPrintedBytes) / 1024.0 / 1024.0, "MB");
 
-	// Write the serialized data to the output file.
-	return saveFile(outputFilename, wastString.data(), wastString.size()) ? EXIT_SUCCESS
-																		  : EXIT_FAILURE;
+	return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
 }
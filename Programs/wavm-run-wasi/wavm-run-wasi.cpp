@@ -28,18 +28,24 @@ using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
-static bool loadModule(const char* filename, IR::Module& outModule)
+static bool loadModule(const char* filename,
+					   IR::Module& outModule,
+					   WASM::FunctionBodyDecoding functionBodyDecoding)
 {
-	// Read the specified file into an array.
-	std::vector<U8> fileBytes;
-	if(!loadFile(filename, fileBytes)) { return false; }
-
-	// If the file starts with the WASM binary magic number, load it as a binary irModule.
-	static const U8 wasmMagicNumber[4] = {0x00, 0x61, 0x73, 0x6d};
-	if(fileBytes.size() >= 4 && !memcmp(fileBytes.data(), wasmMagicNumber, 4))
-	{ return WASM::loadBinaryModule(fileBytes.data(), fileBytes.size(), outModule); }
+	// If the file starts with the WASM binary magic number, load it as a binary irModule. Binary
+	// modules are loaded from a mapping of the file, so their data segments and user sections
+	// borrow their bytes from the mapping instead of copying them.
+	if(isBinaryModuleFile(filename))
+	{
+		return WASM::loadBinaryModuleFromFile(
+			filename, outModule, Log::error, functionBodyDecoding, 0);
+	}
 	else
 	{
+		// Read the specified file into an array.
+		std::vector<U8> fileBytes;
+		if(!loadFile(filename, fileBytes)) { return false; }
+
 		// Make sure the WAST file is null terminated.
 		fileBytes.push_back(0);
 
@@ -63,46 +69,53 @@ struct CommandLineOptions
 	std::vector<std::string> args;
 	bool onlyCheck = false;
 	bool precompiled = false;
+	bool asyncIO = false;
 };
 
 static int run(const CommandLineOptions& options)
 {
+	// The compiled module keeps the IR module, so load its code in the compact operator encoding
+	// to reduce the memory it uses.
 	IR::Module irModule;
-
-	// Load the module.
-	if(!loadModule(options.filename, irModule)) { return EXIT_FAILURE; }
+	irModule.operatorEncoding = IR::OperatorEncoding::compact;
+
+	// Load the module. A precompiled module's function bodies are only needed to compile it, so
+	// if wavm-compile validated the module, don't decode them unless the module is being checked.
+	const WASM::FunctionBodyDecoding functionBodyDecoding
+		= options.precompiled && !options.onlyCheck
+			  ? WASM::FunctionBodyDecoding::lazyIfValidated
+			  : WASM::FunctionBodyDecoding::eager;
+	if(!loadModule(options.filename, irModule, functionBodyDecoding)) { return EXIT_FAILURE; }
 	if(options.onlyCheck) { return EXIT_SUCCESS; }
 
 	// Compile the module.
 	Runtime::ModuleRef module = nullptr;
-	if(!options.precompiled) { module = Runtime::compileModule(irModule); }
+	if(!options.precompiled) { module = Runtime::compileModule(std::move(irModule)); }
 	else
 	{
-		const UserSection* precompiledObjectSection = nullptr;
-		for(const UserSection& userSection : irModule.userSections)
-		{
-			if(userSection.name == "wavm.precompiled_object")
-			{
-				precompiledObjectSection = &userSection;
-				break;
-			}
-		}
-
-		if(!precompiledObjectSection)
+		// Load the object code directly from the precompiled object section, without copying it.
+		module = Runtime::loadPrecompiledModule(std::move(irModule));
+		if(!module)
 		{
 			Log::printf(Log::error,
 						"Input file did not contain 'wavm.precompiled_object' section.\n");
 			return EXIT_FAILURE;
 		}
-		else
-		{
-			module = Runtime::loadPrecompiledModule(irModule, precompiledObjectSection->data);
-		}
 	}
 
 	I32 exitCode = 0;
-	WASI::RunResult result
-		= WASI::run(module, std::vector<std::string>(options.args), {}, exitCode);
+	WASI::RunResult result;
+	if(!options.asyncIO)
+	{ result = WASI::run(module, std::vector<std::string>(options.args), {}, exitCode); }
+	else
+	{
+		// Run the program as the only process on a WASI worker.
+		WASI::Worker* worker = WASI::createWorker();
+		result = WASI::addProcess(
+			worker, module, std::vector<std::string>(options.args), {}, exitCode);
+		if(result == WASI::RunResult::success) { WASI::runWorker(worker); }
+		WASI::destroyWorker(worker);
+	}
 	switch(result)
 	{
 	case WASI::RunResult::success: return exitCode;
@@ -125,6 +138,10 @@ static void showHelp()
 	Log::printf(Log::error,
 				"Usage: wavm-run-wasi [switches] [programfile] [--] [arguments]\n"
 				"  in.wast|in.wasm       Specify program file (.wast/.wasm)\n"
+				"  --async-io            Run the program on a fiber, and suspend it while it\n"
+				"                        waits for I/O instead of blocking the thread\n"
+				"  --async-log           Buffer logging and write it to stdout on a background\n"
+				"                        thread instead of on the logging thread\n"
 				"  -c|--check            Exit after checking that the program is valid\n"
 				"  -d|--debug            Write additional debug information to stdout\n"
 				"  -h|--help             Display this message\n"
@@ -149,6 +166,14 @@ int main(int argc, char** argv)
 		{
 			Log::setCategoryEnabled(Log::metrics, true);
 		}
+		else if(!strcmp(*nextArg, "--async-io"))
+		{
+			options.asyncIO = true;
+		}
+		else if(!strcmp(*nextArg, "--async-log"))
+		{
+			Log::setAsyncOutputEnabled(true);
+		}
 		else if(!strcmp(*nextArg, "--precompiled"))
 		{
 			options.precompiled = true;
@@ -192,5 +217,15 @@ int main(int argc, char** argv)
 										Errors::fatalf("Runtime exception: %s",
 													   describeException(exception).c_str());
 									});
+
+	// Write any buffered log messages, and report any that were dropped.
+	if(Log::getNumDroppedMessages())
+	{
+		Log::printf(Log::error,
+					"Dropped %" PRIu64 " log messages because the log buffer was full.\n",
+					Log::getNumDroppedMessages());
+	}
+	Log::setAsyncOutputEnabled(false);
+
 	return result;
 }
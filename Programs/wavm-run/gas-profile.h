@@ -0,0 +1,296 @@
+#pragma once
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+
+using namespace WAVM;
+
+static const char* gasProfileCountersExportName = "__wavm_gas_profile_counters";
+
+// A gas profile counts how many times each block of metered code runs. A block is the sequence of
+// operators that GasVisitor charges gas for at once, so the gas a function used is the sum over its
+// blocks of the block's gas times the number of times it ran.
+//
+// After each block charges its gas, it increments its counter with an inline load, add, and store,
+// so counting doesn't add any calls to the ones gas metering already makes. The counters are an
+// array in the guest's memory, allocated from the guest's heap, and the instrumented code reads the
+// array's address from a global that the module exports as gasProfileCountersExportName.
+struct GasProfile
+{
+	struct Block
+	{
+		Uptr functionDefIndex;
+
+		// The index of the block's first operator in the function's uninstrumented code.
+		Uptr firstOpIndex;
+
+		U64 gas;
+
+		// The number of times each operator occurs in the block, by index into opNames.
+		std::vector<std::pair<Uptr, U32>> opCounts;
+	};
+
+	// The gas charged for an operator, and the number of times it occurs in a block.
+	struct OpCount
+	{
+		U32 price;
+		U32 count;
+	};
+
+	std::vector<Block> blocks;
+	std::vector<std::string> opNames;
+	std::vector<U32> opPrices;
+	std::map<std::string, Uptr> opNameIndexMap;
+
+	// The index of the global that holds the address of the counters in the guest's memory.
+	Uptr countersGlobalIndex = 0;
+
+	// The number of times each block ran, by block index.
+	std::vector<U64> counters;
+
+	// Adds a block, and returns the index of its counter.
+	Uptr addBlock(Uptr functionDefIndex,
+				  Uptr firstOpIndex,
+				  U64 gas,
+				  const std::map<std::string, OpCount>& opCounts)
+	{
+		Block block{functionDefIndex, firstOpIndex, gas, {}};
+		for(const auto& opCount : opCounts)
+		{
+			auto opNameIndexIt = opNameIndexMap.find(opCount.first);
+			if(opNameIndexIt == opNameIndexMap.end())
+			{
+				opNameIndexIt = opNameIndexMap.emplace(opCount.first, opNames.size()).first;
+				opNames.push_back(opCount.first);
+				opPrices.push_back(opCount.second.price);
+			}
+			block.opCounts.push_back({opNameIndexIt->second, opCount.second.count});
+		}
+		blocks.push_back(std::move(block));
+		return blocks.size() - 1;
+	}
+};
+
+static void appendf(std::string& string, const char* format, ...) VALIDATE_AS_PRINTF(2, 3);
+static void appendf(std::string& string, const char* format, ...)
+{
+	char buffer[1024];
+	va_list argList;
+	va_start(argList, format);
+	vsnprintf(buffer, sizeof(buffer), format, argList);
+	va_end(argList);
+	string += buffer;
+}
+
+static F64 getPercent(F64 numerator, F64 denominator)
+{
+	return denominator > 0.0 ? numerator / denominator * 100.0 : 0.0;
+}
+
+// Formats a report of the gas used by each function, block, and operator, and of how well the gas
+// each function used tracks the time it took. functionNames are the debug names of the module's
+// function definitions, which the samples in functionSampleCounts are keyed by.
+static std::string formatGasProfileReport(
+	const GasProfile& profile,
+	const std::vector<std::string>& functionNames,
+	U64 wallMicroseconds,
+	const std::vector<std::pair<std::string, U64>>& functionSampleCounts,
+	Uptr maxLines = 20)
+{
+	// Sum the gas and executions of each function and operator.
+	struct FunctionTotal
+	{
+		U64 gas = 0;
+		U64 numBlockExecutions = 0;
+		U64 numSamples = 0;
+	};
+	std::vector<FunctionTotal> functionTotals(functionNames.size());
+	std::vector<U64> opExecutions(profile.opNames.size(), 0);
+	std::vector<U64> opGas(profile.opNames.size(), 0);
+	U64 totalGas = 0;
+	U64 totalBlockExecutions = 0;
+	U64 totalOpExecutions = 0;
+	for(Uptr blockIndex = 0; blockIndex < profile.blocks.size(); ++blockIndex)
+	{
+		const GasProfile::Block& block = profile.blocks[blockIndex];
+		const U64 numExecutions = profile.counters[blockIndex];
+		functionTotals[block.functionDefIndex].gas += block.gas * numExecutions;
+		functionTotals[block.functionDefIndex].numBlockExecutions += numExecutions;
+		totalGas += block.gas * numExecutions;
+		totalBlockExecutions += numExecutions;
+		for(const auto& opCount : block.opCounts)
+		{
+			const U64 price = profile.opPrices[opCount.first];
+			opExecutions[opCount.first] += opCount.second * numExecutions;
+			opGas[opCount.first] += price * opCount.second * numExecutions;
+			totalOpExecutions += opCount.second * numExecutions;
+		}
+	}
+
+	// Match the sampled time to the functions.
+	std::map<std::string, Uptr> functionNameIndexMap;
+	for(Uptr functionDefIndex = 0; functionDefIndex < functionNames.size(); ++functionDefIndex)
+	{ functionNameIndexMap[functionNames[functionDefIndex]] = functionDefIndex; }
+	U64 totalSamples = 0;
+	for(const auto& functionSampleCount : functionSampleCounts)
+	{
+		auto functionIndexIt = functionNameIndexMap.find(functionSampleCount.first);
+		if(functionIndexIt != functionNameIndexMap.end())
+		{ functionTotals[functionIndexIt->second].numSamples += functionSampleCount.second; }
+		totalSamples += functionSampleCount.second;
+	}
+
+	std::string report;
+	appendf(report,
+			"Gas profile: %" PRIu64 " gas, %" PRIu64 " block executions, %" PRIu64
+			" operator executions in %.3fms (%.3fns/gas)\n",
+			totalGas,
+			totalBlockExecutions,
+			totalOpExecutions,
+			wallMicroseconds / 1000.0,
+			totalGas ? F64(wallMicroseconds) * 1000.0 / F64(totalGas) : 0.0);
+
+	// The functions that used the most gas, with their share of the sampled time. A time/gas
+	// ratio above 1 means the function takes more of the time than its gas accounts for.
+	std::vector<Uptr> functionOrder;
+	for(Uptr functionDefIndex = 0; functionDefIndex < functionTotals.size(); ++functionDefIndex)
+	{
+		if(functionTotals[functionDefIndex].gas) { functionOrder.push_back(functionDefIndex); }
+	}
+	std::sort(functionOrder.begin(), functionOrder.end(), [&](Uptr a, Uptr b) {
+		return functionTotals[a].gas > functionTotals[b].gas;
+	});
+	appendf(report, "\nTop functions by gas:\n");
+	appendf(report,
+			"%20s %7s %7s %9s %16s  %s\n",
+			"gas",
+			"gas%",
+			"time%",
+			"time/gas",
+			"block execs",
+			"function");
+	for(Uptr orderIndex = 0; orderIndex < std::min(maxLines, functionOrder.size()); ++orderIndex)
+	{
+		const Uptr functionDefIndex = functionOrder[orderIndex];
+		const FunctionTotal& total = functionTotals[functionDefIndex];
+		const F64 gasPercent = getPercent(F64(total.gas), F64(totalGas));
+		const F64 timePercent = getPercent(F64(total.numSamples), F64(totalSamples));
+		appendf(report,
+				"%20" PRIu64 " %6.2f%% %6.2f%% %9.2f %16" PRIu64 "  %s\n",
+				total.gas,
+				gasPercent,
+				timePercent,
+				gasPercent > 0.0 ? timePercent / gasPercent : 0.0,
+				total.numBlockExecutions,
+				functionNames[functionDefIndex].c_str());
+	}
+
+	// The blocks that used the most gas.
+	std::vector<Uptr> blockOrder;
+	for(Uptr blockIndex = 0; blockIndex < profile.blocks.size(); ++blockIndex)
+	{
+		if(profile.counters[blockIndex] && profile.blocks[blockIndex].gas)
+		{ blockOrder.push_back(blockIndex); }
+	}
+	std::sort(blockOrder.begin(), blockOrder.end(), [&](Uptr a, Uptr b) {
+		return profile.blocks[a].gas * profile.counters[a]
+			   > profile.blocks[b].gas * profile.counters[b];
+	});
+	appendf(report, "\nTop blocks by gas:\n");
+	appendf(
+		report, "%20s %7s %16s %9s  %s\n", "gas", "gas%", "executions", "gas/exec", "block");
+	for(Uptr orderIndex = 0; orderIndex < std::min(maxLines, blockOrder.size()); ++orderIndex)
+	{
+		const Uptr blockIndex = blockOrder[orderIndex];
+		const GasProfile::Block& block = profile.blocks[blockIndex];
+		const U64 blockGas = block.gas * profile.counters[blockIndex];
+		appendf(report,
+				"%20" PRIu64 " %6.2f%% %16" PRIu64 " %9" PRIu64 "  %s+%" PRIuPTR "\n",
+				blockGas,
+				getPercent(F64(blockGas), F64(totalGas)),
+				profile.counters[blockIndex],
+				block.gas,
+				functionNames[block.functionDefIndex].c_str(),
+				block.firstOpIndex);
+	}
+
+	// The dynamic instruction mix, with each operator's price and share of the gas.
+	std::vector<Uptr> opOrder;
+	for(Uptr opIndex = 0; opIndex < profile.opNames.size(); ++opIndex)
+	{
+		if(opExecutions[opIndex]) { opOrder.push_back(opIndex); }
+	}
+	std::sort(opOrder.begin(), opOrder.end(), [&](Uptr a, Uptr b) {
+		return opExecutions[a] > opExecutions[b];
+	});
+	appendf(report, "\nInstruction mix:\n");
+	appendf(report,
+			"%20s %7s %20s %7s %7s  %s\n",
+			"executions",
+			"execs%",
+			"gas",
+			"gas%",
+			"price",
+			"operator");
+	for(Uptr opIndex : opOrder)
+	{
+		appendf(report,
+				"%20" PRIu64 " %6.2f%% %20" PRIu64 " %6.2f%% %7u  %s\n",
+				opExecutions[opIndex],
+				getPercent(F64(opExecutions[opIndex]), F64(totalOpExecutions)),
+				opGas[opIndex],
+				getPercent(F64(opGas[opIndex]), F64(totalGas)),
+				profile.opPrices[opIndex],
+				profile.opNames[opIndex].c_str());
+	}
+
+	// How well the gas each function used predicts the time it took: the correlation of the
+	// functions' gas with their samples.
+	appendf(report, "\nGas vs time:\n");
+	if(!totalSamples) { appendf(report, "  No time samples were taken.\n"); }
+	else
+	{
+		F64 sumGas = 0.0, sumSamples = 0.0;
+		F64 sumGasSquares = 0.0, sumSampleSquares = 0.0, sumProducts = 0.0;
+		for(Uptr functionDefIndex : functionOrder)
+		{
+			const F64 gas = F64(functionTotals[functionDefIndex].gas);
+			const F64 samples = F64(functionTotals[functionDefIndex].numSamples);
+			sumGas += gas;
+			sumSamples += samples;
+			sumGasSquares += gas * gas;
+			sumSampleSquares += samples * samples;
+			sumProducts += gas * samples;
+		}
+		const F64 n = F64(functionOrder.size());
+		const F64 covariance = sumProducts - sumGas * sumSamples / n;
+		const F64 gasVariance = sumGasSquares - sumGas * sumGas / n;
+		const F64 sampleVariance = sumSampleSquares - sumSamples * sumSamples / n;
+		appendf(report,
+				"  %" PRIu64 " samples, %.2f%% in functions that used gas\n",
+				totalSamples,
+				getPercent(sumSamples, F64(totalSamples)));
+		if(gasVariance > 0.0 && sampleVariance > 0.0)
+		{
+			appendf(report,
+					"  Correlation of function gas with function time: %.3f over %" PRIuPTR
+					" functions\n",
+					covariance / sqrt(gasVariance * sampleVariance),
+					functionOrder.size());
+		}
+		appendf(report,
+				"  Time/gas ratios above 1 in the function table suggest that the operators in"
+				" the function are underpriced.\n");
+	}
+
+	return report;
+}
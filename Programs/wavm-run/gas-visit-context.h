@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <initializer_list>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -15,6 +16,7 @@
 #include "WAVM/Logging/Logging.h"
 
 #include "gas-cost-table.h"
+#include "gas-profile.h"
 
 using namespace WAVM;
 using namespace WAVM::IR;
@@ -24,8 +26,10 @@ typedef void OperatorEmitFunc(CodeStream*);
 
 struct GasVisitor {
     typedef void Result;
-    GasVisitor(Uptr idx, IR::Module& irModule, IR::FunctionDef& fd)
-        : gasCounter(0), addGasFuncIndex(idx), module(irModule), functionDef(fd) {}
+    GasVisitor(Uptr idx, IR::Module& irModule, IR::FunctionDef& fd,
+               GasProfile* profile = nullptr, Uptr defIndex = 0)
+        : gasCounter(0), addGasFuncIndex(idx), module(irModule), functionDef(fd),
+          gasProfile(profile), functionDefIndex(defIndex) {}
 
     ~GasVisitor() { if (encoderStream != nullptr) delete encoderStream; encoderStream = nullptr; }
 
@@ -37,10 +41,19 @@ struct GasVisitor {
 
     std::vector<std::function<OperatorEmitFunc>> opEmitters;
 
+    // If gasProfile is set, each block is added to the profile and counts its executions in the
+    // profile's counters, and segmentOpCounts counts the operators in the current block.
+    GasProfile* gasProfile;
+    Uptr functionDefIndex;
+    Uptr opIndex = 0;
+    Uptr segmentFirstOpIndex = 0;
+    std::map<std::string, GasProfile::OpCount> segmentOpCounts;
+
     void gas_trap()
     {
         if (opEmitters.size() == 0) {
             gasCounter = 0;
+            start_segment();
             return;
         }
         insert_inst();
@@ -50,11 +63,33 @@ struct GasVisitor {
         }
         gasCounter = 0;
         opEmitters.clear();
+        start_segment();
+    }
+
+    void start_segment()
+    {
+        segmentFirstOpIndex = opIndex;
+        segmentOpCounts.clear();
+    }
+
+    void countOp(const char* opName, U32 price)
+    {
+        if (!gasProfile) { return; }
+        GasProfile::OpCount& opCount = segmentOpCounts[opName];
+        opCount.price = price;
+        ++opCount.count;
+    }
+
+    void chargeOp(const char* opName, const char* priceName)
+    {
+        const U32 price = kGasCostTable[priceName];
+        gasCounter += price;
+        countOp(opName, price);
     }
 
 #define VISIT_OP(encoding, name, nameString, Imm, _4, _5)       \
     Result name(Imm imm) {                                      \
-        gasCounter += kGasCostTable[nameString];                \
+        chargeOp(nameString, nameString);                       \
         opEmitters.push_back(                                   \
                 [imm](CodeStream *codeStream){                  \
                 codeStream->name(imm); });                      \
@@ -68,13 +103,29 @@ struct GasVisitor {
     {
         encoderStream->i64_const({gasCounter});
         encoderStream->call({addGasFuncIndex});
+        if (gasProfile) {
+            // Increment the block's counter inline. The global holds the address of the counter
+            // array, and the counter's offset in the array is the load and store offset.
+            const Uptr counterIndex = gasProfile->addBlock(
+                    functionDefIndex, segmentFirstOpIndex, gasCounter, segmentOpCounts);
+            if (counterIndex >= UINT32_MAX / sizeof(U64)) {
+                Errors::fatal("The module has too many blocks to gas profile");
+            }
+            const LoadOrStoreImm<3> counterImm{3, U32(counterIndex * sizeof(U64))};
+            encoderStream->global_get({gasProfile->countersGlobalIndex});
+            encoderStream->global_get({gasProfile->countersGlobalIndex});
+            encoderStream->i64_load(counterImm);
+            encoderStream->i64_const({1});
+            encoderStream->i64_add();
+            encoderStream->i64_store(counterImm);
+        }
     }
 
 	Result block(ControlStructureImm imm)
     {
         gas_trap();
         encoderStream->block(imm);
-        gasCounter += kGasCostTable["block"];
+        chargeOp("block", "block");
         pushControlStack(ControlContext::Type::block, "");
 
     }
@@ -83,7 +134,7 @@ struct GasVisitor {
     {
         gas_trap();
         encoderStream->loop(imm);
-        gasCounter += kGasCostTable["loop"];
+        chargeOp("loop", "loop");
         pushControlStack(ControlContext::Type::loop, "");
 
     }
@@ -91,7 +142,7 @@ struct GasVisitor {
     {
         gas_trap();
         encoderStream->if_(imm);
-        gasCounter += kGasCostTable["if_"];
+        chargeOp("if", "if_");
         pushControlStack(ControlContext::Type::ifThen, "");
 
     }
@@ -100,7 +151,7 @@ struct GasVisitor {
 	{
         gas_trap();
         encoderStream->else_(imm);
-        gasCounter += kGasCostTable["else_"];
+        chargeOp("else", "else_");
         controlStack.back().type = ControlContext::Type::ifElse;
 
 	}
@@ -109,7 +160,7 @@ struct GasVisitor {
 	{
         gas_trap();
         encoderStream->end(imm);
-        gasCounter += kGasCostTable["end"];
+        chargeOp("end", "end");
         controlStack.pop_back();
 
 	}
@@ -118,7 +169,7 @@ struct GasVisitor {
     {
         gas_trap();
         encoderStream->try_(imm);
-        gasCounter += kGasCostTable["try_"];
+        chargeOp("try", "try_");
         pushControlStack(ControlContext::Type::try_, "");
 
     }
@@ -127,7 +178,7 @@ struct GasVisitor {
 	{
         gas_trap();
         encoderStream->catch_(imm);
-        gasCounter += kGasCostTable["catch_"];
+        chargeOp("catch", "catch_");
         controlStack.back().type = ControlContext::Type::catch_;
 
 	}
@@ -136,13 +187,14 @@ struct GasVisitor {
 	{
         gas_trap();
         encoderStream->catch_all(imm);
-        gasCounter += kGasCostTable["catch_all"];
+        chargeOp("catch_all", "catch_all");
         controlStack.back().type = ControlContext::Type::catch_;
 
 	}
 
     Result unreachable(NoImm imm)
     {
+        countOp("unreachable", 0);
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->unreachable(imm); });
@@ -153,7 +205,7 @@ struct GasVisitor {
     {
         gas_trap();
         encoderStream->br(imm);
-        gasCounter += kGasCostTable["br"];
+        chargeOp("br", "br");
 
     }
 
@@ -161,7 +213,7 @@ struct GasVisitor {
     {
         gas_trap();
         encoderStream->br_if(imm);
-        gasCounter += kGasCostTable["br_if"];
+        chargeOp("br_if", "br_if");
 
     }
 
@@ -169,7 +221,7 @@ struct GasVisitor {
     {
         gas_trap();
         encoderStream->br_table(imm);
-        gasCounter += kGasCostTable["br_table"];
+        chargeOp("br_table", "br_table");
 
     }
 
@@ -178,7 +230,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->return_(imm); });
-        gasCounter += kGasCostTable["return_"];
+        chargeOp("return", "return_");
     }
 
     Result call(FunctionImm imm)
@@ -186,7 +238,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->call(imm); });
-        gasCounter += kGasCostTable["call"];
+        chargeOp("call", "call");
     }
 
     Result call_indirect(CallIndirectImm imm)
@@ -194,7 +246,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->call_indirect(imm); });
-        gasCounter += kGasCostTable["call_indirect"];
+        chargeOp("call_indirect", "call_indirect");
     }
 
     Result drop(NoImm imm)
@@ -202,7 +254,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->drop(imm); });
-        gasCounter += kGasCostTable["drop"];
+        chargeOp("drop", "drop");
     }
 
     Result select(NoImm imm)
@@ -210,7 +262,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->select(imm); });
-        gasCounter += kGasCostTable["select"];
+        chargeOp("select", "select");
     }
 
     Result local_set(GetOrSetVariableImm<false> imm)
@@ -218,7 +270,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->local_set(imm); });
-        gasCounter += kGasCostTable["local_set"];
+        chargeOp("local.set", "local_set");
     }
 
     Result local_get(GetOrSetVariableImm<false> imm)
@@ -226,7 +278,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->local_get(imm); });
-        gasCounter += kGasCostTable["local_get"];
+        chargeOp("local.get", "local_get");
     }
 
     Result local_tee(GetOrSetVariableImm<false> imm)
@@ -234,7 +286,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->local_tee(imm); });
-        gasCounter += kGasCostTable["local_tee"];
+        chargeOp("local.tee", "local_tee");
     }
 
     Result global_set(GetOrSetVariableImm<true> imm)
@@ -242,7 +294,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->global_set(imm); });
-        gasCounter += kGasCostTable["global_set"];
+        chargeOp("global.set", "global_set");
     }
 
     Result global_get(GetOrSetVariableImm<true> imm)
@@ -250,7 +302,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->global_get(imm); });
-        gasCounter += kGasCostTable["global_get"];
+        chargeOp("global.get", "global_get");
     }
 
     Result table_get(TableImm imm)
@@ -258,7 +310,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->table_get(imm); });
-        gasCounter += kGasCostTable["table_get"];
+        chargeOp("table.get", "table_get");
     }
 
     Result table_set(TableImm imm)
@@ -266,7 +318,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->table_get(imm); });
-        gasCounter += kGasCostTable["table_set"];
+        chargeOp("table.set", "table_set");
     }
 
     Result table_grow(TableImm imm)
@@ -274,7 +326,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->table_grow(imm); });
-        gasCounter += kGasCostTable["table_grow"];
+        chargeOp("table.grow", "table_grow");
     }
 
     Result table_fill(TableImm imm)
@@ -282,7 +334,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->table_fill(imm); });
-        gasCounter += kGasCostTable["table_fill"];
+        chargeOp("table.fill", "table_fill");
     }
 
     Result throw_(ExceptionTypeImm imm)
@@ -290,7 +342,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->throw_(imm); });
-        gasCounter += kGasCostTable["throw_"];
+        chargeOp("throw", "throw_");
     }
 
     Result rethrow(RethrowImm imm)
@@ -298,7 +350,7 @@ struct GasVisitor {
         opEmitters.push_back(
                 [imm](CodeStream *codeStream){
                 codeStream->rethrow(imm); });
-        gasCounter += kGasCostTable["rethrow"];
+        chargeOp("rethrow", "rethrow");
     }
 
     void AddGas();
@@ -329,14 +381,14 @@ private:
 void GasVisitor::AddGas()
 {
     Serialization::ArrayOutputStream functionCodes;
-    OperatorEncoderStream  encoder(functionCodes);
+    OperatorEncoderStream  encoder(functionCodes, module.operatorEncoding);
     encoderStream = new CodeValidationProxyStream<OperatorEncoderStream>(
             module, functionDef, encoder);
 
-	OperatorDecoderStream decoder(functionDef.code);
+	OperatorDecoderStream decoder(functionDef.code, module.operatorEncoding);
 	pushControlStack(
 		ControlContext::Type::function, "");
-	while(decoder && controlStack.size()){ decoder.decodeOp(*this); }
+	while(decoder && controlStack.size()){ decoder.decodeOp(*this); ++opIndex; }
     encoderStream->finishValidation();
     functionDef.code = functionCodes.getBytes();
 }
@@ -155,11 +155,11 @@ void ImportFunctionInsertVisitor::AddImportedFunc()
         //update FunctionImm
         FunctionDef& functionDef = module.functions.defs[i];
         Serialization::ArrayOutputStream functionCodes;
-        OperatorEncoderStream  encoder(functionCodes);
+        OperatorEncoderStream  encoder(functionCodes, module.operatorEncoding);
         innerStream = new CodeValidationProxyStream<OperatorEncoderStream>(
                 module, functionDef, encoder);
 
-        OperatorDecoderStream decoder(functionDef.code);
+        OperatorDecoderStream decoder(functionDef.code, module.operatorEncoding);
         pushControlStack(
                 ControlContext::Type::function, "");
         while(decoder && controlStack.size()){ decoder.decodeOp(*this); }
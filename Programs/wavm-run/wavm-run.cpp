@@ -19,7 +19,9 @@
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Serialization.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Runtime/Linker.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/ThreadTest/ThreadTest.h"
@@ -100,7 +102,7 @@ struct RootResolver : Resolver
 			IR::validatePostCodeSections(stubIRModule);
 
 			// Instantiate the module and return the stub function instance.
-			auto stubModule = compileModule(stubIRModule);
+			auto stubModule = compileModule(std::move(stubIRModule));
 			auto stubModuleInstance = instantiateModule(compartment, stubModule, {}, "importStub");
 			return getInstanceExport(stubModuleInstance, "importStub");
 		}
@@ -128,18 +130,26 @@ struct RootResolver : Resolver
 	}
 };
 
-static bool loadModule(const char* filename, IR::Module& outModule)
+static bool loadModule(const char* filename,
+					   IR::Module& outModule,
+					   WASM::FunctionBodyDecoding functionBodyDecoding,
+					   bool mapDataSegments)
 {
-	// Read the specified file into an array.
-	std::vector<U8> fileBytes;
-	if(!loadFile(filename, fileBytes)) { return false; }
-
-	// If the file starts with the WASM binary magic number, load it as a binary irModule.
-	static const U8 wasmMagicNumber[4] = {0x00, 0x61, 0x73, 0x6d};
-	if(fileBytes.size() >= 4 && !memcmp(fileBytes.data(), wasmMagicNumber, 4))
-	{ return WASM::loadBinaryModule(fileBytes.data(), fileBytes.size(), outModule); }
+	// If the file starts with the WASM binary magic number, load it as a binary irModule. Binary
+	// modules are loaded from a mapping of the file, so a precompiled object section is loaded
+	// without copying it, and if mapDataSegments is true, their data segments are mapped into
+	// memory instead of copied when the module is instantiated.
+	if(isBinaryModuleFile(filename))
+	{
+		return WASM::loadBinaryModuleFromFile(
+			filename, outModule, Log::error, functionBodyDecoding, 0, mapDataSegments);
+	}
 	else
 	{
+		// Read the specified file into an array.
+		std::vector<U8> fileBytes;
+		if(!loadFile(filename, fileBytes)) { return false; }
+
 		// Make sure the WAST file is null terminated.
 		fileBytes.push_back(0);
 
@@ -161,80 +171,209 @@ struct CommandLineOptions
 {
 	const char* filename = nullptr;
 	const char* functionName = nullptr;
+	const char* profileFilename = nullptr;
+	const char* gasProfileFilename = nullptr;
 	char** args = nullptr;
 	bool onlyCheck = false;
 	bool enableEmscripten = true;
 	bool enableThreadTest = false;
 	bool precompiled = false;
+	bool mapDataSegments = false;
 };
 
-static int run(const CommandLineOptions& options)
+// Imports a gas function into the module, and calls it from each function body to count the gas
+// it uses. If gasProfile is non-null, each function body also counts how many times each of its
+// blocks runs in the profile's counters, which are in the module's memory at the address in an
+// exported global. Returns false if the module can't be profiled.
+static bool addGasMetering(IR::Module& irModule, GasProfile* gasProfile = nullptr)
 {
-	IR::Module irModule;
+	std::string exportFuncName = "__builtin_add_gas";
+	ImportFunctionInsertVisitor importFunctionInsertVisitor(irModule, exportFuncName);
+	importFunctionInsertVisitor.AddImportedFunc();
+
+	// double check
+	bool found = false;
+	Uptr add_gas_func_index = 0;
+	for(add_gas_func_index = 0; add_gas_func_index < irModule.functions.imports.size();
+		add_gas_func_index++)
+	{
+		auto import_func = irModule.functions.imports[add_gas_func_index];
+		if(import_func.exportName == exportFuncName && import_func.moduleName == "env")
+		{
+			found = true;
+			break;
+		}
+	}
+	if(!found)
+	{
+		printf("can not find  the add gas function\n");
+		exit(-1);
+	}
 
-	// Load the module.
-	if(!loadModule(options.filename, irModule)) { return EXIT_FAILURE; }
-	if(options.onlyCheck) { return EXIT_SUCCESS; }
+	if(gasProfile)
+	{
+		if(!irModule.memories.size())
+		{
+			Log::printf(Log::error, "A module without a memory can't be gas profiled.\n");
+			return false;
+		}
 
-    std::string exportFuncName = "__builtin_add_gas";
-
-    ImportFunctionInsertVisitor importFunctionInsertVisitor(irModule, exportFuncName);
-    importFunctionInsertVisitor.AddImportedFunc();
-
-    // double check
-    bool found = false;
-    Uptr add_gas_func_index = 0;
-    for(add_gas_func_index = 0;
-            add_gas_func_index < irModule.functions.imports.size();
-            add_gas_func_index ++ ) {
-        auto import_func = irModule.functions.imports[add_gas_func_index];
-        if (import_func.exportName == exportFuncName &&
-                import_func.moduleName == "env") {
-            found = true;
-            break;
-        }
-    }
-    if (!found) {
-        printf("can not find  the add gas function\n");
-        exit(-1);
-    }
+		// Add the global that holds the address of the counters after the existing globals, so
+		// the indices of the existing globals don't change.
+		gasProfile->countersGlobalIndex = irModule.globals.size();
+		irModule.globals.defs.push_back(
+			{GlobalType(ValueType::i32, true), InitializerExpression(I32(0))});
+		irModule.exports.push_back(
+			{gasProfileCountersExportName, ExternKind::global, gasProfile->countersGlobalIndex});
+	}
 
-    for (auto& func_def : irModule.functions.defs)
-    {
-        GasVisitor gasVisitor(add_gas_func_index, irModule, func_def);
-        gasVisitor.AddGas();
-    }
+	for(Uptr defIndex = 0; defIndex < irModule.functions.defs.size(); ++defIndex)
+	{
+		GasVisitor gasVisitor(
+			add_gas_func_index, irModule, irModule.functions.defs[defIndex], gasProfile, defIndex);
+		gasVisitor.AddGas();
+	}
 
-    std::string wastStr = WAST::print(irModule);
-    Log::printf(Log::debug,
-            "wasm with gas: %s\n",
-            wastStr.c_str());
+	// Only print the instrumented module if debug logging is enabled, and stream it to the log
+	// instead of building the whole text in memory.
+	if(Log::isCategoryEnabled(Log::debug))
+	{
+		Log::printf(Log::debug, "wasm with gas: ");
+		LogOutputStream stream(Log::debug);
+		WAST::print(stream, irModule);
+		stream.flush();
+		Log::printf(Log::debug, "\n");
+	}
 
-	// Compile the module.
-	Runtime::ModuleRef module = nullptr;
-	if(!options.precompiled) { module = Runtime::compileModule(irModule); }
-	else
+	return true;
+}
+
+// Owns a profiler, and destroys it when it goes out of scope, including when the profiled function
+// traps and the trap unwinds out of run.
+struct ProfilerOwner
+{
+	Runtime::Profiler* profiler = nullptr;
+
+	~ProfilerOwner()
+	{
+		if(profiler) { Runtime::destroyProfiler(profiler); }
+	}
+};
+
+// Writes a profile to a file: in the folded stack format if the filename ends with ".folded", or
+// in the pprof format otherwise.
+static bool writeProfile(Runtime::Profiler* profiler, const char* profileFilename)
+{
+	Platform::File* profileFile = Platform::openFile(profileFilename,
+													 Platform::FileAccessMode::writeOnly,
+													 Platform::FileCreateMode::createAlways);
+	if(!profileFile)
 	{
-		const UserSection* precompiledObjectSection = nullptr;
-		for(const UserSection& userSection : irModule.userSections)
+		Log::printf(Log::error, "Couldn't write %s: couldn't open file.\n", profileFilename);
+		return false;
+	}
+
+	bool succeeded = true;
+	try
+	{
+		const Uptr profileFilenameLength = strlen(profileFilename);
+		FileOutputStream stream(profileFile);
+		if(profileFilenameLength >= 7
+		   && !strcmp(profileFilename + profileFilenameLength - 7, ".folded"))
+		{ Runtime::writeFoldedStacksProfile(profiler, stream); }
+		else
 		{
-			if(userSection.name == "wavm.precompiled_object")
-			{
-				precompiledObjectSection = &userSection;
-				break;
-			}
+			Runtime::writePprofProfile(profiler, stream);
 		}
+		stream.flush();
+	}
+	catch(Serialization::FatalSerializationException const& exception)
+	{
+		Log::printf(Log::error,
+					"Error writing %s:\n%s\n",
+					profileFilename,
+					exception.message.c_str());
+		succeeded = false;
+	}
+	errorUnless(Platform::closeFile(profileFile));
+	return succeeded;
+}
+
+// Writes a report of a gas profile to a file.
+static bool writeGasProfile(const GasProfile& gasProfile,
+							const IR::Module& irModule,
+							const char* moduleDebugName,
+							U64 wallMicroseconds,
+							Runtime::Profiler* profiler,
+							const char* gasProfileFilename)
+{
+	// Use the same names for the functions as the profiler.
+	IR::DisassemblyNames disassemblyNames;
+	IR::getDisassemblyNames(irModule, disassemblyNames);
+	std::vector<std::string> functionNames;
+	for(Uptr defIndex = 0; defIndex < irModule.functions.defs.size(); ++defIndex)
+	{
+		const Uptr functionIndex = irModule.functions.imports.size() + defIndex;
+		functionNames.push_back(std::string("wasm!") + moduleDebugName + "!"
+								+ disassemblyNames.functions[functionIndex].name);
+	}
+
+	std::vector<std::pair<std::string, U64>> functionSampleCounts;
+	if(profiler) { functionSampleCounts = Runtime::getFunctionSampleCounts(profiler); }
+
+	const std::string report = formatGasProfileReport(
+		gasProfile, functionNames, wallMicroseconds, functionSampleCounts);
+	return saveFile(gasProfileFilename, report.data(), report.size());
+}
 
-		if(!precompiledObjectSection)
+static int run(const CommandLineOptions& options)
+{
+	// The compiled module keeps the IR module, so load its code in the compact operator encoding
+	// to reduce the memory it uses.
+	IR::Module irModule;
+	irModule.operatorEncoding = IR::OperatorEncoding::compact;
+
+	// Load the module. A precompiled module's function bodies are only needed to compile it, so
+	// if wavm-compile validated the module, don't decode them unless the module is being checked.
+	const WASM::FunctionBodyDecoding functionBodyDecoding
+		= options.precompiled && !options.onlyCheck
+			  ? WASM::FunctionBodyDecoding::lazyIfValidated
+			  : WASM::FunctionBodyDecoding::eager;
+	if(!loadModule(options.filename, irModule, functionBodyDecoding, options.mapDataSegments))
+	{ return EXIT_FAILURE; }
+	if(options.onlyCheck) { return EXIT_SUCCESS; }
+
+	// Precompiled object code can't be instrumented, so only add gas metering to modules that will
+	// be compiled here.
+	GasProfile gasProfile;
+	if(options.precompiled && options.gasProfileFilename)
+	{
+		Log::printf(Log::error, "A precompiled module can't be gas profiled.\n");
+		return EXIT_FAILURE;
+	}
+	if(!options.enableEmscripten && options.gasProfileFilename)
+	{
+		Log::printf(Log::error, "Gas profiling uses the Emscripten gas functions.\n");
+		return EXIT_FAILURE;
+	}
+	if(!options.precompiled
+	   && !addGasMetering(irModule, options.gasProfileFilename ? &gasProfile : nullptr))
+	{ return EXIT_FAILURE; }
+
+	// Compile the module. The IR module is moved into the compiled module, and read from there
+	// when linking and initializing the module below.
+	Runtime::ModuleRef module = nullptr;
+	if(!options.precompiled) { module = Runtime::compileModule(std::move(irModule)); }
+	else
+	{
+		// Load the object code directly from the precompiled object section, without copying it.
+		module = Runtime::loadPrecompiledModule(std::move(irModule));
+		if(!module)
 		{
 			Log::printf(Log::error,
 						"Input file did not contain 'wavm.precompiled_object' section.\n");
 			return EXIT_FAILURE;
 		}
-		else
-		{
-			module = Runtime::loadPrecompiledModule(irModule, precompiledObjectSection->data);
-		}
 	}
 
 	// Link the module with the intrinsic modules.
@@ -245,7 +384,7 @@ static int run(const CommandLineOptions& options)
 	Emscripten::Instance* emscriptenInstance = nullptr;
 	if(options.enableEmscripten)
 	{
-		emscriptenInstance = Emscripten::instantiate(compartment, irModule);
+		emscriptenInstance = Emscripten::instantiate(compartment, module);
 		if(emscriptenInstance)
 		{
 			rootResolver.moduleNameToInstanceMap.set("env", emscriptenInstance->env);
@@ -262,7 +401,7 @@ static int run(const CommandLineOptions& options)
 		rootResolver.moduleNameToInstanceMap.set("threadTest", threadTestInstance);
 	}
 
-	LinkResult linkResult = linkModule(irModule, rootResolver);
+	LinkResult linkResult = linkModule(getModuleIR(module), rootResolver);
 	if(!linkResult.success)
 	{
 		Log::printf(Log::error, "Failed to link module:\n");
@@ -289,7 +428,7 @@ static int run(const CommandLineOptions& options)
 	if(options.enableEmscripten)
 	{
 		// Call the Emscripten global initalizers.
-		Emscripten::initializeGlobals(emscriptenInstance, context, irModule, moduleInstance);
+		Emscripten::initializeGlobals(emscriptenInstance, context, module, moduleInstance);
 	}
 
 	// Look up the function export to call.
@@ -370,11 +509,71 @@ static int run(const CommandLineOptions& options)
 		}
 	}
 
+	// If a profile was requested, sample the call stacks while the function runs. A gas profile
+	// uses the samples to compare the gas each function uses to its time, but doesn't need them.
+	ProfilerOwner profilerOwner;
+	if(options.profileFilename || options.gasProfileFilename)
+	{
+		profilerOwner.profiler = Runtime::createProfiler();
+		if(!profilerOwner.profiler && options.profileFilename)
+		{
+			Log::printf(Log::error, "Couldn't start profiling: sampling isn't available.\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Allocate the gas profile's counters from the guest's heap, and zero them right before the
+	// function runs, so they cover the same interval as the timer and the samples.
+	U64* gasProfileCounters = nullptr;
+	const Uptr numGasProfileCounters = gasProfile.blocks.size();
+	if(options.gasProfileFilename)
+	{
+		if(numGasProfileCounters > UINT32_MAX / sizeof(U64))
+		{
+			Log::printf(Log::error, "The module has too many blocks to gas profile.\n");
+			return EXIT_FAILURE;
+		}
+		const U32 countersAddress = Emscripten::allocateMemory(
+			emscriptenInstance, U32(numGasProfileCounters * sizeof(U64)));
+		setGlobalValue(
+			context,
+			asGlobal(getInstanceExport(moduleInstance, gasProfileCountersExportName)),
+			I32(countersAddress));
+		gasProfileCounters = memoryArrayPtr<U64>(
+			emscriptenInstance->memory, countersAddress, numGasProfileCounters);
+		memset(gasProfileCounters, 0, numGasProfileCounters * sizeof(U64));
+	}
+
 	// Invoke the function.
 	Timing::Timer executionTimer;
 	IR::ValueTuple functionResults = invokeFunctionChecked(context, function, invokeArgs);
+	const U64 executionMicroseconds = executionTimer.getMicroseconds();
+	if(options.gasProfileFilename)
+	{
+		gasProfile.counters.assign(gasProfileCounters,
+								   gasProfileCounters + numGasProfileCounters);
+	}
 	Timing::logTimer("Invoked function", executionTimer);
 
+	// Stop sampling before writing the profiles, so they don't include samples of the writing.
+	Runtime::Profiler* profiler = profilerOwner.profiler;
+	if(profiler) { Runtime::stopProfiler(profiler); }
+
+	bool wroteProfiles = true;
+	if(options.profileFilename)
+	{ wroteProfiles = writeProfile(profiler, options.profileFilename) && wroteProfiles; }
+	if(options.gasProfileFilename)
+	{
+		wroteProfiles = writeGasProfile(gasProfile,
+										getModuleIR(module),
+										options.filename,
+										executionMicroseconds,
+										profiler,
+										options.gasProfileFilename)
+						&& wroteProfiles;
+	}
+	if(!wroteProfiles) { return EXIT_FAILURE; }
+
 	if(options.enableEmscripten)
     {
         Log::printf(Log::debug,
@@ -412,6 +611,14 @@ static void showHelp()
 				"  --disable-emscripten  Disable Emscripten intrinsics\n"
 				"  --enable-thread-test  Enable ThreadTest intrinsics\n"
 				"  --precompiled         Use precompiled object code in programfile\n"
+				"  --map-data-segments   Map data segments from programfile into memory instead of\n"
+				"                        copying them; programfile must not change while running\n"
+				"  --perf-map            Write /tmp/perf-<pid>.map for the Linux perf tool\n"
+				"  --perf-jitdump        Write jit-<pid>.dump for perf inject --jit\n"
+				"  --profile file        Write a sampled CPU profile of the function to file\n"
+				"                        (folded stacks if file ends in .folded, else pprof)\n"
+				"  --gas-profile file    Write the gas used by each function, block, and operator\n"
+				"                        to file, and compare it to the sampled CPU time\n"
 				"  --metrics             Write benchmarking information to stdout\n"
 				"  --                    Stop parsing arguments\n");
 }
@@ -455,6 +662,36 @@ int main(int argc, char** argv)
 		{
 			options.precompiled = true;
 		}
+		else if(!strcmp(*options.args, "--map-data-segments"))
+		{
+			options.mapDataSegments = true;
+		}
+		else if(!strcmp(*options.args, "--perf-map"))
+		{
+			if(!LLVMJIT::enablePerfMap()) { return EXIT_FAILURE; }
+		}
+		else if(!strcmp(*options.args, "--perf-jitdump"))
+		{
+			if(!LLVMJIT::enablePerfJITDump(".")) { return EXIT_FAILURE; }
+		}
+		else if(!strcmp(*options.args, "--profile"))
+		{
+			if(!*++options.args)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			options.profileFilename = *options.args;
+		}
+		else if(!strcmp(*options.args, "--gas-profile"))
+		{
+			if(!*++options.args)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			options.gasProfileFilename = *options.args;
+		}
 		else if(!strcmp(*options.args, "--"))
 		{
 			++options.args;
@@ -488,5 +725,13 @@ int main(int argc, char** argv)
 										Errors::fatalf("Runtime exception: %s",
 													   describeException(exception).c_str());
 									});
+
+	// Print the metrics that were recorded while running the program.
+	if(Log::isCategoryEnabled(Log::metrics))
+	{
+		const std::string metricsText = Metrics::exportText(Metrics::getSnapshot());
+		Log::printf(Log::metrics, "%s", metricsText.c_str());
+	}
+
 	return result;
 }
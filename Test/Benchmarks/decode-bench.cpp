@@ -0,0 +1,231 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "WAVM/IR/IR.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/CLI.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Serialization.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Inline/Unicode.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/WASM/WASM.h"
+#include "WAVM/WASTParse/TestScript.h"
+#include "WAVM/WASTParse/WASTParse.h"
+
+enum
+{
+	numSyntheticLEBs = 1000000,
+	numRepeats = 16
+};
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::WAST;
+
+static void serializeModule(const Module& module, std::vector<std::vector<U8>>& outBinaries)
+{
+	Serialization::ArrayOutputStream stream;
+	WASM::serialize(stream, module);
+	outBinaries.push_back(stream.getBytes());
+}
+
+// Adds the binary encoding of each valid module in a WAST file or test script to outBinaries, or
+// adds the file itself if it is a WebAssembly binary.
+static bool loadCorpusFile(const char* filename, std::vector<std::vector<U8>>& outBinaries)
+{
+	std::vector<U8> fileBytes;
+	if(!loadFile(filename, fileBytes)) { return false; }
+
+	if(fileBytes.size() >= 4 && !memcmp(fileBytes.data(), "\0asm", 4))
+	{
+		outBinaries.push_back(std::move(fileBytes));
+		return true;
+	}
+
+	// Make sure the file is null terminated.
+	fileBytes.push_back(0);
+
+	std::vector<std::unique_ptr<Command>> testCommands;
+	std::vector<WAST::Error> testErrors;
+	FeatureSpec featureSpec;
+	WAST::parseTestCommands(
+		(const char*)fileBytes.data(), fileBytes.size(), featureSpec, testCommands, testErrors);
+	if(testErrors.size())
+	{
+		WAST::reportParseErrors(filename, testErrors);
+		return false;
+	}
+
+	for(const auto& command : testCommands)
+	{
+		if(command->type == Command::action)
+		{
+			auto actionCommand = (ActionCommand*)command.get();
+			if(actionCommand->action->type == ActionType::_module)
+			{
+				auto moduleAction = (ModuleAction*)actionCommand->action.get();
+				serializeModule(*moduleAction->module, outBinaries);
+			}
+		}
+		else if(command->type == Command::assert_unlinkable)
+		{
+			auto assertUnlinkableCommand = (AssertUnlinkableCommand*)command.get();
+			serializeModule(*assertUnlinkableCommand->moduleAction->module, outBinaries);
+		}
+	}
+	return true;
+}
+
+// Loads every module in the corpus, and logs the decode speed in bytes per second.
+static void runLoadBenchmark(const std::vector<std::vector<U8>>& binaries)
+{
+	Uptr numBytes = 0;
+	for(const std::vector<U8>& binary : binaries) { numBytes += binary.size(); }
+
+	Timing::Timer timer;
+	for(Uptr repeatIndex = 0; repeatIndex < numRepeats; ++repeatIndex)
+	{
+		for(const std::vector<U8>& binary : binaries)
+		{
+			Module module;
+			errorUnless(WASM::loadBinaryModule(binary.data(), binary.size(), module));
+		}
+	}
+	timer.stop();
+
+	Log::printf(Log::output,
+				"load %" PRIuPTR " modules (%.1f KB): %.1f MB/s\n",
+				binaries.size(),
+				F64(numBytes) / 1024.0,
+				F64(numBytes) * numRepeats / F64(timer.getMicroseconds()));
+}
+
+// Decodes a synthetic stream of LEB128 integers with a mix of lengths similar to code section
+// immediates, and logs the decode speed in bytes per second.
+static void runLEBBenchmark()
+{
+	Serialization::ArrayOutputStream encodeStream;
+	U32 random = 1;
+	for(Uptr index = 0; index < numSyntheticLEBs; ++index)
+	{
+		random = random * 1103515245 + 12345;
+
+		// Mostly small local indices and alignments, with some larger offsets and constants.
+		U32 value = random >> 16;
+		switch(random % 8)
+		{
+		case 0: value = random; break;
+		case 1:
+		case 2: value &= 0x3fff; break;
+		default: value &= 0x7f; break;
+		};
+		Serialization::serializeVarUInt32(encodeStream, value);
+	}
+	const std::vector<U8> bytes = encodeStream.getBytes();
+
+	U32 checksum = 0;
+	Timing::Timer timer;
+	for(Uptr repeatIndex = 0; repeatIndex < numRepeats; ++repeatIndex)
+	{
+		Serialization::MemoryInputStream stream(bytes.data(), bytes.size());
+		for(Uptr index = 0; index < numSyntheticLEBs; ++index)
+		{
+			U32 value;
+			Serialization::serializeVarUInt32(stream, value);
+			checksum += value;
+		}
+	}
+	timer.stop();
+
+	Log::printf(Log::output,
+				"decode %u LEB128 integers (%.1f KB): %.1f MB/s (checksum %u)\n",
+				U32(numSyntheticLEBs),
+				F64(bytes.size()) / 1024.0,
+				F64(bytes.size()) * numRepeats / F64(timer.getMicroseconds()),
+				checksum);
+}
+
+template<typename Type>
+static void addImportNames(const std::vector<Import<Type>>& imports,
+						   std::vector<std::string>& outNames)
+{
+	for(const Import<Type>& import : imports)
+	{
+		outNames.push_back(import.moduleName);
+		outNames.push_back(import.exportName);
+	}
+}
+
+// Validates the import, export, and custom section names in the corpus as UTF-8, and logs the
+// validation speed in bytes per second.
+static void runUTF8Benchmark(const std::vector<std::vector<U8>>& binaries)
+{
+	std::vector<std::string> names;
+	Uptr numNameBytes = 0;
+	for(const std::vector<U8>& binary : binaries)
+	{
+		Module module;
+		errorUnless(WASM::loadBinaryModule(binary.data(), binary.size(), module));
+		addImportNames(module.functions.imports, names);
+		addImportNames(module.tables.imports, names);
+		addImportNames(module.memories.imports, names);
+		addImportNames(module.globals.imports, names);
+		addImportNames(module.exceptionTypes.imports, names);
+		for(const Export& export_ : module.exports) { names.push_back(export_.name); }
+		for(const UserSection& userSection : module.userSections)
+		{ names.push_back(userSection.name); }
+	}
+	for(const std::string& name : names) { numNameBytes += name.size(); }
+
+	// Repeat more times than the other benchmarks, since the names are short.
+	const Uptr numUTF8Repeats = numRepeats * 64;
+	Uptr numValidNames = 0;
+	Timing::Timer timer;
+	for(Uptr repeatIndex = 0; repeatIndex < numUTF8Repeats; ++repeatIndex)
+	{
+		for(const std::string& name : names)
+		{
+			const U8* endChar = (const U8*)name.data() + name.size();
+			if(Unicode::validateUTF8String((const U8*)name.data(), endChar) == endChar)
+			{ ++numValidNames; }
+		}
+	}
+	timer.stop();
+	errorUnless(numValidNames == names.size() * numUTF8Repeats);
+
+	Log::printf(Log::output,
+				"validate %" PRIuPTR " names (%.1f KB) as UTF-8: %.1f MB/s\n",
+				names.size(),
+				F64(numNameBytes) / 1024.0,
+				F64(numNameBytes) * numUTF8Repeats / F64(timer.getMicroseconds()));
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		Log::printf(Log::error, "Usage: decode-bench <in.wast|in.wasm>...\n");
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::vector<U8>> binaries;
+	for(int argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		if(!loadCorpusFile(argv[argIndex], binaries)) { return EXIT_FAILURE; }
+	}
+
+	Log::printf(Log::output, "Benchmarking, averaged over %u repeats\n", U32(numRepeats));
+
+	runLoadBenchmark(binaries);
+	runLEBBenchmark();
+	runUTF8Benchmark(binaries);
+
+	return 0;
+}
@@ -17,10 +17,12 @@
 #include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/Runtime/RuntimeData.h"
+#include "WAVM/Runtime/TypedFunction.h"
 
 enum
 {
-	numInvokesPerThread = 100000
+	numInvokesPerThread = 100000,
+	numInvokesPerBatch = 1000
 };
 
 using namespace WAVM;
@@ -111,7 +113,7 @@ int main(int argc, char** argv)
 
 	// Instantiate the module and return the stub function instance.
 	GCPointer<Compartment> compartment = Runtime::createCompartment();
-	auto module = compileModule(irModule);
+	auto module = compileModule(std::move(irModule));
 	auto moduleInstance = instantiateModule(compartment, module, {}, "nopModule");
 	auto nopFunction = asFunction(getInstanceExport(moduleInstance, "nopFunction"));
 
@@ -170,6 +172,48 @@ int main(int argc, char** argv)
 			return 0;
 		});
 
+	// Benchmark TypedFunction.
+	runBenchmarkSingleAndMultiThreaded(
+		compartment, nopFunction, "TypedFunction", [](void* argument) -> I64 {
+			ThreadArgs* threadArgs = (ThreadArgs*)argument;
+
+			TypedFunction<I32(I32)> typedNopFunction(threadArgs->context, threadArgs->nopFunction);
+
+			Timing::Timer timer;
+			for(Uptr repeatIndex = 0; repeatIndex < numInvokesPerThread; ++repeatIndex)
+			{ typedNopFunction(0); }
+			timer.stop();
+
+			threadArgs->elapsedMicroseconds = timer.getMicroseconds();
+
+			return 0;
+		});
+
+	// Benchmark invokeFunctionBatch.
+	runBenchmarkSingleAndMultiThreaded(
+		compartment, nopFunction, "invokeFunctionBatch", [](void* argument) -> I64 {
+			ThreadArgs* threadArgs = (ThreadArgs*)argument;
+
+			std::vector<UntaggedValue> functionArgs(numInvokesPerBatch, UntaggedValue{I32(0)});
+			std::vector<UntaggedValue> functionResults(numInvokesPerBatch);
+
+			Timing::Timer timer;
+			for(Uptr batchIndex = 0; batchIndex < numInvokesPerThread / numInvokesPerBatch;
+				++batchIndex)
+			{
+				invokeFunctionBatch(threadArgs->context,
+									threadArgs->nopFunction,
+									functionArgs.data(),
+									numInvokesPerBatch,
+									functionResults.data());
+			}
+			timer.stop();
+
+			threadArgs->elapsedMicroseconds = timer.getMicroseconds();
+
+			return 0;
+		});
+
 	// Free the compartment.
 	errorUnless(tryCollectCompartment(std::move(compartment)));
 
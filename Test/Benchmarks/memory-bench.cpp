@@ -0,0 +1,143 @@
+#include <inttypes.h>
+#include <string.h>
+#include <string>
+#include <utility>
+
+#include "WAVM/IR/IR.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Runtime/Runtime.h"
+
+enum
+{
+	numMemoryPages = 1024,
+	numGrowPagesPerStep = 16,
+	numRepeats = 8
+};
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// Writes to every platform page in a range of a memory, so that each page is faulted in if it
+// wasn't already.
+static void touchMemoryPages(Memory* memory, Uptr firstPageIndex, Uptr numPages)
+{
+	const Uptr platformPageBytes = Uptr(1) << Platform::getPageSizeLog2();
+	U8* baseAddress = getMemoryBaseAddress(memory) + firstPageIndex * IR::numBytesPerPage;
+	for(Uptr offset = 0; offset < numPages * IR::numBytesPerPage; offset += platformPageBytes)
+	{ baseAddress[offset] = U8(offset); }
+}
+
+// Creates a memory with the full size up front, and then touches every page of it.
+static void runCreateBenchmark(Compartment* compartment,
+							   const MemoryPolicy& policy,
+							   const char* description)
+{
+	U64 createMicroseconds = 0;
+	U64 touchMicroseconds = 0;
+	for(Uptr repeatIndex = 0; repeatIndex < numRepeats; ++repeatIndex)
+	{
+		Timing::Timer createTimer;
+		Memory* memory = createMemory(
+			compartment, MemoryType(false, SizeConstraints{numMemoryPages, numMemoryPages}), "", policy);
+		errorUnless(memory);
+		createTimer.stop();
+
+		Timing::Timer touchTimer;
+		touchMemoryPages(memory, 0, numMemoryPages);
+		touchTimer.stop();
+
+		createMicroseconds += createTimer.getMicroseconds();
+		touchMicroseconds += touchTimer.getMicroseconds();
+
+		collectCompartmentGarbage(compartment);
+	}
+
+	Log::printf(Log::output,
+				"%s: create %.1fms, touch %.1fms, total %.1fms\n",
+				description,
+				F64(createMicroseconds) / numRepeats / 1000.0,
+				F64(touchMicroseconds) / numRepeats / 1000.0,
+				F64(createMicroseconds + touchMicroseconds) / numRepeats / 1000.0);
+}
+
+// Creates an empty memory, and then grows it in small steps, touching the new pages after each.
+static void runGrowBenchmark(Compartment* compartment,
+							 const MemoryPolicy& policy,
+							 const char* description)
+{
+	U64 totalMicroseconds = 0;
+	for(Uptr repeatIndex = 0; repeatIndex < numRepeats; ++repeatIndex)
+	{
+		Memory* memory = createMemory(
+			compartment, MemoryType(false, SizeConstraints{0, numMemoryPages}), "", policy);
+		errorUnless(memory);
+
+		Timing::Timer timer;
+		for(Uptr numPages = 0; numPages < numMemoryPages; numPages += numGrowPagesPerStep)
+		{
+			errorUnless(growMemory(memory, numGrowPagesPerStep) == Iptr(numPages));
+			touchMemoryPages(memory, numPages, numGrowPagesPerStep);
+		}
+		timer.stop();
+
+		totalMicroseconds += timer.getMicroseconds();
+
+		collectCompartmentGarbage(compartment);
+	}
+
+	Log::printf(Log::output,
+				"%s: grow+touch %.1fms\n",
+				description,
+				F64(totalMicroseconds) / numRepeats / 1000.0);
+}
+
+int main(int argc, char** argv)
+{
+	GCPointer<Compartment> compartment = Runtime::createCompartment();
+
+	Log::printf(Log::output,
+				"Benchmarking %u 64KB pages (%u MB) per memory, averaged over %u repeats\n",
+				U32(numMemoryPages),
+				U32(numMemoryPages / 16),
+				U32(numRepeats));
+
+	MemoryPolicy defaultPolicy;
+
+	MemoryPolicy hugePagePolicy;
+	hugePagePolicy.useHugePages = true;
+
+	MemoryPolicy prefaultPolicy;
+	prefaultPolicy.prefaultInitialPages = true;
+
+	MemoryPolicy hugePagePrefaultPolicy;
+	hugePagePrefaultPolicy.useHugePages = true;
+	hugePagePrefaultPolicy.prefaultInitialPages = true;
+
+	MemoryPolicy prefaultGrowthPolicy;
+	prefaultGrowthPolicy.prefaultGrownPages = true;
+
+	MemoryPolicy hugePagePrefaultGrowthPolicy;
+	hugePagePrefaultGrowthPolicy.useHugePages = true;
+	hugePagePrefaultGrowthPolicy.prefaultGrownPages = true;
+
+	runCreateBenchmark(compartment, defaultPolicy, "default");
+	runCreateBenchmark(compartment, hugePagePolicy, "huge pages");
+	runCreateBenchmark(compartment, prefaultPolicy, "prefault initial pages");
+	runCreateBenchmark(compartment, hugePagePrefaultPolicy, "huge pages+prefault initial pages");
+
+	runGrowBenchmark(compartment, defaultPolicy, "default");
+	runGrowBenchmark(compartment, hugePagePolicy, "huge pages");
+	runGrowBenchmark(compartment, prefaultGrowthPolicy, "prefault grown pages");
+	runGrowBenchmark(compartment, hugePagePrefaultGrowthPolicy, "huge pages+prefault grown pages");
+
+	// Free the compartment.
+	errorUnless(tryCollectCompartment(std::move(compartment)));
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include <inttypes.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "WAVM/IR/IR.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Operators.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/CLI.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Serialization.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/WASM/WASM.h"
+
+enum
+{
+	numSyntheticFunctions = 2000,
+	numSyntheticOpsPerFunction = 512,
+	numRepeats = 16
+};
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+// A visitor that just counts the operators it visits.
+struct OperatorCounter
+{
+	typedef void Result;
+
+	Uptr numOperators = 0;
+
+#define VISIT_OPCODE(_, name, nameString, Imm, ...)                                                \
+	void name(Imm imm) { ++numOperators; }
+	ENUM_OPERATORS(VISIT_OPCODE)
+#undef VISIT_OPCODE
+
+	void unknown(Opcode opcode) { Errors::unreachable(); }
+};
+
+// Creates a module with function bodies that have a mix of operators similar to typical compiled
+// C code: mostly local accesses, constants, arithmetic, loads and stores, and some calls and
+// branches. The code isn't valid, but is only decoded, not validated.
+static void createSyntheticModule(Module& outModule)
+{
+	outModule.types.push_back(FunctionType());
+	for(Uptr functionIndex = 0; functionIndex < numSyntheticFunctions; ++functionIndex)
+	{
+		Serialization::ArrayOutputStream codeStream;
+		OperatorEncoderStream encoder(codeStream);
+		for(Uptr opIndex = 0; opIndex < numSyntheticOpsPerFunction; opIndex += 8)
+		{
+			encoder.local_get({opIndex % 7});
+			encoder.i32_const({I32(opIndex * 37)});
+			encoder.i32_add();
+			encoder.i32_load({2, U32(opIndex * 4)});
+			encoder.local_tee({opIndex % 5});
+			encoder.br_if({opIndex % 3});
+			encoder.call({(functionIndex + opIndex) % numSyntheticFunctions});
+			encoder.drop();
+		}
+		encoder.end();
+
+		outModule.functions.defs.push_back({{0}, {}, std::move(codeStream.getBytes()), {}});
+		outModule.functions.defs.back().code.shrink_to_fit();
+	}
+}
+
+static Uptr getNumCodeBytes(const Module& module)
+{
+	Uptr numCodeBytes = 0;
+	for(const FunctionDef& functionDef : module.functions.defs)
+	{ numCodeBytes += functionDef.code.size(); }
+	return numCodeBytes;
+}
+
+// Decodes all the operators in a module, and logs the code size and decode speed.
+static void runDecodeBenchmark(const Module& module, const char* description)
+{
+	Uptr numOperators = 0;
+	Timing::Timer timer;
+	for(Uptr repeatIndex = 0; repeatIndex < numRepeats; ++repeatIndex)
+	{
+		OperatorCounter counter;
+		for(const FunctionDef& functionDef : module.functions.defs)
+		{
+			OperatorDecoderStream decoder(functionDef.code, module.operatorEncoding);
+			while(decoder) { decoder.decodeOp(counter); }
+		}
+		numOperators = counter.numOperators;
+	}
+	timer.stop();
+
+	const Uptr numCodeBytes = getNumCodeBytes(module);
+	Log::printf(Log::output,
+				"%s: %.1f KB (%.2f bytes/op), decoded %.1f Mops/s (%.2fms per decode)\n",
+				description,
+				F64(numCodeBytes) / 1024.0,
+				F64(numCodeBytes) / F64(numOperators),
+				F64(numOperators) * numRepeats / F64(timer.getMicroseconds()),
+				timer.getMilliseconds() / numRepeats);
+}
+
+int main(int argc, char** argv)
+{
+	Module module;
+	if(argc == 2)
+	{
+		// Load the module from a binary file specified on the command-line.
+		if(!WASM::loadBinaryModuleFromFile(argv[1], module)) { return EXIT_FAILURE; }
+	}
+	else if(argc == 1)
+	{
+		createSyntheticModule(module);
+	}
+	else
+	{
+		Log::printf(Log::error, "Usage: operator-encoding-bench [in.wasm]\n");
+		return EXIT_FAILURE;
+	}
+
+	Log::printf(Log::output,
+				"Benchmarking %" PRIuPTR " function definitions, averaged over %u repeats\n",
+				module.functions.defs.size(),
+				U32(numRepeats));
+
+	runDecodeBenchmark(module, "fixed");
+
+	Timing::Timer compactTimer;
+	setOperatorEncoding(module, OperatorEncoding::compact);
+	compactTimer.stop();
+	Log::printf(
+		Log::output, "re-encoding as compact: %.2fms\n", compactTimer.getMilliseconds());
+
+	runDecodeBenchmark(module, "compact");
+
+	return 0;
+}
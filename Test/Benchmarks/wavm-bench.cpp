@@ -0,0 +1,882 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Operators.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Validate.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/CLI.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/Serialization.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Linker.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
+#include "WAVM/WASTParse/TestScript.h"
+#include "WAVM/WASTParse/WASTParse.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+//
+// Performance counters
+//
+
+// The counters that each repetition of a phase is measured with: name, perf_event type, config.
+#define ENUM_PERF_COUNTERS(visit)                                                                  \
+	visit(cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES)                                    \
+	visit(instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS)                            \
+	visit(cacheMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES)                             \
+	visit(iTLBMisses,                                                                              \
+		  PERF_TYPE_HW_CACHE,                                                                      \
+		  PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)                            \
+			  | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))                                           \
+	visit(pageFaults, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS)
+
+enum
+{
+#define VISIT_PERF_COUNTER(name, ...) +1
+	numPerfCounters = 0 ENUM_PERF_COUNTERS(VISIT_PERF_COUNTER)
+#undef VISIT_PERF_COUNTER
+};
+
+static const char* perfCounterNames[numPerfCounters] = {
+#define VISIT_PERF_COUNTER(name, ...) #name,
+	ENUM_PERF_COUNTERS(VISIT_PERF_COUNTER)
+#undef VISIT_PERF_COUNTER
+};
+
+// Counts events on the calling thread with perf_event_open. Each counter is opened separately, so
+// a counter the CPU or kernel doesn't support (e.g. hardware counters in a VM, or when
+// perf_event_paranoid forbids them) is left out without losing the others.
+struct PerfCounters
+{
+	PerfCounters()
+	{
+#ifdef __linux__
+		const U32 types[numPerfCounters] = {
+#define VISIT_PERF_COUNTER(name, type, config) type,
+			ENUM_PERF_COUNTERS(VISIT_PERF_COUNTER)
+#undef VISIT_PERF_COUNTER
+		};
+		const U64 configs[numPerfCounters] = {
+#define VISIT_PERF_COUNTER(name, type, config) config,
+			ENUM_PERF_COUNTERS(VISIT_PERF_COUNTER)
+#undef VISIT_PERF_COUNTER
+		};
+		for(Uptr counterIndex = 0; counterIndex < numPerfCounters; ++counterIndex)
+		{
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = types[counterIndex];
+			attr.config = configs[counterIndex];
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			fds[counterIndex] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+#else
+		for(Uptr counterIndex = 0; counterIndex < numPerfCounters; ++counterIndex)
+		{ fds[counterIndex] = -1; }
+#endif
+	}
+
+	~PerfCounters()
+	{
+#ifdef __linux__
+		for(int fd : fds)
+		{
+			if(fd >= 0) { close(fd); }
+		}
+#endif
+	}
+
+	bool isOpen(Uptr counterIndex) const { return fds[counterIndex] >= 0; }
+
+	void start()
+	{
+#ifdef __linux__
+		for(int fd : fds)
+		{
+			if(fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+	}
+
+	void stop(U64 outValues[numPerfCounters])
+	{
+		for(Uptr counterIndex = 0; counterIndex < numPerfCounters; ++counterIndex)
+		{
+			outValues[counterIndex] = 0;
+#ifdef __linux__
+			const int fd = fds[counterIndex];
+			if(fd < 0) { continue; }
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+			// If the kernel multiplexed the counter with others, scale its value by the fraction
+			// of the time it was counting.
+			U64 readValues[3];
+			if(read(fd, readValues, sizeof(readValues)) == sizeof(readValues) && readValues[2])
+			{
+				outValues[counterIndex]
+					= U64(F64(readValues[0]) * F64(readValues[1]) / F64(readValues[2]));
+			}
+#endif
+		}
+	}
+
+private:
+	int fds[numPerfCounters];
+};
+
+//
+// Measurement
+//
+
+struct Options
+{
+	std::vector<std::string> filenames;
+	bool showHelp = false;
+	const char* filter = nullptr;
+	const char* outputFilename = nullptr;
+	bool includeGeneratedModules = true;
+
+	// Each phase is repeated at least minRepetitions times, until the wall-clock times of the last
+	// minRepetitions repetitions have a relative standard deviation of at most maxRelativeStdDev,
+	// or until maxRepetitions or maxSecondsPerPhase is reached.
+	Uptr minRepetitions = 5;
+	Uptr maxRepetitions = 50;
+	F64 maxSecondsPerPhase = 10.0;
+	F64 maxRelativeStdDev = 0.02;
+};
+
+struct PhaseSample
+{
+	U64 nanoseconds;
+	U64 counters[numPerfCounters];
+};
+
+struct PhaseResult
+{
+	std::string corpusName;
+	const char* phaseName;
+
+	// The number of operations each repetition performs, e.g. the number of functions invoked.
+	Uptr numIterations;
+
+	std::vector<PhaseSample> samples;
+	bool isStable;
+};
+
+struct Benchmark
+{
+	const Options& options;
+	PerfCounters perfCounters;
+	std::vector<PhaseResult> results;
+
+	Benchmark(const Options& inOptions) : options(inOptions) {}
+
+	// Measures repetitions of a phase. reset is called before each repetition to discard the
+	// previous repetition's results, and isn't measured. run returns false if the phase failed, in
+	// which case the phase isn't measured further.
+	template<typename Reset, typename Run>
+	bool measurePhase(const std::string& corpusName,
+					  const char* phaseName,
+					  Uptr numIterations,
+					  Reset&& reset,
+					  Run&& run)
+	{
+		Log::printf(Log::debug, "%s: %s\n", corpusName.c_str(), phaseName);
+
+		// Run the phase once before measuring it, so one-time costs like page faults on the first
+		// use of an allocator's memory aren't measured.
+		reset();
+		if(!run())
+		{
+			Log::printf(Log::error, "%s: %s failed.\n", corpusName.c_str(), phaseName);
+			return false;
+		}
+
+		PhaseResult result;
+		result.corpusName = corpusName;
+		result.phaseName = phaseName;
+		result.numIterations = numIterations;
+		result.isStable = false;
+
+		const auto phaseStartTime = std::chrono::steady_clock::now();
+		while(result.samples.size() < options.maxRepetitions)
+		{
+			reset();
+
+			PhaseSample sample;
+			perfCounters.start();
+			const auto startTime = std::chrono::steady_clock::now();
+			const bool succeeded = run();
+			const auto endTime = std::chrono::steady_clock::now();
+			perfCounters.stop(sample.counters);
+			if(!succeeded)
+			{
+				Log::printf(Log::error, "%s: %s failed.\n", corpusName.c_str(), phaseName);
+				return false;
+			}
+
+			sample.nanoseconds = U64(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count());
+			result.samples.push_back(sample);
+
+			if(result.samples.size() >= options.minRepetitions)
+			{
+				result.isStable = isStable(result.samples);
+				const F64 elapsedSeconds
+					= std::chrono::duration<F64>(std::chrono::steady_clock::now() - phaseStartTime)
+						  .count();
+				if(result.isStable || elapsedSeconds >= options.maxSecondsPerPhase) { break; }
+			}
+		}
+
+		results.push_back(std::move(result));
+		return true;
+	}
+
+private:
+	bool isStable(const std::vector<PhaseSample>& samples) const
+	{
+		F64 sum = 0.0;
+		F64 sumSquares = 0.0;
+		for(Uptr sampleIndex = samples.size() - options.minRepetitions;
+			sampleIndex < samples.size();
+			++sampleIndex)
+		{
+			const F64 nanoseconds = F64(samples[sampleIndex].nanoseconds);
+			sum += nanoseconds;
+			sumSquares += nanoseconds * nanoseconds;
+		}
+		const F64 mean = sum / F64(options.minRepetitions);
+		const F64 variance = std::max(0.0, sumSquares / F64(options.minRepetitions) - mean * mean);
+		return mean == 0.0 || sqrt(variance) / mean <= options.maxRelativeStdDev;
+	}
+};
+
+//
+// Phases
+//
+
+// Resolves imports to stub objects, so modules that import from WASI, Emscripten, or other modules
+// in a test script can be instantiated without them. Calling a stub function traps.
+struct StubResolver : Resolver
+{
+	Compartment* compartment = nullptr;
+
+	bool resolve(const std::string& moduleName,
+				 const std::string& exportName,
+				 ExternType type,
+				 Object*& outObject) override
+	{
+		switch(type.kind)
+		{
+		case ExternKind::function:
+		{
+			ModuleRef& stubModule = stubModules.getOrAdd(asFunctionType(type), nullptr);
+			if(!stubModule) { stubModule = compileStubModule(asFunctionType(type)); }
+			outObject = getInstanceExport(
+				instantiateModule(compartment, stubModule, {}, "importStub"), "importStub");
+			return true;
+		}
+		case ExternKind::table:
+			outObject = asObject(createTable(compartment, asTableType(type), "importStub"));
+			return outObject != nullptr;
+		case ExternKind::memory:
+			outObject = asObject(createMemory(compartment, asMemoryType(type), "importStub"));
+			return outObject != nullptr;
+		case ExternKind::global:
+			outObject = asObject(createGlobal(compartment, asGlobalType(type)));
+			return true;
+		case ExternKind::exceptionType:
+			outObject = asObject(
+				createExceptionType(compartment, asExceptionType(type), "importStub"));
+			return true;
+		default: Errors::unreachable();
+		};
+	}
+
+private:
+	HashMap<FunctionType, ModuleRef> stubModules;
+
+	static ModuleRef compileStubModule(FunctionType type)
+	{
+		Serialization::ArrayOutputStream codeStream;
+		OperatorEncoderStream encoder(codeStream);
+		encoder.unreachable();
+		encoder.end();
+
+		IR::Module stubModule;
+		stubModule.types.push_back(type);
+		stubModule.functions.defs.push_back({{0}, {}, std::move(codeStream.getBytes()), {}});
+		stubModule.exports.push_back({"importStub", ExternKind::function, 0});
+		validatePreCodeSections(stubModule);
+		validatePostCodeSections(stubModule);
+		return compileModule(std::move(stubModule));
+	}
+};
+
+enum
+{
+	numInvokesPerRepetition = 10000,
+	numExecuteLoopIterations = 1000000
+};
+
+// Measures each phase of running a test script's modules, from parsing the text to executing the
+// code. Each phase is measured for all the modules defined by the script's module commands.
+static void benchmarkScript(Benchmark& benchmark,
+							const std::string& corpusName,
+							const std::vector<U8>& scriptBytes)
+{
+	FeatureSpec featureSpec;
+	featureSpec.requireSharedFlagForAtomicOperators = true;
+
+	// Parse the script. This also validates the modules it defines.
+	std::vector<std::unique_ptr<WAST::Command>> commands;
+	std::vector<WAST::Error> parseErrors;
+	if(!benchmark.measurePhase(
+		   corpusName,
+		   "parse",
+		   1,
+		   [&] {
+			   commands.clear();
+			   parseErrors.clear();
+		   },
+		   [&] {
+			   WAST::parseTestCommands((const char*)scriptBytes.data(),
+									   scriptBytes.size(),
+									   featureSpec,
+									   commands,
+									   parseErrors);
+			   return parseErrors.empty();
+		   }))
+	{
+		WAST::reportParseErrors(corpusName.c_str(), parseErrors);
+		return;
+	}
+
+	// The IR modules are shared with the compiled modules, so each phase that compiles or loads
+	// them doesn't copy them.
+	std::vector<std::shared_ptr<const IR::Module>> irModules;
+	for(std::unique_ptr<WAST::Command>& command : commands)
+	{
+		if(command->type != WAST::Command::action) { continue; }
+		WAST::Action* action = static_cast<WAST::ActionCommand*>(command.get())->action.get();
+		if(action->type == WAST::ActionType::_module)
+		{ irModules.push_back(static_cast<WAST::ModuleAction*>(action)->module); }
+	}
+	commands.clear();
+	if(irModules.empty()) { return; }
+
+	// Decode and validate the binary encoding of the modules.
+	std::vector<std::vector<U8>> wasmBytes;
+	for(const std::shared_ptr<const IR::Module>& irModule : irModules)
+	{
+		Serialization::ArrayOutputStream stream;
+		WASM::serialize(stream, *irModule);
+		wasmBytes.push_back(std::move(stream.getBytes()));
+	}
+	std::vector<IR::Module> decodedModules;
+	if(!benchmark.measurePhase(
+		   corpusName,
+		   "validate",
+		   irModules.size(),
+		   [&] { decodedModules.clear(); },
+		   [&] {
+			   for(Uptr moduleIndex = 0; moduleIndex < irModules.size(); ++moduleIndex)
+			   {
+				   decodedModules.emplace_back(irModules[moduleIndex]->featureSpec);
+				   if(!WASM::loadBinaryModule(wasmBytes[moduleIndex].data(),
+											  wasmBytes[moduleIndex].size(),
+											  decodedModules.back()))
+				   { return false; }
+			   }
+			   return true;
+		   }))
+	{ return; }
+	decodedModules.clear();
+
+	// Compile the modules to object code.
+	std::vector<ModuleRef> modules;
+	if(!benchmark.measurePhase(
+		   corpusName,
+		   "compile",
+		   irModules.size(),
+		   [&] { modules.clear(); },
+		   [&] {
+			   for(const std::shared_ptr<const IR::Module>& irModule : irModules)
+			   { modules.push_back(compileModule(irModule)); }
+			   return true;
+		   }))
+	{ return; }
+
+	// Load the object code.
+	std::vector<std::vector<U8>> objectCodes;
+	for(const ModuleRef& module : modules) { objectCodes.push_back(getObjectCode(module)); }
+	if(!benchmark.measurePhase(
+		   corpusName,
+		   "load",
+		   irModules.size(),
+		   [&] { modules.clear(); },
+		   [&] {
+			   for(Uptr moduleIndex = 0; moduleIndex < irModules.size(); ++moduleIndex)
+			   {
+				   modules.push_back(loadPrecompiledModule(
+					   irModules[moduleIndex], std::vector<U8>(objectCodes[moduleIndex])));
+			   }
+			   return true;
+		   }))
+	{ return; }
+
+	// Instantiate the modules in a new compartment. Linking them to stub imports isn't measured.
+	GCPointer<Compartment> compartment;
+	StubResolver stubResolver;
+	std::vector<ImportBindings> moduleImports;
+	std::vector<ModuleInstance*> moduleInstances;
+	const bool instantiated = benchmark.measurePhase(
+		corpusName,
+		"instantiate",
+		irModules.size(),
+		[&] {
+			moduleImports.clear();
+			moduleInstances.clear();
+			if(compartment) { errorUnless(tryCollectCompartment(std::move(compartment))); }
+			compartment = createCompartment();
+			stubResolver.compartment = compartment;
+			for(const ModuleRef& module : modules)
+			{
+				LinkResult linkResult = linkModule(getModuleIR(module), stubResolver);
+				errorUnless(linkResult.success);
+				moduleImports.push_back(std::move(linkResult.resolvedImports));
+			}
+		},
+		[&] {
+			bool succeeded = true;
+			catchRuntimeExceptions(
+				[&] {
+					for(Uptr moduleIndex = 0; moduleIndex < modules.size(); ++moduleIndex)
+					{
+						moduleInstances.push_back(
+							instantiateModule(compartment,
+											  modules[moduleIndex],
+											  std::move(moduleImports[moduleIndex]),
+											  std::string(corpusName)));
+					}
+				},
+				[&](Exception* exception) {
+					Log::printf(Log::error,
+								"%s: instantiating module %" PRIuPTR " failed: %s\n",
+								corpusName.c_str(),
+								moduleInstances.size(),
+								describeException(exception).c_str());
+					destroyException(exception);
+					succeeded = false;
+				});
+			return succeeded;
+		});
+
+	// Modules may export nop (i32) -> i32 and run (i32) -> i32 functions to measure invoking a
+	// function, and executing code.
+	if(instantiated)
+	{
+		Context* context = createContext(compartment);
+		const FunctionType benchFunctionType({ValueType::i32}, {ValueType::i32});
+		for(ModuleInstance* moduleInstance : moduleInstances)
+		{
+			Function* nopFunction = asFunctionNullable(getInstanceExport(moduleInstance, "nop"));
+			if(nopFunction && getFunctionType(nopFunction) == benchFunctionType)
+			{
+				UntaggedValue arguments[1]{{I32(0)}};
+				benchmark.measurePhase(
+					corpusName,
+					"invoke",
+					numInvokesPerRepetition,
+					[] {},
+					[&] {
+						for(Uptr invokeIndex = 0; invokeIndex < numInvokesPerRepetition;
+							++invokeIndex)
+						{ invokeFunctionUnchecked(context, nopFunction, arguments); }
+						return true;
+					});
+			}
+
+			Function* runFunction = asFunctionNullable(getInstanceExport(moduleInstance, "run"));
+			if(runFunction && getFunctionType(runFunction) == benchFunctionType)
+			{
+				benchmark.measurePhase(corpusName,
+									   "execute",
+									   numExecuteLoopIterations,
+									   [] {},
+									   [&] {
+										   invokeFunctionChecked(
+											   context,
+											   runFunction,
+											   {Value{I32(numExecuteLoopIterations)}});
+										   return true;
+									   });
+			}
+		}
+	}
+
+	moduleInstances.clear();
+	if(compartment) { errorUnless(tryCollectCompartment(std::move(compartment))); }
+}
+
+//
+// Generated modules
+//
+
+static std::vector<U8> toScriptBytes(const std::string& text)
+{
+	// parseTestCommands requires the text to be null terminated.
+	std::vector<U8> bytes(text.begin(), text.end());
+	bytes.push_back(0);
+	return bytes;
+}
+
+// Generates a module with many small functions that each call the previous one, to measure costs
+// that are proportional to the number of functions.
+static std::string generateManyFunctionsModule(Uptr numFunctions, Uptr numOpsPerFunction)
+{
+	std::string text = "(module\n";
+	for(Uptr functionIndex = 0; functionIndex < numFunctions; ++functionIndex)
+	{
+		text += "(func $f" + std::to_string(functionIndex) + " (param i32) (result i32)\n";
+		text += "  local.get 0\n";
+		for(Uptr opIndex = 0; opIndex < numOpsPerFunction; ++opIndex)
+		{
+			text += "  i32.const " + std::to_string(opIndex * 7919 + functionIndex) + "\n";
+			text += (opIndex & 1) ? "  i32.xor\n" : "  i32.add\n";
+		}
+		if(functionIndex > 0) { text += "  call $f" + std::to_string(functionIndex - 1) + "\n"; }
+		text += ")\n";
+	}
+	text += "(func (export \"nop\") (param i32) (result i32) local.get 0))\n";
+	return text;
+}
+
+// Generates a module with a single large function, to measure costs that are superlinear in the
+// size of a function.
+static std::string generateLargeFunctionModule(Uptr numOps)
+{
+	std::string text = "(module\n(func (export \"large\") (param i32) (result i32)\n";
+	text += "  (local i32 i32 i32 i32)\n";
+	for(Uptr opIndex = 0; opIndex < numOps; ++opIndex)
+	{
+		const std::string local = std::to_string(opIndex & 3);
+		const std::string nextLocal = std::to_string((opIndex + 1) & 3);
+		text += "  (local.set " + nextLocal + " (i32.add (local.get " + local + ")";
+		text += " (i32.mul (local.get " + nextLocal + ") (i32.const " + std::to_string(opIndex | 1)
+				+ "))))\n";
+	}
+	text += "  local.get 0)\n";
+	text += "(func (export \"nop\") (param i32) (result i32) local.get 0))\n";
+	return text;
+}
+
+// Generates a module with a loop that loads, computes, and stores, to measure executing code.
+static std::string generateLoopModule()
+{
+	return "(module\n"
+		   "(memory 1)\n"
+		   "(func (export \"nop\") (param i32) (result i32) local.get 0)\n"
+		   "(func (export \"run\") (param $n i32) (result i32) (local $i i32) (local $acc i32)\n"
+		   "  (block $done\n"
+		   "    (loop $loop\n"
+		   "      (br_if $done (i32.ge_u (local.get $i) (local.get $n)))\n"
+		   "      (local.set $acc\n"
+		   "        (i32.add (i32.mul (local.get $acc) (i32.const 31))\n"
+		   "                 (i32.load (i32.and (i32.shl (local.get $i) (i32.const 2))\n"
+		   "                                    (i32.const 0xfffc)))))\n"
+		   "      (i32.store (i32.and (i32.shl (local.get $acc) (i32.const 2))\n"
+		   "                          (i32.const 0xfffc))\n"
+		   "                 (local.get $i))\n"
+		   "      (local.set $i (i32.add (local.get $i) (i32.const 1)))\n"
+		   "      (br $loop)))\n"
+		   "  (local.get $acc)))\n";
+}
+
+//
+// Output
+//
+
+static std::string escapeJSONString(const std::string& string)
+{
+	std::string result;
+	for(char c : string)
+	{
+		switch(c)
+		{
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if(U8(c) < 0x20)
+			{
+				char buffer[8];
+				snprintf(buffer, sizeof(buffer), "\\u%04x", U8(c));
+				result += buffer;
+			}
+			else
+			{
+				result += c;
+			}
+			break;
+		};
+	}
+	return result;
+}
+
+static U64 getMedian(std::vector<U64> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+static std::string formatResultsJSON(const Benchmark& benchmark)
+{
+	const Options& options = benchmark.options;
+
+	std::string json = "{\n";
+	json += "  \"minRepetitions\": " + std::to_string(options.minRepetitions) + ",\n";
+	json += "  \"maxRepetitions\": " + std::to_string(options.maxRepetitions) + ",\n";
+	json += "  \"maxSecondsPerPhase\": " + std::to_string(options.maxSecondsPerPhase) + ",\n";
+	json += "  \"maxRelativeStdDev\": " + std::to_string(options.maxRelativeStdDev) + ",\n";
+	json += "  \"counters\": [";
+	bool isFirstCounter = true;
+	for(Uptr counterIndex = 0; counterIndex < numPerfCounters; ++counterIndex)
+	{
+		if(!benchmark.perfCounters.isOpen(counterIndex)) { continue; }
+		json += isFirstCounter ? "\"" : ", \"";
+		json += perfCounterNames[counterIndex];
+		json += "\"";
+		isFirstCounter = false;
+	}
+	json += "],\n";
+
+	json += "  \"results\": [";
+	for(Uptr resultIndex = 0; resultIndex < benchmark.results.size(); ++resultIndex)
+	{
+		const PhaseResult& result = benchmark.results[resultIndex];
+
+		std::vector<U64> nanoseconds;
+		F64 sum = 0.0;
+		F64 sumSquares = 0.0;
+		for(const PhaseSample& sample : result.samples)
+		{
+			nanoseconds.push_back(sample.nanoseconds);
+			sum += F64(sample.nanoseconds);
+			sumSquares += F64(sample.nanoseconds) * F64(sample.nanoseconds);
+		}
+		const F64 mean = sum / F64(nanoseconds.size());
+		const F64 stdDev = sqrt(std::max(0.0, sumSquares / F64(nanoseconds.size()) - mean * mean));
+
+		json += resultIndex == 0 ? "\n" : ",\n";
+		json += "    {\"corpus\": \"" + escapeJSONString(result.corpusName) + "\", ";
+		json += "\"phase\": \"" + std::string(result.phaseName) + "\", ";
+		json += "\"iterations\": " + std::to_string(result.numIterations) + ", ";
+		json += "\"repetitions\": " + std::to_string(result.samples.size()) + ", ";
+		json += "\"stable\": " + std::string(result.isStable ? "true" : "false") + ",\n";
+		json += "     \"nanoseconds\": {\"min\": "
+				+ std::to_string(*std::min_element(nanoseconds.begin(), nanoseconds.end()))
+				+ ", \"median\": " + std::to_string(getMedian(nanoseconds))
+				+ ", \"mean\": " + std::to_string(U64(mean))
+				+ ", \"stdDev\": " + std::to_string(U64(stdDev)) + "},\n";
+
+		// Write the median of each counter over the repetitions.
+		json += "     \"counters\": {";
+		isFirstCounter = true;
+		for(Uptr counterIndex = 0; counterIndex < numPerfCounters; ++counterIndex)
+		{
+			if(!benchmark.perfCounters.isOpen(counterIndex)) { continue; }
+			std::vector<U64> values;
+			for(const PhaseSample& sample : result.samples)
+			{ values.push_back(sample.counters[counterIndex]); }
+			json += isFirstCounter ? "\"" : ", \"";
+			json += perfCounterNames[counterIndex];
+			json += "\": " + std::to_string(getMedian(values));
+			isFirstCounter = false;
+		}
+		json += "}}";
+	}
+	json += "\n  ]\n}\n";
+	return json;
+}
+
+static void showHelp()
+{
+	Log::printf(
+		Log::error,
+		"Usage: wavm-bench [options] [in.wast...]\n"
+		"  Measures parsing, validating, compiling, loading, instantiating, invoking, and\n"
+		"  executing the modules defined by each WAST script, and by some generated modules.\n"
+		"  Modules that export nop or run functions of type (i32) -> i32 are also measured\n"
+		"  invoking nop, and executing run.\n"
+		"\n"
+		"  -h|--help                    Display this message\n"
+		"  -d|--debug                   Write each phase to stdout as it is measured\n"
+		"  --filter <string>            Only measure the corpus entries that contain string\n"
+		"  --no-generated               Don't measure the generated modules\n"
+		"  --min-repetitions <n>        Repeat each phase at least n times (default 5)\n"
+		"  --max-repetitions <n>        Repeat each phase at most n times (default 50)\n"
+		"  --max-seconds <s>            Stop repeating a phase after s seconds (default 10)\n"
+		"  --max-relative-stddev <f>    Stop repeating a phase when the relative standard\n"
+		"                               deviation of its last min-repetitions times is at\n"
+		"                               most f (default 0.02)\n"
+		"  --output <file>              Write the JSON results to file instead of stdout\n");
+}
+
+static bool parseCommandLine(char** argv, Options& options)
+{
+	char** nextArg = argv;
+	while(*++nextArg)
+	{
+		const char* arg = *nextArg;
+		const bool hasValue = nextArg[1] != nullptr;
+		if(!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+		{
+			options.showHelp = true;
+			return true;
+		}
+		else if(!strcmp(arg, "--debug") || !strcmp(arg, "-d"))
+		{
+			Log::setCategoryEnabled(Log::debug, true);
+		}
+		else if(!strcmp(arg, "--no-generated"))
+		{
+			options.includeGeneratedModules = false;
+		}
+		else if(!strcmp(arg, "--filter") && hasValue)
+		{
+			options.filter = *++nextArg;
+		}
+		else if(!strcmp(arg, "--output") && hasValue)
+		{
+			options.outputFilename = *++nextArg;
+		}
+		else if(!strcmp(arg, "--min-repetitions") && hasValue)
+		{
+			options.minRepetitions = std::max(Uptr(1), Uptr(strtoull(*++nextArg, nullptr, 10)));
+		}
+		else if(!strcmp(arg, "--max-repetitions") && hasValue)
+		{
+			options.maxRepetitions = Uptr(strtoull(*++nextArg, nullptr, 10));
+		}
+		else if(!strcmp(arg, "--max-seconds") && hasValue)
+		{
+			options.maxSecondsPerPhase = strtod(*++nextArg, nullptr);
+		}
+		else if(!strcmp(arg, "--max-relative-stddev") && hasValue)
+		{
+			options.maxRelativeStdDev = strtod(*++nextArg, nullptr);
+		}
+		else if(arg[0] == '-')
+		{
+			Log::printf(Log::error, "Unknown option or missing value: %s\n", arg);
+			return false;
+		}
+		else
+		{
+			options.filenames.push_back(arg);
+		}
+	}
+	options.maxRepetitions = std::max(options.maxRepetitions, options.minRepetitions);
+	return true;
+}
+
+static int run(const Options& options)
+{
+	Benchmark benchmark(options);
+
+	auto isFiltered = [&options](const std::string& corpusName) {
+		return options.filter && corpusName.find(options.filter) == std::string::npos;
+	};
+
+	for(const std::string& filename : options.filenames)
+	{
+		if(isFiltered(filename)) { continue; }
+
+		std::vector<U8> scriptBytes;
+		if(!loadFile(filename.c_str(), scriptBytes)) { return EXIT_FAILURE; }
+		scriptBytes.push_back(0);
+		benchmarkScript(benchmark, filename, scriptBytes);
+	}
+
+	if(options.includeGeneratedModules)
+	{
+		const std::pair<const char*, std::string> generatedModules[] = {
+			{"generated/many-functions", generateManyFunctionsModule(2000, 50)},
+			{"generated/large-function", generateLargeFunctionModule(20000)},
+			{"generated/loop", generateLoopModule()},
+		};
+		for(const auto& generatedModule : generatedModules)
+		{
+			if(isFiltered(generatedModule.first)) { continue; }
+			benchmarkScript(
+				benchmark, generatedModule.first, toScriptBytes(generatedModule.second));
+		}
+	}
+
+	const std::string json = formatResultsJSON(benchmark);
+	if(!options.outputFilename) { Log::printf(Log::output, "%s", json.c_str()); }
+	else if(!saveFile(options.outputFilename, json.data(), json.size()))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if(!parseCommandLine(argv, options))
+	{
+		showHelp();
+		return EXIT_FAILURE;
+	}
+	else if(options.showHelp)
+	{
+		showHelp();
+		return EXIT_SUCCESS;
+	}
+
+	int result = EXIT_FAILURE;
+	Runtime::catchRuntimeExceptions([&result, &options]() { result = run(options); },
+									[](Runtime::Exception* exception) {
+										// Treat any unhandled exception as a fatal error.
+										Errors::fatalf("Runtime exception: %s",
+													   describeException(exception).c_str());
+									});
+	return result;
+}
@@ -0,0 +1,137 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Thread.h"
+
+using namespace WAVM;
+
+// The asynchronous output is written to stdout, so the test redirects stdout to this file and
+// reads the messages back from it.
+static const char* outputFilename = "AsyncOutputTest.out";
+
+static std::string readOutput()
+{
+	fflush(stdout);
+
+	FILE* file = fopen(outputFilename, "rb");
+	errorUnless(file);
+	std::string output;
+	char buffer[4096];
+	Uptr numBytesRead;
+	while((numBytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{ output.append(buffer, numBytesRead); }
+	fclose(file);
+	return output;
+}
+
+static I64 getNumAsyncBuffers()
+{
+	for(const Metrics::MetricSnapshot& metric : Metrics::getSnapshot())
+	{
+		if(metric.name == "wavm_log_async_buffers") { return metric.gaugeValue; }
+	}
+	Errors::fatal("Didn't find the wavm_log_async_buffers metric");
+}
+
+static I64 logMessagesThreadEntry(void* argument)
+{
+	const Uptr threadIndex = reinterpret_cast<Uptr>(argument);
+	for(Uptr messageIndex = 0; messageIndex < 100; ++messageIndex)
+	{
+		Log::printf(Log::output,
+					"thread %" PRIuPTR " message %" PRIuPTR "\n",
+					threadIndex,
+					messageIndex);
+	}
+	return 0;
+}
+
+static void testMessagesFromThreads()
+{
+	enum
+	{
+		numThreads = 8
+	};
+
+	const U64 numDroppedMessages = Log::getNumDroppedMessages();
+
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+	{
+		threads.push_back(Platform::createThread(
+			1024 * 1024, logMessagesThreadEntry, reinterpret_cast<void*>(threadIndex)));
+	}
+	for(Platform::Thread* thread : threads) { errorUnless(Platform::joinThread(thread) == 0); }
+	Log::flushAsyncOutput();
+
+	// Each thread's messages should all be written, in the order the thread logged them.
+	const std::string output = readOutput();
+	for(Uptr threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+	{
+		std::string::size_type previousOffset = 0;
+		for(Uptr messageIndex = 0; messageIndex < 100; ++messageIndex)
+		{
+			const std::string message = "thread " + std::to_string(threadIndex) + " message "
+										+ std::to_string(messageIndex) + "\n";
+			const std::string::size_type offset = output.find(message);
+			errorUnless(offset != std::string::npos && offset >= previousOffset);
+			errorUnless(output.find(message, offset + 1) == std::string::npos);
+			previousOffset = offset;
+		}
+	}
+	errorUnless(Log::getNumDroppedMessages() == numDroppedMessages);
+}
+
+static void testDroppedMessages()
+{
+	// A message that is larger than a thread's buffer can never fit, so it is always dropped.
+	const U64 numDroppedMessages = Log::getNumDroppedMessages();
+	const std::string largeMessage(1024 * 1024, 'x');
+	Log::printf(Log::output, "%s\n", largeMessage.c_str());
+	errorUnless(Log::getNumDroppedMessages() == numDroppedMessages + 1);
+
+	Log::flushAsyncOutput();
+	errorUnless(readOutput().find(largeMessage) == std::string::npos);
+}
+
+// Logs a message, and returns the number of buffers while the thread's buffer still exists.
+static I64 logOrphanedMessageThreadEntry(void*)
+{
+	Log::printf(Log::output, "orphaned message\n");
+	return getNumAsyncBuffers();
+}
+
+static void testOrphanedBuffers()
+{
+	// The buffer of a thread that exits should be freed once its messages are written.
+	const I64 numAsyncBuffers = getNumAsyncBuffers();
+	errorUnless(Platform::joinThread(
+					Platform::createThread(1024 * 1024, logOrphanedMessageThreadEntry, nullptr))
+				== numAsyncBuffers + 1);
+	Log::flushAsyncOutput();
+
+	errorUnless(readOutput().find("orphaned message\n") != std::string::npos);
+	errorUnless(getNumAsyncBuffers() == numAsyncBuffers);
+}
+
+I32 main()
+{
+	errorUnless(freopen(outputFilename, "wb", stdout));
+	Log::setAsyncOutputEnabled(true);
+
+	testMessagesFromThreads();
+	testDroppedMessages();
+	testOrphanedBuffers();
+
+	Log::setAsyncOutputEnabled(false);
+	fclose(stdout);
+	remove(outputFilename);
+	return 0;
+}
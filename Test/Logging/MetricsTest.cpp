@@ -0,0 +1,122 @@
+#include <string>
+#include <vector>
+
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Thread.h"
+
+using namespace WAVM;
+using namespace WAVM::Metrics;
+
+static Counter testCounter("test_counter_total", "A test counter");
+static Gauge testGauge("test_gauge", "A test gauge");
+static Histogram testHistogram("test_histogram", "A test histogram", "kind=\"test\"");
+
+static const MetricSnapshot& findMetric(const std::vector<MetricSnapshot>& snapshot,
+										const std::string& name,
+										const std::string& labels = std::string())
+{
+	for(const MetricSnapshot& metric : snapshot)
+	{
+		if(metric.name == name && metric.labels == labels) { return metric; }
+	}
+	Errors::fatalf("Didn't find metric %s{%s}", name.c_str(), labels.c_str());
+}
+
+static I64 addToCounterThreadEntry(void* argument)
+{
+	for(Uptr index = 0; index < 1000; ++index) { testCounter.add(); }
+	testGauge.add(10);
+	return 0;
+}
+
+static void testCountersAndGauges()
+{
+	enum
+	{
+		numThreads = 8
+	};
+
+	testCounter.add(5);
+	testGauge.add(-3);
+
+	// Threads' values should still be counted after the threads exit.
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+	{ threads.push_back(Platform::createThread(1024 * 1024, addToCounterThreadEntry, nullptr)); }
+	for(Platform::Thread* thread : threads) { errorUnless(Platform::joinThread(thread) == 0); }
+
+	const std::vector<MetricSnapshot> snapshot = getSnapshot();
+	errorUnless(findMetric(snapshot, "test_counter_total").counterValue == numThreads * 1000 + 5);
+	errorUnless(findMetric(snapshot, "test_gauge").gaugeValue == numThreads * 10 - 3);
+}
+
+static void testHistograms()
+{
+	// Small values are counted exactly, and larger values are counted in buckets whose width is
+	// 1/8 of their power of two.
+	for(U64 value = 1; value <= 100; ++value) { testHistogram.record(value); }
+	testHistogram.record(UINT64_MAX);
+
+	const std::vector<MetricSnapshot> snapshot = getSnapshot();
+	const MetricSnapshot& metric = findMetric(snapshot, "test_histogram", "kind=\"test\"");
+	errorUnless(metric.kind == Kind::histogram);
+	errorUnless(metric.numValues == 101);
+	errorUnless(metric.sum == 5050 + UINT64_MAX);
+	errorUnless(metric.getPercentile(0.0) == 1);
+	errorUnless(metric.getPercentile(0.05) == 6);
+	errorUnless(metric.getPercentile(0.5) >= 51 && metric.getPercentile(0.5) <= 51 * 9 / 8);
+	errorUnless(metric.getPercentile(0.99) >= 100 && metric.getPercentile(0.99) <= 100 * 9 / 8);
+	errorUnless(metric.getPercentile(1.0) == UINT64_MAX);
+
+	U64 numValuesInBuckets = 0;
+	for(Uptr bucketIndex = 0; bucketIndex < metric.buckets.size(); ++bucketIndex)
+	{
+		numValuesInBuckets += metric.buckets[bucketIndex].numValues;
+		if(bucketIndex > 0)
+		{
+			errorUnless(metric.buckets[bucketIndex].maxValue
+						> metric.buckets[bucketIndex - 1].maxValue);
+		}
+	}
+	errorUnless(numValuesInBuckets == metric.numValues);
+}
+
+static void testLabeledCounters()
+{
+	Counter* fooCounter = getCounter("test_labeled_total", "A labeled counter", "name=\"foo\"");
+	Counter* barCounter = getCounter("test_labeled_total", "A labeled counter", "name=\"bar\"");
+	errorUnless(fooCounter != barCounter);
+	errorUnless(getCounter("test_labeled_total", "A labeled counter", "name=\"foo\"")
+				== fooCounter);
+
+	fooCounter->add(2);
+	barCounter->add(3);
+
+	const std::vector<MetricSnapshot> snapshot = getSnapshot();
+	errorUnless(findMetric(snapshot, "test_labeled_total", "name=\"foo\"").counterValue == 2);
+	errorUnless(findMetric(snapshot, "test_labeled_total", "name=\"bar\"").counterValue == 3);
+
+	// Metrics with the same name should share their HELP and TYPE lines.
+	const std::string text = exportText(snapshot);
+	errorUnless(text.find("# TYPE test_labeled_total counter\n")
+				== text.rfind("# TYPE test_labeled_total counter\n"));
+	errorUnless(text.find("test_labeled_total{name=\"bar\"} 3\n") != std::string::npos);
+	errorUnless(text.find("test_labeled_total{name=\"foo\"} 2\n") != std::string::npos);
+	errorUnless(text.find("test_histogram_bucket{kind=\"test\",le=\"+Inf\"} 101\n")
+				!= std::string::npos);
+	errorUnless(text.find("test_histogram_count{kind=\"test\"} 101\n") != std::string::npos);
+}
+
+I32 main()
+{
+	Timing::Timer timer;
+	testCountersAndGauges();
+	testHistograms();
+	testLabeledCounters();
+	Timing::logTimer("MetricsTest", timer);
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include <vector>
+
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/EventLoop.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/File.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+static void appendIndex(void* argument)
+{
+	auto& indices = *(std::vector<Uptr>*)argument;
+	indices.push_back(indices.size());
+}
+
+static void testTimeouts()
+{
+	EventLoop* eventLoop = createEventLoop();
+
+	// Add waits that time out in the opposite order they are added.
+	std::vector<Uptr> laterIndices;
+	std::vector<Uptr> earlierIndices;
+	const U64 startClock = getMonotonicClock();
+	addEventLoopWait(eventLoop, nullptr, 0, startClock + 20000, appendIndex, &laterIndices);
+	addEventLoopWait(eventLoop, nullptr, 0, startClock + 10000, appendIndex, &earlierIndices);
+	errorUnless(getNumPendingEventLoopWaits(eventLoop) == 2);
+
+	// Running the event loop without waiting shouldn't satisfy either wait.
+	errorUnless(runEventLoop(eventLoop, 0) == 0);
+
+	errorUnless(runEventLoop(eventLoop, UINT64_MAX) == 1);
+	errorUnless(getMonotonicClock() >= startClock + 10000);
+	errorUnless(earlierIndices.size() == 1 && laterIndices.empty());
+
+	errorUnless(runEventLoop(eventLoop, UINT64_MAX) == 1);
+	errorUnless(getMonotonicClock() >= startClock + 20000);
+	errorUnless(laterIndices.size() == 1);
+	errorUnless(getNumPendingEventLoopWaits(eventLoop) == 0);
+
+	destroyEventLoop(eventLoop);
+}
+
+static void testFileWaits()
+{
+	EventLoop* eventLoop = createEventLoop();
+
+	// Stdout may be a terminal, a pipe, or a regular file, but it should be writable in any case.
+	const FileWait wait = {getStdFile(StdDevice::out), false, true};
+	FileReadiness readiness;
+	errorUnless(pollFiles(&wait, &readiness, 1, UINT64_MAX) == 1);
+	errorUnless(readiness.writable);
+
+	// Wait for it to be writable twice, with a timeout that should never be reached.
+	std::vector<Uptr> indices;
+	addEventLoopWait(eventLoop, &wait, 1, getMonotonicClock() + 60000000, appendIndex, &indices);
+	addEventLoopWait(eventLoop, &wait, 1, UINT64_MAX, appendIndex, &indices);
+	errorUnless(runEventLoop(eventLoop, UINT64_MAX) == 2);
+	errorUnless(indices.size() == 2);
+	errorUnless(getNumPendingEventLoopWaits(eventLoop) == 0);
+
+	// Destroying an event loop should discard its pending waits.
+	addEventLoopWait(eventLoop, &wait, 1, UINT64_MAX, appendIndex, &indices);
+	addEventLoopWait(eventLoop, nullptr, 0, getMonotonicClock() + 60000000, appendIndex, &indices);
+	destroyEventLoop(eventLoop);
+	errorUnless(indices.size() == 2);
+}
+
+// Suspends fibers while they wait on an event loop, as a WASI worker does.
+struct FiberScheduler
+{
+	EventLoop* eventLoop;
+	std::vector<Fiber*> readyFibers;
+	Uptr numWakeups = 0;
+};
+
+static void readyFiber(void* argument)
+{
+	Fiber* fiber = (Fiber*)argument;
+	FiberScheduler* scheduler = (FiberScheduler*)getFiberArgument(fiber);
+	scheduler->readyFibers.push_back(fiber);
+}
+
+static void sleepingFiberEntry(void* argument)
+{
+	FiberScheduler* scheduler = (FiberScheduler*)argument;
+	for(Uptr sleepIndex = 0; sleepIndex < 3; ++sleepIndex)
+	{
+		addEventLoopWait(scheduler->eventLoop,
+						 nullptr,
+						 0,
+						 getMonotonicClock() + 1000,
+						 readyFiber,
+						 getCurrentFiber());
+		suspendFiber();
+		++scheduler->numWakeups;
+	}
+}
+
+static void testSuspendingFibers()
+{
+	enum
+	{
+		numFibers = 8
+	};
+
+	FiberScheduler scheduler;
+	scheduler.eventLoop = createEventLoop();
+
+	std::vector<Fiber*> fibers;
+	for(Uptr fiberIndex = 0; fiberIndex < numFibers; ++fiberIndex)
+	{
+		fibers.push_back(createFiber(64 * 1024, sleepingFiberEntry, &scheduler));
+		errorUnless(fibers.back());
+	}
+	scheduler.readyFibers = fibers;
+
+	Uptr numReturnedFibers = 0;
+	while(numReturnedFibers < numFibers)
+	{
+		std::vector<Fiber*> readyFibers = std::move(scheduler.readyFibers);
+		scheduler.readyFibers.clear();
+		for(Fiber* fiber : readyFibers)
+		{
+			if(resumeFiber(fiber)) { ++numReturnedFibers; }
+		}
+
+		if(numReturnedFibers < numFibers) { runEventLoop(scheduler.eventLoop, UINT64_MAX); }
+	}
+	errorUnless(scheduler.numWakeups == numFibers * 3);
+
+	for(Fiber* fiber : fibers) { destroyFiber(fiber); }
+	destroyEventLoop(scheduler.eventLoop);
+}
+
+I32 main()
+{
+	Timing::Timer timer;
+	testTimeouts();
+	testFileWaits();
+	testSuspendingFibers();
+	Timing::logTimer("EventLoopTest", timer);
+	return 0;
+}
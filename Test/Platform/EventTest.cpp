@@ -0,0 +1,62 @@
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Thread.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+enum
+{
+	timeoutMicroseconds = 10000
+};
+
+static void testSignalBeforeWait()
+{
+	// A signal that happens before the wait should wake it, and the wait should reset the event.
+	Event event;
+	event.signal();
+	errorUnless(event.wait(getMonotonicClock() + timeoutMicroseconds));
+
+	const U64 untilClock = getMonotonicClock() + timeoutMicroseconds;
+	errorUnless(!event.wait(untilClock));
+	errorUnless(getMonotonicClock() >= untilClock);
+}
+
+static void testRepeatedSignals()
+{
+	// Signaling an event that is already signaled should only wake one wait.
+	Event event;
+	event.signal();
+	event.signal();
+	errorUnless(event.wait(getMonotonicClock() + timeoutMicroseconds));
+	errorUnless(!event.wait(getMonotonicClock() + timeoutMicroseconds));
+}
+
+static I64 signalThreadEntry(void* argument)
+{
+	// Wait a while before signaling, so the main thread is likely to be blocked in wait.
+	const U64 signalClock = getMonotonicClock() + timeoutMicroseconds;
+	while(getMonotonicClock() < signalClock) {}
+	((Event*)argument)->signal();
+	return 0;
+}
+
+static void testSignalFromOtherThread()
+{
+	// A signal from another thread should wake a wait without a timeout.
+	Event event;
+	Thread* thread = createThread(1024 * 1024, signalThreadEntry, &event);
+	errorUnless(event.wait(UINT64_MAX));
+	errorUnless(joinThread(thread) == 0);
+}
+
+I32 main()
+{
+	testSignalBeforeWait();
+	testRepeatedSignals();
+	testSignalFromOtherThread();
+	return 0;
+}
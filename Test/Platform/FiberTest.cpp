@@ -0,0 +1,226 @@
+#include <vector>
+
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/Signal.h"
+#include "WAVM/Platform/Thread.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+enum
+{
+	numFiberStackBytes = 256 * 1024,
+	numSuspends = 1000
+};
+
+static void countingFiberEntry(void* argument)
+{
+	Uptr& counter = *(Uptr*)argument;
+	for(Uptr suspendIndex = 0; suspendIndex < numSuspends; ++suspendIndex)
+	{
+		++counter;
+		suspendFiber();
+	}
+}
+
+static void testSuspendAndResume()
+{
+	Uptr counter = 0;
+	Fiber* fiber = createFiber(numFiberStackBytes, countingFiberEntry, &counter);
+	errorUnless(fiber);
+	errorUnless(getFiberArgument(fiber) == &counter);
+	errorUnless(!getCurrentFiber());
+
+	for(Uptr resumeIndex = 0; resumeIndex < numSuspends; ++resumeIndex)
+	{
+		errorUnless(!resumeFiber(fiber));
+		errorUnless(counter == resumeIndex + 1);
+	}
+	errorUnless(resumeFiber(fiber));
+	errorUnless(!getCurrentFiber());
+
+	destroyFiber(fiber);
+}
+
+static I64 resumeFiberThreadEntry(void* argument)
+{
+	return resumeFiber((Fiber*)argument) ? 1 : 0;
+}
+
+static void testResumeOnOtherThread()
+{
+	Uptr counter = 0;
+	Fiber* fiber = createFiber(numFiberStackBytes, countingFiberEntry, &counter);
+	errorUnless(fiber);
+
+	// Alternate between resuming the fiber on this thread and on a new thread.
+	for(Uptr resumeIndex = 0; resumeIndex < 10; ++resumeIndex)
+	{
+		if(resumeIndex & 1) { errorUnless(!resumeFiber(fiber)); }
+		else
+		{
+			Thread* thread = createThread(1024 * 1024, resumeFiberThreadEntry, fiber);
+			errorUnless(joinThread(thread) == 0);
+		}
+		errorUnless(counter == resumeIndex + 1);
+	}
+
+	destroyFiber(fiber);
+}
+
+static void nestedFiberEntry(void* argument)
+{
+	Fiber* outerFiber = (Fiber*)argument;
+	errorUnless(getCurrentFiber() != outerFiber);
+	suspendFiber();
+}
+
+static void outerFiberEntry(void* argument)
+{
+	Fiber* outerFiber = getCurrentFiber();
+	Fiber* innerFiber = createFiber(numFiberStackBytes, nestedFiberEntry, outerFiber);
+	errorUnless(innerFiber);
+
+	// Suspending the inner fiber should return to the outer fiber.
+	errorUnless(!resumeFiber(innerFiber));
+	errorUnless(getCurrentFiber() == outerFiber);
+	suspendFiber();
+
+	errorUnless(resumeFiber(innerFiber));
+	errorUnless(getCurrentFiber() == outerFiber);
+	destroyFiber(innerFiber);
+}
+
+static void testNestedFibers()
+{
+	Fiber* fiber = createFiber(numFiberStackBytes, outerFiberEntry, nullptr);
+	errorUnless(fiber);
+	errorUnless(!resumeFiber(fiber));
+	errorUnless(resumeFiber(fiber));
+	destroyFiber(fiber);
+}
+
+// Recurses until the stack overflows.
+static Uptr recurse(Uptr depth)
+{
+	volatile U8 padding[256];
+	padding[0] = U8(depth);
+	if(depth == UINTPTR_MAX) { return 0; }
+	return recurse(depth + 1) + padding[0];
+}
+
+static void signalFiberEntry(void* argument)
+{
+	Signal::Type& outSignalType = *(Signal::Type*)argument;
+
+	// Overflow the fiber's stack, and check that it is reported as a stack overflow, with a call
+	// stack that was captured from the fiber's stack.
+	errorUnless(catchSignals([](void*) { recurse(0); },
+							 [](void* argument, Signal signal, CallStack&& callStack) {
+								 *(Signal::Type*)argument = signal.type;
+								 return callStack.numStackFrames > 1;
+							 },
+							 &outSignalType));
+	suspendFiber();
+
+	// Check that signals are still caught after the fiber is resumed.
+	errorUnless(catchSignals([](void*) { recurse(0); },
+							 [](void* argument, Signal signal, CallStack&& callStack) {
+								 *(Signal::Type*)argument = signal.type;
+								 return true;
+							 },
+							 &outSignalType));
+}
+
+static void testSignalsOnFiber()
+{
+	Signal::Type signalType = Signal::Type::invalid;
+	Fiber* fiber = createFiber(numFiberStackBytes, signalFiberEntry, &signalType);
+	errorUnless(fiber);
+
+	errorUnless(!resumeFiber(fiber));
+	errorUnless(signalType == Signal::Type::stackOverflow);
+
+	signalType = Signal::Type::invalid;
+	errorUnless(resumeFiber(fiber));
+	errorUnless(signalType == Signal::Type::stackOverflow);
+
+	destroyFiber(fiber);
+}
+
+// The state shared by a fiber and the fiber forked from it.
+struct ForkedFiberState
+{
+	Fiber* forkedFiber = nullptr;
+	Uptr numOriginalResumes = 0;
+	Uptr numForkedResumes = 0;
+};
+static ForkedFiberState forkedFiberState;
+
+static void forkingFiberEntry(void*)
+{
+	// Each fiber increments its own copy of a local variable each time it is resumed, so if the
+	// forked fiber shared the original fiber's stack, the final value would be wrong.
+	volatile Uptr numLocalResumes = 0;
+	Fiber* forkedFiber = forkCurrentFiber(&forkedFiberState);
+	if(forkedFiber) { forkedFiberState.forkedFiber = forkedFiber; }
+	else
+	{
+		errorUnless(getFiberArgument(getCurrentFiber()) == &forkedFiberState);
+	}
+
+	for(Uptr suspendIndex = 0; suspendIndex < 3; ++suspendIndex)
+	{
+		numLocalResumes = numLocalResumes + 1;
+		if(forkedFiber) { ++forkedFiberState.numOriginalResumes; }
+		else
+		{
+			++forkedFiberState.numForkedResumes;
+		}
+		suspendFiber();
+	}
+	errorUnless(numLocalResumes == 3);
+}
+
+static void testForkFiber()
+{
+	Fiber* fiber = createFiber(numFiberStackBytes, forkingFiberEntry, nullptr);
+	errorUnless(fiber);
+	errorUnless(!resumeFiber(fiber));
+	Fiber* forkedFiber = forkedFiberState.forkedFiber;
+	errorUnless(forkedFiber && forkedFiber != fiber);
+
+	// Interleave resuming the original and forked fibers, resuming the forked fiber on another
+	// thread.
+	for(Uptr resumeIndex = 0; resumeIndex < 3; ++resumeIndex)
+	{
+		Thread* thread = createThread(1024 * 1024, resumeFiberThreadEntry, forkedFiber);
+		errorUnless(joinThread(thread) == 0);
+		errorUnless(forkedFiberState.numForkedResumes == resumeIndex + 1);
+
+		errorUnless(resumeFiber(fiber) == (resumeIndex == 2));
+	}
+	errorUnless(resumeFiber(forkedFiber));
+	errorUnless(forkedFiberState.numOriginalResumes == 3);
+	errorUnless(forkedFiberState.numForkedResumes == 3);
+
+	destroyFiber(fiber);
+	destroyFiber(forkedFiber);
+}
+
+I32 main()
+{
+	Timing::Timer timer;
+	testSuspendAndResume();
+	testResumeOnOtherThread();
+	testNestedFibers();
+	testSignalsOnFiber();
+	testForkFiber();
+	Timing::logTimer("FiberTest", timer);
+	return 0;
+}
@@ -262,7 +262,7 @@ static bool processAction(TestScriptState& state, Action* action, IR::ValueTuple
 		{
 			state.hasInstantiatedModule = true;
 			state.lastModuleInstance = instantiateModule(state.compartment,
-														 compileModule(*moduleAction->module),
+														 compileModule(moduleAction->module),
 														 std::move(linkResult.resolvedImports),
 														 "test module");
 
@@ -581,7 +581,7 @@ static void processCommand(TestScriptState& state, const Command* command)
 				{
 					auto moduleInstance
 						= instantiateModule(state.compartment,
-											compileModule(*assertCommand->moduleAction->module),
+											compileModule(assertCommand->moduleAction->module),
 											std::move(linkResult.resolvedImports),
 											"test module");
 
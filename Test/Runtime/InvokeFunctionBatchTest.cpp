@@ -0,0 +1,171 @@
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// A function with several parameters and results of different types, that counts how many times
+// it is called, and traps if its i32 argument is zero.
+static const char* testModuleWAST = R"(
+	(module
+		(global $numCalls (export "numCalls") (mut i32) (i32.const 0))
+
+		(func (export "divide") (param i64 i32 f64) (result i64 i32 f64)
+			(global.set $numCalls (i32.add (global.get $numCalls) (i32.const 1)))
+			(i64.div_s (local.get 0) (i64.extend_i32_s (local.get 1)))
+			(i32.rem_s (i32.wrap_i64 (local.get 0)) (local.get 1))
+			(f64.mul (local.get 2) (f64.convert_i32_s (local.get 1))))
+	)
+)";
+
+static constexpr Uptr numParams = 3;
+static constexpr Uptr numResults = 3;
+static constexpr Uptr numCalls = 8;
+
+static ModuleInstance* instantiateTestModule(Compartment* compartment)
+{
+	IR::Module irModule;
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule(testModuleWAST, strlen(testModuleWAST) + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors("testModuleWAST", parseErrors);
+		Errors::fatal("Couldn't parse the test module");
+	}
+	return instantiateModule(compartment, compileModule(std::move(irModule)), {}, "test");
+}
+
+// Creates the arguments for each call. If trappingCallIndex is less than numCalls, that call's i32
+// argument is zero, so it traps.
+static std::vector<UntaggedValue> createArgs(Uptr trappingCallIndex)
+{
+	std::vector<UntaggedValue> args(numCalls * numParams);
+	for(Uptr callIndex = 0; callIndex < numCalls; ++callIndex)
+	{
+		args[callIndex * numParams + 0] = I64(1000 + 37 * callIndex);
+		args[callIndex * numParams + 1] = callIndex == trappingCallIndex ? 0 : I32(callIndex + 1);
+		args[callIndex * numParams + 2] = F64(0.5 * callIndex);
+	}
+	return args;
+}
+
+// Creates a results array filled with a byte pattern that the function's results can't produce,
+// so the test can check which results were written.
+static std::vector<UntaggedValue> createUnwrittenResults()
+{
+	std::vector<UntaggedValue> results(numCalls * numResults);
+	memset(results.data(), 0xcd, results.size() * sizeof(UntaggedValue));
+	return results;
+}
+
+static bool isUnwritten(const UntaggedValue* callResults)
+{
+	for(Uptr byteIndex = 0; byteIndex < numResults * sizeof(UntaggedValue); ++byteIndex)
+	{
+		if(reinterpret_cast<const U8*>(callResults)[byteIndex] != 0xcd) { return false; }
+	}
+	return true;
+}
+
+// Checks that the results of a call are the ones expected for its arguments.
+static void checkCallResults(Uptr callIndex, const UntaggedValue* callResults)
+{
+	const I64 dividend = I64(1000 + 37 * callIndex);
+	const I32 divisor = I32(callIndex + 1);
+	errorUnless(callResults[0].i64 == dividend / divisor);
+	errorUnless(callResults[1].i32 == I32(dividend) % divisor);
+	errorUnless(callResults[2].f64 == 0.5 * callIndex * divisor);
+}
+
+static Uptr getNumCalls(Context* context, Global* numCallsGlobal)
+{
+	return Uptr(getGlobalValue(context, numCallsGlobal).i32);
+}
+
+static void testBatch(Context* context, Function* function, Global* numCallsGlobal)
+{
+	// Each call's results should be written at the call index times the number of results.
+	setGlobalValue(context, numCallsGlobal, Value(I32(0)));
+	const std::vector<UntaggedValue> args = createArgs(numCalls);
+	std::vector<UntaggedValue> results = createUnwrittenResults();
+	invokeFunctionBatch(context, function, args.data(), numCalls, results.data());
+
+	errorUnless(getNumCalls(context, numCallsGlobal) == numCalls);
+	for(Uptr callIndex = 0; callIndex < numCalls; ++callIndex)
+	{ checkCallResults(callIndex, results.data() + callIndex * numResults); }
+}
+
+static void testEmptyBatch(Context* context, Function* function, Global* numCallsGlobal)
+{
+	setGlobalValue(context, numCallsGlobal, Value(I32(0)));
+	const std::vector<UntaggedValue> args = createArgs(numCalls);
+	std::vector<UntaggedValue> results = createUnwrittenResults();
+	invokeFunctionBatch(context, function, args.data(), 0, results.data());
+
+	errorUnless(getNumCalls(context, numCallsGlobal) == 0);
+	for(Uptr callIndex = 0; callIndex < numCalls; ++callIndex)
+	{ errorUnless(isUnwritten(results.data() + callIndex * numResults)); }
+}
+
+static void testTrapInBatch(Context* context, Function* function, Global* numCallsGlobal)
+{
+	// If a call in the middle of the batch traps, the results of the calls before it should have
+	// been written, and the calls after it should be skipped.
+	static constexpr Uptr trappingCallIndex = 5;
+	setGlobalValue(context, numCallsGlobal, Value(I32(0)));
+	const std::vector<UntaggedValue> args = createArgs(trappingCallIndex);
+	std::vector<UntaggedValue> results = createUnwrittenResults();
+
+	bool trapped = false;
+	catchRuntimeExceptions(
+		[&] { invokeFunctionBatch(context, function, args.data(), numCalls, results.data()); },
+		[&](Exception* exception) {
+			trapped = getExceptionType(exception)
+					  == ExceptionTypes::integerDivideByZeroOrOverflow;
+			destroyException(exception);
+		});
+	errorUnless(trapped);
+
+	errorUnless(getNumCalls(context, numCallsGlobal) == trappingCallIndex + 1);
+	for(Uptr callIndex = 0; callIndex < numCalls; ++callIndex)
+	{
+		const UntaggedValue* callResults = results.data() + callIndex * numResults;
+		if(callIndex < trappingCallIndex) { checkCallResults(callIndex, callResults); }
+		else
+		{
+			errorUnless(isUnwritten(callResults));
+		}
+	}
+}
+
+I32 main()
+{
+	GCPointer<Compartment> compartment = createCompartment();
+	Context* context = createContext(compartment);
+	ModuleInstance* moduleInstance = instantiateTestModule(compartment);
+	Function* function = asFunctionNullable(getInstanceExport(moduleInstance, "divide"));
+	Global* numCallsGlobal = asGlobalNullable(getInstanceExport(moduleInstance, "numCalls"));
+	errorUnless(function && numCallsGlobal);
+
+	testBatch(context, function, numCallsGlobal);
+	testEmptyBatch(context, function, numCallsGlobal);
+	testTrapInBatch(context, function, numCallsGlobal);
+
+	// The batch should still work after a call in a previous batch trapped.
+	testBatch(context, function, numCallsGlobal);
+
+	function = nullptr;
+	numCallsGlobal = nullptr;
+	moduleInstance = nullptr;
+	context = nullptr;
+	errorUnless(tryCollectCompartment(std::move(compartment)));
+	return 0;
+}
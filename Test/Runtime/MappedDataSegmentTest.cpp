@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char* moduleFilename = "MappedDataSegmentTest.wasm";
+
+// The data segment covers several whole pages for any page size up to the WebAssembly page size,
+// with partial pages before and after them.
+static constexpr Uptr numMemoryPages = 5;
+static constexpr Uptr numSegmentBytes = 3 * IR::numBytesPerPage + 1000;
+
+// Appends a U32 as a LEB128 that is padded to 5 bytes, so the offsets of the following bytes don't
+// depend on its value.
+static void appendPaddedLEB(std::vector<U8>& bytes, U32 value)
+{
+	for(Uptr byteIndex = 0; byteIndex < 5; ++byteIndex)
+	{
+		bytes.push_back(U8((value & 0x7f) | (byteIndex < 4 ? 0x80 : 0)));
+		value >>= 7;
+	}
+}
+
+static U8 getSegmentByte(Uptr byteIndex) { return U8(byteIndex * 7 + 3); }
+
+// Creates a binary module with an exported memory and one active data segment. The segment's base
+// offset in the memory is a page more than its offset in the file, so the runtime may map it.
+static std::vector<U8> createModule()
+{
+	std::vector<U8> wasmBytes = {0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00};
+	wasmBytes.insert(wasmBytes.end(), {5, 0x03, 0x01, 0x00, U8(numMemoryPages)});
+	wasmBytes.insert(wasmBytes.end(),
+					 {7, 0x0a, 0x01, 0x06, 'm', 'e', 'm', 'o', 'r', 'y', 0x02, 0x00});
+
+	// The data section is: 5 byte size, 1 byte count, 1 byte flags, a 7 byte base offset
+	// expression, and a 5 byte size, followed by the segment's bytes.
+	const Uptr segmentFileOffset = wasmBytes.size() + 1 + 5 + 1 + 1 + 7 + 5;
+	wasmBytes.push_back(11);
+	appendPaddedLEB(wasmBytes, U32(1 + 1 + 7 + 5 + numSegmentBytes));
+	wasmBytes.insert(wasmBytes.end(), {0x01, 0x00, 0x41});
+	appendPaddedLEB(wasmBytes, U32(segmentFileOffset + IR::numBytesPerPage));
+	wasmBytes.push_back(0x0b);
+	appendPaddedLEB(wasmBytes, U32(numSegmentBytes));
+	errorUnless(wasmBytes.size() == segmentFileOffset);
+	for(Uptr byteIndex = 0; byteIndex < numSegmentBytes; ++byteIndex)
+	{ wasmBytes.push_back(getSegmentByte(byteIndex)); }
+	return wasmBytes;
+}
+
+static std::vector<U8> readModuleFile()
+{
+	FILE* file = fopen(moduleFilename, "rb");
+	errorUnless(file);
+	std::vector<U8> bytes;
+	U8 buffer[4096];
+	Uptr numBytesRead;
+	while((numBytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{ bytes.insert(bytes.end(), buffer, buffer + numBytesRead); }
+	fclose(file);
+	return bytes;
+}
+
+// Instantiates a module, and returns a copy of its memory's contents. If writeToMemory is true,
+// also writes to each page of the memory before copying it.
+static std::vector<U8> instantiateAndCopyMemory(IR::Module&& irModule, bool writeToMemory)
+{
+	GCPointer<Compartment> compartment = createCompartment();
+	ModuleRef module = compileModule(std::move(irModule));
+	ModuleInstance* moduleInstance = instantiateModule(compartment, module, {}, "test");
+	Memory* memory = getDefaultMemory(moduleInstance);
+	errorUnless(memory && getMemoryNumPages(memory) == numMemoryPages);
+
+	U8* memoryBytes = getMemoryBaseAddress(memory);
+	const Uptr numMemoryBytes = numMemoryPages * IR::numBytesPerPage;
+	if(writeToMemory)
+	{
+		for(Uptr offset = 0; offset < numMemoryBytes; offset += 4096)
+		{ memoryBytes[offset] ^= 0xff; }
+	}
+	std::vector<U8> contents(memoryBytes, memoryBytes + numMemoryBytes);
+
+	moduleInstance = nullptr;
+	memory = nullptr;
+	errorUnless(tryCollectCompartment(std::move(compartment)));
+	return contents;
+}
+
+static void testMappedDataSegment(const std::vector<U8>& wasmBytes)
+{
+	// The memory contents of a module loaded from a file with mapped data segments should be the
+	// same as when the segment is copied from a module loaded from the same bytes.
+	IR::Module copiedIRModule;
+	errorUnless(WASM::loadBinaryModule(wasmBytes.data(), wasmBytes.size(), copiedIRModule));
+	const std::vector<U8> copiedContents
+		= instantiateAndCopyMemory(std::move(copiedIRModule), false);
+
+	IR::Module mappedIRModule;
+	errorUnless(WASM::loadBinaryModuleFromFile(
+		moduleFilename, mappedIRModule, Log::error, WASM::FunctionBodyDecoding::eager, 1, true));
+	errorUnless(mappedIRModule.dataSegments.size() == 1);
+	errorUnless(mappedIRModule.dataSegments[0].mappedFile);
+	errorUnless(mappedIRModule.dataSegments[0].mappedFile->mapDataSegments);
+	const std::vector<U8> mappedContents
+		= instantiateAndCopyMemory(std::move(mappedIRModule), false);
+
+	errorUnless(mappedContents == copiedContents);
+	const Uptr segmentBaseOffset = wasmBytes.size() - numSegmentBytes + IR::numBytesPerPage;
+	for(Uptr offset = 0; offset < mappedContents.size(); ++offset)
+	{
+		const bool isInSegment
+			= offset >= segmentBaseOffset && offset < segmentBaseOffset + numSegmentBytes;
+		errorUnless(mappedContents[offset]
+					== (isInSegment ? getSegmentByte(offset - segmentBaseOffset) : 0));
+	}
+}
+
+static void testWritesDontChangeFile(const std::vector<U8>& wasmBytes)
+{
+	// Writing to the mapped pages of a memory should only change the memory, not the file.
+	IR::Module mappedIRModule;
+	errorUnless(WASM::loadBinaryModuleFromFile(
+		moduleFilename, mappedIRModule, Log::error, WASM::FunctionBodyDecoding::eager, 1, true));
+	const std::vector<U8> writtenContents
+		= instantiateAndCopyMemory(std::move(mappedIRModule), true);
+
+	const Uptr segmentBaseOffset = wasmBytes.size() - numSegmentBytes + IR::numBytesPerPage;
+	const Uptr mappedPageOffset = 2 * IR::numBytesPerPage;
+	errorUnless(writtenContents[0] == 0xff);
+	errorUnless(writtenContents[mappedPageOffset]
+				== U8(getSegmentByte(mappedPageOffset - segmentBaseOffset) ^ 0xff));
+	errorUnless(readModuleFile() == wasmBytes);
+}
+
+I32 main()
+{
+	const std::vector<U8> wasmBytes = createModule();
+	FILE* file = fopen(moduleFilename, "wb");
+	errorUnless(file);
+	errorUnless(fwrite(wasmBytes.data(), 1, wasmBytes.size(), file) == wasmBytes.size());
+	errorUnless(!fclose(file));
+
+	testMappedDataSegment(wasmBytes);
+	testWritesDontChangeFile(wasmBytes);
+
+	remove(moduleFilename);
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include <string.h>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/Runtime/TypedFunction.h"
+#include "WAVM/WASTParse/WASTParse.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// Functions with a mix of parameter and result types, to check that TypedFunction lays out the
+// arguments in the same places as the invoke thunks expect them.
+static const char* testModuleWAST = R"(
+	(module
+		(global $lastI64 (export "lastI64") (mut i64) (i64.const 0))
+
+		(func (export "f64FromMixed") (param i32 i64 f32 f64) (result f64)
+			(f64.add (f64.add (f64.convert_i32_s (local.get 0)) (f64.convert_i64_s (local.get 1)))
+					 (f64.add (f64.promote_f32 (local.get 2)) (local.get 3))))
+
+		(func (export "i64FromMixed") (param f64 i32 i64 f32) (result i64)
+			(i64.add (i64.add (i64.trunc_f64_s (local.get 0)) (i64.extend_i32_u (local.get 1)))
+					 (i64.add (local.get 2) (i64.trunc_f32_s (local.get 3)))))
+
+		(func (export "f32FromMixed") (param i64 f32) (result f32)
+			(f32.mul (f32.convert_i64_s (local.get 0)) (local.get 1)))
+
+		(func (export "i32FromMixed") (param f32 f64 i32) (result i32)
+			(i32.sub (i32.trunc_f32_s (local.get 0))
+					 (i32.add (i32.trunc_f64_s (local.get 1)) (local.get 2))))
+
+		(func (export "setLastI64") (param i64)
+			(global.set $lastI64 (local.get 0)))
+	)
+)";
+
+static ModuleInstance* instantiateTestModule(Compartment* compartment)
+{
+	IR::Module irModule;
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule(testModuleWAST, strlen(testModuleWAST) + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors("testModuleWAST", parseErrors);
+		Errors::fatal("Couldn't parse the test module");
+	}
+	return instantiateModule(compartment, compileModule(std::move(irModule)), {}, "test");
+}
+
+static Function* getExportedFunction(ModuleInstance* moduleInstance, const char* name)
+{
+	Function* function = asFunctionNullable(getInstanceExport(moduleInstance, name));
+	errorUnless(function);
+	return function;
+}
+
+// Calls thunk, and returns whether it threw an invokeSignatureMismatch exception.
+static bool throwsSignatureMismatch(const std::function<void()>& thunk)
+{
+	bool threwSignatureMismatch = false;
+	catchRuntimeExceptions(thunk, [&](Exception* exception) {
+		threwSignatureMismatch
+			= getExceptionType(exception) == ExceptionTypes::invokeSignatureMismatch;
+		destroyException(exception);
+	});
+	return threwSignatureMismatch;
+}
+
+static void testMixedTypes(Context* context, ModuleInstance* moduleInstance)
+{
+	TypedFunction<F64(I32, I64, F32, F64)> f64FromMixed(
+		context, getExportedFunction(moduleInstance, "f64FromMixed"));
+	errorUnless(f64FromMixed(-3, I64(1) << 40, 0.5f, 0.25) == 1099511627773.75);
+
+	// The i64 argument is aligned to 8 bytes after the i32 argument.
+	TypedFunction<I64(F64, I32, I64, F32)> i64FromMixed(
+		context, getExportedFunction(moduleInstance, "i64FromMixed"));
+	errorUnless(i64FromMixed(1500.75, -1, -5, 2.5f) == 1500 + I64(0xffffffff) - 5 + 2);
+
+	TypedFunction<F32(I64, F32)> f32FromMixed(context,
+											  getExportedFunction(moduleInstance, "f32FromMixed"));
+	errorUnless(f32FromMixed(-6, 0.5f) == -3.0f);
+
+	// An I16 argument is sign-extended to the function's i32 parameter.
+	TypedFunction<I32(F32, F64, I16)> i32FromMixed(
+		context, getExportedFunction(moduleInstance, "i32FromMixed"));
+	errorUnless(i32FromMixed(7.9f, -2.5, I16(-100)) == 7 - (-2 - 100));
+
+	// Invoking a TypedFunction again should write the new arguments over the old ones.
+	errorUnless(i32FromMixed(1.0f, 2.0, I16(3)) == 1 - (2 + 3));
+
+	TypedFunction<void(I64)> setLastI64(context,
+										getExportedFunction(moduleInstance, "setLastI64"));
+	setLastI64(I64(0x123456789abcdef0));
+	Global* lastI64 = asGlobalNullable(getInstanceExport(moduleInstance, "lastI64"));
+	errorUnless(lastI64);
+	const IR::Value lastI64Value = getGlobalValue(context, lastI64);
+	errorUnless(lastI64Value.type == ValueType::i64 && lastI64Value.i64 == 0x123456789abcdef0);
+}
+
+static void testSignatureMismatch(Context* context, ModuleInstance* moduleInstance)
+{
+	Function* f64FromMixed = getExportedFunction(moduleInstance, "f64FromMixed");
+	Function* setLastI64 = getExportedFunction(moduleInstance, "setLastI64");
+
+	// The parameter types are in the wrong order.
+	errorUnless(throwsSignatureMismatch(
+		[&] { TypedFunction<F64(I64, I32, F32, F64)> typedFunction(context, f64FromMixed); }));
+
+	// There are too few parameters.
+	errorUnless(throwsSignatureMismatch(
+		[&] { TypedFunction<F64(I32, I64, F32)> typedFunction(context, f64FromMixed); }));
+
+	// The result type is wrong.
+	errorUnless(throwsSignatureMismatch(
+		[&] { TypedFunction<F32(I32, I64, F32, F64)> typedFunction(context, f64FromMixed); }));
+
+	// The function doesn't have a result.
+	errorUnless(throwsSignatureMismatch(
+		[&] { TypedFunction<I64(I64)> typedFunction(context, setLastI64); }));
+
+	// Binding with the right signature shouldn't throw.
+	errorUnless(!throwsSignatureMismatch(
+		[&] { TypedFunction<F64(I32, I64, F32, F64)> typedFunction(context, f64FromMixed); }));
+}
+
+I32 main()
+{
+	GCPointer<Compartment> compartment = createCompartment();
+	Context* context = createContext(compartment);
+	ModuleInstance* moduleInstance = instantiateTestModule(compartment);
+
+	testMixedTypes(context, moduleInstance);
+	testSignatureMismatch(context, moduleInstance);
+
+	moduleInstance = nullptr;
+	context = nullptr;
+	errorUnless(tryCollectCompartment(std::move(compartment)));
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Operators.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/WASM/WASM.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+// The loader logs errors, so the test logs them to stdout, redirects stdout to this file, and reads
+// the errors back from it.
+static const char* outputFilename = "LoadBinaryModuleTest.out";
+
+// The code of some function bodies, without their local declarations.
+static const std::vector<U8> validCode = {0x0b};
+static const std::vector<U8> branchTableCode
+	= {0x02, 0x40, 0x41, 0x00, 0x0e, 0x01, 0x00, 0x00, 0x0b, 0x0b};
+static const std::vector<U8> i32AddWithoutOperandsCode = {0x6a, 0x0b};
+static const std::vector<U8> dropWithoutOperandsCode = {0x1a, 0x0b};
+
+static void appendSection(std::vector<U8>& wasmBytes, U8 sectionId, const std::vector<U8>& bytes)
+{
+	errorUnless(bytes.size() < 128);
+	wasmBytes.push_back(sectionId);
+	wasmBytes.push_back(U8(bytes.size()));
+	wasmBytes.insert(wasmBytes.end(), bytes.begin(), bytes.end());
+}
+
+// Creates a binary module with a function definition of type ()->() for each function body code.
+static std::vector<U8> createModule(const std::vector<std::vector<U8>>& codes)
+{
+	errorUnless(codes.size() < 128);
+	std::vector<U8> wasmBytes = {0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00};
+	appendSection(wasmBytes, 1, {0x01, 0x60, 0x00, 0x00});
+
+	std::vector<U8> functionSection = {U8(codes.size())};
+	functionSection.insert(functionSection.end(), codes.size(), 0x00);
+	appendSection(wasmBytes, 3, functionSection);
+
+	// The code section is built separately, since it may be larger than the other sections.
+	std::vector<U8> codeSection = {U8(codes.size())};
+	for(const std::vector<U8>& code : codes)
+	{
+		errorUnless(code.size() + 1 < 128);
+		codeSection.push_back(U8(code.size() + 1));
+		codeSection.push_back(0x00);
+		codeSection.insert(codeSection.end(), code.begin(), code.end());
+	}
+	wasmBytes.push_back(10);
+	for(Uptr numBytes = codeSection.size(); true; numBytes >>= 7)
+	{
+		wasmBytes.push_back(U8((numBytes & 0x7f) | (numBytes >= 0x80 ? 0x80 : 0)));
+		if(numBytes < 0x80) { break; }
+	}
+	wasmBytes.insert(wasmBytes.end(), codeSection.begin(), codeSection.end());
+	return wasmBytes;
+}
+
+// Loads a module, and returns whether it loaded, and the errors the loader logged.
+static bool loadModule(const std::vector<U8>& wasmBytes,
+					   Module& outModule,
+					   WASM::FunctionBodyDecoding functionBodyDecoding,
+					   std::string& outErrors,
+					   Uptr numDecodeThreads = 1)
+{
+	fflush(stdout);
+	FILE* file = fopen(outputFilename, "rb");
+	errorUnless(file);
+	errorUnless(!fseek(file, 0, SEEK_END));
+	const long numPreviousOutputBytes = ftell(file);
+
+	const bool loaded = WASM::loadBinaryModule(wasmBytes.data(),
+											   wasmBytes.size(),
+											   outModule,
+											   Log::output,
+											   functionBodyDecoding,
+											   numDecodeThreads);
+	fflush(stdout);
+
+	errorUnless(!fseek(file, numPreviousOutputBytes, SEEK_SET));
+	outErrors.clear();
+	char buffer[4096];
+	Uptr numBytesRead;
+	while((numBytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{ outErrors.append(buffer, numBytesRead); }
+	fclose(file);
+	return loaded;
+}
+
+static void testLazyInvalidBody()
+{
+	// A lazily loaded function body should still be validated when the module is loaded, and the
+	// error should be the same as when it is loaded eagerly.
+	const std::vector<U8> wasmBytes
+		= createModule({validCode, i32AddWithoutOperandsCode, branchTableCode});
+
+	Module eagerModule;
+	std::string eagerErrors;
+	errorUnless(
+		!loadModule(wasmBytes, eagerModule, WASM::FunctionBodyDecoding::eager, eagerErrors));
+	errorUnless(eagerErrors.find("Error validating WebAssembly binary file") != std::string::npos);
+
+	Module lazyModule;
+	std::string lazyErrors;
+	errorUnless(!loadModule(wasmBytes, lazyModule, WASM::FunctionBodyDecoding::lazy, lazyErrors));
+	errorUnless(lazyErrors == eagerErrors);
+}
+
+static void testLazyValidBodies()
+{
+	// Materializing a lazily loaded module should produce the same code as loading it eagerly.
+	const std::vector<U8> wasmBytes = createModule({validCode, branchTableCode, validCode});
+
+	Module eagerModule;
+	std::string errors;
+	errorUnless(loadModule(wasmBytes, eagerModule, WASM::FunctionBodyDecoding::eager, errors));
+
+	Module lazyModule;
+	errorUnless(loadModule(wasmBytes, lazyModule, WASM::FunctionBodyDecoding::lazy, errors));
+	errorUnless(lazyModule.lazyFunctionBodies);
+	for(const FunctionDef& functionDef : lazyModule.functions.defs)
+	{
+		errorUnless(functionDef.isLazy.value.load());
+		errorUnless(functionDef.code.empty() && functionDef.branchTables.empty());
+	}
+
+	materializeFunctionDefs(lazyModule);
+
+	// The fixed operator encoding may include uninitialized padding, so compare the code in the
+	// compact encoding.
+	setOperatorEncoding(eagerModule, OperatorEncoding::compact);
+	setOperatorEncoding(lazyModule, OperatorEncoding::compact);
+	errorUnless(lazyModule.functions.defs.size() == eagerModule.functions.defs.size());
+	for(Uptr functionDefIndex = 0; functionDefIndex < lazyModule.functions.defs.size();
+		++functionDefIndex)
+	{
+		const FunctionDef& lazyFunctionDef = lazyModule.functions.defs[functionDefIndex];
+		const FunctionDef& eagerFunctionDef = eagerModule.functions.defs[functionDefIndex];
+		errorUnless(!lazyFunctionDef.isLazy.value.load());
+		errorUnless(lazyFunctionDef.code == eagerFunctionDef.code);
+		errorUnless(lazyFunctionDef.branchTables == eagerFunctionDef.branchTables);
+	}
+}
+
+static void testParallelInvalidBodies()
+{
+	// When the function bodies are deserialized on multiple threads, the error should be the same
+	// as when they are deserialized on this thread: the error for the first invalid body.
+	std::vector<std::vector<U8>> codes(64, validCode);
+	codes[5] = i32AddWithoutOperandsCode;
+	codes[17] = dropWithoutOperandsCode;
+	codes[40] = i32AddWithoutOperandsCode;
+	codes[60] = dropWithoutOperandsCode;
+	const std::vector<U8> wasmBytes = createModule(codes);
+
+	for(WASM::FunctionBodyDecoding functionBodyDecoding :
+		{WASM::FunctionBodyDecoding::eager, WASM::FunctionBodyDecoding::lazy})
+	{
+		Module serialModule;
+		std::string serialErrors;
+		errorUnless(!loadModule(wasmBytes, serialModule, functionBodyDecoding, serialErrors, 1));
+		errorUnless(serialErrors.find("Error validating WebAssembly binary file")
+					!= std::string::npos);
+
+		for(Uptr numDecodeThreads : {Uptr(4), Uptr(0)})
+		{
+			Module parallelModule;
+			std::string parallelErrors;
+			errorUnless(!loadModule(
+				wasmBytes, parallelModule, functionBodyDecoding, parallelErrors, numDecodeThreads));
+			errorUnless(parallelErrors == serialErrors);
+		}
+	}
+}
+
+I32 main()
+{
+	errorUnless(freopen(outputFilename, "wb", stdout));
+
+	testLazyInvalidBody();
+	testLazyValidBodies();
+	testParallelInvalidBodies();
+
+	fclose(stdout);
+	remove(outputFilename);
+	return 0;
+}
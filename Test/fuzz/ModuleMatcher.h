@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string.h>
+
 #include "WAVM/IR/Module.h"
 #include "WAVM/IR/Operators.h"
 #include "WAVM/Inline/Assert.h"
@@ -13,6 +15,10 @@ namespace WAVM {
 
 		void verify()
 		{
+			// The function definitions' code is compared byte-wise in the fixed operator encoding.
+			wavmAssert(aModule.operatorEncoding == OperatorEncoding::fixed);
+			wavmAssert(bModule.operatorEncoding == OperatorEncoding::fixed);
+
 			verifyMatches(aModule.functions, bModule.functions);
 			verifyMatches(aModule.tables, bModule.tables);
 			verifyMatches(aModule.memories, bModule.memories);
@@ -30,7 +36,8 @@ namespace WAVM {
 				if(segment.isActive
 				   && (segment.memoryIndex != wastSegment.memoryIndex
 					   || segment.baseOffset != wastSegment.baseOffset
-					   || segment.data != wastSegment.data))
+					   || segment.getNumBytes() != wastSegment.getNumBytes()
+					   || memcmp(segment.getBytes(), wastSegment.getBytes(), segment.getNumBytes())))
 				{ failVerification(); }
 			}
 
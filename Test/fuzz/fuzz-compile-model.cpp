@@ -827,7 +827,7 @@ extern "C" I32 LLVMFuzzerTestOneInput(const U8* data, Uptr numBytes)
 {
 	IR::Module module;
 	generateValidModule(module, data, numBytes);
-	compileModule(module);
+	compileModule(std::move(module));
 
 	return 0;
 }
@@ -855,7 +855,7 @@ I32 main(int argc, char** argv)
 	std::string wastString = WAST::print(module);
 	Log::printf(Log::Category::debug, "Generated module WAST:\n%s\n", wastString.c_str());
 
-	compileModule(module);
+	compileModule(std::move(module));
 
 	return EXIT_SUCCESS;
 }
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <utility>
 #include <vector>
 
 #include "WAVM/IR/IR.h"
@@ -22,7 +23,7 @@ extern "C" I32 LLVMFuzzerTestOneInput(const U8* data, Uptr numBytes)
 	module.featureSpec.maxDataSegments = 65536;
 	if(!WASM::loadBinaryModule(data, numBytes, module, Log::debug)) { return 0; }
 
-	compileModule(module);
+	compileModule(std::move(module));
 
 	return 0;
 }
@@ -79,7 +79,7 @@ struct StubResolver : Runtime::Resolver
 
 			// Instantiate the module and return the stub function instance.
 			auto stubModuleInstance = Runtime::instantiateModule(
-				compartment, Runtime::compileModule(stubModule), {}, "importStub");
+				compartment, Runtime::compileModule(std::move(stubModule)), {}, "importStub");
 			return getInstanceExport(stubModuleInstance, "importStub");
 		}
 		case IR::ExternKind::memory:
@@ -122,7 +122,7 @@ extern "C" I32 LLVMFuzzerTestOneInput(const U8* data, Uptr numBytes)
 		catchRuntimeExceptions(
 			[&] {
 				instantiateModule(compartment,
-								  compileModule(module),
+								  compileModule(std::move(module)),
 								  std::move(linkResult.resolvedImports),
 								  "fuzz");
 			},